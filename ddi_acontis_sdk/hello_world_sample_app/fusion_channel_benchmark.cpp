@@ -0,0 +1,136 @@
+#include "ddi_sdk_common.h"
+#include "ddi_sdk_fusion_interface.h"
+#include "ddi_status.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//compares the per-channel Fusion accessors against the bulk accessors
+//the instance is built over a local process data buffer, no EtherCAT master or hardware is needed
+
+int ddi_log_level = 3;
+
+#define BENCH_CHANNELS   64
+#define BENCH_ITERATIONS 1000000
+#define BENCH_PD_SIZE    1024
+
+static uint8_t pd_input[BENCH_PD_SIZE];
+static uint8_t pd_output[BENCH_PD_SIZE];
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//lay out the channels as 16-bit entries, stride is the distance between two entries in bytes
+static void setup_channels(ddi_fusion_instance_t *instance, uint16_t count, uint16_t stride)
+{
+  uint16_t i;
+  fusion_pd_desc_t desc;
+
+  memset(&desc, 0, sizeof(desc));
+  desc.size = 2;
+  desc.pd_input = pd_input;
+  desc.pd_output = pd_output;
+  for (i = 0; i < count; i++)
+  {
+    desc.byte_offset = i * stride;
+    instance->din_desc[i]  = desc;
+    instance->dout_desc[i] = desc;
+    instance->ain_desc[i]  = desc;
+    instance->aout_desc[i] = desc;
+  }
+  instance->din_count  = count;
+  instance->dout_count = count;
+  instance->ain_count  = count;
+  instance->aout_count = count;
+  ddi_sdk_fusion_update_layout(instance);
+}
+
+static void run_benchmark(ddi_fusion_instance_t *instance, const char *layout)
+{
+  static uint16_t values[BENCH_CHANNELS];
+  uint64_t start, single_ns, bulk_ns;
+  uint32_t iteration, count;
+  uint16_t length;
+  volatile uint16_t sink = 0;
+
+  for (count = 0; count < BENCH_CHANNELS; count++)
+    values[count] = count;
+
+  //outputs: one call per channel
+  start = now_ns();
+  for (iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+  {
+    values[0] = iteration;
+    for (count = 0; count < instance->aout_count; count++)
+      ddi_sdk_fusion_set_aout(instance, count, values[count]);
+    for (count = 0; count < instance->dout_count; count++)
+      ddi_sdk_fusion_set_dout16(instance, count, values[count]);
+  }
+  single_ns = now_ns() - start;
+
+  //outputs: one call per channel type
+  start = now_ns();
+  for (iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+  {
+    values[0] = iteration;
+    ddi_sdk_fusion_set_aout_all(instance, values, BENCH_CHANNELS);
+    ddi_sdk_fusion_set_dout16_all(instance, values, BENCH_CHANNELS);
+  }
+  bulk_ns = now_ns() - start;
+  printf("%-14s outputs: per-channel %8.1f ns/cycle, bulk %8.1f ns/cycle, %.1fx\n", layout,
+         (double)single_ns / BENCH_ITERATIONS, (double)bulk_ns / BENCH_ITERATIONS, (double)single_ns / bulk_ns);
+
+  //inputs: one call per channel
+  start = now_ns();
+  for (iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+  {
+    for (count = 0; count < instance->ain_count; count++)
+      values[count] = ddi_sdk_fusion_get_ain(instance, count);
+    for (count = 0; count < instance->din_count; count++)
+      values[count] += ddi_sdk_fusion_get_din(instance, count, &length);
+    sink += values[iteration % BENCH_CHANNELS];
+  }
+  single_ns = now_ns() - start;
+
+  //inputs: one call per channel type
+  start = now_ns();
+  for (iteration = 0; iteration < BENCH_ITERATIONS; iteration++)
+  {
+    ddi_sdk_fusion_get_ain_all(instance, values, BENCH_CHANNELS);
+    ddi_sdk_fusion_get_din16_all(instance, values, BENCH_CHANNELS);
+    sink += values[iteration % BENCH_CHANNELS];
+  }
+  bulk_ns = now_ns() - start;
+  printf("%-14s inputs:  per-channel %8.1f ns/cycle, bulk %8.1f ns/cycle, %.1fx\n", layout,
+         (double)single_ns / BENCH_ITERATIONS, (double)bulk_ns / BENCH_ITERATIONS, (double)single_ns / bulk_ns);
+  (void)sink;
+}
+
+int main(int argc, char *argv[])
+{
+  ddi_fusion_instance_t *instance;
+
+  //the instance holds the descriptor tables, keep it off the stack
+  instance = (ddi_fusion_instance_t *)calloc(1, sizeof(ddi_fusion_instance_t));
+  if (!instance)
+  {
+    printf("unable to allocate the fusion instance\n");
+    return -1;
+  }
+
+  printf("%d channels of each type, %d cycles\n", BENCH_CHANNELS, BENCH_ITERATIONS);
+  //entries back to back, the bulk accessors use one memcpy per channel type
+  setup_channels(instance, BENCH_CHANNELS, 2);
+  run_benchmark(instance, "contiguous");
+  //a status word between the entries, the bulk accessors walk the descriptors
+  setup_channels(instance, BENCH_CHANNELS, 4);
+  run_benchmark(instance, "interleaved");
+
+  free(instance);
+  return 0;
+}
@@ -44,6 +44,13 @@ typedef struct
 
   uint8_t   is_allocated;      /**< Is this instance free or allocated (0 = free, 1 = allocated) */
 
+  /* set when every channel of the type is a 16-bit entry directly following the previous one,
+     the bulk accessors then copy all channels with one memcpy */
+  uint8_t   dout_contiguous;   /**< The DO PDO entries are contiguous 16-bit entries */
+  uint8_t   din_contiguous;    /**< The DI PDO entries are contiguous 16-bit entries */
+  uint8_t   aout_contiguous;   /**< The AO PDO entries are contiguous 16-bit entries */
+  uint8_t   ain_contiguous;    /**< The AI PDO entries are contiguous 16-bit entries */
+
   //process data descriptor section
   fusion_pd_desc_t aout_desc[DDI_FUSION_MAX_MODULES];
   fusion_pd_desc_t ain_desc[DDI_FUSION_MAX_MODULES];
@@ -156,6 +163,39 @@ void ddi_sdk_fusion_set_aout    (ddi_fusion_instance_t *instance, uint32_t index
  */
 uint16_t ddi_sdk_fusion_get_ain (ddi_fusion_instance_t *instance, uint32_t index );
 
+/** ddi_sdk_fusion_update_layout
+ * Check which channel types of an instance are stored as contiguous 16-bit entries in the process data.
+ * This is done when the instance is opened, call it again after modifying the channel descriptors.
+ *
+ * @param instance the fusion instance to operate on
+ * @return void
+ */
+void ddi_sdk_fusion_update_layout (ddi_fusion_instance_t *instance);
+
+/** ddi_sdk_fusion_set_aout_all
+ * Set all aout channels of an instance from a contiguous array in one call. values[0] is written to aout channel 0,
+ * values[1] to channel 1 and so on. Use this instead of calling ddi_sdk_fusion_set_aout() for every channel.
+ *
+ * Example: ddi_sdk_fusion_set_aout_all (instance, values, instance->aout_count) will set every aout channel.
+ *
+ * @param instance the fusion instance to operate on
+ * @param values the aout values, one per channel
+ * @param count the number of entries in values
+ * @return uint32_t the number of channels written, the smaller of count and aout_count
+ */
+uint32_t ddi_sdk_fusion_set_aout_all (ddi_fusion_instance_t *instance, const uint16_t *values, uint32_t count);
+
+/** ddi_sdk_fusion_get_ain_all
+ * Get all ain channels of an instance into a contiguous array in one call. values[0] receives ain channel 0,
+ * values[1] channel 1 and so on. Use this instead of calling ddi_sdk_fusion_get_ain() for every channel.
+ *
+ * @param instance the fusion instance to operate on
+ * @param values the array receiving the ain values, one per channel
+ * @param max_count the number of entries in values
+ * @return uint32_t the number of channels read, the smaller of max_count and ain_count
+ */
+uint32_t ddi_sdk_fusion_get_ain_all (ddi_fusion_instance_t *instance, uint16_t *values, uint32_t max_count);
+
 /** ddi_sdk_fusion_set_dout8
  * Set a DOUT 8 bit value.  This function will set the dout value represented in the slot
  * poitned to by index. For example, to retreive DOUT 2 of a Fusion,
@@ -188,6 +228,17 @@ void ddi_sdk_fusion_set_dout8   (ddi_fusion_instance_t *instance, uint32_t index
  */
 void ddi_sdk_fusion_set_dout16  (ddi_fusion_instance_t *instance, uint32_t index, uint16_t  value );
 
+/** ddi_sdk_fusion_set_dout16_all
+ * Set all 16-bit dout values of an instance from a contiguous array in one call. values[0] is written to dout 0,
+ * values[1] to dout 1 and so on. Use this instead of calling ddi_sdk_fusion_set_dout16() for every dout.
+ *
+ * @param instance the fusion instance to operate on
+ * @param values the dout values, one per dout
+ * @param count the number of entries in values
+ * @return uint32_t the number of douts written, the smaller of count and dout_count
+ */
+uint32_t ddi_sdk_fusion_set_dout16_all (ddi_fusion_instance_t *instance, const uint16_t *values, uint32_t count);
+
 /** ddi_sdk_fusion_get_din8
  * Get a DIN 8-bit value.  This function will retreive the value represented in the slot
  * poitned to by index. For example, to retreive DIN 5 of a Fusion,
@@ -220,6 +271,17 @@ uint8_t ddi_sdk_fusion_get_din8    (ddi_fusion_instance_t *instance, uint32_t in
  */
 uint16_t ddi_sdk_fusion_get_din16   (ddi_fusion_instance_t *instance, uint32_t index, uint16_t  *value);
 
+/** ddi_sdk_fusion_get_din16_all
+ * Get all 16-bit DIN values of an instance into a contiguous array in one call. values[0] receives DIN 0,
+ * values[1] DIN 1 and so on. Use this instead of calling ddi_sdk_fusion_get_din16() for every DIN.
+ *
+ * @param instance the fusion instance to operate on
+ * @param values the array receiving the DIN values, one per DIN
+ * @param max_count the number of entries in values
+ * @return uint32_t the number of DINs read, the smaller of max_count and din_count
+ */
+uint32_t ddi_sdk_fusion_get_din16_all (ddi_fusion_instance_t *instance, uint16_t *values, uint32_t max_count);
+
 /** ddi_sdk_fusion_get_din16
  * Get a DIN 8-bit or 16-bit value.  This function will retreive the value represented in the slot
  * poitned to by index. For example, to retreive DIN 5 of a Fusion,
@@ -200,6 +200,107 @@ uint16_t ddi_sdk_fusion_get_din16 (ddi_fusion_instance_t *instance, uint32_t ind
   return *mem_ptr;
 }
 
+uint32_t ddi_sdk_fusion_set_aout_all (ddi_fusion_instance_t *instance, const uint16_t *values, uint32_t count)
+{
+  uint32_t index;
+  if (count > instance->aout_count)
+    count = instance->aout_count;
+  if (count == 0)
+    return 0;
+  //one copy when the aout entries follow each other in the process data
+  if (instance->aout_contiguous)
+  {
+    memcpy(&instance->aout_desc[0].pd_output[instance->aout_desc[0].byte_offset], values, count * sizeof(uint16_t));
+    return count;
+  }
+  for (index = 0; index < count; index++)
+  {
+    fusion_pd_desc_t *desc = &instance->aout_desc[index];
+    memcpy(&desc->pd_output[desc->byte_offset], &values[index], sizeof(uint16_t));
+  }
+  return count;
+}
+
+uint32_t ddi_sdk_fusion_get_ain_all (ddi_fusion_instance_t *instance, uint16_t *values, uint32_t max_count)
+{
+  uint32_t index;
+  if (max_count > instance->ain_count)
+    max_count = instance->ain_count;
+  if (max_count == 0)
+    return 0;
+  if (instance->ain_contiguous)
+  {
+    memcpy(values, &instance->ain_desc[0].pd_input[instance->ain_desc[0].byte_offset], max_count * sizeof(uint16_t));
+    return max_count;
+  }
+  for (index = 0; index < max_count; index++)
+  {
+    fusion_pd_desc_t *desc = &instance->ain_desc[index];
+    memcpy(&values[index], &desc->pd_input[desc->byte_offset], sizeof(uint16_t));
+  }
+  return max_count;
+}
+
+uint32_t ddi_sdk_fusion_set_dout16_all (ddi_fusion_instance_t *instance, const uint16_t *values, uint32_t count)
+{
+  uint32_t index;
+  if (count > instance->dout_count)
+    count = instance->dout_count;
+  if (count == 0)
+    return 0;
+  if (instance->dout_contiguous)
+  {
+    memcpy(&instance->dout_desc[0].pd_output[instance->dout_desc[0].byte_offset], values, count * sizeof(uint16_t));
+    return count;
+  }
+  for (index = 0; index < count; index++)
+  {
+    fusion_pd_desc_t *desc = &instance->dout_desc[index];
+    memcpy(&desc->pd_output[desc->byte_offset], &values[index], sizeof(uint16_t));
+  }
+  return count;
+}
+
+uint32_t ddi_sdk_fusion_get_din16_all (ddi_fusion_instance_t *instance, uint16_t *values, uint32_t max_count)
+{
+  uint32_t index;
+  if (max_count > instance->din_count)
+    max_count = instance->din_count;
+  if (max_count == 0)
+    return 0;
+  if (instance->din_contiguous)
+  {
+    memcpy(values, &instance->din_desc[0].pd_input[instance->din_desc[0].byte_offset], max_count * sizeof(uint16_t));
+    return max_count;
+  }
+  for (index = 0; index < max_count; index++)
+  {
+    fusion_pd_desc_t *desc = &instance->din_desc[index];
+    memcpy(&values[index], &desc->pd_input[desc->byte_offset], sizeof(uint16_t));
+  }
+  return max_count;
+}
+
+//check if count 16-bit entries directly follow each other in the process data
+static uint8_t pd_desc_contiguous(fusion_pd_desc_t *desc, uint16_t count)
+{
+  uint16_t i;
+  for (i = 0; i < count; i++)
+  {
+    if ((desc[i].size != 2) || (desc[i].byte_offset != desc[0].byte_offset + 2 * i))
+      return 0;
+  }
+  return 1;
+}
+
+void ddi_sdk_fusion_update_layout (ddi_fusion_instance_t *instance)
+{
+  instance->din_contiguous  = pd_desc_contiguous(instance->din_desc,  instance->din_count);
+  instance->dout_contiguous = pd_desc_contiguous(instance->dout_desc, instance->dout_count);
+  instance->ain_contiguous  = pd_desc_contiguous(instance->ain_desc,  instance->ain_count);
+  instance->aout_contiguous = pd_desc_contiguous(instance->aout_desc, instance->aout_count);
+}
+
 uint16_t ddi_sdk_fusion_get_din (ddi_fusion_instance_t *instance, uint32_t index, uint16_t *length )
 {
   if (instance->din_desc[index].size == 2)
@@ -340,6 +441,7 @@ ddi_status_t ddi_sdk_fusion_close(ddi_fusion_instance_t *instance)
   instance->douts      = 0;
   instance->ains       = 0;
   instance->aouts      = 0;
+  ddi_sdk_fusion_update_layout(instance);
   instance->slave->allocated = 0;
   return ddi_status_ok;
 }
@@ -526,5 +628,8 @@ static uint32_t ddi_sdk_ecat_scan_slave(ddi_fusion_instance_t *instance)
   DLOG("%d\tDI %p\n", instance->din_count,  instance->dins);
   DLOG("%d\tAI %p\n", instance->ain_count,  instance->ains);
 
+  //check which channel types the bulk accessors can copy in one go
+  ddi_sdk_fusion_update_layout(instance);
+
   return status;
 }
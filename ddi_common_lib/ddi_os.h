@@ -142,6 +142,12 @@ ddi_status_t ddi_mutex_lock(ddi_mutex_handle_t handle, uint32_t timeout_ms);
  */
 ddi_status_t ddi_mutex_unlock(ddi_mutex_handle_t handle);
 
+/** @brief Frees a mutex and its internally allocated resources, the mutex must be unlocked
+ * @param handle The ddi_mutex_handle_t which was returned when the mutex was created.
+ * @return ddi_status_ok if successful; ddi_status_param_err if the mutex handle is invalid.
+ */
+ddi_status_t ddi_mutex_free(ddi_mutex_handle_t handle);
+
 /** @brief Creates a new counting semaphore
  * @param phandle Pointer to a ddi_semaphore_handle_t which receives the handle of the newly created semaphore.
  * @param max_count The highest count which the semaphore may be incremented to.
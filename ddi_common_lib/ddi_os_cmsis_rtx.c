@@ -211,6 +211,16 @@ ddi_status_t ddi_mutex_unlock(ddi_mutex_handle_t handle)
   return ddi_status_ok;
 }
 
+ddi_status_t ddi_mutex_free(ddi_mutex_handle_t handle)
+{
+  ddi_mutex_t *mutex = (ddi_mutex_t *)handle;
+  if (mutex == NULL)
+    return ddi_status_param_err;
+  osMutexDelete(mutex->id);
+  free(mutex);
+  return ddi_status_ok;
+}
+
 /*
  * Semaphores
  */
@@ -14,6 +14,7 @@ prior written authorization of DDI is prohibited.
 #include <stdlib.h>
 #include <unistd.h>
 #include "ddi_em_platform.h"
+#include "ddi_em_capture.h"
 
 // The ddi_em_platform.h file adds support for platform-specific features
 // The ddi_em_platform.h file should be soft-linked to one of the files in the hw_platforms directory
@@ -288,6 +289,47 @@ typedef enum {
 */
 #define DDI_EM_DEFAULT_CYCLIC_RATE       1000
 
+/*! @enum ddi_em_sched_policy
+  @brief Scheduling policy of the cyclic thread
+
+  DDI_EM_SCHED_RR is the default and matches the behavior of previous SDK releases.
+  DDI_EM_SCHED_DEADLINE uses the Linux SCHED_DEADLINE scheduler. The runtime and period are given by the
+  deadline_runtime_ns and deadline_period_ns fields in ddi_em_init_params. SCHED_DEADLINE can not be combined with
+  CPU affinity selection.
+*/
+typedef enum {
+  DDI_EM_SCHED_RR       = 0, /**< @brief SCHED_RR real-time scheduling (default) */
+  DDI_EM_SCHED_FIFO     = 1, /**< @brief SCHED_FIFO real-time scheduling */
+  DDI_EM_SCHED_DEADLINE = 2, /**< @brief SCHED_DEADLINE scheduling, uses deadline_runtime_ns and deadline_period_ns */
+} ddi_em_sched_policy;
+
+/** @struct ddi_em_acyc_bandwidth
+ *  @brief Acyclic (mailbox) bandwidth configuration of an EtherCAT Master instance
+
+  The frame, command and byte limits apply to each eUsrJob_SendAcycFrames job and are fixed by ddi_em_init().
+  When adaptive mode is enabled, the cyclic task runs additional eUsrJob_SendAcycFrames jobs while the cycle has
+  slack. The number of jobs per cycle grows by one each cycle that finishes before adaptive_deadline_percent of the
+  bus cycle, up to adaptive_max_jobs. It is halved each cycle that passes adaptive_deadline_percent.
+ */
+typedef struct {
+  uint32_t frames_per_cycle;          /**< Acyclic frames sent per job, 0 = DDI_EM_MAX_ACYC_FRAMES_PER_CYCLE (fixed at init) */
+  uint32_t cmds_per_cycle;            /**< Acyclic commands sent per job, 0 = DDI_EM_MAX_ACYC_CMD_PER_CYCLE (fixed at init) */
+  uint32_t bytes_per_cycle;           /**< Acyclic bytes sent per job, 0 = default for the scan rate (fixed at init) */
+  uint32_t adaptive_enable;           /**< 0 = one acyclic job per cycle, 1 = adapt the number of jobs per cycle to the cycle slack */
+  uint32_t adaptive_max_jobs;         /**< Maximum acyclic jobs per cycle in adaptive mode, 0 = DDI_EM_ACYC_ADAPTIVE_MAX_JOBS */
+  uint32_t adaptive_deadline_percent; /**< No additional jobs are sent after this percentage of the bus cycle, 0 = DDI_EM_ACYC_ADAPTIVE_DEADLINE_PERCENT */
+} ddi_em_acyc_bandwidth;
+
+/*! @var DDI_EM_ACYC_ADAPTIVE_MAX_JOBS
+  @brief Default maximum number of acyclic jobs per cycle in adaptive mode
+*/
+#define DDI_EM_ACYC_ADAPTIVE_MAX_JOBS          8
+
+/*! @var DDI_EM_ACYC_ADAPTIVE_DEADLINE_PERCENT
+  @brief Default percentage of the bus cycle after which no additional acyclic jobs are sent in adaptive mode
+*/
+#define DDI_EM_ACYC_ADAPTIVE_DEADLINE_PERCENT  50
+
 /** @struct ddi_em_init_params
  *  @brief This is the EtherCAT Master initialization structure
  */
@@ -305,6 +347,17 @@ typedef struct {
   uint32_t                enable_cpu_affinity;     /**< Enable CPU affinity selection, 0 = disable CPU affinity, 1 = use the value in cyclic_cpu_select */
   ddi_em_cpu_select       cyclic_cpu_select;       /**< CPU affinity selection */
   uint32_t                network_control_flags;   /**< Network control options, @see ddi_em_network_control */
+  // Real-time hardening of the cyclic thread
+  uint32_t                cyclic_stack_size;       /**< Cyclic thread stack size in bytes, 0 = operating system default */
+  uint32_t                enable_memory_lock;      /**< 1 = lock all current and future process memory with mlockall(MCL_CURRENT|MCL_FUTURE) */
+  uint32_t                stack_prefault_size;     /**< Bytes of the cyclic thread stack to touch before the first cycle, 0 = disabled */
+  uint32_t                heap_prefault_size;      /**< Bytes of heap to touch and keep reserved during initialization, 0 = disabled */
+  ddi_em_sched_policy     cyclic_sched_policy;     /**< Cyclic thread scheduling policy, @see ddi_em_sched_policy */
+  uint64_t                deadline_runtime_ns;     /**< SCHED_DEADLINE runtime in nanoseconds, 0 = half of the period */
+  uint64_t                deadline_period_ns;      /**< SCHED_DEADLINE period in nanoseconds, 0 = the scan rate */
+  uint32_t                page_fault_check_cycles; /**< Report the page faults taken by the cyclic thread during this many cycles after start, 0 = disabled */
+  // Acyclic bandwidth
+  ddi_em_acyc_bandwidth   acyc_bandwidth;          /**< Acyclic bandwidth limits, all zero = SDK defaults @see ddi_em_acyc_bandwidth */
 } ddi_em_init_params;
 
 /*! @var DDI_EM_MAX_MASTER_INSTANCES
@@ -403,8 +456,62 @@ typedef struct {
   uint32_t max_cyclic_timestamp_diff_ns;         /**< @brief Maximum delta of consecutive cyclic frames, in nanoseconds */
   uint32_t min_cyclic_timestamp_diff_ns;         /**< @brief Minimum delta of consecutive cyclic frames, in nanoseconds */
   uint32_t average_cyclic_timestamp_diff_ns;     /**< @brief Average delta of consecutive cyclic frames, in nanoseconds */
+  uint32_t startup_minor_page_faults;            /**< @brief Minor page faults taken by the cyclic thread during the page_fault_check_cycles window */
+  uint32_t startup_major_page_faults;            /**< @brief Major page faults taken by the cyclic thread during the page_fault_check_cycles window */
+  uint32_t startup_page_fault_check_done;        /**< @brief 1 = the page fault check window has completed and the startup counts are final */
+  uint32_t acyc_jobs_per_cycle;                  /**< @brief Current number of acyclic jobs per cycle (adaptive acyclic bandwidth) */
+  uint64_t acyc_backoff_count;                   /**< @brief Number of cycles the adaptive acyclic bandwidth backed off */
+  uint32_t callback_budget_overrun_count;        /**< @brief Number of cyclic callbacks that exceeded the callback budget */
+  uint32_t last_callback_duration_ns;            /**< @brief Duration of the last cyclic callback in nanoseconds (callback budget enabled only) */
+  uint32_t max_callback_duration_ns;             /**< @brief Longest cyclic callback in nanoseconds (callback budget enabled only) */
+  uint64_t wkc_error_count;                      /**< @brief Cyclic commands with a working counter mismatch since initialization */
+  uint32_t window_cycles;                        /**< @brief Number of cycles currently covered by the rolling window statistics */
+  uint32_t window_lost_frame_count;              /**< @brief Lost frames in the rolling window */
+  uint32_t window_wkc_error_count;               /**< @brief Cyclic working counter mismatches in the rolling window */
+  uint64_t ms_since_last_frame_loss;             /**< @brief Milliseconds since the last lost frame, DDI_EM_NO_FRAME_LOSS if no frame was lost */
+  uint32_t cycle_rate_us;                        /**< @brief Cycle rate in use by the cyclic thread, in microseconds */
+  uint32_t cycle_rate_change_count;              /**< @brief Number of cycle rate changes applied since initialization */
+  uint64_t event_drop_count;                     /**< @brief SDK-generated events dropped because the event queue was full */
 } ddi_em_master_stats;
 
+/*! @var DDI_EM_NO_FRAME_LOSS
+    @brief Value of ms_since_last_frame_loss in ddi_em_master_stats when no frame has been lost
+*/
+#define DDI_EM_NO_FRAME_LOSS              UINT64_MAX
+
+/*! @var DDI_EM_TELEMETRY_WINDOW_DEFAULT
+    @brief Default length of the rolling telemetry window in cycles
+*/
+#define DDI_EM_TELEMETRY_WINDOW_DEFAULT   1000
+
+/*! @struct ddi_em_telemetry_config
+  \brief Rolling window length and notification limits of the frame-loss and working counter telemetry
+
+  Each limit raises its event once when it is reached. The event is raised again after the value drops below the limit.
+*/
+typedef struct {
+  uint32_t window_cycles;            /**< @brief Rolling window length in cycles, 0 = DDI_EM_TELEMETRY_WINDOW_DEFAULT */
+  uint32_t window_lost_frame_limit;  /**< @brief Raise DDI_EM_EVENT_ERR_FRAMELOSS_LIMIT at this many lost frames in the window, 0 = disabled */
+  uint32_t lost_frame_streak_limit;  /**< @brief Raise DDI_EM_EVENT_ERR_FRAMELOSS_STREAK at this many consecutive lost frames, 0 = disabled */
+  uint32_t window_wkc_error_limit;   /**< @brief Raise DDI_EM_EVENT_ERR_WKC_LIMIT at this many WKC mismatches in the window, 0 = disabled */
+} ddi_em_telemetry_config;
+
+/*! @var DDI_EM_MAX_CYC_CMD_STATS
+    @brief Maximum number of cyclic commands tracked by the working counter telemetry
+*/
+#define DDI_EM_MAX_CYC_CMD_STATS          32
+
+/*! @struct ddi_em_cyc_cmd_stats
+  \brief Working counter mismatch statistics of one cyclic EtherCAT command
+*/
+typedef struct {
+  uint8_t  command;                  /**< @brief EtherCAT command type, e.g. 12 = LRW */
+  uint32_t address;                  /**< @brief Logical address or physical address (ADP/ADO) of the command */
+  uint16_t wkc_expected;             /**< @brief Expected working counter */
+  uint16_t wkc_last;                 /**< @brief Working counter of the last mismatch */
+  uint32_t mismatch_count;           /**< @brief Number of working counter mismatches of this command */
+} ddi_em_cyc_cmd_stats;
+
 /*! @var DDI_EM_DISABLE_REV_DURING_OPEN
     @brief This value will disable the revision check during the ddi_em_open_by_station_address() call
 */
@@ -457,6 +564,10 @@ typedef enum {
   DDI_EM_EVENT_ERR_SLAVE_NOT_SUPPORTED      = 0x20006,  /**< @brief Unsupported master detected during bus scan */
   DDI_EM_EVENT_ERR_ALL_SLAVES_IN_OP         = 0x20007,  /**< @brief All devices back in OP after DDI_EM_EVENT_ERR_NOT_ALL_SLAVES_IN_OP */
   DDI_EM_EVENT_ERR_SCAN_MISMATCH            = 0x20008,  /**< @brief Mismatch during network scan  */
+  DDI_EM_EVENT_ERR_CALLBACK_BUDGET          = 0x20009,  /**< @brief Cyclic callback exceeded its time budget, event_value holds the duration in ns */
+  DDI_EM_EVENT_ERR_FRAMELOSS_LIMIT          = 0x2000A,  /**< @brief Lost frames in the telemetry window reached the limit, event_value holds the count */
+  DDI_EM_EVENT_ERR_FRAMELOSS_STREAK         = 0x2000B,  /**< @brief Consecutive lost frames reached the limit, event_value holds the streak length */
+  DDI_EM_EVENT_ERR_WKC_LIMIT                = 0x2000C,  /**< @brief Cyclic WKC mismatches in the telemetry window reached the limit, event_value holds the count */
   // 0x30000-0x3FFFF Slave Events
   DDI_ES_EVENT_PRESENCE                     = 0x30000,  /**< @brief New slave presence on the network detected */
   DDI_ES_EVENT_MULTIPLE_PRESENCE            = 0x30001,  /**< @brief New multiple slaves presence on the network detected */
@@ -508,6 +619,7 @@ typedef struct {
   ddi_es_handle      es_handle;               /**< Slave Handle the event occurred on */
   ddi_em_event_type  event_code;              /**< Event code @see ddi_em_event_type */
   const char         *event_str;              /**< Event details in text format */
+  uint64_t           event_value;             /**< Event-specific value for SDK-generated events, 0 otherwise */
 } ddi_em_event;
 
 /*! @enum ddi_em_event_control
@@ -617,7 +729,7 @@ typedef void (ddi_em_cyclic_func)(void *user_data);
 ddi_em_result ddi_em_sdk_init(void);
 
 /** ddi_em_deinit
- @brief De-initializes the EtherCAT Master SDK
+ @brief De-initializes the EtherCAT Master SDK, call after ddi_em_deinit() of every master instance
  @return ddi_em_result The result code of the operation @see ddi_em_result
  */
 ddi_em_result ddi_em_sdk_deinit(void);
@@ -671,12 +783,32 @@ ddi_em_result ddi_em_configure_master(ddi_em_handle em_handle, const char* eni_f
 
 /** ddi_em_set_cycle_rate
  @brief Sets the cycle rate for the given Master instance
+ If the cyclic task is running, the new rate is applied at the next cycle boundary without stopping the task or changing
+ the network state. The next cycle is scheduled one new period after the boundary and the cyclic timestamp statistics restart.
+ cycle_rate_us in ddi_em_master_stats reports the rate in use.
  @param em_handle The EtherCAT Master instance handle
  @param cycle_rate_us The cycle rate in microseconds
  @return ddi_em_result The result code of the operation @see ddi_em_result
  */
 ddi_em_result ddi_em_set_cycle_rate(ddi_em_handle em_handle, uint32_t cycle_rate_us);
 
+/** ddi_em_set_acyc_bandwidth
+ @brief Update the adaptive acyclic bandwidth settings of a running Master instance
+ The per-job frame, command and byte limits are fixed at ddi_em_init() and are ignored by this call
+ @param em_handle The EtherCAT Master instance handle
+ @param acyc_bandwidth The acyclic bandwidth settings @see ddi_em_acyc_bandwidth
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_set_acyc_bandwidth(ddi_em_handle em_handle, ddi_em_acyc_bandwidth *acyc_bandwidth);
+
+/** ddi_em_get_acyc_bandwidth
+ @brief Retrieve the effective acyclic bandwidth settings of a Master instance
+ @param em_handle The EtherCAT Master instance handle
+ @param acyc_bandwidth The acyclic bandwidth settings in use @see ddi_em_acyc_bandwidth
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_get_acyc_bandwidth(ddi_em_handle em_handle, ddi_em_acyc_bandwidth *acyc_bandwidth);
+
 // Slave Management -------------------------------------------------------
 /** ddi_em_open_by_station_address
  @brief Returns a slave handle for a slave whose station address matches for the given EtherCAT Master Instance
@@ -735,6 +867,25 @@ ddi_em_result ddi_em_get_slave_config(ddi_em_handle em_handle, ddi_es_handle es_
  */
 ddi_em_result ddi_em_get_master_stats(ddi_em_handle em_handle, ddi_em_master_stats *master_stats);
 
+/** ddi_em_set_telemetry_config
+ @brief Set the rolling window length and notification limits of the frame-loss and working counter telemetry
+ Changing the window length restarts the rolling window
+ @param em_handle The EtherCAT Master instance handle
+ @param config The telemetry configuration @see ddi_em_telemetry_config
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_set_telemetry_config(ddi_em_handle em_handle, ddi_em_telemetry_config *config);
+
+/** ddi_em_get_cyc_cmd_stats
+ @brief Gets the working counter mismatch statistics of each cyclic command that had a mismatch
+ @param em_handle The EtherCAT Master instance handle
+ @param cmd_stats Array receiving the per-command statistics @see ddi_em_cyc_cmd_stats
+ @param max_count The number of entries in cmd_stats
+ @param count The number of entries written to cmd_stats
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_get_cyc_cmd_stats(ddi_em_handle em_handle, ddi_em_cyc_cmd_stats *cmd_stats, uint32_t max_count, uint32_t *count);
+
 // Process Data Management -------------------------------------------------
 // Instance versions
 /** ddi_em_set_process_data
@@ -788,6 +939,358 @@ ddi_em_result ddi_em_get_process_data(uint32_t em_handle, uint32_t pd_offset, ui
  */
 ddi_em_result ddi_em_get_process_data_bits(ddi_em_handle em_handle, uint32_t pd_bit_offset, uint32_t dest_bit_offset, uint8_t *data, uint32_t bit_length, uint8_t is_output=false );
 
+/*! @var DDI_EM_PD_MAX_NAME_LEN
+    @brief Maximum length of an ENI process variable name, including the terminating null
+*/
+#define DDI_EM_PD_MAX_NAME_LEN            128
+
+/** @enum ddi_em_pd_data_type
+ *  @brief Data types of ENI process variables, the values are the CoE data type codes used in the ENI
+ */
+typedef enum {
+  DDI_EM_PD_TYPE_ANY    = 0x0000,          /**< @brief Accept any data type when binding */
+  DDI_EM_PD_TYPE_BOOL   = 0x0001,          /**< @brief BOOL, 1 bit */
+  DDI_EM_PD_TYPE_INT8   = 0x0002,          /**< @brief SINT */
+  DDI_EM_PD_TYPE_INT16  = 0x0003,          /**< @brief INT */
+  DDI_EM_PD_TYPE_INT32  = 0x0004,          /**< @brief DINT */
+  DDI_EM_PD_TYPE_UINT8  = 0x0005,          /**< @brief USINT */
+  DDI_EM_PD_TYPE_UINT16 = 0x0006,          /**< @brief UINT */
+  DDI_EM_PD_TYPE_UINT32 = 0x0007,          /**< @brief UDINT */
+  DDI_EM_PD_TYPE_REAL32 = 0x0008,          /**< @brief REAL */
+  DDI_EM_PD_TYPE_REAL64 = 0x0011,          /**< @brief LREAL */
+  DDI_EM_PD_TYPE_INT64  = 0x0015,          /**< @brief LINT */
+  DDI_EM_PD_TYPE_UINT64 = 0x001B,          /**< @brief ULINT */
+} ddi_em_pd_data_type;
+
+/** @struct ddi_em_pd_var_info
+ *  @brief Description of an ENI process variable
+ */
+typedef struct {
+  char     name[DDI_EM_PD_MAX_NAME_LEN];   /**< @brief The ENI variable name */
+  uint16_t data_type;                      /**< @brief The ENI data type @see ddi_em_pd_data_type */
+  uint16_t slave_address;                  /**< @brief Station address of the slave owning the variable */
+  uint32_t bit_offset;                     /**< @brief Bit offset in the input or output process data */
+  uint32_t bit_size;                       /**< @brief Size in bits */
+  uint8_t  is_output;                      /**< @brief 0 = input process data, 1 = output process data */
+} ddi_em_pd_var_info;
+
+/** @struct ddi_em_pd_binding
+ *  @brief Handle of a bound process variable, resolved once by ddi_em_pd_bind() so no lookup is needed per access
+ *  A binding stays valid until the master is configured again or de-initialized
+ */
+typedef struct {
+  ddi_em_handle em_handle;                 /**< @brief The Master instance handle */
+  uint8_t       *image;                    /**< @brief First byte of the variable in the process data image */
+  uint8_t       bit_shift;                 /**< @brief Bit position of the variable in its first byte */
+  uint8_t       is_output;                 /**< @brief 0 = input process data, 1 = output process data */
+  uint16_t      data_type;                 /**< @brief The ENI data type @see ddi_em_pd_data_type */
+  uint32_t      bit_size;                  /**< @brief Size in bits */
+} ddi_em_pd_binding;
+
+/** ddi_em_pd_lookup
+ @brief Look up an ENI process variable by name, e.g. "Box 1 (Fusion.IO).User PDO Inputs.Event Status"
+ The names are hashed once when the master is configured
+ @param em_handle The Master instance handle
+ @param name The ENI variable name
+ @param info The variable description @see ddi_em_pd_var_info
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND if the ENI has no variable of this name @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_lookup(ddi_em_handle em_handle, const char *name, ddi_em_pd_var_info *info);
+
+/** ddi_em_pd_bind
+ @brief Bind an ENI process variable by name for ddi_em_pd_read() and ddi_em_pd_write()
+ @param em_handle The Master instance handle
+ @param name The ENI variable name
+ @param data_type The expected data type, DDI_EM_PD_TYPE_ANY to accept any type @see ddi_em_pd_data_type
+ @param binding The binding handle
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NOT_FOUND for an unknown name or DDI_EM_STATUS_INVALID_DATA if the
+         ENI data type differs from data_type @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_bind(ddi_em_handle em_handle, const char *name, ddi_em_pd_data_type data_type, ddi_em_pd_binding *binding);
+
+/** ddi_em_pd_read
+ @brief Read a bound process variable. The value is stored in host byte order in the first (bit_size + 7) / 8 bytes of value,
+ e.g. a uint32_t for DDI_EM_PD_TYPE_UINT32 or a uint8_t (0 or 1) for DDI_EM_PD_TYPE_BOOL
+ @param binding The binding handle
+ @param value The buffer receiving the value
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_read(const ddi_em_pd_binding *binding, void *value);
+
+/** ddi_em_pd_write
+ @brief Write a bound output process variable, value has the layout described in ddi_em_pd_read()
+ @param binding The binding handle
+ @param value The value to write
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_INVALID_ARG for an input variable @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_write(const ddi_em_pd_binding *binding, const void *value);
+
+/** @struct ddi_em_pd_field
+ *  @brief A process data field of an access plan
+ */
+typedef struct {
+  const char *name;                        /**< @brief ENI variable name, NULL to use pd_bit_offset, bit_size and is_output */
+  uint32_t   pd_bit_offset;                /**< @brief Bit offset in the input or output process data (name == NULL) */
+  uint32_t   bit_size;                     /**< @brief Size in bits (name == NULL) */
+  uint8_t    is_output;                    /**< @brief 0 = input process data, 1 = output process data (name == NULL) */
+  uint32_t   user_offset;                  /**< @brief Byte offset of the field in the user structure, fields that aren't a whole
+                                                number of bytes are stored from bit 0 of this byte */
+} ddi_em_pd_field;
+
+/** @struct ddi_em_pd_plan_info
+ *  @brief Copy operations of a compiled access plan
+ */
+typedef struct {
+  uint32_t field_count;                    /**< @brief Number of fields in the plan */
+  uint32_t gather_copy_ops;                /**< @brief memcpy operations of ddi_em_pd_plan_gather(), after merging contiguous fields */
+  uint32_t gather_bit_ops;                 /**< @brief Bit copy operations of ddi_em_pd_plan_gather() */
+  uint32_t scatter_copy_ops;               /**< @brief memcpy operations of ddi_em_pd_plan_scatter(), after merging contiguous fields */
+  uint32_t scatter_bit_ops;                /**< @brief Bit copy operations of ddi_em_pd_plan_scatter() */
+} ddi_em_pd_plan_info;
+
+/** @typedef ddi_em_pd_plan
+ *  @brief A compiled process data access plan
+ */
+typedef struct ddi_em_pd_plan_t ddi_em_pd_plan;
+
+/** ddi_em_pd_plan_create
+ @brief Compile a list of process data fields into an access plan that copies all of them in one call.
+ Byte aligned fields that are contiguous both in the process data and in the user structure are merged into one memcpy.
+ A plan stays valid until the master is configured again or de-initialized
+ @param em_handle The Master instance handle
+ @param fields The fields of the plan @see ddi_em_pd_field
+ @param count The number of fields
+ @param user_size The size of the user structure in bytes, every field must fit into it
+ @param plan The compiled plan
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NOT_FOUND for an unknown field name, DDI_EM_STATUS_INVALID_SIZE for
+         a field outside of the user structure or DDI_EM_STATUS_INVALID_ARG for a field outside of the process data @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_plan_create(ddi_em_handle em_handle, const ddi_em_pd_field *fields, uint32_t count, uint32_t user_size, ddi_em_pd_plan **plan);
+
+/** ddi_em_pd_plan_gather
+ @brief Copy every field of the plan from the process data into the user structure
+ @param plan The access plan
+ @param user The user structure
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_plan_gather(const ddi_em_pd_plan *plan, void *user);
+
+/** ddi_em_pd_plan_scatter
+ @brief Copy the output fields of the plan from the user structure into the output process data, the input fields are skipped
+ @param plan The access plan
+ @param user The user structure
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_plan_scatter(const ddi_em_pd_plan *plan, const void *user);
+
+/** ddi_em_pd_plan_get_info
+ @brief Return the number of copy operations of a compiled plan
+ @param plan The access plan
+ @param info The plan information @see ddi_em_pd_plan_info
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_plan_get_info(const ddi_em_pd_plan *plan, ddi_em_pd_plan_info *info);
+
+/** ddi_em_pd_plan_free
+ @brief Free an access plan
+ @param plan The access plan
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_plan_free(ddi_em_pd_plan *plan);
+
+/*! @var DDI_EM_PD_DELTA_MAX_REGIONS
+    @brief Maximum number of input regions watched by the change detection of a master instance
+*/
+#define DDI_EM_PD_DELTA_MAX_REGIONS       32
+
+/** @enum ddi_em_pd_edge
+ *  @brief Input transitions reported to an edge callback
+ */
+typedef enum {
+  DDI_EM_PD_EDGE_RISING  = 0x1,            /**< @brief Report 0 -> 1 transitions */
+  DDI_EM_PD_EDGE_FALLING = 0x2,            /**< @brief Report 1 -> 0 transitions */
+  DDI_EM_PD_EDGE_BOTH    = 0x3,            /**< @brief Report every transition */
+} ddi_em_pd_edge;
+
+/** @typedef ddi_em_pd_edge_func
+ *  @brief Edge callback of a watched input region, called by the cyclic thread once per changed bit before the cyclic
+ *  callback runs. The callback can add and remove regions, the update takes effect in the next cycle and a removed region
+ *  gets no further callbacks.
+ *  @param em_handle The Master instance handle
+ *  @param bit_offset The bit offset of the changed input in the input process data
+ *  @param value The new value of the input, 0 or 1
+ *  @param user_data The user data passed to ddi_em_pd_delta_add_region()
+ */
+typedef void (ddi_em_pd_edge_func)(ddi_em_handle em_handle, uint32_t bit_offset, uint8_t value, void *user_data);
+
+/** ddi_em_pd_delta_add_region
+ @brief Watch a region of the input process data for changes. Every cycle, after the cyclic frames were received, the
+ watched regions are compared against the previous cycle and the changed bits are stored in the change bitmap.
+ Regions stay registered until they are removed or the master is configured again
+ @param em_handle The Master instance handle
+ @param bit_offset The bit offset of the region in the input process data, e.g. ddi_em_pd_var_info.bit_offset
+ @param bit_size The size of the region in bits
+ @param edges The transitions reported to callback @see ddi_em_pd_edge
+ @param callback The edge callback, NULL to only poll the region with ddi_em_pd_delta_next()
+ @param user_data The user data passed to callback
+ @param region_id The id of the new region
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NOT_READY if the master isn't configured, DDI_EM_STATUS_INVALID_ARG
+         for a region outside of the input process data or DDI_EM_STATUS_NO_RESOURCES if DDI_EM_PD_DELTA_MAX_REGIONS regions
+         are registered @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_add_region(ddi_em_handle em_handle, uint32_t bit_offset, uint32_t bit_size, ddi_em_pd_edge edges,
+                                         ddi_em_pd_edge_func *callback, void *user_data, uint32_t *region_id);
+
+/** ddi_em_pd_delta_remove_region
+ @brief Stop watching an input region
+ @param em_handle The Master instance handle
+ @param region_id The id returned by ddi_em_pd_delta_add_region()
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND for an unknown region @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_remove_region(ddi_em_handle em_handle, uint32_t region_id);
+
+/** ddi_em_pd_delta_next
+ @brief Return the next input of a region that changed in the current cycle. Set cursor to 0 before the first call,
+ each call continues after the previously returned bit. Call from the cyclic callback, the changes are replaced every cycle
+ @param em_handle The Master instance handle
+ @param region_id The id returned by ddi_em_pd_delta_add_region()
+ @param cursor The iteration state
+ @param bit_offset The bit offset of the changed input in the input process data
+ @param value The new value of the input, 0 or 1
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND when the region has no further changes @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_next(ddi_em_handle em_handle, uint32_t region_id, uint32_t *cursor, uint32_t *bit_offset, uint8_t *value);
+
+/** ddi_em_pd_delta_get_changes
+ @brief Return the number of inputs of a region that changed in the current cycle
+ @param em_handle The Master instance handle
+ @param region_id The id returned by ddi_em_pd_delta_add_region()
+ @param change_count The number of changed bits
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND for an unknown region @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_get_changes(ddi_em_handle em_handle, uint32_t region_id, uint32_t *change_count);
+
+/** ddi_em_pd_delta_get_bitmap
+ @brief Return the change bitmap of the current cycle. Bit n of the bitmap is set when bit n of the input process data
+ changed, the bits outside of the watched regions are always clear. Skipping the zero words finds the changed inputs
+ without looking at the unchanged ones. Call from the cyclic callback, the bitmap is updated every cycle
+ @param em_handle The Master instance handle
+ @param bitmap The change bitmap
+ @param word_count The number of 64-bit words in the bitmap
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_READY if the master isn't configured @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_get_bitmap(ddi_em_handle em_handle, const uint64_t **bitmap, uint32_t *word_count);
+
+/*! @var DDI_EM_RECORDER_RING_DEFAULT
+    @brief Default number of records held by the recorder ring, about 4 seconds at 1 kHz
+*/
+#define DDI_EM_RECORDER_RING_DEFAULT      4096
+
+/*! @var DDI_EM_RECORDER_RING_MAX
+    @brief Maximum number of records held by the recorder ring
+*/
+#define DDI_EM_RECORDER_RING_MAX          (1U << 24)
+
+/** @struct ddi_em_recorder_config
+ *  @brief Process data recorder configuration
+ */
+typedef struct {
+  uint32_t              ring_records;      /**< @brief Records held by the ring between the cyclic thread and the file writer, rounded up to a
+                                                power of two, 0 = DDI_EM_RECORDER_RING_DEFAULT, at most DDI_EM_RECORDER_RING_MAX */
+  uint32_t              decimation;        /**< @brief Record every n-th cycle, 0 or 1 = every cycle */
+  uint32_t              region_count;      /**< @brief Number of valid entries in regions */
+  ddi_em_capture_region regions[DDI_EM_CAPTURE_MAX_REGIONS]; /**< @brief The recorded process data regions @see ddi_em_capture_region */
+} ddi_em_recorder_config;
+
+/** @struct ddi_em_recorder_stats
+ *  @brief Process data recorder statistics
+ */
+typedef struct {
+  uint64_t captured_records;               /**< @brief Records copied into the ring by the cyclic thread */
+  uint64_t written_records;                /**< @brief Records written to the capture file */
+  uint64_t dropped_records;                /**< @brief Cycles not recorded because the ring was full */
+  uint64_t bytes_written;                  /**< @brief Bytes written to the capture file */
+  uint32_t ring_high_water;                /**< @brief Highest number of records waiting in the ring */
+  uint8_t  active;                         /**< @brief Is the recorder running? */
+  uint8_t  write_error;                    /**< @brief Did a write to the capture file fail? Recording stopped and the file has no
+                                                       index or footer, so the decoder reports it as incomplete */
+} ddi_em_recorder_stats;
+
+/** ddi_em_recorder_start
+ @brief Start recording process data regions every cycle into a capture file @see ddi_em_capture.h
+ The cyclic thread copies the regions into a lock-free ring after the cyclic callback, so the recorded outputs are the
+ ones sent in the same cycle. A background thread writes the ring to the file. When the writer falls behind, the ring
+ fills up and cycles are dropped instead of delaying the cyclic thread. Use util/ddi_em_capture_decode to convert a
+ capture file to CSV
+ @param em_handle The Master instance handle
+ @param filename The capture file, an existing file is replaced
+ @param config The recorder configuration @see ddi_em_recorder_config
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_BUSY if the recorder is running, DDI_EM_STATUS_INVALID_ARG for a region
+         outside of the process data or a ring larger than DDI_EM_RECORDER_RING_MAX, DDI_EM_STATUS_NOT_FOUND if the file can't be created @see ddi_em_result
+ */
+ddi_em_result ddi_em_recorder_start(ddi_em_handle em_handle, const char *filename, const ddi_em_recorder_config *config);
+
+/** ddi_em_recorder_stop
+ @brief Stop recording, write the records left in the ring, the index and the footer and close the capture file. After a
+ write error only the records written before it are kept @see ddi_em_recorder_stats
+ @param em_handle The Master instance handle
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_READY if the recorder isn't running @see ddi_em_result
+ */
+ddi_em_result ddi_em_recorder_stop(ddi_em_handle em_handle);
+
+/** ddi_em_recorder_get_stats
+ @brief Return the statistics of the current or last recording
+ @param em_handle The Master instance handle
+ @param stats The recorder statistics @see ddi_em_recorder_stats
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_recorder_get_stats(ddi_em_handle em_handle, ddi_em_recorder_stats *stats);
+
+/** @struct ddi_em_replay_config
+ *  @brief Process data replay configuration
+ */
+typedef struct {
+  const char          *input_file;         /**< @brief Capture whose input regions are fed to the application */
+  const char          *golden_file;        /**< @brief Capture whose output regions are the expected outputs, NULL = the output regions of input_file */
+  const char          *output_file;        /**< @brief Capture of the replayed inputs and the resulting outputs, NULL = not written */
+  ddi_em_cyclic_func  *callback;           /**< @brief Control logic run every replayed cycle, NULL = the registered cyclic callback */
+  void                *user_data;          /**< @brief Argument of callback */
+  uint32_t             speed_percent;      /**< @brief Replay speed in percent of the recorded timing, 100 = real time, 0 = as fast as possible */
+  uint64_t             max_cycles;         /**< @brief Stop after this many records, 0 = replay the whole capture */
+  uint8_t              stop_on_mismatch;   /**< @brief Stop at the first cycle whose outputs differ from the golden capture */
+} ddi_em_replay_config;
+
+/** @struct ddi_em_replay_result
+ *  @brief Process data replay result
+ */
+typedef struct {
+  uint64_t cycles;                         /**< @brief Replayed cycles */
+  uint64_t compared_cycles;                /**< @brief Replayed cycles that had a golden record */
+  uint64_t mismatched_cycles;              /**< @brief Compared cycles with at least one differing output region */
+  uint64_t first_mismatch_cycle;           /**< @brief Capture cycle number of the first mismatch, valid if mismatched_cycles != 0 */
+  uint32_t first_mismatch_region;          /**< @brief Golden capture region index of the first mismatch */
+  uint32_t region_count;                   /**< @brief Number of compared output regions */
+  uint64_t region_mismatches[DDI_EM_CAPTURE_MAX_REGIONS]; /**< @brief Mismatched cycles per golden capture region */
+  uint64_t elapsed_ns;                     /**< @brief Duration of the replay */
+} ddi_em_replay_result;
+
+/** ddi_em_replay_run
+ @brief Replay a process data capture through the control logic and compare its outputs against a golden capture @see ddi_em_capture.h
+ Every record of the input capture is one cycle: its input regions are copied into the input process data, the callback
+ runs, and the output regions of the golden record with the same cycle number are compared against the output process
+ data. The callback uses the usual process data calls, so control logic runs unchanged against a recording of a live
+ rack. A master that isn't configured gets an in-memory process image sized to fit the capture for the duration of the
+ replay, no network adapter is needed. A configured master replays through its own process image, nothing is sent to
+ the network. The call returns when the replay is complete
+ @param em_handle The Master instance handle
+ @param config The replay configuration @see ddi_em_replay_config
+ @param result The replay result @see ddi_em_replay_result
+ @return ddi_em_result DDI_EM_STATUS_OK if all compared outputs matched, DDI_EM_STATUS_INVALID_DATA for a mismatch or a damaged
+         capture, DDI_EM_STATUS_BUSY if the cyclic thread or another replay is running, DDI_EM_STATUS_NOT_FOUND if a capture can't
+         be opened or DDI_EM_STATUS_INVALID_ARG for a capture that doesn't fit the process data @see ddi_em_result
+ */
+ddi_em_result ddi_em_replay_run(ddi_em_handle em_handle, const ddi_em_replay_config *config, ddi_em_replay_result *result);
+
 // State Control -----------------------------------------------------------
 /** ddi_em_set_master_state
  @brief Sets the Master state for the given Master instance
@@ -835,12 +1338,25 @@ ddi_em_result ddi_em_get_slave_state(ddi_em_handle em_handle, ddi_es_handle es_h
  */
 ddi_em_result ddi_em_register_cyclic_callback(ddi_em_handle em_handle, ddi_em_cyclic_func *callback, void *user_data);
 
+/** ddi_em_set_callback_budget
+ @brief Set the time budget of the cyclic callback for the given master instance. This function may be called at any time.
+ The duration of the cyclic callback is measured each cycle. When it exceeds budget_ns, the callback_budget_overrun_count
+ statistic is incremented and a DDI_EM_EVENT_ERR_CALLBACK_BUDGET event carrying the measured duration is sent to the event handler.
+ If a fallback callback is given, it is called instead of the cyclic callback on the cycle following an overrun.
+ @param em_handle The Master instance
+ @param budget_ns The callback budget in nanoseconds, 0 = disable the budget watchdog
+ @param fallback The degraded fallback callback, may be NULL
+ @param fallback_data The user-specified fallback callback arguments, may be NULL
+ @return ddi_em_result The result of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_set_callback_budget(ddi_em_handle em_handle, uint32_t budget_ns, ddi_em_cyclic_func *fallback, void *fallback_data);
+
 /** ddi_em_cyclic_task_start
  @brief Start the cyclic task.  This function is used if the cyclic thread is managed outside of the DDI ECAT SDK.
  This function will start the cyclic task. This function is used if the cyclic thread is managed outside of the DDI ECAT SDK
  This function blocks and will not return until ddi_em_cyclic_task_stop() is called
  @param em_handle The Master instance to start the cyclic task on
- @return ddi_em_result The result of the operation @see ddi_em_result
+ @return ddi_em_result The result of the operation, DDI_EM_STATUS_BUSY if ddi_em_replay_run() is running @see ddi_em_result
  */
 ddi_em_result ddi_em_cyclic_task_start(ddi_em_handle em_handle);
 
@@ -853,7 +1369,9 @@ ddi_em_result ddi_em_cyclic_task_stop(ddi_em_handle em_handle);
 
 // Notifications -------------------------------------------------------------
 /** ddi_em_register_notify
- @brief Registers the event callback mechanism for the given Master instance
+ @brief Registers the event callback mechanism for the given Master instance. The events the SDK raises in the
+ cyclic thread (callback budget and telemetry limits) are queued and delivered from a separate event thread, the
+ handler does not delay the cycle. Events beyond the queue depth are counted in ddi_em_master_stats.event_drop_count.
  @param em_handle The EtherCAT Master instance handle
  @param callback The callback to be executed when the event that matches the mask is received @see ddi_em_event_func
  @return ddi_em_result The result of the register operation @see ddi_em_result
@@ -902,6 +1420,165 @@ ddi_em_result ddi_em_coe_write(ddi_em_handle em_handle, ddi_es_handle es_handle,
 ddi_em_result ddi_em_coe_read(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
  uint32_t len, uint32_t *out_len, uint32_t timeout, uint32_t flags );
 
+/*! @var DDI_EM_MAX_COE_REQUESTS
+    @brief Maximum number of outstanding asynchronous CoE requests per Master instance
+*/
+#define DDI_EM_MAX_COE_REQUESTS           256
+
+/*! @var DDI_EM_COE_INVALID_REQUEST
+    @brief Request id that is never assigned to an asynchronous CoE request
+*/
+#define DDI_EM_COE_INVALID_REQUEST        0
+
+/** @typedef ddi_em_coe_request_id
+ *  @brief Identifies an asynchronous CoE request
+ */
+typedef uint32_t ddi_em_coe_request_id;
+
+/** @struct ddi_em_coe_completion
+ *  @brief Result of an asynchronous CoE request
+ */
+typedef struct {
+  ddi_em_coe_request_id request_id;        /**< @brief The request id returned when the request was started */
+  ddi_es_handle         es_handle;         /**< @brief The slave handle */
+  uint16_t              index;             /**< @brief The object index */
+  uint16_t              subindex;          /**< @brief The object subindex */
+  bool                  write;             /**< @brief Was the request a write (download)? */
+  ddi_em_result         result;            /**< @brief The result of the transfer @see ddi_em_result */
+  uint32_t              out_len;           /**< @brief Bytes copied to the read buffer (reads only) */
+  uint32_t              duration_us;       /**< @brief Time from starting the request to its completion in microseconds */
+  void                  *user_data;        /**< @brief The user data given when the request was started */
+} ddi_em_coe_completion;
+
+/** @typedef ddi_em_coe_complete_func
+ *  @brief Completion callback of an asynchronous CoE request
+ *  The callback runs in the context of the master job processing (normally the cyclic thread) and must return quickly
+ */
+typedef void (ddi_em_coe_complete_func)(ddi_em_coe_completion *completion);
+
+/** ddi_em_coe_read_async
+ @brief Start reading a COE index/subindex without waiting for the mailbox round trip. This operation is from Slave->Master
+ Requests to different slaves are processed in parallel, requests to the same slave in order.
+ The request completes through callback if given. Otherwise the completion is returned by ddi_em_coe_poll() or ddi_em_coe_wait().
+ @param em_handle The Master instance handle
+ @param es_handle The slave handle
+ @param index The object index to read
+ @param subindex The object subindex to read
+ @param data The read buffer, must stay valid until the request completes
+ @param len The maximum data length to read in bytes
+ @param timeout Timeout in milliseconds
+ @param flags Additional COE Flags. 1 = Complete access
+ @param callback The completion callback, NULL to complete through ddi_em_coe_poll() or ddi_em_coe_wait()
+ @param user_data User data returned in the completion
+ @param request_id The id of the started request
+ @return ddi_em_result The result of starting the request, DDI_EM_STATUS_BUSY if DDI_EM_MAX_COE_REQUESTS are outstanding @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_read_async(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
+ uint32_t len, uint32_t timeout, uint32_t flags, ddi_em_coe_complete_func *callback, void *user_data, ddi_em_coe_request_id *request_id);
+
+/** ddi_em_coe_write_async
+ @brief Start writing a COE index/subindex without waiting for the mailbox round trip. This operation is from Master->Slave
+ The data is copied, so the buffer can be reused when this call returns. Completion works as in ddi_em_coe_read_async()
+ @param em_handle The Master instance handle
+ @param es_handle The slave handle
+ @param index The object index to write
+ @param subindex The object subindex to write
+ @param data The data to write
+ @param len The data length to write in bytes
+ @param timeout Timeout in milliseconds
+ @param flags Additional COE Flags. 1 = Complete access
+ @param callback The completion callback, NULL to complete through ddi_em_coe_poll() or ddi_em_coe_wait()
+ @param user_data User data returned in the completion
+ @param request_id The id of the started request
+ @return ddi_em_result The result of starting the request, DDI_EM_STATUS_BUSY if DDI_EM_MAX_COE_REQUESTS are outstanding @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_write_async(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
+ uint32_t len, uint32_t timeout, uint32_t flags, ddi_em_coe_complete_func *callback, void *user_data, ddi_em_coe_request_id *request_id);
+
+/** ddi_em_coe_poll
+ @brief Return the completed asynchronous CoE requests that were started without a callback, oldest completion first
+ @param em_handle The Master instance handle
+ @param completions Array receiving the completions
+ @param max_count The number of entries in completions
+ @param count The number of completions returned
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_poll(ddi_em_handle em_handle, ddi_em_coe_completion *completions, uint32_t max_count, uint32_t *count);
+
+/** ddi_em_coe_wait
+ @brief Wait for an asynchronous CoE request that was started without a callback
+ @param em_handle The Master instance handle
+ @param request_id The request to wait for
+ @param timeout_ms The maximum time to wait in milliseconds, the request stays outstanding when the wait times out
+ @param completion The completion of the request
+ @return ddi_em_result DDI_EM_STATUS_OK if the request completed (its own result is in completion), DDI_EM_STATUS_TIMEOUT
+         or DDI_EM_STATUS_NOT_FOUND for unknown or already completed requests @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_wait(ddi_em_handle em_handle, ddi_em_coe_request_id request_id, uint32_t timeout_ms, ddi_em_coe_completion *completion);
+
+/*! @var DDI_EM_COE_LIST_SINGLE_ACCESS
+    @brief ddi_em_coe_read_list()/ddi_em_coe_write_list() flag: transfer every item on its own, don't merge items into complete access transfers
+*/
+#define DDI_EM_COE_LIST_SINGLE_ACCESS     0x1
+
+/** @struct ddi_em_coe_list_item
+ *  @brief One object of a batched CoE transfer
+ */
+typedef struct {
+  ddi_es_handle es_handle;                 /**< @brief The slave handle */
+  uint16_t      index;                     /**< @brief The object index */
+  uint16_t      subindex;                  /**< @brief The object subindex */
+  uint8_t       *data;                     /**< @brief The read buffer or the data to write */
+  uint32_t      len;                       /**< @brief The buffer or data length in bytes */
+  uint32_t      out_len;                   /**< @brief Bytes read (reads only), set by the transfer */
+  ddi_em_result result;                    /**< @brief The result of this item, set by the transfer @see ddi_em_result */
+  uint32_t      duration_us;               /**< @brief Round-trip time of the SDO transfer that carried this item, set by the transfer */
+} ddi_em_coe_list_item;
+
+/** @struct ddi_em_coe_list_stats
+ *  @brief Aggregate timing of a batched CoE transfer
+ */
+typedef struct {
+  uint32_t item_count;                     /**< @brief Number of items in the list */
+  uint32_t failed_count;                   /**< @brief Number of items that failed */
+  uint32_t transfer_count;                 /**< @brief Number of SDO transfers used for the list */
+  uint32_t complete_access_count;          /**< @brief Number of successful complete access transfers that carried several items */
+  uint32_t total_us;                       /**< @brief Time to transfer the whole list in microseconds */
+  uint32_t max_transfer_us;                /**< @brief Longest SDO transfer round-trip time in microseconds */
+} ddi_em_coe_list_stats;
+
+/** ddi_em_coe_read_list
+ @brief Read a list of COE objects, possibly from several slaves. This operation is from Slave->Master
+ The items of one slave are pipelined in list order, the slaves are processed in parallel. Consecutive items of the same
+ slave and index starting at subindex 1 are read with one complete access transfer. If the slave rejects the complete
+ access transfer, the items are read one by one.
+ @param em_handle The Master instance handle
+ @param items The objects to read, out_len, result and duration_us are updated for every item
+ @param count The number of items
+ @param timeout Timeout of each SDO transfer in milliseconds
+ @param flags List flags, DDI_EM_COE_LIST_SINGLE_ACCESS
+ @param stats Aggregate timing of the list, can be NULL
+ @return ddi_em_result DDI_EM_STATUS_OK if every item was read, otherwise the result of the first failed item @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_read_list(ddi_em_handle em_handle, ddi_em_coe_list_item *items, uint32_t count, uint32_t timeout, uint32_t flags,
+ ddi_em_coe_list_stats *stats);
+
+/** ddi_em_coe_write_list
+ @brief Write a list of COE objects, possibly to several slaves. This operation is from Master->Slave
+ The items of one slave are written in list order, the slaves are processed in parallel. Consecutive items of the same
+ slave and index starting at subindex 1 are written with one complete access transfer. If the slave rejects the complete
+ access transfer, the items are written one by one.
+ @param em_handle The Master instance handle
+ @param items The objects to write, result and duration_us are updated for every item
+ @param count The number of items
+ @param timeout Timeout of each SDO transfer in milliseconds
+ @param flags List flags, DDI_EM_COE_LIST_SINGLE_ACCESS
+ @param stats Aggregate timing of the list, can be NULL
+ @return ddi_em_result DDI_EM_STATUS_OK if every item was written, otherwise the result of the first failed item @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_write_list(ddi_em_handle em_handle, ddi_em_coe_list_item *items, uint32_t count, uint32_t timeout, uint32_t flags,
+ ddi_em_coe_list_stats *stats);
+
 // File over EtherCAT (FoE) Interface ----------------------------------------
 /** ddi_em_foe_write
  @brief Send data over File over EtherCAT (FoE) for the given Master instance
@@ -936,6 +1613,135 @@ ddi_em_result ddi_em_foe_write(ddi_em_handle em_handle, ddi_es_handle es_handle,
 ddi_em_result ddi_em_foe_read(ddi_em_handle em_handle, ddi_es_handle es_handle, char *filename, uint32_t file_length,
   uint8_t *data, uint32_t data_length, uint32_t* read_len, uint32_t password, uint32_t timeout );
 
+/*! @var DDI_EM_MAX_FOE_STREAMS
+    @brief Maximum number of streaming FoE downloads and uploads per master instance
+*/
+#define DDI_EM_MAX_FOE_STREAMS            32
+
+/*! @var DDI_EM_FOE_SEGMENT_DEFAULT
+    @brief Default number of bytes per segment of a streaming FoE transfer, taken from the source of a download
+*/
+#define DDI_EM_FOE_SEGMENT_DEFAULT        0x10000
+
+/*! @var DDI_EM_FOE_INVALID_STREAM
+    @brief Stream id that is never assigned to a streaming FoE transfer
+*/
+#define DDI_EM_FOE_INVALID_STREAM         0
+
+/** @typedef ddi_em_foe_stream_id
+ *  @brief Identifies a streaming FoE transfer of a master instance
+ */
+typedef uint32_t ddi_em_foe_stream_id;
+
+/** @struct ddi_em_foe_progress
+ *  @brief Progress of a streaming FoE transfer
+ */
+typedef struct {
+  ddi_em_foe_stream_id stream_id;          /**< @brief The stream id returned by ddi_em_foe_stream_start() */
+  ddi_es_handle        es_handle;          /**< @brief The slave handle */
+  uint32_t             total_bytes;        /**< @brief Size of the file, for an upload the expected size until it is done */
+  uint32_t             transferred_bytes;  /**< @brief Bytes acknowledged by the slave in the current attempt */
+  uint32_t             bytes_per_sec;      /**< @brief Achieved throughput of the current attempt */
+  uint32_t             elapsed_ms;         /**< @brief Time since the start of the current attempt */
+  uint32_t             retries;            /**< @brief Attempts restarted after a failure */
+  uint32_t             busy_done;          /**< @brief Slave busy progress, e.g. while it flashes the file, 0 to busy_entire */
+  uint32_t             busy_entire;        /**< @brief Slave busy range, 0 = the slave isn't busy */
+  uint8_t              done;               /**< @brief Is the transfer complete? */
+  ddi_em_result        result;             /**< @brief Result of the transfer, valid once done is set */
+  void                *user_data;          /**< @brief The user_data of the stream configuration */
+} ddi_em_foe_progress;
+
+/** @typedef ddi_em_foe_progress_func
+ *  @brief Progress callback of a streaming FoE transfer, called from the stream's thread after every segment and once when the
+ *  transfer is done
+ */
+typedef void (ddi_em_foe_progress_func)(const ddi_em_foe_progress *progress);
+
+/** @typedef ddi_em_foe_source_func
+ *  @brief Chunk source of a streaming FoE download, copies length bytes of the file starting at offset into buffer. A result other
+ *  than DDI_EM_STATUS_OK aborts the download without retrying
+ */
+typedef ddi_em_result (ddi_em_foe_source_func)(void *user_data, uint32_t offset, uint8_t *buffer, uint32_t length);
+
+/** @typedef ddi_em_foe_sink_func
+ *  @brief Chunk sink of a streaming FoE upload, takes the length bytes of the file starting at offset from buffer. A retried upload
+ *  starts over at offset 0. A result other than DDI_EM_STATUS_OK aborts the upload without retrying
+ */
+typedef ddi_em_result (ddi_em_foe_sink_func)(void *user_data, uint32_t offset, const uint8_t *buffer, uint32_t length);
+
+/** @struct ddi_em_foe_stream_config
+ *  @brief Streaming FoE transfer configuration. A download reads the file from exactly one of source_path, data or source,
+ *  an upload sets none of them and writes the file to sink
+ */
+typedef struct {
+  ddi_es_handle             es_handle;     /**< @brief The slave handle */
+  const char               *filename;      /**< @brief FoE filename on the slave, null terminated */
+  uint32_t                  password;      /**< @brief The FoE password */
+  uint32_t                  timeout;       /**< @brief Timeout of each segment in milliseconds */
+  const char               *source_path;   /**< @brief Local file, mapped into memory for the duration of the download */
+  const uint8_t            *data;          /**< @brief File contents in memory, must stay valid until the download is done */
+  ddi_em_foe_source_func   *source;        /**< @brief Chunk source callback */
+  void                     *source_data;   /**< @brief Argument of source */
+  ddi_em_foe_sink_func     *sink;          /**< @brief Chunk sink callback, makes the stream an upload */
+  void                     *sink_data;     /**< @brief Argument of sink */
+  uint32_t                  size;          /**< @brief File size for data and source, ignored for source_path, expected size of an upload or 0 */
+  uint32_t                  segment_size;  /**< @brief Bytes per segment, 0 = DDI_EM_FOE_SEGMENT_DEFAULT */
+  uint32_t                  max_retries;   /**< @brief Restarts of the transfer after a failure, FoE can't resume a partial file */
+  ddi_em_foe_progress_func *progress;      /**< @brief Progress callback, can be NULL */
+  void                     *user_data;     /**< @brief Passed to progress in ddi_em_foe_progress */
+} ddi_em_foe_stream_config;
+
+/** ddi_em_foe_stream_start
+ @brief Start a streaming FoE download to a slave, or an upload from a slave when the configuration has a sink
+ The transfer runs in its own thread and moves the file one segment at a time, so the file is never copied as a whole.
+ Transfers to different slaves run in parallel, the master interleaves their mailbox traffic. Use ddi_em_foe_stream_wait()
+ to wait for the result and release the stream
+ @param em_handle The master instance handle
+ @param config The stream configuration @see ddi_em_foe_stream_config
+ @param stream_id The id of the started stream
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_BUSY if DDI_EM_MAX_FOE_STREAMS streams are in use,
+         DDI_EM_STATUS_FILE_OPEN_ERR if source_path can't be mapped or DDI_EM_STATUS_INVALID_ARG unless there is exactly one source or the sink @see ddi_em_result
+ */
+ddi_em_result ddi_em_foe_stream_start(ddi_em_handle em_handle, const ddi_em_foe_stream_config *config, ddi_em_foe_stream_id *stream_id);
+
+/** ddi_em_foe_stream_get_progress
+ @brief Return the progress of a streaming FoE transfer
+ @param em_handle The master instance handle
+ @param stream_id The stream id
+ @param progress The progress of the stream @see ddi_em_foe_progress
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND for an unknown or released stream @see ddi_em_result
+ */
+ddi_em_result ddi_em_foe_stream_get_progress(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id, ddi_em_foe_progress *progress);
+
+/** ddi_em_foe_stream_cancel
+ @brief Cancel a streaming FoE transfer, the transfer completes with DDI_EM_STATUS_OP_CANCELLED
+ @param em_handle The master instance handle
+ @param stream_id The stream id
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_NOT_FOUND for an unknown or released stream @see ddi_em_result
+ */
+ddi_em_result ddi_em_foe_stream_cancel(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id);
+
+/** ddi_em_foe_stream_wait
+ @brief Wait for a streaming FoE transfer to complete and release the stream
+ @param em_handle The master instance handle
+ @param stream_id The stream id
+ @param timeout_ms The maximum wait time in milliseconds
+ @param progress The final progress of the stream, its result is the result of the transfer @see ddi_em_foe_progress
+ @return ddi_em_result DDI_EM_STATUS_OK when the transfer is complete, DDI_EM_STATUS_TIMEOUT if it's still running or
+         DDI_EM_STATUS_NOT_FOUND for an unknown or released stream @see ddi_em_result
+ */
+ddi_em_result ddi_em_foe_stream_wait(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id, uint32_t timeout_ms, ddi_em_foe_progress *progress);
+
+/** ddi_em_foe_write_parallel
+ @brief Download files to several slaves in parallel and wait for all of them, e.g. to update the firmware of a rack
+ @param em_handle The master instance handle
+ @param configs The stream configurations, one per slave @see ddi_em_foe_stream_config
+ @param count The number of configurations, at most DDI_EM_MAX_FOE_STREAMS
+ @param results The final progress of every download, can be NULL @see ddi_em_foe_progress
+ @return ddi_em_result DDI_EM_STATUS_OK if every download succeeded, otherwise the result of the first failed download @see ddi_em_result
+ */
+ddi_em_result ddi_em_foe_write_parallel(ddi_em_handle em_handle, const ddi_em_foe_stream_config *configs, uint32_t count, ddi_em_foe_progress *results);
+
 /** ddi_em_read_eeprom
  @brief Read the ESC eeprom registers
  @param[in] em_handle The master instance handle
@@ -960,6 +1766,84 @@ ddi_em_result ddi_em_read_eeprom(ddi_em_handle em_handle, ddi_es_handle es_handl
  */
 ddi_em_result ddi_em_write_eeprom(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t offset, uint16_t *data, uint32_t write_len, uint32_t timeout);
 
+/*! @var DDI_EM_SII_MAX_WORDS
+  @brief The largest slave EEPROM (SII) image read by ddi_em_sii_read_all(), in words (64 KiB)
+*/
+#define DDI_EM_SII_MAX_WORDS      0x8000
+
+/*! @var DDI_EM_SII_REFRESH
+  @brief ddi_em_sii_read_all() flag, read every EEPROM from the slave and rewrite its cache file
+*/
+#define DDI_EM_SII_REFRESH        0x1
+
+/*! @var DDI_EM_SII_NO_CACHE
+  @brief ddi_em_sii_read_all() flag, read every EEPROM from the slave and leave the cache untouched
+*/
+#define DDI_EM_SII_NO_CACHE       0x2
+
+/** ddi_em_sii_identity
+ @brief The identity a cached slave EEPROM (SII) image is stored under
+ */
+typedef struct {
+  uint32_t vendor_id;
+  uint32_t product_code;
+  uint32_t revision;
+  uint32_t serial_number;
+} ddi_em_sii_identity;
+
+/** ddi_em_sii_image
+ @brief The EEPROM (SII) image of one slave, returned by ddi_em_sii_read_all()
+ */
+typedef struct {
+  uint16_t            station_address;  /**< Station address of the slave */
+  ddi_em_sii_identity identity;         /**< Identity of the slave from the bus scan */
+  uint16_t           *data;             /**< The image from word 0 to the end category, release with ddi_em_sii_free() */
+  uint32_t            size;             /**< Size of the image, in words */
+  ddi_em_result       result;           /**< Result of the read, data is NULL if it failed */
+  uint8_t             from_cache;       /**< Was the image served from the cache? */
+  uint32_t            read_time_us;     /**< Time spent on this slave */
+} ddi_em_sii_image;
+
+/** ddi_em_sii_read_all
+ @brief Read the EEPROM (SII) images of all connected slaves concurrently
+ @details A cached image is validated against the first 8 words of the slave EEPROM, which hold the ESC configuration and
+          its checksum, before it is used. Images that are not cached or don't match are read in full and written to the
+          cache. The cache directory is DDI_EM_SII_CACHE_DIR unless set with ddi_em_sii_set_cache_dir().
+ @param[in] em_handle The master instance handle
+ @param[out] images The images, in bus order @see ddi_em_sii_image
+ @param[in] max_count The number of entries in images
+ @param[out] count The number of connected slaves
+ @param[in] threads The number of slaves read at the same time, 0 for the default
+ @param[in] timeout The EEPROM access timeout in milliseconds, per read
+ @param[in] flags DDI_EM_SII_REFRESH, DDI_EM_SII_NO_CACHE or 0
+ @return ddi_em_result DDI_EM_STATUS_OK if every image was read, DDI_EM_STATUS_INVALID_SIZE if max_count is below the
+         number of connected slaves, otherwise the result of the first failed slave @see ddi_em_result
+ */
+ddi_em_result ddi_em_sii_read_all(ddi_em_handle em_handle, ddi_em_sii_image *images, uint32_t max_count, uint32_t *count, uint32_t threads, uint32_t timeout, uint32_t flags);
+
+/** ddi_em_sii_free
+ @brief Release the image data returned by ddi_em_sii_read_all()
+ @param[in] images The images
+ @param[in] count The number of images
+ */
+void ddi_em_sii_free(ddi_em_sii_image *images, uint32_t count);
+
+/** ddi_em_sii_set_cache_dir
+ @brief Set the EEPROM (SII) image cache directory of a master instance, the directory is created if needed
+ @param[in] em_handle The master instance handle
+ @param[in] cache_dir The cache directory, NULL for the default
+ @return ddi_em_result DDI_EM_STATUS_OK or DDI_EM_STATUS_FILE_OPEN_ERR if the directory can't be created @see ddi_em_result
+ */
+ddi_em_result ddi_em_sii_set_cache_dir(ddi_em_handle em_handle, const char *cache_dir);
+
+/** ddi_em_sii_cache_invalidate
+ @brief Remove cached EEPROM (SII) images, ddi_em_write_eeprom() removes the image of the slave it writes
+ @param[in] em_handle The master instance handle
+ @param[in] identity The identity of the image to remove, NULL to remove all images
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NOT_FOUND if the image isn't cached @see ddi_em_result
+ */
+ddi_em_result ddi_em_sii_cache_invalidate(ddi_em_handle em_handle, const ddi_em_sii_identity *identity);
+
 /** ddi_em_write_esc_reg
  @brief Write the ESC hardware registers
  @param[in] em_handle The master instance handle
@@ -0,0 +1,106 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_CAPTURE_H
+#define DDI_EM_CAPTURE_H
+
+// Binary process data capture file format, written by the process data recorder (ddi_em_recorder_start())
+//
+// A capture file is laid out as follows, all values are little-endian:
+//   ddi_em_capture_header   file header, followed by region_count ddi_em_capture_region entries
+//   records                 record_count records of record_size bytes, each a ddi_em_capture_record followed by
+//                           the bytes of every region in header order
+//   ddi_em_capture_index    index_count index entries, one per DDI_EM_CAPTURE_INDEX_INTERVAL records
+//   ddi_em_capture_footer   file footer
+// The records have a fixed size, record n starts at data_offset + n * record_size. Cycles that were not recorded
+// (decimation, ring overflow) leave gaps in the cycle numbers, the index finds a cycle without reading every record.
+
+#include <stdint.h>
+
+/*! @var DDI_EM_CAPTURE_MAGIC
+    @brief Magic value at the start of the header and the footer of a capture file
+*/
+#define DDI_EM_CAPTURE_MAGIC              "DDIEMCAP"
+
+/*! @var DDI_EM_CAPTURE_VERSION
+    @brief Capture file format version
+*/
+#define DDI_EM_CAPTURE_VERSION            1
+
+/*! @var DDI_EM_CAPTURE_MAX_REGIONS
+    @brief Maximum number of process data regions in a capture
+*/
+#define DDI_EM_CAPTURE_MAX_REGIONS        16
+
+/*! @var DDI_EM_CAPTURE_NAME_LEN
+    @brief Maximum length of a capture region name, including the terminating null
+*/
+#define DDI_EM_CAPTURE_NAME_LEN           32
+
+/*! @var DDI_EM_CAPTURE_INDEX_INTERVAL
+    @brief Records between two index entries
+*/
+#define DDI_EM_CAPTURE_INDEX_INTERVAL     1024
+
+#pragma pack(push, 1)
+
+/** @struct ddi_em_capture_region
+ *  @brief A process data region of a capture
+ */
+typedef struct {
+  char     name[DDI_EM_CAPTURE_NAME_LEN];  /**< @brief Region name, used as the CSV column name */
+  uint32_t byte_offset;                    /**< @brief Byte offset in the input or output process data */
+  uint32_t byte_size;                      /**< @brief Size in bytes */
+  uint8_t  is_output;                      /**< @brief 0 = input process data, 1 = output process data */
+  uint8_t  reserved[3];
+} ddi_em_capture_region;
+
+/** @struct ddi_em_capture_header
+ *  @brief Capture file header
+ */
+typedef struct {
+  char     magic[8];                       /**< @brief DDI_EM_CAPTURE_MAGIC, not null terminated */
+  uint16_t version;                        /**< @brief DDI_EM_CAPTURE_VERSION */
+  uint16_t region_count;                   /**< @brief Number of regions following the header */
+  uint32_t record_size;                    /**< @brief Size of a record in bytes, including its ddi_em_capture_record */
+  uint32_t data_offset;                    /**< @brief File offset of the first record */
+  uint32_t cycle_time_us;                  /**< @brief Cycle time of the master when the capture started */
+  uint32_t decimation;                     /**< @brief Every n-th cycle was recorded */
+  uint32_t reserved;
+  uint64_t start_time_ns;                  /**< @brief Wall clock time of the start of the capture, in ns since the epoch */
+} ddi_em_capture_header;
+
+/** @struct ddi_em_capture_record
+ *  @brief Record header, the region bytes follow
+ */
+typedef struct {
+  uint64_t cycle;                          /**< @brief Cycle number, counted from the start of the capture */
+  uint64_t timestamp_ns;                   /**< @brief Start of the cycle in ns of the master's monotonic clock */
+} ddi_em_capture_record;
+
+/** @struct ddi_em_capture_index
+ *  @brief Index entry of a capture file
+ */
+typedef struct {
+  uint64_t cycle;                          /**< @brief Cycle number of the record */
+  uint64_t record;                         /**< @brief Record number */
+} ddi_em_capture_index;
+
+/** @struct ddi_em_capture_footer
+ *  @brief Capture file footer, written when the capture stops
+ */
+typedef struct {
+  uint64_t index_offset;                   /**< @brief File offset of the first index entry */
+  uint64_t index_count;                    /**< @brief Number of index entries */
+  uint64_t record_count;                   /**< @brief Number of records */
+  uint64_t dropped_count;                  /**< @brief Cycles lost because the ring was full */
+  char     magic[8];                       /**< @brief DDI_EM_CAPTURE_MAGIC, not null terminated */
+} ddi_em_capture_footer;
+
+#pragma pack(pop)
+
+#endif // DDI_EM_CAPTURE_H
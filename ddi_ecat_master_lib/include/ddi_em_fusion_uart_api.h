@@ -149,6 +149,12 @@ typedef enum {
 */
 typedef int32_t ddi_fusion_uart_handle;
 
+/*! @var DDI_FUSION_UART_MAX_HANDLES
+  @brief The number of UART handles that can be open at once, over all EtherCAT Master instances
+  UART handles are allocated as they are opened, closed handles are reused
+*/
+#define DDI_FUSION_UART_MAX_HANDLES            1024
+
 /** ddi_fusion_uart_open
  @brief Opens a UART instance handle
  This function opens a UART instance handle. This UART instance handle will be used in other UART calls
@@ -189,6 +195,306 @@ ddi_em_result ddi_fusion_uart_tx_data (ddi_fusion_uart_handle handle, uint8_t *s
  */
 ddi_em_result ddi_fusion_uart_rx_data (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length);
 
+/*! @var DDI_FUSION_UART_RX_CHUNK_UNTIMED
+  @brief The Rx bytes available did not report the bytes of the chunk yet, it carries the cycle and time of the read
+*/
+#define DDI_FUSION_UART_RX_CHUNK_UNTIMED 0x1
+
+/*! @var DDI_FUSION_UART_RX_CHUNK_MERGED
+  @brief The chunk array was full, the last chunk also holds the bytes of later cycles
+*/
+#define DDI_FUSION_UART_RX_CHUNK_MERGED  0x2
+
+/*! @struct ddi_fusion_uart_rx_chunk
+  @brief Bytes returned by ddi_fusion_uart_rx_data_timed() that were reported in the same cycle
+*/
+typedef struct {
+  uint32_t offset;         /**< @brief Offset of the first byte of the chunk in the destination buffer */
+  uint32_t length;         /**< @brief Bytes in the chunk */
+  uint64_t cycle;          /**< @brief Number of the cycle the Rx bytes available rose by these bytes in, counted from ddi_em_init() */
+  uint64_t timestamp_ns;   /**< @brief Monotonic time of that cycle in nanoseconds, the clock of ddi_fusion_uart_status */
+  uint32_t flags;          /**< @brief DDI_FUSION_UART_RX_CHUNK_UNTIMED, DDI_FUSION_UART_RX_CHUNK_MERGED */
+} ddi_fusion_uart_rx_chunk;
+
+/** ddi_fusion_uart_rx_data_timed
+ @brief Receive up to 255 bytes like ddi_fusion_uart_rx_data() and tag them with the cycle they arrived in
+ Every cycle, the cyclic thread follows the Rx bytes available in the status process data of the open UART handles and
+ remembers the cycle number and time of every rise. The received bytes are returned in chunks, one per rise, so gaps
+ between bytes on the line show as gaps between the timestamps of consecutive chunks, to the resolution of the cycle
+ time. A read only counts against the Rx bytes available a few cycles after it completes, bytes that arrive meanwhile
+ are reported up to DDI_FUSION_UART_RX_CHUNK_LAG_CYCLES cycles late. Bytes already received when the handle was
+ opened carry the first cycle after the open. All reads of the handle, including ddi_fusion_uart_rx_data(), advance
+ the same timeline.
+ @param[in]  handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] dest_buffer The destination buffer, at least 255 bytes
+ @param[out] rx_length The received data byte length
+ @param[out] chunks The chunks of the received bytes, in order
+ @param[in]  max_chunks The number of entries of chunks, at least 1
+ @param[out] chunk_count The number of chunks returned, 0 if no bytes were received
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_INVALID_ARG if max_chunks is 0 @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_rx_data_timed (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length,
+                                             ddi_fusion_uart_rx_chunk *chunks, uint32_t max_chunks, uint32_t *chunk_count);
+
+/*! @var DDI_FUSION_UART_RX_CHUNK_LAG_CYCLES
+  @brief Cycles the arrival of bytes can be reported late by ddi_fusion_uart_rx_data_timed() while a read is pending
+*/
+#define DDI_FUSION_UART_RX_CHUNK_LAG_CYCLES 2
+
+/*! @var DDI_FUSION_UART_LEASE_BUFFERS
+  @brief The buffers a UART handle can have leased at once, transmit and receive together
+*/
+#define DDI_FUSION_UART_LEASE_BUFFERS 4
+
+/*! @struct ddi_fusion_uart_buffer
+  @brief A UART transfer buffer leased with ddi_fusion_uart_tx_lease() or ddi_fusion_uart_rx_borrow()
+  The data lives in the image of the SDO transfer, it is sent or received in place without being copied. The
+  structure belongs to the caller, it only describes the buffer.
+*/
+typedef struct {
+  uint8_t  *data;     /**< @brief DDI_FUSION_UART_SDO_DATA_SIZE_MAX bytes */
+  uint32_t length;    /**< @brief The bytes to send, set by the caller, or the bytes received */
+  uint32_t lease;     /**< @brief Identifies the lease, a buffer kept past the close of its handle no longer matches */
+} ddi_fusion_uart_buffer;
+
+/** ddi_fusion_uart_tx_lease
+ @brief Lease a transmit buffer of a UART handle. The data is written to buffer->data and sent with
+ ddi_fusion_uart_tx_commit(), or the buffer is given back unsent with ddi_fusion_uart_release_buffer().
+ @param[in]  handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] buffer The leased buffer, its length is 0
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NO_RESOURCES if DDI_FUSION_UART_LEASE_BUFFERS buffers are leased
+ @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_lease (ddi_fusion_uart_handle handle, ddi_fusion_uart_buffer *buffer);
+
+/** ddi_fusion_uart_tx_commit
+ @brief Send the buffer->length bytes of a leased transmit buffer like ddi_fusion_uart_tx_data() and give the buffer back.
+ Without the transmit scheduler the bytes are not copied. The scheduler copies them once, into the SDO transfer that
+ may also carry other writes. The buffer is given back whatever the result.
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] buffer The buffer leased with ddi_fusion_uart_tx_lease()
+ @return ddi_em_result The result code of the operation, DDI_EM_STATUS_INVALID_ARG if the buffer is not leased from the handle
+ @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_commit (ddi_fusion_uart_handle handle, const ddi_fusion_uart_buffer *buffer);
+
+/** ddi_fusion_uart_rx_borrow
+ @brief Receive up to 255 bytes like ddi_fusion_uart_rx_data() into a leased buffer, without copying them. The buffer
+ is given back with ddi_fusion_uart_release_buffer() once the data was used.
+ @param[in]  handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] buffer The leased buffer with the received bytes, its length can be 0. No buffer is leased if the receive fails.
+ @return ddi_em_result The result code of the operation, DDI_EM_STATUS_NO_RESOURCES if DDI_FUSION_UART_LEASE_BUFFERS
+ buffers are leased, DDI_EM_STATUS_OP_CANCELLED if the handle was closed during the receive
+ @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_rx_borrow (ddi_fusion_uart_handle handle, ddi_fusion_uart_buffer *buffer);
+
+/** ddi_fusion_uart_release_buffer
+ @brief Give back a buffer leased from a UART handle. Closing the handle gives back all its buffers, their data must not
+ be used after the close.
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] buffer The buffer leased with ddi_fusion_uart_tx_lease() or ddi_fusion_uart_rx_borrow()
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_INVALID_ARG if the buffer is not leased from the handle
+ @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_release_buffer (ddi_fusion_uart_handle handle, const ddi_fusion_uart_buffer *buffer);
+
+/*! @enum uart_framing_mode
+  @brief Represents the receive framing modes of a UART handle opened by ddi_fusion_uart_open_framed()
+*/
+typedef enum {
+  UART_FRAMING_NONE          = 0, /**< @brief No framing, the application reads the bytes with ddi_fusion_uart_rx_data() */
+  UART_FRAMING_DELIMITER     = 1, /**< @brief A frame ends with a delimiter sequence, which is not part of the delivered frame */
+  UART_FRAMING_FIXED_LENGTH  = 2, /**< @brief Every frame has the same length */
+  UART_FRAMING_LENGTH_PREFIX = 3, /**< @brief The frame length is read from a length field in the frame header */
+  UART_FRAMING_TIMEOUT       = 4  /**< @brief A frame ends when no byte was received for the inter-byte timeout */
+} uart_framing_mode;
+
+/*! @var DDI_FUSION_UART_FRAME_SIZE_MAX
+  @brief The largest frame the UART framing engine can deliver
+*/
+#define DDI_FUSION_UART_FRAME_SIZE_MAX        4096
+
+/*! @var DDI_FUSION_UART_FRAME_SIZE_DEFAULT
+  @brief The frame size limit used when uart_framing_config.max_frame_length is 0
+*/
+#define DDI_FUSION_UART_FRAME_SIZE_DEFAULT    1024
+
+/*! @var DDI_FUSION_UART_DELIMITER_MAX
+  @brief The longest frame delimiter sequence of UART_FRAMING_DELIMITER
+*/
+#define DDI_FUSION_UART_DELIMITER_MAX         4
+
+/*! @struct uart_framing_config
+  @brief The receive framing of a UART handle
+  Frames longer than max_frame_length, frames with an invalid length field, and partial frames followed by an
+  inter-byte gap longer than inter_byte_timeout_us (other than in UART_FRAMING_TIMEOUT mode) are dropped, the
+  framing engine then resynchronizes on the next byte.
+*/
+typedef struct {
+  uart_framing_mode mode;                                    /**< @brief The framing mode @see uart_framing_mode */
+  uint32_t max_frame_length;                                 /**< @brief Frame size limit, 0 for DDI_FUSION_UART_FRAME_SIZE_DEFAULT */
+  uint32_t inter_byte_timeout_us;                            /**< @brief Inter-byte timeout, ends a UART_FRAMING_TIMEOUT frame, 0 to disable in the other modes */
+  uint8_t  delimiter[DDI_FUSION_UART_DELIMITER_MAX];         /**< @brief UART_FRAMING_DELIMITER: the delimiter sequence */
+  uint8_t  delimiter_length;                                 /**< @brief UART_FRAMING_DELIMITER: the delimiter length, 1 to 4 */
+  uint32_t frame_length;                                     /**< @brief UART_FRAMING_FIXED_LENGTH: the frame length */
+  uint16_t length_offset;                                    /**< @brief UART_FRAMING_LENGTH_PREFIX: offset of the length field in the frame */
+  uint8_t  length_size;                                      /**< @brief UART_FRAMING_LENGTH_PREFIX: size of the length field, 1 or 2 bytes */
+  uint8_t  length_big_endian;                                /**< @brief UART_FRAMING_LENGTH_PREFIX: is the length field big-endian? */
+  int32_t  length_adjust;                                    /**< @brief UART_FRAMING_LENGTH_PREFIX: added to the length field to give the whole frame length */
+} uart_framing_config;
+
+/** ddi_fusion_uart_open_framed
+ @brief Opens a UART instance handle with receive framing
+ The received bytes of the handle are read by the framing thread of the master instance, which splits them into frames
+ and delivers every complete frame as a UART_EVENT_FRAME event to the callback registered with
+ ddi_fusion_uart_register_event(). The event carries the frame and the cycle times its first and last bytes were
+ reported in. Frames completed before a callback is registered are dropped. Do not call ddi_fusion_uart_rx_data() on
+ a framed handle.
+ @param[in] em_handle The DDI ECAT master initialization parameters @see ddi_em_init_params
+ @param[in] es_handle The EtherCAT master slave instance
+ @param[in] module_index The UART EtherCAT module index
+ @param[in] channel The UART channel value @see ddi_uart_channel
+ @param[in] flags The UART flags, currently reserved
+ @param[in] framing The receive framing @see uart_framing_config
+ @param[out] handle The UART handle returned by open
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_open_framed (ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t module_index, uart_channel channel,
+                                             uint32_t flags, const uart_framing_config *framing, ddi_fusion_uart_handle *handle);
+
+/*! @var DDI_FUSION_UART_TX_QUEUE_DEFAULT
+  @brief The default per-channel transmit queue limit of the UART transmit scheduler, in bytes
+*/
+#define DDI_FUSION_UART_TX_QUEUE_DEFAULT      4096
+
+/** ddi_fusion_uart_tx_scheduler_start
+ @brief Start the UART transmit scheduler of an EtherCAT master instance
+ The scheduler queues the transmits of every UART channel of the master instance and sends them from one thread, so
+ concurrent transmits no longer race for the mailbox. The channels are served in deficit round-robin order, each turn a
+ channel may send up to its weight times 255 bytes (ddi_fusion_uart_set_tx_weight(), 1 by default, which is plain
+ round-robin). Queued writes of a channel are coalesced into SDO payloads of up to 255 bytes. While the scheduler runs,
+ ddi_fusion_uart_tx_data() queues its data and waits until it was sent.
+ @param[in] em_handle The EtherCAT master instance handle
+ @param[in] queue_limit The transmit queue limit of each channel in bytes, 0 for DDI_FUSION_UART_TX_QUEUE_DEFAULT
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_scheduler_start (ddi_em_handle em_handle, uint32_t queue_limit);
+
+/** ddi_fusion_uart_tx_scheduler_stop
+ @brief Stop the UART transmit scheduler, transmits still queued are dropped and their waiters get DDI_EM_STATUS_OP_CANCELLED
+ @param[in] em_handle The EtherCAT master instance handle
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_scheduler_stop (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_set_tx_weight
+ @brief Set the share of the transmit scheduler given to the given UART channel
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] weight The number of 255 byte SDO payloads the channel may send per round, 1 to 64
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_set_tx_weight (ddi_fusion_uart_handle handle, uint32_t weight);
+
+/** ddi_fusion_uart_tx_queue
+ @brief Queue data for the given UART channel and return without waiting, requires the transmit scheduler
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] source_buffer The data to send, copied before the call returns
+ @param[in] tx_length The data length, any length up to the queue limit
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_BUSY if the channel queue is full or DDI_EM_STATUS_NOT_READY if
+         the transmit scheduler is not running @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_queue (ddi_fusion_uart_handle handle, const uint8_t *source_buffer, uint32_t tx_length);
+
+/** ddi_fusion_uart_tx_flush_queue
+ @brief Wait until the transmit queue of the given UART channel is empty
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] timeout_ms The wait timeout in milliseconds
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_TIMEOUT, or the result of the first failed SDO since the previous
+         flush @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_tx_flush_queue (ddi_fusion_uart_handle handle, uint32_t timeout_ms);
+
+/*! @struct ddi_fusion_uart_tx_stats
+  @brief The transmit statistics of a UART channel, kept by the transmit scheduler
+*/
+typedef struct {
+  uint64_t bytes_sent;          /**< @brief Bytes sent to the channel */
+  uint64_t writes_sent;         /**< @brief Queued writes sent, several writes can share one SDO */
+  uint64_t sdo_count;           /**< @brief SDO transfers made for the channel */
+  uint64_t errors;              /**< @brief Failed SDO transfers, their data is dropped */
+  uint32_t queued_bytes;        /**< @brief Bytes waiting in the channel queue */
+  uint32_t queued_writes;       /**< @brief Writes waiting in the channel queue */
+  uint32_t avg_latency_us;      /**< @brief Average time from queueing a write until it was sent */
+  uint32_t max_latency_us;      /**< @brief Longest time from queueing a write until it was sent */
+  uint32_t bytes_per_sec;       /**< @brief Throughput since the statistics were reset */
+  ddi_em_result last_error;     /**< @brief Result of the last failed SDO */
+} ddi_fusion_uart_tx_stats;
+
+/** ddi_fusion_uart_get_tx_stats
+ @brief Get the transmit statistics of the given UART channel
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] stats The transmit statistics @see ddi_fusion_uart_tx_stats
+ @param[in] reset Reset the statistics after reading them?
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_get_tx_stats (ddi_fusion_uart_handle handle, ddi_fusion_uart_tx_stats *stats, bool reset);
+
+/*! @struct ddi_fusion_uart_pty_config
+  @brief The buffering of a UART pseudo-terminal bridge, 0 selects the default of a field
+*/
+typedef struct {
+  uint32_t tx_batch_bytes;        /**< @brief Bytes collected from the pty before a transmit, 1 to 255, default 255 */
+  uint32_t tx_batch_timeout_us;   /**< @brief Longest wait for a batch to fill after its first byte, default 0: send at once */
+  uint32_t rx_poll_interval_us;   /**< @brief Receive poll interval while the channel is idle, default 1000 */
+  uint32_t rx_buffer_size;        /**< @brief Received bytes buffered for a slow pty reader before the bridge stops reading the channel, default 4096 */
+} ddi_fusion_uart_pty_config;
+
+/*! @struct ddi_fusion_uart_pty_stats
+  @brief The throughput counters of a UART pseudo-terminal bridge
+*/
+typedef struct {
+  uint64_t tx_bytes;              /**< @brief Bytes read from the pty and sent to the channel */
+  uint64_t rx_bytes;              /**< @brief Bytes received from the channel and written to the pty */
+  uint64_t tx_transfers;          /**< @brief ddi_fusion_uart_tx_data() calls */
+  uint64_t rx_transfers;          /**< @brief ddi_fusion_uart_rx_data() calls */
+  uint64_t tx_errors;             /**< @brief Failed transmits, their data is dropped */
+  uint64_t rx_errors;             /**< @brief Failed receives */
+  uint32_t rx_buffered;           /**< @brief Received bytes waiting for the pty reader */
+  uint32_t tx_bytes_per_sec;      /**< @brief Transmit throughput since the counters were reset */
+  uint32_t rx_bytes_per_sec;      /**< @brief Receive throughput since the counters were reset */
+} ddi_fusion_uart_pty_stats;
+
+/** ddi_fusion_uart_pty_open
+ @brief Expose a UART handle as a Linux pseudo-terminal
+ A bridge thread copies the bytes written to the pseudo-terminal to the UART channel with ddi_fusion_uart_tx_data()
+ and the bytes received on the channel to the pseudo-terminal with ddi_fusion_uart_rx_data(), so serial tools can open
+ the returned device like any tty. The pseudo-terminal starts in raw mode. Larger tx_batch_bytes and
+ tx_batch_timeout_us values trade latency for fewer mailbox transfers. Closing the UART handle closes its bridge.
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] config The bridge buffering, NULL for the defaults @see ddi_fusion_uart_pty_config
+ @param[out] pty_name The pseudo-terminal device name, e.g. /dev/pts/3
+ @param[in] pty_name_size The size of the pty_name buffer
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_pty_open (ddi_fusion_uart_handle handle, const ddi_fusion_uart_pty_config *config, char *pty_name, uint32_t pty_name_size);
+
+/** ddi_fusion_uart_pty_close
+ @brief Stop the pseudo-terminal bridge of a UART handle and remove its pseudo-terminal
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_pty_close (ddi_fusion_uart_handle handle);
+
+/** ddi_fusion_uart_pty_get_stats
+ @brief Get the throughput counters of the pseudo-terminal bridge of a UART handle
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] stats The throughput counters @see ddi_fusion_uart_pty_stats
+ @param[in] reset Reset the counters after reading them?
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_pty_get_stats (ddi_fusion_uart_handle handle, ddi_fusion_uart_pty_stats *stats, bool reset);
+
 /*! @enum uart_baud
   @brief Represents the baud rate modes available in the Fusion UART subsystem
 */
@@ -345,6 +651,56 @@ ddi_em_result ddi_fusion_uart_set_flow_control (ddi_fusion_uart_handle handle, u
  */
 ddi_em_result ddi_fusion_uart_get_flow_control (ddi_fusion_uart_handle handle, uart_flow_control *flow_control);
 
+/*! @struct uart_channel_config
+  @brief The complete configuration of a UART channel
+*/
+typedef struct {
+  uart_interface    interface;     /**< @brief Physical interface @see uart_interface */
+  uart_baud         baud;          /**< @brief Baud rate @see uart_baud */
+  uart_parity       parity;        /**< @brief Parity mode @see uart_parity */
+  uart_data_bits    data_bits;     /**< @brief Data bits @see uart_data_bits */
+  uart_stop_bits    stop_bits;     /**< @brief Stop bits @see uart_stop_bits */
+  uart_flow_control flow_control;  /**< @brief Flow control mode @see uart_flow_control */
+} uart_channel_config;
+
+/** ddi_fusion_uart_apply_config
+ @brief Set the complete configuration of the given UART channel in one complete access transfer
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] config The channel configuration @see uart_channel_config
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_apply_config (ddi_fusion_uart_handle handle, const uart_channel_config *config);
+
+/** ddi_fusion_uart_read_config
+ @brief Get the complete configuration of the given UART channel in one complete access transfer
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] config The channel configuration @see uart_channel_config
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_read_config (ddi_fusion_uart_handle handle, uart_channel_config *config);
+
+/** ddi_fusion_uart_apply_config_list
+ @brief Set the configuration of several UART channels
+ The channels are grouped by UART module, each module is configured with one complete access read and one complete
+ access write of its 0x5nn5 object, whatever the number of its channels in the list
+ @param[in] handles The UART handles opened by ddi_fusion_uart_open
+ @param[in] configs The channel configurations, one per handle @see uart_channel_config
+ @param[in] count The number of handles, at most DDI_FUSION_UART_MAX_HANDLES
+ @param[out] results The result of each channel, can be NULL @see ddi_em_result
+ @return ddi_em_result DDI_EM_STATUS_OK if every channel was configured, otherwise the first failed channel result @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_apply_config_list (const ddi_fusion_uart_handle *handles, const uart_channel_config *configs, uint32_t count, ddi_em_result *results);
+
+/** ddi_fusion_uart_read_config_list
+ @brief Get the configuration of several UART channels with one complete access read per UART module
+ @param[in] handles The UART handles opened by ddi_fusion_uart_open
+ @param[out] configs The channel configurations, one per handle @see uart_channel_config
+ @param[in] count The number of handles, at most DDI_FUSION_UART_MAX_HANDLES
+ @param[out] results The result of each channel, can be NULL @see ddi_em_result
+ @return ddi_em_result DDI_EM_STATUS_OK if every channel was read, otherwise the first failed channel result @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_read_config_list (const ddi_fusion_uart_handle *handles, uart_channel_config *configs, uint32_t count, ddi_em_result *results);
+
 /** ddi_fusion_uart_channel_flush
  @brief Flush the tx and rx buffers of the given UART channel
  @param[in] handle The UART handle opened by ddi_fusion_uart_open
@@ -368,6 +724,7 @@ ddi_em_result ddi_fusion_uart_enable_transmit (ddi_fusion_uart_handle handle);
 
 /** ddi_fusion_uart_get_transmit_hold_status
  @brief Get the transmit enable status for the given UART channel
+ The hold status is the one last set by ddi_fusion_uart_set_transmit_hold() or ddi_fusion_uart_enable_transmit()
  @param[in] handle The UART handle opened by ddi_fusion_uart_open
  @param[out] is_hold_enabled Is the transmit hold currently enabled?
  @return ddi_em_result The result code of the operation @see ddi_em_result
@@ -381,6 +738,7 @@ ddi_em_result ddi_fusion_uart_get_transmit_hold_status (ddi_fusion_uart_handle h
 
 /** ddi_fusion_uart_get_error_status
  @brief Get the error detail status for the given UART channel
+ The error details are only read from the slave while the process data status reports an error condition
  @param[in] handle The UART handle opened by ddi_fusion_uart_open
  @param[out] error_details The error detail status
  @return ddi_em_result The result code of the operation @see ddi_em_result
@@ -395,12 +753,42 @@ ddi_em_result ddi_fusion_uart_get_error_status (ddi_fusion_uart_handle handle, u
  */
 ddi_em_result ddi_fusion_uart_get_rx_bytes_avail (ddi_fusion_uart_handle handle, uint16_t *bytes_avail);
 
+/*! @struct ddi_fusion_uart_status
+  @brief The UART channel status mirrored from the UART status process data
+*/
+typedef struct {
+  uint16_t status;          /**< @brief The raw status word @see DDI_FUSION_UART_STATUS_RX_BYTE_MASK */
+  uint16_t rx_bytes_avail;  /**< @brief The Rx bytes available */
+  uint8_t  error;           /**< @brief Is an error condition present? */
+  uint8_t  tx_almost_full;  /**< @brief Is the Fusion firmware Tx buffer almost full? */
+  uint8_t  rx_almost_full;  /**< @brief Is the Fusion firmware Rx buffer almost full? */
+  uint64_t timestamp_ns;    /**< @brief Monotonic time of the cycle the status was received in, in nanoseconds */
+  uint64_t age_ns;          /**< @brief Age of the status when it was returned, in nanoseconds */
+} ddi_fusion_uart_status;
+
+/** ddi_fusion_uart_get_status
+ @brief Get the status of the given UART channel without mailbox traffic
+ The status is copied from the UART status process data every cycle. ddi_fusion_uart_get_rx_bytes_avail() and
+ ddi_fusion_uart_get_error_status() use the same copy while it is younger than DDI_FUSION_UART_STATUS_MAX_AGE_MS
+ and fall back to an SDO read otherwise.
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] status The UART channel status @see ddi_fusion_uart_status
+ @return ddi_em_result DDI_EM_STATUS_OK, DDI_EM_STATUS_NOT_READY if the status was not received yet @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_get_status (ddi_fusion_uart_handle handle, ddi_fusion_uart_status *status);
+
+/*! @var DDI_FUSION_UART_STATUS_MAX_AGE_MS
+  @brief The UART status getters fall back to an SDO read when the process data status is older than this
+*/
+#define DDI_FUSION_UART_STATUS_MAX_AGE_MS     100
+
 /*! @enum uart_event_type
   @brief Represents the event handler types of the Fusion UART subsystem
 */
 typedef enum {
   UART_EVENT_THRESHOLD,       /**< @brief Treshold event detected */
-  UART_EVENT_ERROR            /**< @brief Error condition detected */
+  UART_EVENT_ERROR,           /**< @brief Error condition detected */
+  UART_EVENT_FRAME            /**< @brief Frame received on a handle opened by ddi_fusion_uart_open_framed() */
 } uart_event_type;
 
 /*! @enum uart_event_threshold_type
@@ -421,6 +809,10 @@ typedef struct {
   uart_event_threshold_type threshold_type; /**< @brief The UART threshold type, rising or falling edge */
   ddi_fusion_uart_handle uart_handle; /**< @brief The DDI EtherCAT UART handle the event occurred on */
   uint16_t threshold_level; /**< @brief The threshold buffer level the event triggered on */
+  const uint8_t *frame; /**< @brief UART_EVENT_FRAME: the frame, only valid during the callback */
+  uint32_t frame_length; /**< @brief UART_EVENT_FRAME: the frame length */
+  uint64_t frame_start_ns; /**< @brief UART_EVENT_FRAME: monotonic cycle time the first frame byte was reported in */
+  uint64_t frame_end_ns; /**< @brief UART_EVENT_FRAME: monotonic cycle time the last frame byte was reported in */
 } uart_event;
 
 typedef void (ddi_uart_event_func)(uart_event *event, void *user_data);
@@ -478,6 +870,59 @@ ddi_em_result ddi_fusion_uart_enable_error_event (ddi_fusion_uart_handle handle)
  */
 ddi_em_result ddi_fusion_uart_disable_error_event (ddi_fusion_uart_handle handle);
 
+/*! @enum uart_fd_event_type
+  @brief Represents the events signalled on a UART event file descriptor
+*/
+typedef enum {
+  UART_FD_EVENT_RX_THRESHOLD  = (1 << 0), /**< @brief The Rx bytes available rose to the Rx threshold */
+  UART_FD_EVENT_TX_READY      = (1 << 1), /**< @brief The Fusion firmware Tx buffer is no longer almost full */
+  UART_FD_EVENT_ERROR         = (1 << 2), /**< @brief An error condition was detected */
+  UART_FD_EVENT_RX_ALMOST_FULL = (1 << 3) /**< @brief The Fusion firmware Rx buffer became almost full */
+} uart_fd_event_type;
+
+/** ddi_fusion_uart_enable_event_fd
+ @brief Return a pollable file descriptor for the given UART channel
+ The file descriptor is an eventfd that becomes readable when one of the enabled events occurs. The events are detected on
+ the edges of the UART status process data in the cyclic thread, which only sets the event and never runs application code.
+ The file descriptor is owned by the SDK and is closed by ddi_fusion_uart_disable_event_fd() or ddi_fusion_uart_close().
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[in] event_flags The events to signal @see uart_fd_event_type
+ @param[in] rx_threshold The Rx bytes available that signal UART_FD_EVENT_RX_THRESHOLD, 1 signals any received data
+ @param[out] fd The event file descriptor, add it to a poll/epoll set with POLLIN/EPOLLIN
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ Example Usage:
+ <PRE>
+ int fd;
+ uint32_t events;
+ struct epoll_event ev = { EPOLLIN };
+ ddi_fusion_uart_enable_event_fd(handle, UART_FD_EVENT_RX_THRESHOLD | UART_FD_EVENT_ERROR, 1, &fd);
+ ev.data.u32 = handle;
+ epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+ ...
+ // After epoll_wait() reports the handle
+ ddi_fusion_uart_get_fd_events(ev.data.u32, &events);
+ if ( events & UART_FD_EVENT_RX_THRESHOLD )
+   ddi_fusion_uart_rx_data(ev.data.u32, buffer, &length);
+ </PRE>
+ */
+ddi_em_result ddi_fusion_uart_enable_event_fd (ddi_fusion_uart_handle handle, uint32_t event_flags, uint16_t rx_threshold, int *fd);
+
+/** ddi_fusion_uart_disable_event_fd
+ @brief Stop signalling events for the given UART channel and close its event file descriptor
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_disable_event_fd (ddi_fusion_uart_handle handle);
+
+/** ddi_fusion_uart_get_fd_events
+ @brief Return and clear the events signalled on the event file descriptor of the given UART channel
+ This also resets the file descriptor, so it becomes readable again on the next event
+ @param[in] handle The UART handle opened by ddi_fusion_uart_open
+ @param[out] events The events that occurred since the previous call @see uart_fd_event_type
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_get_fd_events (ddi_fusion_uart_handle handle, uint32_t *events);
+
 #ifdef __cplusplus
 }
 #endif
@@ -25,7 +25,18 @@ prior written authorization of DDI is prohibited.
 #include "ddi_em_translate.h"
 #include "ddi_em_remote_access.h"
 #include "ddi_em_fusion_interface.h"
+#include "ddi_em_fusion_uart_tx.h"
+#include "ddi_em_fusion_uart_framing.h"
+#include "ddi_em_fusion_uart_pty.h"
+#include "ddi_em_fusion_uart_rx_timing.h"
+#include "ddi_em_fusion_uart_lease.h"
 #include "ddi_em_slave_management.h"
+#include "ddi_em_realtime.h"
+#include "ddi_em_coe_async.h"
+#include "ddi_em_foe_stream.h"
+#include "ddi_em_pd_symbols.h"
+#include "ddi_em_pd_delta.h"
+#include "ddi_em_recorder.h"
 
 // This file provides basic master capability such as cyclic thread scheduling, SDK initialization
 // It contains the main functionality of the DDI ECAT Master SDK
@@ -74,6 +85,15 @@ EM_API ddi_em_result ddi_em_deinit(ddi_em_handle em_handle)
       ELOG(em_handle, "Event Handler Deinit failed %s \n", ddi_em_get_error_string(result));
     }
   }
+  ddi_em_notify_deinit(em_handle);
+
+  ddi_em_telemetry_deinit(em_handle);
+  ddi_em_coe_async_deinit(em_handle);
+  ddi_em_foe_stream_deinit(em_handle);
+  ddi_fusion_uart_pty_deinit(em_handle);
+  ddi_fusion_uart_framing_deinit(em_handle);
+  ddi_fusion_uart_tx_deinit(em_handle);
+  ddi_em_recorder_deinit(em_handle);
 
   // De-initialize the Acontis EC Master instance
   // The result from the Master De-init takes priority over the registration deinit
@@ -85,6 +105,8 @@ EM_API ddi_em_result ddi_em_deinit(ddi_em_handle em_handle)
   }
 
   ddi_em_close_all_slave_handles(em_handle);
+  ddi_em_pd_symbols_free(em_handle);
+  ddi_em_pd_delta_free(em_handle);
   return result;
 }
 
@@ -103,6 +125,21 @@ EM_API ddi_em_result ddi_em_register_cyclic_callback(ddi_em_handle em_handle, dd
   return DDI_EM_STATUS_OK;
 }
 
+// Set the cyclic callback budget and the optional fallback callback for an instance
+EM_API ddi_em_result ddi_em_set_callback_budget(ddi_em_handle em_handle, uint32_t budget_ns, ddi_em_cyclic_func *fallback, void *fallback_data)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  ddi_em_config *config = &g_em_instance[em_handle].master_config;
+  // The budget is disabled while the fallback is updated and published last, the cyclic thread loads it once per
+  // cycle and sees the fallback below once it sees the budget
+  __atomic_store_n(&config->callback_budget_ns, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&config->fallback_args, fallback_data, __ATOMIC_RELAXED);
+  __atomic_store_n(&config->fallback_callback, fallback, __ATOMIC_RELAXED);
+  __atomic_store_n(&g_em_instance[em_handle].master_status.callback_overrun, false, __ATOMIC_RELAXED);
+  __atomic_store_n(&config->callback_budget_ns, budget_ns, __ATOMIC_RELEASE);
+  return DDI_EM_STATUS_OK;
+}
+
 // Shutdown the thread instance
 ddi_em_result shutdown_thread_instance(ddi_em_handle em_handle)
 {
@@ -112,7 +149,8 @@ ddi_em_result shutdown_thread_instance(ddi_em_handle em_handle)
   if ( g_em_instance[em_handle].master_config.cyclic_thread_enabled ) // If there's a thread, wait for it to exit
   {
     // Wait for cyclic thread to exit
-    ddi_thread_join(g_em_instance[em_handle].master_status.cyclic_thread_handle,NULL);
+    pthread_join(g_em_instance[em_handle].master_status.cyclic_thread_tid, NULL);
+    g_em_instance[em_handle].master_config.cyclic_thread_enabled = 0;
   }
   while ( g_em_instance[em_handle].master_status.thread_exit_occurred == 0 ) // Wait for the cyclic thread to exit
   {
@@ -154,9 +192,10 @@ ddi_em_result log_cyclic_stastics (ddi_em_instance *instance, ddi_em_master_stat
       {
         stats->min_cyclic_timestamp_diff_ns = (uint32_t)cyclic_delta_ns;
       }
-      // Keep track of the average cyclic data delta
+      // Keep track of the average cyclic data delta, the count restarts with each cycle rate change
       instance->master_status.average_cyclic_delta_sum += (uint64_t)cyclic_delta_ns;
-      stats->average_cyclic_timestamp_diff_ns = instance->master_status.average_cyclic_delta_sum /total_cyclic_frames;
+      instance->master_status.cyclic_delta_count++;
+      stats->average_cyclic_timestamp_diff_ns = instance->master_status.average_cyclic_delta_sum / instance->master_status.cyclic_delta_count;
     }
   }
   // Update the previous timestmap
@@ -165,16 +204,116 @@ ddi_em_result log_cyclic_stastics (ddi_em_instance *instance, ddi_em_master_stat
   return DDI_EM_STATUS_OK;
 }
 
+// Send the acyclic frames for this cycle. In adaptive mode, additional jobs are sent while the cycle has slack
+// The adaptive settings are changed by ddi_em_set_acyc_bandwidth() while the cyclic thread runs, they are read atomically
+static uint32_t send_acyclic_frames (ddi_em_instance *instance, ntime_t *cycle_start)
+{
+  ddi_em_handle em_handle = instance->master_config.em_handle;
+  ddi_em_acyc_bandwidth *bandwidth = &instance->master_config.acyc_bandwidth;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  uint32_t result;
+  uint32_t jobs = 1;
+  uint32_t jobs_per_cycle, max_jobs;
+  int64_t deadline_ns;
+  ntime_t current_ts;
+
+  result = emExecJob(em_handle, eUsrJob_SendAcycFrames, EC_NULL);
+  if ( !__atomic_load_n(&bandwidth->adaptive_enable, __ATOMIC_ACQUIRE) || (result != EC_E_NOERROR) )
+  {
+    return result;
+  }
+
+  deadline_ns = (int64_t)instance->master_config.bus_cycle_us * NSEC_PER_USEC *
+    __atomic_load_n(&bandwidth->adaptive_deadline_percent, __ATOMIC_RELAXED) / 100;
+  max_jobs = __atomic_load_n(&bandwidth->adaptive_max_jobs, __ATOMIC_RELAXED);
+  // The budget never exceeds a maximum lowered since the last cycle
+  jobs_per_cycle = __atomic_load_n(&stats->acyc_jobs_per_cycle, __ATOMIC_RELAXED);
+  if ( jobs_per_cycle > max_jobs )
+  {
+    jobs_per_cycle = max_jobs;
+  }
+  ddi_ntime_get_systime(&current_ts);
+  if ( ddi_ntime_diff_ns(&current_ts, cycle_start) >= deadline_ns )
+  {
+    // The cycle is already close to its deadline, halve the acyclic budget
+    if ( jobs_per_cycle > 1 )
+    {
+      jobs_per_cycle /= 2;
+    }
+    __atomic_store_n(&stats->acyc_jobs_per_cycle, jobs_per_cycle, __ATOMIC_RELAXED);
+    stats->acyc_backoff_count++;
+    return result;
+  }
+  while ( jobs < jobs_per_cycle )
+  {
+    result = emExecJob(em_handle, eUsrJob_SendAcycFrames, EC_NULL);
+    jobs++;
+    ddi_ntime_get_systime(&current_ts);
+    if ( (result != EC_E_NOERROR) || (ddi_ntime_diff_ns(&current_ts, cycle_start) >= deadline_ns) )
+    {
+      return result;
+    }
+  }
+  // The full budget was sent with slack left, allow one more job next cycle
+  if ( jobs_per_cycle < max_jobs )
+  {
+    jobs_per_cycle++;
+  }
+  __atomic_store_n(&stats->acyc_jobs_per_cycle, jobs_per_cycle, __ATOMIC_RELAXED);
+  return result;
+}
+
+// Run the cyclic callback and check its duration against the callback budget
+// After an overrun, the fallback callback (if registered) runs in place of the cyclic callback for one cycle
+static void run_budgeted_callback (ddi_em_instance *instance, uint32_t budget_ns)
+{
+  ddi_em_config *config = &instance->master_config;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  ntime_t start_ts;
+  ntime_t end_ts;
+  uint32_t duration_ns;
+
+  ddi_ntime_get_systime(&start_ts);
+  ddi_em_cyclic_func *fallback = __atomic_load_n(&config->fallback_callback, __ATOMIC_RELAXED);
+  if ( __atomic_load_n(&instance->master_status.callback_overrun, __ATOMIC_RELAXED) && (fallback != NULL) )
+  {
+    fallback(__atomic_load_n(&config->fallback_args, __ATOMIC_RELAXED));
+  }
+  else
+  {
+    config->cyclic_callback(config->cyclic_args);
+  }
+  ddi_ntime_get_systime(&end_ts);
+
+  duration_ns = (uint32_t)ddi_ntime_diff_ns(&end_ts, &start_ts);
+  stats->last_callback_duration_ns = duration_ns;
+  if ( duration_ns > stats->max_callback_duration_ns )
+  {
+    stats->max_callback_duration_ns = duration_ns;
+  }
+  bool overrun = (duration_ns > budget_ns);
+  __atomic_store_n(&instance->master_status.callback_overrun, overrun, __ATOMIC_RELAXED);
+  if ( overrun )
+  {
+    stats->callback_budget_overrun_count++;
+    snprintf(instance->master_status.event_str, sizeof(instance->master_status.event_str),
+      "Cyclic callback took %u ns, budget is %u ns", duration_ns, budget_ns);
+    ddi_em_notify_event(config->em_handle, DDI_EM_INVALID_HANDLE, DDI_EM_EVENT_ERR_CALLBACK_BUDGET,
+      instance->master_status.event_str, duration_ns);
+  }
+}
+
 // Perform Acontis-related job update duties
 static uint32_t cyclic_update (ddi_em_instance *instance)
 {
   ddi_em_handle em_handle = instance->master_config.em_handle;
-  static uint32_t lost_frame_count = 0;
   uint32_t result;
   EC_T_USER_JOB_PARMS  oJobParms;
   memset(&oJobParms, 0, sizeof(EC_T_USER_JOB_PARMS));
   ddi_em_master_stats *stats;
   stats = &instance->master_status.master_stats;
+  ntime_t cycle_start;
+  ddi_ntime_get_systime(&cycle_start);
 
   // Process cyclic data receive
   result = emExecJob(em_handle, eUsrJob_ProcessAllRxFrames,&oJobParms);
@@ -193,7 +332,7 @@ static uint32_t cyclic_update (ddi_em_instance *instance)
       ELOG(em_handle, "Master[%d] cyclic thread lost frame detected \n", em_handle);
       if (stats->cur_consecutive_err_frame_count == DDI_EM_LOST_FRAME_COUNT_MAX)
       {
-        ELOG(em_handle,"Master[%d] cyclic thread %d consecutive lost frames received\n", em_handle, lost_frame_count);
+        ELOG(em_handle,"Master[%d] cyclic thread %d consecutive lost frames received\n", em_handle, stats->cur_consecutive_err_frame_count);
       }
     }
     else
@@ -202,18 +341,32 @@ static uint32_t cyclic_update (ddi_em_instance *instance)
       // reset lost frame count on successful rx completion
       stats->cur_consecutive_err_frame_count=0;
     }
+    ddi_em_telemetry_cycle(em_handle, !oJobParms.bAllCycFramesProcessed);
+    // Find the inputs that changed since the previous cycle before the callback looks at them
+    ddi_em_pd_delta_cycle(em_handle);
   }
 
   // If the master cyclic callback function is registered and the master state is greater than INIT, execute the callback
   if ( (instance->master_config.cyclic_callback  != NULL) && (emGetMasterState(em_handle) >= eEcatState_INIT) )
   {
-    // Call the process data callback
-    instance->master_config.cyclic_callback(instance->master_config.cyclic_args);
+    uint32_t budget_ns = __atomic_load_n(&instance->master_config.callback_budget_ns, __ATOMIC_ACQUIRE);
+    if ( budget_ns )
+    {
+      run_budgeted_callback(instance, budget_ns);
+    }
+    else
+    {
+      // Call the process data callback
+      instance->master_config.cyclic_callback(instance->master_config.cyclic_args);
+    }
   }
 
   // Handle any Fusion-specific processing
   ddi_em_fusion_handle_process_data(instance->master_config.em_handle);
 
+  // Record the inputs of this cycle together with the outputs about to be sent
+  ddi_em_recorder_cycle(em_handle, &cycle_start);
+
   // Record cyclic statistics
   log_cyclic_stastics(instance, stats);
 
@@ -230,7 +383,7 @@ static uint32_t cyclic_update (ddi_em_instance *instance)
     ELOG(em_handle, "Master[%d] cyclic thread - Admin Jobs: %s (0x%x)\n", em_handle, ecatGetText(result), result);
   }
   //send acyclic frames
-  result = emExecJob(em_handle, eUsrJob_SendAcycFrames, EC_NULL);
+  result = send_acyclic_frames(instance, &cycle_start);
   if (EC_E_NOERROR != result && EC_E_INVALIDSTATE != result && EC_E_LINK_DISCONNECTED != result)
   {
     ELOG(em_handle, "Master[%d] cyclic thread - Acyclic Frames: %s (0x%x)\n", em_handle, ecatGetText(result), result);
@@ -239,12 +392,96 @@ static uint32_t cyclic_update (ddi_em_instance *instance)
   return result;
 }
 
+// Start the page fault self-check window of the cyclic thread
+static void page_fault_check_start (ddi_em_instance *instance)
+{
+  ddi_em_rt_get_page_faults(&instance->master_status.page_fault_minor_base, &instance->master_status.page_fault_major_base);
+  instance->master_status.master_stats.startup_page_fault_check_done = 0;
+}
+
+// Complete the page fault self-check window and report the faults taken during it
+static void page_fault_check_complete (ddi_em_instance *instance)
+{
+  ddi_em_handle em_handle = instance->master_config.em_handle;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  uint64_t minor_faults;
+  uint64_t major_faults;
+
+  ddi_em_rt_get_page_faults(&minor_faults, &major_faults);
+  stats->startup_minor_page_faults = (uint32_t)(minor_faults - instance->master_status.page_fault_minor_base);
+  stats->startup_major_page_faults = (uint32_t)(major_faults - instance->master_status.page_fault_major_base);
+  stats->startup_page_fault_check_done = 1;
+  if ( stats->startup_major_page_faults || stats->startup_minor_page_faults )
+  {
+    WLOG(em_handle, "Master[%d] cyclic thread took %u minor and %u major page faults during the first %u cycles \n", em_handle,
+      stats->startup_minor_page_faults, stats->startup_major_page_faults, instance->master_config.rt_config.page_fault_check_cycles);
+  }
+  else
+  {
+    DLOG(em_handle, "Master[%d] cyclic thread took no page faults during the first %u cycles \n", em_handle,
+      instance->master_config.rt_config.page_fault_check_cycles);
+  }
+}
+
+// Switch to a new cycle rate at the cycle boundary. The deadline of the boundary cycle has passed, so the next
+// deadline is one new period after it. The timestamp statistics restart so they describe the new rate only.
+static void apply_cycle_rate (ddi_em_instance *instance, uint32_t cycle_rate_us, ntime_t *deadline)
+{
+  ddi_em_handle em_handle = instance->master_config.em_handle;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  EC_T_DWORD bus_cycle_us = cycle_rate_us;
+  ntime_t current_time;
+  uint32_t result;
+
+  // Keep the stack's timeouts in line with the real cycle
+  result = emIoCtl(em_handle, EC_IOCTL_SET_BUS_CYCLE_TIME, (EC_T_BYTE*)&bus_cycle_us, sizeof(EC_T_DWORD), EC_NULL, 0, EC_NULL);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] cyclic thread - Cycle rate change to %u us rejected: %s (0x%x)\n", em_handle, cycle_rate_us, ecatGetText(result), result);
+    ddi_ntime_add_ns(deadline, 0, instance->master_config.bus_cycle_us * NSEC_PER_USEC);
+    return;
+  }
+  instance->master_config.bus_cycle_us = cycle_rate_us;
+
+  // Re-arm the absolute deadline, if the boundary cycle overran the new period start from now
+  ddi_ntime_add_ns(deadline, 0, cycle_rate_us * NSEC_PER_USEC);
+  ddi_ntime_get_systime(&current_time);
+  if ( ddi_ntime_diff_ns(deadline, &current_time) < 0 )
+  {
+    *deadline = current_time;
+    ddi_ntime_add_ns(deadline, 0, cycle_rate_us * NSEC_PER_USEC);
+  }
+
+  ddi_em_rt_update_cycle_rate(em_handle, &instance->master_config.rt_config, cycle_rate_us);
+
+  stats->max_cyclic_timestamp_diff_ns = 0;
+  stats->min_cyclic_timestamp_diff_ns = 0;
+  stats->average_cyclic_timestamp_diff_ns = 0;
+  instance->master_status.average_cyclic_delta_sum = 0;
+  instance->master_status.cyclic_delta_count = 0;
+  stats->cycle_rate_us = cycle_rate_us;
+  stats->cycle_rate_change_count++;
+  DLOG(em_handle, "Master[%d] cyclic thread - Cycle rate changed to %u us \n", em_handle, cycle_rate_us);
+}
+
 static ddi_em_result cyclic_thread_scheduler (ddi_em_instance *instance)
 {
   ntime_t deadline;
   ntime_t current_time;
   pthread_t current_thread_tid;
+  uint32_t page_fault_check_cycles = instance->master_config.rt_config.page_fault_check_cycles;
+  uint32_t cycle_rate_us;
 
+  // A replay drives the process image itself. The scheduler is claimed before checking for a replay and
+  // ddi_em_replay_run() claims the replay before checking the scheduler, so one of the two always backs off
+  __atomic_store_n(&instance->master_status.scheduler_running, true, __ATOMIC_SEQ_CST);
+  if ( __atomic_load_n(&instance->master_status.replay_active, __ATOMIC_SEQ_CST) )
+  {
+    ELOG(instance->master_config.em_handle, "Master[%d] cyclic thread: a replay is running \n", instance->master_config.em_handle);
+    __atomic_store_n(&instance->master_status.scheduler_running, false, __ATOMIC_SEQ_CST);
+    instance->master_status.thread_exit_occurred = 1;
+    return DDI_EM_STATUS_BUSY;
+  }
   ddi_ntime_get_systime(&current_time);
   deadline.ns = current_time.ns;
   deadline.sec = current_time.sec;
@@ -260,24 +497,54 @@ static ddi_em_result cyclic_thread_scheduler (ddi_em_instance *instance)
     if ( ret != 0 )
     {
       ELOG(instance->master_config.em_handle, "Master[%d] init: Setting CPU affinity failed ret %d \n", instance->master_config.em_handle, ret);
+      instance->master_status.scheduler_running = false;
       return DDI_EM_STATUS_CPU_AFFINITY_ERR;
     }
   }
 
+  if ( instance->master_config.rt_config.stack_prefault_size ) // Touch the stack before the first cycle
+  {
+    ddi_em_rt_prefault_stack(instance->master_config.em_handle, instance->master_config.rt_config.stack_prefault_size);
+  }
+  if ( page_fault_check_cycles )
+  {
+    page_fault_check_start(instance);
+  }
+
   while(instance->master_config.thread_exit_enabled == 0)
   {
     ddi_ntime_sleep_ns(&deadline); // Sleep until the deadline using clock_nanosleep
     cyclic_update(instance); // Update the cyclic job
-    ddi_ntime_add_ns(&deadline, 0, instance->master_config.bus_cycle_us * NSEC_PER_USEC); // Increment the deadline;
+    // Apply a requested cycle rate change at this cycle boundary
+    cycle_rate_us = __atomic_exchange_n(&instance->master_status.pending_cycle_rate_us, 0, __ATOMIC_ACQ_REL);
+    if ( cycle_rate_us )
+    {
+      apply_cycle_rate(instance, cycle_rate_us, &deadline);
+    }
+    else
+    {
+      ddi_ntime_add_ns(&deadline, 0, instance->master_config.bus_cycle_us * NSEC_PER_USEC); // Increment the deadline;
+    }
+    if ( page_fault_check_cycles && (--page_fault_check_cycles == 0) )
+    {
+      page_fault_check_complete(instance);
+    }
   }
 
+  instance->master_status.scheduler_running = false;
   instance->master_status.thread_exit_occurred = 1;
   return DDI_EM_STATUS_OK;
 }
 
-static void * ddi_cyclic_thread(const void *arg)
+static void * ddi_cyclic_thread(void *arg)
 {
   ddi_em_instance *instance = (ddi_em_instance *)arg;
+  // SCHED_DEADLINE can only be applied by the thread itself
+  if ( ddi_em_rt_apply_deadline(instance->master_config.em_handle, &instance->master_config.rt_config) != DDI_EM_STATUS_OK )
+  {
+    instance->master_status.thread_exit_occurred = 1;
+    return NULL;
+  }
   cyclic_thread_scheduler(instance);
   return NULL;
 }
@@ -417,6 +684,10 @@ EM_API ddi_em_result ddi_em_sdk_init(void)
 
 EM_API ddi_em_result ddi_em_sdk_deinit(void)
 {
+  // Free the UART buffers kept for the reopens of the handles, the master instances are de-initialized by now
+  ddi_fusion_uart_rx_timing_deinit();
+  ddi_fusion_uart_lease_deinit();
+  ddi_fusion_uart_tx_free_channels();
   // De-initialize the global instance structure
   g_sdk_initalized = 0;
   return DDI_EM_STATUS_OK;
@@ -440,6 +711,13 @@ static ddi_em_result get_next_instance (ddi_em_handle *handle)
   return DDI_EM_STATUS_NO_RESOURCES;
 }
 
+// Give back an instance claimed by get_next_instance() when ddi_em_init() fails before the master is created
+static void release_instance (ddi_em_handle handle)
+{
+  ddi_em_logging_deinit(handle);
+  g_em_instance[handle].master_config.enabled = 0;
+}
+
 // Instance version of the init routine
 ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_handle)
 {
@@ -472,6 +750,33 @@ ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_
     return DDI_EM_STATUS_CPU_AFFINITY_ERR;
   }
 
+  // Validate the real-time parameters of the cyclic thread
+  ddi_em_rt_config rt_config;
+  memset(&rt_config, 0, sizeof(ddi_em_rt_config));
+  rt_config.stack_size              = em_init_params->cyclic_stack_size;
+  rt_config.stack_prefault_size     = em_init_params->stack_prefault_size;
+  rt_config.sched_policy            = em_init_params->cyclic_sched_policy;
+  rt_config.priority                = em_init_params->polling_thread_priority;
+  rt_config.deadline_runtime_ns     = em_init_params->deadline_runtime_ns;
+  rt_config.deadline_period_ns      = em_init_params->deadline_period_ns;
+  rt_config.page_fault_check_cycles = em_init_params->page_fault_check_cycles;
+  em_result = ddi_em_rt_validate_config(&rt_config, em_init_params->scan_rate_us,
+                em_init_params->enable_cyclic_thread && em_init_params->enable_cpu_affinity);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    // Logging not available yet for this instance
+    printf(RED "Master init: Invalid cyclic thread scheduling parameters (SCHED_DEADLINE requires a runtime <= period and no CPU affinity)" CLEAR "\n");
+    return em_result;
+  }
+
+  // Validate the acyclic bandwidth parameters before an instance is claimed, zero values select the defaults
+  if ( em_init_params->acyc_bandwidth.adaptive_deadline_percent > 100 )
+  {
+    // Logging not available yet for this instance
+    printf(RED "Master init: Invalid acyclic bandwidth parameters (the adaptive deadline is a percentage of the cycle)" CLEAR "\n");
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+
   em_result=get_next_instance(em_handle);
   if ( em_result != DDI_EM_STATUS_OK ) // Validate instance return code
   {
@@ -495,10 +800,32 @@ ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_
     ELOG(instance, "Master[%d] init: Network adapter %d already registered \n", instance, em_init_params->network_adapter);
     return DDI_EM_NIC_ALREADY_REG;
   }
+  // Lock and prefault memory before the master allocates its resources
+  if ( em_init_params->enable_memory_lock )
+  {
+    em_result = ddi_em_rt_lock_memory(instance);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      release_instance(instance);
+      return em_result;
+    }
+  }
+  if ( em_init_params->heap_prefault_size )
+  {
+    em_result = ddi_em_rt_prefault_heap(instance, em_init_params->heap_prefault_size);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      release_instance(instance);
+      return em_result;
+    }
+  }
+  g_em_instance[instance].master_config.rt_config = rt_config;
+
   ddi_mutex_create(&g_em_instance[instance].master_status.pd_out_mutex);
   g_em_instance[instance].master_config.em_handle = instance;
   // Set the initial scan rate
   g_em_instance[instance].master_config.bus_cycle_us = em_init_params->scan_rate_us;
+  g_em_instance[instance].master_status.master_stats.cycle_rate_us = em_init_params->scan_rate_us;
   // Create the optimized link layer instance
   link_layer_i8254_init(instance,&g_em_instance[instance].master_config.param_ptr, em_init_params->network_adapter);
 
@@ -513,17 +840,34 @@ ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_
   init_params.dwMaxBusSlaves                = DDI_EM_MAX_BUS_SLAVES;
   // The following parameters determine the amount of bytes and acyclic commands sent per cyclic update
   // These values were borrowed from the Acontis EcMasterDemo.cpp file
-  init_params.dwMaxAcycFramesQueued         = DDI_EM_MAX_ACYC_FRAMES_QUEUED;
-  init_params.dwMaxAcycFramesPerCycle       = DDI_EM_MAX_ACYC_FRAMES_PER_CYCLE;
-  init_params.dwMaxAcycCmdsPerCycle         = DDI_EM_MAX_ACYC_CMD_PER_CYCLE;
-  if (init_params.dwBusCycleTimeUsec >= 1000)
+  // Zero values in the acyclic bandwidth parameters select these defaults
+  ddi_em_acyc_bandwidth *acyc_bandwidth = &g_em_instance[instance].master_config.acyc_bandwidth;
+  *acyc_bandwidth = em_init_params->acyc_bandwidth;
+  if ( acyc_bandwidth->frames_per_cycle == 0 )
   {
-    init_params.dwMaxAcycBytesPerCycle      = DDI_EM_MAX_ACYC_BYTES_PER_CYC_1MS;
+    acyc_bandwidth->frames_per_cycle = DDI_EM_MAX_ACYC_FRAMES_PER_CYCLE;
   }
-  else
+  if ( acyc_bandwidth->cmds_per_cycle == 0 )
+  {
+    acyc_bandwidth->cmds_per_cycle = DDI_EM_MAX_ACYC_CMD_PER_CYCLE;
+  }
+  if ( acyc_bandwidth->bytes_per_cycle == 0 )
   {
-    init_params.dwMaxAcycBytesPerCycle      = DDI_EM_MAX_ACYC_BYTES_PER_CYC;
+    if (em_init_params->scan_rate_us >= 1000)
+    {
+      acyc_bandwidth->bytes_per_cycle = DDI_EM_MAX_ACYC_BYTES_PER_CYC_1MS;
+    }
+    else
+    {
+      acyc_bandwidth->bytes_per_cycle = DDI_EM_MAX_ACYC_BYTES_PER_CYC;
+    }
   }
+  g_em_instance[instance].master_status.master_stats.acyc_jobs_per_cycle = 1;
+  ddi_em_set_acyc_bandwidth(instance, &em_init_params->acyc_bandwidth); // Fill in the adaptive defaults, validated above
+  init_params.dwMaxAcycFramesQueued         = DDI_EM_MAX_ACYC_FRAMES_QUEUED;
+  init_params.dwMaxAcycFramesPerCycle       = acyc_bandwidth->frames_per_cycle;
+  init_params.dwMaxAcycCmdsPerCycle         = acyc_bandwidth->cmds_per_cycle;
+  init_params.dwMaxAcycBytesPerCycle        = acyc_bandwidth->bytes_per_cycle;
   init_params.dwEcatCmdMaxRetries           = DDI_EM_CFG_MAX_ACYC_CMD_RETRIES;
 
   //------------ Initialize the EtherCAT master stack -------------
@@ -545,6 +889,15 @@ ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_
 
   DLOG(instance, "Master[%d] init: init master result = 0x%04x \n",result);
 
+  // Start counting lost frames and working counter mismatches
+  ddi_em_telemetry_init(instance);
+  ddi_em_coe_async_init(instance);
+  ddi_em_foe_stream_init(instance);
+  ddi_fusion_uart_tx_init(instance);
+  ddi_fusion_uart_framing_init(instance);
+  ddi_fusion_uart_rx_timing_init(instance);
+  ddi_em_pd_delta_init(instance);
+
   // Setup the license file
   license_file_name = getenv("DDI_EM_LICENSE_FILE");
   // If the DDI_EM_LICENSE_FILE enviornent variable is not defined, use the default license file
@@ -575,14 +928,17 @@ ddi_em_result ddi_em_init(ddi_em_init_params *em_init_params, ddi_em_handle *em_
 
   if ( em_init_params->enable_cyclic_thread == 1 )
   {
-    g_em_instance[instance].master_config.cyclic_thread_enabled = 1;
-    // create the cyclic data thread
-    ddi_thread_create_with_scheduler(&g_em_instance[instance].master_status.cyclic_thread_handle,
-      SCHED_RR, em_init_params->polling_thread_priority, DDI_CYCLIC_THREAD_STACK_SIZE, "cyclic_process_data", ddi_cyclic_thread, (void*)&g_em_instance[instance]);
-    ddi_thread_detach(g_em_instance[instance].master_status.cyclic_thread_handle);
-
+    // The affinity is applied by the cyclic thread, so it must be set before the thread is created
     g_em_instance[instance].master_config.enable_cpu_affinity = em_init_params->enable_cpu_affinity;
     g_em_instance[instance].master_config.cyclic_cpu_select = em_init_params->cyclic_cpu_select;
+    // create the cyclic data thread
+    em_result = ddi_em_rt_thread_create(instance, &g_em_instance[instance].master_config.rt_config,
+      &g_em_instance[instance].master_status.cyclic_thread_tid, ddi_cyclic_thread, (void*)&g_em_instance[instance]);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      return em_result;
+    }
+    g_em_instance[instance].master_config.cyclic_thread_enabled = 1;
   }
 
   // EM-57, update network control flags in the master configuration instance
@@ -596,6 +952,7 @@ EM_API ddi_em_result ddi_em_configure_master(ddi_em_handle em_handle, const char
 {
   uint8_t enable_partial_network_support = 0;
   uint32_t result;
+  ddi_em_result em_result;
 
   VALIDATE_INSTANCE(em_handle); // Validate the instance argument
 
@@ -634,11 +991,37 @@ EM_API ddi_em_result ddi_em_configure_master(ddi_em_handle em_handle, const char
     }
   }
 
+  // Count the working counter mismatches of the new configuration
+  em_result = ddi_em_telemetry_register(em_handle);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+  // Receive the completions of the asynchronous CoE requests
+  em_result = ddi_em_coe_async_register(em_handle);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+
   // Update the input process data pointer for this master
   g_em_instance[em_handle].master_config.pd_input  = emGetProcessImageInputPtr(em_handle);
   // Update the output process data pointer for this master
   g_em_instance[em_handle].master_config.pd_output = emGetProcessImageOutputPtr(em_handle);
 
+  // Hash the ENI process variable names for ddi_em_pd_lookup() and ddi_em_pd_bind()
+  em_result = ddi_em_pd_symbols_build(em_handle);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+  // Size the input change detection for the new input image
+  em_result = ddi_em_pd_delta_build(em_handle);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+
   // Scan the EtherCAT network
   result = emScanBus(em_handle, DDI_EM_SCAN_NETWORK_TIMEOUT);
 
@@ -676,11 +1059,76 @@ EM_API ddi_em_result ddi_em_configure_master(ddi_em_handle em_handle, const char
   return DDI_EM_STATUS_OK;
 }
 
-// Set the cycle rate
+// Set the cycle rate, a running cyclic task switches at its next cycle boundary
 EM_API ddi_em_result ddi_em_set_cycle_rate(ddi_em_handle em_handle, uint32_t cycle_rate_us)
+{
+  ddi_em_instance *instance;
+  EC_T_DWORD bus_cycle_us = cycle_rate_us;
+  uint32_t result;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  instance = &g_em_instance[em_handle];
+  if ( (cycle_rate_us == 0) || (ddi_em_rt_check_cycle_rate(&instance->master_config.rt_config, cycle_rate_us) != DDI_EM_STATUS_OK) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  if ( instance->master_status.scheduler_running )
+  {
+    __atomic_store_n(&instance->master_status.pending_cycle_rate_us, cycle_rate_us, __ATOMIC_RELEASE);
+    return DDI_EM_STATUS_OK;
+  }
+  // No cyclic task, update the stack and the scheduler period directly
+  result = emIoCtl(em_handle, EC_IOCTL_SET_BUS_CYCLE_TIME, (EC_T_BYTE*)&bus_cycle_us, sizeof(EC_T_DWORD), EC_NULL, 0, EC_NULL);
+  if ( result != EC_E_NOERROR )
+  {
+    return translate_ddi_acontis_err_code(em_handle, result); // Return the Acontis->DDI translated error code
+  }
+  instance->master_config.bus_cycle_us = cycle_rate_us;
+  instance->master_status.master_stats.cycle_rate_us = cycle_rate_us;
+  instance->master_status.master_stats.cycle_rate_change_count++;
+  return DDI_EM_STATUS_OK;
+}
+
+// Update the adaptive acyclic bandwidth settings, the per-job limits are fixed by emInitMaster()
+// The cyclic thread reads the settings while they are updated, they are written atomically
+EM_API ddi_em_result ddi_em_set_acyc_bandwidth(ddi_em_handle em_handle, ddi_em_acyc_bandwidth *acyc_bandwidth)
 {
   VALIDATE_INSTANCE(em_handle); // Validate the instance argument
-  g_em_instance[em_handle].master_config.bus_cycle_us = cycle_rate_us;
+  if ( acyc_bandwidth == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( acyc_bandwidth->adaptive_deadline_percent > 100 )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  ddi_em_acyc_bandwidth *config = &g_em_instance[em_handle].master_config.acyc_bandwidth;
+  uint32_t max_jobs = acyc_bandwidth->adaptive_max_jobs ? acyc_bandwidth->adaptive_max_jobs : DDI_EM_ACYC_ADAPTIVE_MAX_JOBS;
+  __atomic_store_n(&config->adaptive_max_jobs, max_jobs, __ATOMIC_RELAXED);
+  __atomic_store_n(&config->adaptive_deadline_percent, acyc_bandwidth->adaptive_deadline_percent ?
+    acyc_bandwidth->adaptive_deadline_percent : DDI_EM_ACYC_ADAPTIVE_DEADLINE_PERCENT, __ATOMIC_RELAXED);
+  ddi_em_master_stats *stats = &g_em_instance[em_handle].master_status.master_stats;
+  if ( !acyc_bandwidth->adaptive_enable || (__atomic_load_n(&stats->acyc_jobs_per_cycle, __ATOMIC_RELAXED) > max_jobs) )
+  {
+    __atomic_store_n(&stats->acyc_jobs_per_cycle, acyc_bandwidth->adaptive_enable ? max_jobs : 1, __ATOMIC_RELAXED);
+  }
+  // Published last, the cyclic thread sees the limits above once it sees adaptive mode enabled
+  __atomic_store_n(&config->adaptive_enable, acyc_bandwidth->adaptive_enable, __ATOMIC_RELEASE);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the acyclic bandwidth settings in use
+EM_API ddi_em_result ddi_em_get_acyc_bandwidth(ddi_em_handle em_handle, ddi_em_acyc_bandwidth *acyc_bandwidth)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( acyc_bandwidth == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  ddi_em_acyc_bandwidth *config = &g_em_instance[em_handle].master_config.acyc_bandwidth;
+  memcpy(acyc_bandwidth, config, sizeof(ddi_em_acyc_bandwidth));
+  acyc_bandwidth->adaptive_enable = __atomic_load_n(&config->adaptive_enable, __ATOMIC_ACQUIRE);
+  acyc_bandwidth->adaptive_max_jobs = __atomic_load_n(&config->adaptive_max_jobs, __ATOMIC_RELAXED);
+  acyc_bandwidth->adaptive_deadline_percent = __atomic_load_n(&config->adaptive_deadline_percent, __ATOMIC_RELAXED);
   return DDI_EM_STATUS_OK;
 }
 
@@ -693,6 +1141,7 @@ EM_API ddi_em_result ddi_em_get_master_stats(ddi_em_handle em_handle, ddi_em_mas
     return DDI_EM_STATUS_INVALID_ARG;
   }
   memcpy(master_stats,&g_em_instance[em_handle].master_status.master_stats, sizeof(ddi_em_master_stats));
+  master_stats->ms_since_last_frame_loss = ddi_em_telemetry_ms_since_frame_loss(em_handle);
   return DDI_EM_STATUS_OK;
 }
 
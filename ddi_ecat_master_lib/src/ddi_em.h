@@ -16,6 +16,8 @@ prior written authorization of DDI is prohibited.
 #include "ddi_os.h"
 #include "ddi_ntime.h"
 #include "ddi_em_fusion_interface.h"
+#include "ddi_em_realtime.h"
+#include "ddi_em_telemetry.h"
 
 /** @struct ddi_em_init_params
  *  @brief Slave information structure
@@ -37,10 +39,19 @@ typedef struct {
   uint32_t            average_cyclic_delta_ns; /**< Average cyclic delta reading  */
   uint64_t            average_cyclic_delta_sum;/**< Average accumulator  */
   ddi_mutex_handle_t  pd_out_mutex;            /**< Mutex for setting the output process data */
-  ddi_thread_handle_t cyclic_thread_handle;    /**< Cyclic thread handle */
+  pthread_t           cyclic_thread_tid;       /**< Cyclic thread id */
   uint32_t            thread_exit_occurred;    /**< Has the thread exit occurred? */
   uint32_t            notification_registered; /**< Has the event notification been registered? */
   uint32_t            notification_id;         /**< The acontis-based notification id */
+  uint64_t            page_fault_minor_base;   /**< Cyclic thread minor page faults at the start of the page fault check */
+  uint64_t            page_fault_major_base;   /**< Cyclic thread major page faults at the start of the page fault check */
+  bool                callback_overrun;        /**< Did the previous cyclic callback exceed its budget? */
+  char                event_str[DDI_EM_EVENT_MAX_STR_SIZE]; /**< Text of the last SDK-generated event */
+  ddi_em_telemetry    telemetry;               /**< Frame-loss and working counter telemetry */
+  uint32_t            pending_cycle_rate_us;   /**< Cycle rate to apply at the next cycle boundary, 0 = no change pending */
+  bool                scheduler_running;       /**< Is the cyclic task scheduler running? */
+  bool                replay_active;           /**< Does a replay own the process image? @see ddi_em_replay_run() */
+  uint64_t            cyclic_delta_count;      /**< Cyclic timestamp deltas in average_cyclic_delta_sum */
 } ddi_em_status;
 
 /** @struct ddi_em_config
@@ -61,6 +72,11 @@ typedef struct {
   ddi_em_cpu_select    cyclic_cpu_select;      /**< CPU affinity selection */
   uint32_t             cyclic_thread_enabled;  /**< Is the cyclic thread enabled? */
   uint32_t             network_control_flags;  /**< EtherCAT network control flags, used for partital network support */
+  ddi_em_rt_config     rt_config;              /**< Cyclic thread real-time configuration */
+  ddi_em_acyc_bandwidth acyc_bandwidth;       /**< Acyclic bandwidth configuration */
+  uint32_t             callback_budget_ns;     /**< Cyclic callback time budget in nanoseconds, 0 = disabled */
+  ddi_em_cyclic_func*  fallback_callback;      /**< Degraded callback run on the cycle after a budget overrun */
+  void*                fallback_args;          /**< Fallback callback arguments for this instance */
 } ddi_em_config;
 
 /** @struct ddi_em_instance
@@ -97,6 +113,23 @@ ddi_em_instance* get_master_instance(ddi_em_handle em_handle);
  */
 ddi_em_slave*    get_slave_instance(ddi_em_handle em_handle, ddi_em_handle slave_handle);
 
+/** ddi_em_notify_event
+ @brief Queue an SDK-generated event for the event handler of a master instance, the event thread of the instance
+        delivers it. Does not block, the event is dropped and counted if the queue is full.
+ @param em_handle The EtherCAT master handle
+ @param es_handle The EtherCAT slave handle, DDI_EM_INVALID_HANDLE for master events
+ @param event_code The event code @see ddi_em_event_type
+ @param event_str The event details in text format
+ @param event_value The event-specific value
+ */
+void ddi_em_notify_event(ddi_em_handle em_handle, ddi_es_handle es_handle, ddi_em_event_type event_code, const char *event_str, uint64_t event_value);
+
+/** ddi_em_notify_deinit
+ @brief Stop the event thread of a master instance and drop the events still queued
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_notify_deinit(ddi_em_handle em_handle);
+
 /** shutdown_thread_instance
  @brief Shutdown the main cyclic thread instance (if running)
  @param em_handle The EtherCAT master handle
@@ -10,12 +10,35 @@ prior written authorization of DDI is prohibited.
 #include <stdarg.h>
 #include <time.h>
 #include <signal.h>
+#include <string.h>
+#include <pthread.h>
 #include <AtEthercat.h>
 #include "ddi_debug.h"
+#include "ddi_ntime.h"
 #include "ddi_em_api.h"
 #include "ddi_em_config.h"
 #include "ddi_em_logging.h"
 #include "ddi_em_translate.h"
+#ifdef DDI_EM_TEST_STANDIN // Only built into the library variant the hardware-free tests link
+#include "ddi_em_coe_standin.h"
+
+typedef struct {
+  ddi_em_coe_standin_func *standin;
+  void                    *user_data;
+} coe_standin;
+
+// The mailbox stand-in of each master instance, see ddi_em_coe_standin.h
+static coe_standin g_coe_standin[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Set the mailbox stand-in of a master instance
+ddi_em_result ddi_em_coe_set_standin(ddi_em_handle em_handle, ddi_em_coe_standin_func *standin, void *user_data)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  g_coe_standin[em_handle].user_data = user_data;
+  __atomic_store_n(&g_coe_standin[em_handle].standin, standin, __ATOMIC_RELEASE);
+  return DDI_EM_STATUS_OK;
+}
+#endif // DDI_EM_TEST_STANDIN
 
 // Support COE read functionality
 EM_API ddi_em_result ddi_em_coe_read(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
@@ -23,6 +46,13 @@ EM_API ddi_em_result ddi_em_coe_read(ddi_em_handle em_handle, ddi_es_handle es_h
 {
   uint32_t result;
   VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+#ifdef DDI_EM_TEST_STANDIN
+  ddi_em_coe_standin_func *standin = __atomic_load_n(&g_coe_standin[em_handle].standin, __ATOMIC_ACQUIRE);
+  if ( standin != NULL )
+  {
+    return standin(em_handle, es_handle, index, subindex, data, len, out_len, flags, g_coe_standin[em_handle].user_data);
+  }
+#endif
   result = emCoeSdoUpload(em_handle, es_handle, index, subindex, data, len, out_len, timeout, flags);
   if ( result != ACONTIS_SUCCESS )
   {
@@ -38,6 +68,13 @@ EM_API ddi_em_result ddi_em_coe_write(ddi_em_handle em_handle, ddi_es_handle es_
 {
   uint32_t result;
   VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+#ifdef DDI_EM_TEST_STANDIN
+  ddi_em_coe_standin_func *standin = __atomic_load_n(&g_coe_standin[em_handle].standin, __ATOMIC_ACQUIRE);
+  if ( standin != NULL )
+  {
+    return standin(em_handle, es_handle, index, subindex, data, len, NULL, flags, g_coe_standin[em_handle].user_data);
+  }
+#endif
   result = emCoeSdoDownload(em_handle, es_handle, index, subindex, data, len, timeout, flags);
   if ( result != ACONTIS_SUCCESS )
   {
@@ -46,3 +83,428 @@ EM_API ddi_em_result ddi_em_coe_write(ddi_em_handle em_handle, ddi_es_handle es_
   }
   return DDI_EM_STATUS_OK;
 }
+
+// A batched CoE transfer is split into operations, each one is a single SDO transfer. An operation carries one item,
+// or a run of items of the same object that is merged into a complete access transfer. The operations of a slave
+// are queued per slave and started up to DDI_EM_COE_LIST_DEPTH at a time, the slaves run in parallel.
+typedef struct coe_list coe_list;
+
+typedef struct {
+  coe_list      *list;
+  uint32_t      first_item;    // First item carried by this operation
+  uint32_t      item_count;    // Number of items carried, > 1 for a complete access transfer
+  uint32_t      len;           // Transfer length in bytes
+  uint8_t       *buffer;       // Complete access read or write buffer, NULL for a single item
+  uint32_t      slave;         // Index in the slave table
+  int32_t       next;          // Next queued operation of the same slave
+  ddi_em_result result;        // Completion result
+  uint32_t      out_len;       // Completion read length
+  uint32_t      duration_us;   // Completion round-trip time
+} coe_list_op;
+
+typedef struct {
+  ddi_es_handle es_handle;
+  int32_t       head;          // Next operation to start
+  int32_t       tail;          // Last queued operation
+  uint32_t      queued;        // Operations started and not yet completed
+} coe_list_slave;
+
+struct coe_list {
+  pthread_mutex_t       lock;
+  pthread_cond_t        done_cond;
+  ddi_em_handle         em_handle;
+  ddi_em_coe_list_item  *items;
+  bool                  write;
+  uint32_t              timeout;
+  coe_list_op           *ops;          // Room for one operation per item plus the merged operations
+  uint32_t              op_count;
+  uint32_t              op_capacity;
+  coe_list_slave        *slaves;
+  uint32_t              slave_count;
+  int32_t               *done;         // Ring of completed operations, filled by the completion callback
+  uint32_t              done_head;
+  uint32_t              done_tail;
+  uint32_t              queued;        // Operations started and not yet completed, all slaves
+  uint32_t              outstanding;   // Operations not yet completed, started or not
+};
+
+#define COE_LIST_NO_OP -1
+
+// Completion callback of the list transfers, hands the operation back to the list thread
+static void coe_list_complete(ddi_em_coe_completion *completion)
+{
+  coe_list_op *op = (coe_list_op *)completion->user_data;
+  coe_list *list = op->list;
+
+  pthread_mutex_lock(&list->lock);
+  op->result = completion->result;
+  op->out_len = completion->out_len;
+  op->duration_us = completion->duration_us;
+  list->done[list->done_tail++ % list->op_capacity] = (int32_t)(op - list->ops);
+  pthread_cond_signal(&list->done_cond);
+  pthread_mutex_unlock(&list->lock);
+}
+
+// Return the slave table index of a slave handle, adding the slave on first use
+static uint32_t coe_list_slave_index(coe_list *list, ddi_es_handle es_handle)
+{
+  uint32_t index;
+  for ( index = 0; index < list->slave_count; index++ )
+  {
+    if ( list->slaves[index].es_handle == es_handle )
+    {
+      return index;
+    }
+  }
+  list->slaves[index].es_handle = es_handle;
+  list->slaves[index].head = COE_LIST_NO_OP;
+  list->slaves[index].tail = COE_LIST_NO_OP;
+  list->slaves[index].queued = 0;
+  list->slave_count++;
+  return index;
+}
+
+// Add an operation for count items starting at first_item and return its index
+static int32_t coe_list_add_op(coe_list *list, uint32_t first_item, uint32_t count)
+{
+  coe_list_op *op = &list->ops[list->op_count];
+  memset(op, 0, sizeof(coe_list_op));
+  op->list = list;
+  op->first_item = first_item;
+  op->item_count = count;
+  op->len = list->items[first_item].len;
+  op->slave = coe_list_slave_index(list, list->items[first_item].es_handle);
+  op->next = COE_LIST_NO_OP;
+  list->outstanding++;
+  return (int32_t)list->op_count++;
+}
+
+// Queue an operation at the end of its slave queue
+static void coe_list_append(coe_list *list, int32_t op_index)
+{
+  coe_list_slave *slave = &list->slaves[list->ops[op_index].slave];
+  if ( slave->tail == COE_LIST_NO_OP )
+  {
+    slave->head = op_index;
+  }
+  else
+  {
+    list->ops[slave->tail].next = op_index;
+  }
+  slave->tail = op_index;
+}
+
+// Return the number of consecutive items starting at first_item that can share one complete access transfer
+static uint32_t coe_list_run_length(coe_list *list, uint32_t first_item, uint32_t count)
+{
+  ddi_em_coe_list_item *first = &list->items[first_item];
+  uint32_t run = 1;
+  uint32_t len = first->len;
+
+  // Complete access starts at subindex 0 or 1, subindex 0 is padded to 16 bits so only runs from subindex 1 are merged
+  if ( first->subindex != 1 )
+  {
+    return 1;
+  }
+  while ( (first_item + run < count) && (list->items[first_item + run].es_handle == first->es_handle) &&
+          (list->items[first_item + run].index == first->index) && (list->items[first_item + run].subindex == first->subindex + run) )
+  {
+    len += list->items[first_item + run].len;
+    if ( !list->write && (len > DDI_EM_COE_LIST_CA_READ_SIZE) )
+    {
+      break;
+    }
+    run++;
+  }
+  return run;
+}
+
+// Split the operations into per-slave queues, merging runs of subindexes into complete access transfers
+static ddi_em_result coe_list_build(coe_list *list, uint32_t count, uint32_t flags)
+{
+  uint32_t item = 0;
+  uint32_t run, offset, index;
+  int32_t op_index;
+  coe_list_op *op;
+
+  while ( item < count )
+  {
+    run = (flags & DDI_EM_COE_LIST_SINGLE_ACCESS) ? 1 : coe_list_run_length(list, item, count);
+    op_index = coe_list_add_op(list, item, run);
+    if ( run > 1 )
+    {
+      op = &list->ops[op_index];
+      op->len = 0;
+      for ( index = item; index < item + run; index++ )
+      {
+        op->len += list->items[index].len;
+      }
+      // The slave returns the object from subindex 1 to its end, not just the requested run
+      op->len = list->write ? op->len : DDI_EM_COE_LIST_CA_READ_SIZE;
+      op->buffer = (uint8_t *)malloc(op->len);
+      if ( op->buffer == NULL )
+      {
+        return DDI_EM_STATUS_NO_RESOURCES;
+      }
+      if ( list->write )
+      {
+        for ( index = item, offset = 0; index < item + run; offset += list->items[index].len, index++ )
+        {
+          memcpy(&op->buffer[offset], list->items[index].data, list->items[index].len);
+        }
+      }
+    }
+    coe_list_append(list, op_index);
+    item += run;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Start an operation, called without the list lock since the completion can run before this returns
+static ddi_em_result coe_list_start(coe_list *list, coe_list_op *op)
+{
+  ddi_em_coe_list_item *item = &list->items[op->first_item];
+  uint8_t *data = (op->buffer != NULL) ? op->buffer : item->data;
+  uint32_t coe_flags = (op->item_count > 1) ? EC_MAILBOX_FLAG_SDO_COMPLETE : 0;
+  ddi_em_coe_request_id request_id;
+
+  if ( list->write )
+  {
+    return ddi_em_coe_write_async(list->em_handle, item->es_handle, item->index, item->subindex, data, op->len, list->timeout,
+      coe_flags, coe_list_complete, op, &request_id);
+  }
+  return ddi_em_coe_read_async(list->em_handle, item->es_handle, item->index, item->subindex, data, op->len, list->timeout,
+    coe_flags, coe_list_complete, op, &request_id);
+}
+
+// Finish a completed operation, a rejected complete access transfer is queued again one item at a time.
+// Called with the list lock held
+static void coe_list_finish(coe_list *list, coe_list_op *op, ddi_em_coe_list_stats *stats)
+{
+  coe_list_slave *slave = &list->slaves[op->slave];
+  ddi_em_coe_list_item *item;
+  uint32_t index, offset, len;
+  int32_t op_index, first_op = COE_LIST_NO_OP, last_op = COE_LIST_NO_OP;
+
+  list->outstanding--;
+  if ( op->duration_us > stats->max_transfer_us )
+  {
+    stats->max_transfer_us = op->duration_us;
+  }
+  len = 0;
+  for ( index = op->first_item; index < op->first_item + op->item_count; index++ )
+  {
+    len += list->items[index].len;
+  }
+
+  if ( (op->item_count > 1) && ((op->result != DDI_EM_STATUS_OK) || (!list->write && (op->out_len < len))) )
+  {
+    // Fall back to single transfers, they go to the front of the slave queue to keep the list order
+    DLOG(list->em_handle, "Master[%d] Slave[%d] CoE list: complete access to 0x%04x failed (0x%x), falling back to single transfers\n",
+      list->em_handle, list->items[op->first_item].es_handle, list->items[op->first_item].index, op->result);
+    for ( index = op->first_item; index < op->first_item + op->item_count; index++ )
+    {
+      op_index = coe_list_add_op(list, index, 1);
+      if ( first_op == COE_LIST_NO_OP )
+      {
+        first_op = op_index;
+      }
+      else
+      {
+        list->ops[last_op].next = op_index;
+      }
+      last_op = op_index;
+    }
+    list->ops[last_op].next = slave->head;
+    slave->head = first_op;
+    if ( slave->tail == COE_LIST_NO_OP )
+    {
+      slave->tail = last_op;
+    }
+    return;
+  }
+
+  if ( op->item_count > 1 )
+  {
+    stats->complete_access_count++;
+  }
+  for ( index = op->first_item, offset = 0; index < op->first_item + op->item_count; index++ )
+  {
+    item = &list->items[index];
+    item->result = op->result;
+    item->duration_us = op->duration_us;
+    if ( list->write )
+    {
+      continue;
+    }
+    if ( op->item_count > 1 )
+    {
+      memcpy(item->data, &op->buffer[offset], item->len);
+      item->out_len = item->len;
+      offset += item->len;
+    }
+    else
+    {
+      item->out_len = op->out_len;
+    }
+  }
+}
+
+// Run a batched CoE transfer
+static ddi_em_result coe_list_transfer(ddi_em_handle em_handle, ddi_em_coe_list_item *items, uint32_t count, uint32_t timeout,
+  uint32_t flags, bool write, ddi_em_coe_list_stats *stats)
+{
+  coe_list list;
+  coe_list_slave *slave;
+  coe_list_op *op;
+  ddi_em_coe_list_stats local_stats;
+  ddi_em_result result;
+  ntime_t start_time, end_time;
+  uint32_t index;
+  int32_t op_index;
+
+  if ( (items == NULL) && (count > 0) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  stats = (stats != NULL) ? stats : &local_stats;
+  memset(stats, 0, sizeof(ddi_em_coe_list_stats));
+  stats->item_count = count;
+  if ( count == 0 )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  for ( index = 0; index < count; index++ )
+  {
+    if ( (items[index].data == NULL) || (items[index].len == 0) )
+    {
+      return DDI_EM_STATUS_INVALID_ARG;
+    }
+    items[index].out_len = 0;
+    items[index].duration_us = 0;
+    items[index].result = DDI_EM_STATUS_OP_CANCELLED;
+  }
+  ddi_ntime_get_systime(&start_time);
+
+  memset(&list, 0, sizeof(coe_list));
+  list.em_handle = em_handle;
+  list.items = items;
+  list.write = write;
+  list.timeout = timeout;
+  list.op_capacity = 2 * count;
+  list.ops = (coe_list_op *)calloc(list.op_capacity, sizeof(coe_list_op));
+  list.slaves = (coe_list_slave *)calloc(count, sizeof(coe_list_slave));
+  list.done = (int32_t *)calloc(list.op_capacity, sizeof(int32_t));
+  result = ((list.ops != NULL) && (list.slaves != NULL) && (list.done != NULL)) ? coe_list_build(&list, count, flags) : DDI_EM_STATUS_NO_RESOURCES;
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    ELOG(em_handle, "Master[%d] CoE list: Cannot allocate the transfer list (%d items)\n", em_handle, count);
+    list.outstanding = 0;
+  }
+  pthread_mutex_init(&list.lock, NULL);
+  pthread_cond_init(&list.done_cond, NULL);
+
+  pthread_mutex_lock(&list.lock);
+  while ( list.outstanding > 0 )
+  {
+    // Keep every slave's queue filled
+    for ( index = 0; index < list.slave_count; index++ )
+    {
+      slave = &list.slaves[index];
+      while ( (slave->head != COE_LIST_NO_OP) && (slave->queued < DDI_EM_COE_LIST_DEPTH) && (list.queued < DDI_EM_COE_LIST_MAX_QUEUED) )
+      {
+        op_index = slave->head;
+        op = &list.ops[op_index];
+        slave->head = op->next;
+        if ( slave->head == COE_LIST_NO_OP )
+        {
+          slave->tail = COE_LIST_NO_OP;
+        }
+        slave->queued++;
+        list.queued++;
+        stats->transfer_count++;
+        pthread_mutex_unlock(&list.lock);
+        result = coe_list_start(&list, op);
+        pthread_mutex_lock(&list.lock);
+        if ( (result == DDI_EM_STATUS_BUSY) && (list.queued > 1) )
+        {
+          // The request table is full of other requests, retry once one of ours has completed
+          op->next = slave->head;
+          slave->head = op_index;
+          if ( slave->tail == COE_LIST_NO_OP )
+          {
+            slave->tail = op_index;
+          }
+          slave->queued--;
+          list.queued--;
+          stats->transfer_count--;
+          break;
+        }
+        if ( result != DDI_EM_STATUS_OK )
+        {
+          op->result = result;
+          list.done[list.done_tail++ % list.op_capacity] = op_index;
+        }
+      }
+    }
+
+    while ( list.done_head == list.done_tail )
+    {
+      pthread_cond_wait(&list.done_cond, &list.lock);
+    }
+    while ( list.done_head != list.done_tail )
+    {
+      op = &list.ops[list.done[list.done_head++ % list.op_capacity]];
+      list.slaves[op->slave].queued--;
+      list.queued--;
+      coe_list_finish(&list, op, stats);
+    }
+  }
+  pthread_mutex_unlock(&list.lock);
+
+  pthread_cond_destroy(&list.done_cond);
+  pthread_mutex_destroy(&list.lock);
+  for ( index = 0; (list.ops != NULL) && (index < list.op_count); index++ )
+  {
+    free(list.ops[index].buffer);
+  }
+  free(list.ops);
+  free(list.slaves);
+  free(list.done);
+
+  ddi_ntime_get_systime(&end_time);
+  stats->total_us = (uint32_t)(ddi_ntime_diff_ns(&end_time, &start_time) / NSEC_PER_USEC);
+  if ( result == DDI_EM_STATUS_NO_RESOURCES )
+  {
+    return result;
+  }
+  result = DDI_EM_STATUS_OK;
+  for ( index = 0; index < count; index++ )
+  {
+    if ( items[index].result != DDI_EM_STATUS_OK )
+    {
+      stats->failed_count++;
+      if ( result == DDI_EM_STATUS_OK )
+      {
+        result = items[index].result;
+      }
+    }
+  }
+  return result;
+}
+
+// Read a list of COE objects, pipelined per slave
+EM_API ddi_em_result ddi_em_coe_read_list(ddi_em_handle em_handle, ddi_em_coe_list_item *items, uint32_t count, uint32_t timeout, uint32_t flags,
+ ddi_em_coe_list_stats *stats)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  return coe_list_transfer(em_handle, items, count, timeout, flags, false, stats);
+}
+
+// Write a list of COE objects, pipelined per slave
+EM_API ddi_em_result ddi_em_coe_write_list(ddi_em_handle em_handle, ddi_em_coe_list_item *items, uint32_t count, uint32_t timeout, uint32_t flags,
+ ddi_em_coe_list_stats *stats)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  return coe_list_transfer(em_handle, items, count, timeout, flags, true, stats);
+}
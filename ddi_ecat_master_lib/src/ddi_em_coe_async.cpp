@@ -0,0 +1,503 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+#include "ddi_em_coe_async.h"
+
+// This file implements the asynchronous CoE SDO requests. Each request owns a slot of the per-instance request table
+// and an Acontis mailbox transfer object. The request is queued with emCoeSdoUploadReq()/emCoeSdoDownloadReq(), the
+// master processes it from the cyclic job and reports the completion through an internal notification client.
+// Requests to different slaves are processed by the master in parallel, so many requests can be outstanding at once.
+// The transfer objects must not be deleted from the notification, so a slot keeps its transfer object until the
+// slot is reused or the instance is de-initialized.
+
+#define COE_NO_SLOT -1
+
+typedef enum {
+  COE_SLOT_FREE,       // Slot is on the free list
+  COE_SLOT_PENDING,    // Request is queued with the master
+  COE_SLOT_CALLBACK,   // Request completed, the completion callback is running
+  COE_SLOT_DONE        // Request completed, the completion waits on the done list for ddi_em_coe_poll()/ddi_em_coe_wait()
+} coe_slot_state;
+
+typedef struct {
+  coe_slot_state            state;
+  ddi_em_coe_completion     completion;   // Request description, completed by the notification
+  ddi_em_coe_complete_func *callback;     // Completion callback, NULL to complete through the done list
+  uint8_t                  *read_data;    // Caller read buffer
+  uint32_t                  sequence;     // Use count of the slot, makes the request ids unique
+  ntime_t                   start_time;   // Time the request was started
+  EC_T_MBXTFER             *tfer;         // Mailbox transfer object, kept until the slot is reused
+  uint8_t                  *tfer_data;    // Data buffer of the mailbox transfer object
+  int32_t                   prev;         // Previous slot on the done list
+  int32_t                   next;         // Next slot on the free or done list
+} coe_request_slot;
+
+typedef struct {
+  pthread_mutex_t  lock;
+  pthread_cond_t   done_cond;             // Signalled when a request without callback completes
+  bool             lock_initialized;
+  coe_request_slot slots[DDI_EM_MAX_COE_REQUESTS];
+  int32_t          free_head;
+  int32_t          done_head;             // Oldest completion
+  int32_t          done_tail;             // Newest completion
+  bool             client_registered;     // Is the internal notification client registered?
+  uint32_t         client_id;             // The acontis-based notification client id
+} coe_request_table;
+
+static coe_request_table g_coe_requests[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Caller data of the CoE notification client, must outlive the registration
+static ddi_em_handle g_coe_cb_instance[DDI_EM_MAX_MASTER_INSTANCES];
+
+// The sequence is bounded so the highest request id doesn't wrap to DDI_EM_COE_INVALID_REQUEST
+#define COE_MAX_SEQUENCE (UINT32_MAX / DDI_EM_MAX_COE_REQUESTS - 1)
+
+// Return the slot index of a request id
+static int32_t coe_request_slot_index(ddi_em_coe_request_id request_id)
+{
+  return (int32_t)((request_id - 1) % DDI_EM_MAX_COE_REQUESTS);
+}
+
+// Append a completed slot to the done list, called with the table lock held
+static void coe_done_push(coe_request_table *table, int32_t index)
+{
+  coe_request_slot *slot = &table->slots[index];
+  slot->prev = table->done_tail;
+  slot->next = COE_NO_SLOT;
+  if ( table->done_tail == COE_NO_SLOT )
+  {
+    table->done_head = index;
+  }
+  else
+  {
+    table->slots[table->done_tail].next = index;
+  }
+  table->done_tail = index;
+}
+
+// Remove a slot from the done list, called with the table lock held
+static void coe_done_remove(coe_request_table *table, int32_t index)
+{
+  coe_request_slot *slot = &table->slots[index];
+  if ( slot->prev == COE_NO_SLOT )
+  {
+    table->done_head = slot->next;
+  }
+  else
+  {
+    table->slots[slot->prev].next = slot->next;
+  }
+  if ( slot->next == COE_NO_SLOT )
+  {
+    table->done_tail = slot->prev;
+  }
+  else
+  {
+    table->slots[slot->next].prev = slot->prev;
+  }
+}
+
+// Return a slot to the free list, called with the table lock held
+static void coe_slot_release(coe_request_table *table, int32_t index)
+{
+  coe_request_slot *slot = &table->slots[index];
+  slot->state = COE_SLOT_FREE;
+  slot->next = table->free_head;
+  table->free_head = index;
+}
+
+// Delete the transfer object and data buffer a slot kept from its previous request
+static void coe_slot_reclaim(ddi_em_handle em_handle, coe_request_slot *slot)
+{
+  if ( slot->tfer != NULL )
+  {
+    emMbxTferDelete(em_handle, slot->tfer);
+    slot->tfer = NULL;
+  }
+  free(slot->tfer_data);
+  slot->tfer_data = NULL;
+}
+
+// Complete a pending request with the given result. Requests with a callback are reported right away, the others
+// are queued on the done list and the waiters are woken up
+static void coe_request_complete(ddi_em_handle em_handle, int32_t index, EC_T_MBXTFER *tfer, ddi_em_result result)
+{
+  coe_request_table *table = &g_coe_requests[em_handle];
+  coe_request_slot *slot = &table->slots[index];
+  ddi_em_coe_complete_func *callback;
+  ddi_em_coe_completion completion;
+  ntime_t now;
+
+  pthread_mutex_lock(&table->lock);
+  if ( (slot->state != COE_SLOT_PENDING) || (slot->tfer != tfer) )
+  {
+    // Already completed, e.g. cancelled while the notification was on its way
+    pthread_mutex_unlock(&table->lock);
+    return;
+  }
+  slot->completion.result = result;
+  if ( (result == DDI_EM_STATUS_OK) && !slot->completion.write )
+  {
+    // The uploaded data is only valid during the notification
+    slot->completion.out_len = (tfer->dwDataLen < tfer->MbxTferDesc.dwMaxDataLen) ? tfer->dwDataLen : tfer->MbxTferDesc.dwMaxDataLen;
+    memcpy(slot->read_data, tfer->pbyMbxTferData, slot->completion.out_len);
+  }
+  ddi_ntime_get_systime(&now);
+  slot->completion.duration_us = (uint32_t)(ddi_ntime_diff_ns(&now, &slot->start_time) / NSEC_PER_USEC);
+
+  if ( slot->callback == NULL )
+  {
+    slot->state = COE_SLOT_DONE;
+    coe_done_push(table, index);
+    pthread_cond_broadcast(&table->done_cond);
+    pthread_mutex_unlock(&table->lock);
+    return;
+  }
+
+  // The callback runs without the lock so it can start the next request
+  slot->state = COE_SLOT_CALLBACK;
+  callback = slot->callback;
+  completion = slot->completion;
+  pthread_mutex_unlock(&table->lock);
+  callback(&completion);
+  pthread_mutex_lock(&table->lock);
+  coe_slot_release(table, index);
+  pthread_mutex_unlock(&table->lock);
+}
+
+// Acontis notification handler of the CoE client, only the mailbox transfer completions are of interest
+static EC_T_DWORD coe_async_notify(EC_T_DWORD code, EC_T_NOTIFYPARMS *parms)
+{
+  ddi_em_handle em_handle = *(ddi_em_handle *)parms->pCallerData;
+  EC_T_MBXTFER *tfer;
+  ddi_em_result result;
+
+  if ( (code != EC_NOTIFY_MBOXRCV) || (parms->pbyInBuf == NULL) )
+  {
+    return EC_E_NOERROR;
+  }
+  tfer = (EC_T_MBXTFER *)parms->pbyInBuf;
+  if ( (tfer->eMbxTferType != eMbxTferType_COE_SDO_UPLOAD) && (tfer->eMbxTferType != eMbxTferType_COE_SDO_DOWNLOAD) )
+  {
+    return EC_E_NOERROR;
+  }
+  if ( tfer->dwTferId == DDI_EM_COE_INVALID_REQUEST )
+  {
+    return EC_E_NOERROR;
+  }
+  if ( (tfer->eTferStatus == eMbxTferStatus_TferDone) && (tfer->dwErrorCode == EC_E_NOERROR) )
+  {
+    result = DDI_EM_STATUS_OK;
+  }
+  else
+  {
+    result = translate_ddi_acontis_err_code(em_handle, (tfer->dwErrorCode != EC_E_NOERROR) ? tfer->dwErrorCode : EC_E_ERROR);
+  }
+  coe_request_complete(em_handle, coe_request_slot_index(tfer->dwTferId), tfer, result);
+  return EC_E_NOERROR;
+}
+
+// Reset the request table of a new master instance
+void ddi_em_coe_async_init(ddi_em_handle em_handle)
+{
+  coe_request_table *table = &g_coe_requests[em_handle];
+  pthread_condattr_t cond_attr;
+  int32_t index;
+
+  if ( !table->lock_initialized )
+  {
+    pthread_mutex_init(&table->lock, NULL);
+    // ddi_em_coe_wait() timeouts must not follow wall clock changes
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&table->done_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    table->lock_initialized = true;
+  }
+
+  pthread_mutex_lock(&table->lock);
+  memset(table->slots, 0, sizeof(table->slots));
+  table->free_head = COE_NO_SLOT;
+  for ( index = DDI_EM_MAX_COE_REQUESTS - 1; index >= 0; index-- )
+  {
+    coe_slot_release(table, index);
+  }
+  table->done_head = COE_NO_SLOT;
+  table->done_tail = COE_NO_SLOT;
+  table->client_registered = false;
+  pthread_mutex_unlock(&table->lock);
+}
+
+// Register the notification client, emConfigureMaster() drops the clients registered before it
+ddi_em_result ddi_em_coe_async_register(ddi_em_handle em_handle)
+{
+  coe_request_table *table = &g_coe_requests[em_handle];
+  EC_T_REGISTERRESULTS register_results;
+  uint32_t result;
+
+  g_coe_cb_instance[em_handle] = em_handle;
+  memset(&register_results, 0, sizeof(EC_T_REGISTERRESULTS));
+  result = emRegisterClient(em_handle, coe_async_notify, &g_coe_cb_instance[em_handle], &register_results);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] configure: Cannot register the CoE request client: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+    return translate_ddi_acontis_err_code(em_handle, result);
+  }
+  table->client_id = register_results.dwClntId;
+  table->client_registered = true;
+  return DDI_EM_STATUS_OK;
+}
+
+// Cancel the outstanding requests, release the transfer objects and unregister the notification client
+void ddi_em_coe_async_deinit(ddi_em_handle em_handle)
+{
+  coe_request_table *table = &g_coe_requests[em_handle];
+  coe_request_slot *slot;
+  EC_T_MBXTFER *tfer;
+  uint32_t result;
+  int32_t index;
+
+  if ( !table->lock_initialized )
+  {
+    return;
+  }
+  for ( index = 0; index < DDI_EM_MAX_COE_REQUESTS; index++ )
+  {
+    slot = &table->slots[index];
+    pthread_mutex_lock(&table->lock);
+    tfer = (slot->state == COE_SLOT_PENDING) ? slot->tfer : NULL;
+    pthread_mutex_unlock(&table->lock);
+    if ( tfer != NULL )
+    {
+      emMbxTferAbort(em_handle, tfer);
+      coe_request_complete(em_handle, index, tfer, DDI_EM_STATUS_OP_CANCELLED);
+    }
+  }
+
+  if ( table->client_registered )
+  {
+    result = emUnregisterClient(em_handle, table->client_id);
+    if ( result != EC_E_NOERROR )
+    {
+      ELOG(em_handle, "Master[%d] deinit: Cannot unregister the CoE request client: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+    }
+    table->client_registered = false;
+  }
+
+  // The cyclic thread is stopped, nothing completes from here on
+  for ( index = 0; index < DDI_EM_MAX_COE_REQUESTS; index++ )
+  {
+    coe_slot_reclaim(em_handle, &table->slots[index]);
+  }
+}
+
+// Start an asynchronous upload or download
+static ddi_em_result coe_request_start(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
+ uint32_t len, uint32_t timeout, uint32_t flags, bool write, ddi_em_coe_complete_func *callback, void *user_data, ddi_em_coe_request_id *request_id)
+{
+  coe_request_table *table;
+  coe_request_slot *slot;
+  EC_T_MBXTFER_DESC tfer_desc;
+  int32_t slot_index;
+  uint32_t result;
+
+  if ( (data == NULL) || (request_id == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( len == 0 )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  table = &g_coe_requests[em_handle];
+  if ( !table->client_registered )
+  {
+    ELOG(em_handle, "Master[%d] Slave[%d] CoE request: the master is not configured\n", em_handle, es_handle);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+
+  pthread_mutex_lock(&table->lock);
+  slot_index = table->free_head;
+  if ( slot_index == COE_NO_SLOT )
+  {
+    pthread_mutex_unlock(&table->lock);
+    return DDI_EM_STATUS_BUSY;
+  }
+  slot = &table->slots[slot_index];
+  table->free_head = slot->next;
+  slot->state = COE_SLOT_PENDING;
+  slot->sequence = (slot->sequence >= COE_MAX_SEQUENCE) ? 0 : slot->sequence + 1;
+  memset(&slot->completion, 0, sizeof(ddi_em_coe_completion));
+  slot->completion.request_id = slot->sequence * DDI_EM_MAX_COE_REQUESTS + slot_index + 1;
+  slot->callback = callback;
+  pthread_mutex_unlock(&table->lock);
+
+  // The pending slot belongs to this call, the previous transfer object can be released without the lock
+  coe_slot_reclaim(em_handle, slot);
+  slot->completion.es_handle  = es_handle;
+  slot->completion.index      = index;
+  slot->completion.subindex   = subindex;
+  slot->completion.write      = write;
+  slot->completion.user_data  = user_data;
+  slot->read_data = data;
+
+  slot->tfer_data = (uint8_t *)malloc(len);
+  if ( slot->tfer_data != NULL )
+  {
+    tfer_desc.dwMaxDataLen = len;
+    tfer_desc.pbyMbxTferDescData = slot->tfer_data;
+    slot->tfer = emMbxTferCreate(em_handle, &tfer_desc);
+  }
+  if ( slot->tfer == NULL )
+  {
+    ELOG(em_handle, "Master[%d] Slave[%d] CoE request: Cannot create the mailbox transfer (%d bytes)\n", em_handle, es_handle, len);
+    pthread_mutex_lock(&table->lock);
+    coe_slot_release(table, slot_index);
+    pthread_mutex_unlock(&table->lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  slot->tfer->dwClntId = table->client_id;
+  slot->tfer->dwTferId = slot->completion.request_id;
+  slot->tfer->dwDataLen = len;
+  if ( write )
+  {
+    memcpy(slot->tfer->pbyMbxTferData, data, len);
+  }
+
+  // The request can complete before the call returns, so the id is handed out first
+  *request_id = slot->completion.request_id;
+  ddi_ntime_get_systime(&slot->start_time);
+  if ( write )
+  {
+    result = emCoeSdoDownloadReq(em_handle, slot->tfer, es_handle, index, subindex, timeout, flags);
+  }
+  else
+  {
+    result = emCoeSdoUploadReq(em_handle, slot->tfer, es_handle, index, subindex, timeout, flags);
+  }
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] Slave[%d] CAN over EtherCAT %s request: %s (0x%x)\n", em_handle, es_handle,
+      write ? "Write" : "Read", ecatGetText(result), result);
+    *request_id = DDI_EM_COE_INVALID_REQUEST;
+    pthread_mutex_lock(&table->lock);
+    coe_slot_release(table, slot_index);
+    pthread_mutex_unlock(&table->lock);
+    return translate_ddi_acontis_err_code(em_handle, result); // Return the Acontis->DDI translated error code
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Start an asynchronous COE read
+EM_API ddi_em_result ddi_em_coe_read_async(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
+ uint32_t len, uint32_t timeout, uint32_t flags, ddi_em_coe_complete_func *callback, void *user_data, ddi_em_coe_request_id *request_id)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  return coe_request_start(em_handle, es_handle, index, subindex, data, len, timeout, flags, false, callback, user_data, request_id);
+}
+
+// Start an asynchronous COE write
+EM_API ddi_em_result ddi_em_coe_write_async(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex, uint8_t *data,
+ uint32_t len, uint32_t timeout, uint32_t flags, ddi_em_coe_complete_func *callback, void *user_data, ddi_em_coe_request_id *request_id)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  return coe_request_start(em_handle, es_handle, index, subindex, data, len, timeout, flags, true, callback, user_data, request_id);
+}
+
+// Return the completions of the requests started without a callback, oldest first
+EM_API ddi_em_result ddi_em_coe_poll(ddi_em_handle em_handle, ddi_em_coe_completion *completions, uint32_t max_count, uint32_t *count)
+{
+  coe_request_table *table;
+  int32_t index;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (completions == NULL) || (count == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  table = &g_coe_requests[em_handle];
+  *count = 0;
+  pthread_mutex_lock(&table->lock);
+  while ( (*count < max_count) && (table->done_head != COE_NO_SLOT) )
+  {
+    index = table->done_head;
+    coe_done_remove(table, index);
+    completions[(*count)++] = table->slots[index].completion;
+    coe_slot_release(table, index);
+  }
+  pthread_mutex_unlock(&table->lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Wait for a request started without a callback
+EM_API ddi_em_result ddi_em_coe_wait(ddi_em_handle em_handle, ddi_em_coe_request_id request_id, uint32_t timeout_ms, ddi_em_coe_completion *completion)
+{
+  coe_request_table *table;
+  coe_request_slot *slot;
+  struct timespec deadline;
+  int32_t index;
+  int wait_result = 0;
+  ddi_em_result result;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( completion == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( request_id == DDI_EM_COE_INVALID_REQUEST )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  table = &g_coe_requests[em_handle];
+  index = coe_request_slot_index(request_id);
+  slot = &table->slots[index];
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec  += timeout_ms / MSEC_PER_SEC;
+  deadline.tv_nsec += (timeout_ms % MSEC_PER_SEC) * NSEC_PER_MSEC;
+  if ( deadline.tv_nsec >= NSEC_PER_SEC )
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= NSEC_PER_SEC;
+  }
+
+  pthread_mutex_lock(&table->lock);
+  // A completed request is released by the first poll or wait that returns it
+  if ( (slot->state == COE_SLOT_FREE) || (slot->completion.request_id != request_id) || (slot->callback != NULL) )
+  {
+    pthread_mutex_unlock(&table->lock);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  while ( (slot->state == COE_SLOT_PENDING) && (slot->completion.request_id == request_id) && (wait_result != ETIMEDOUT) )
+  {
+    wait_result = pthread_cond_timedwait(&table->done_cond, &table->lock, &deadline);
+  }
+  if ( (slot->state != COE_SLOT_DONE) || (slot->completion.request_id != request_id) )
+  {
+    // Still pending, or a concurrent poll took the completion
+    result = ((slot->state == COE_SLOT_PENDING) && (slot->completion.request_id == request_id)) ? DDI_EM_STATUS_TIMEOUT : DDI_EM_STATUS_NOT_FOUND;
+    pthread_mutex_unlock(&table->lock);
+    return result;
+  }
+  coe_done_remove(table, index);
+  *completion = slot->completion;
+  coe_slot_release(table, index);
+  pthread_mutex_unlock(&table->lock);
+  return DDI_EM_STATUS_OK;
+}
@@ -0,0 +1,35 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_COE_ASYNC_H
+#define DDI_EM_COE_ASYNC_H
+
+// Asynchronous CoE SDO requests of a master instance
+
+#include "ddi_em_api.h"
+
+/** ddi_em_coe_async_init
+ @brief Reset the asynchronous CoE request table of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_coe_async_init(ddi_em_handle em_handle);
+
+/** ddi_em_coe_async_register
+ @brief Register the notification client that receives the mailbox transfer completions
+ Must be called after emConfigureMaster(), which drops the clients registered before it
+ @param em_handle The EtherCAT master handle
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_async_register(ddi_em_handle em_handle);
+
+/** ddi_em_coe_async_deinit
+ @brief Cancel the outstanding requests, release the transfer objects and unregister the notification client
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_coe_async_deinit(ddi_em_handle em_handle);
+
+#endif // DDI_EM_COE_ASYNC_H
@@ -0,0 +1,48 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_coe_standin.h
+
+#ifndef DDI_EM_COE_STANDIN_H
+#define DDI_EM_COE_STANDIN_H
+
+#include "ddi_em_api.h"
+
+#ifndef DDI_EM_TEST_STANDIN
+#error "The stand-ins are only built into the test variant of the library, define DDI_EM_TEST_STANDIN"
+#endif
+
+// Mailbox stand-in for the tests that run without EtherCAT hardware, only built into the test variant of the library.
+// While a master instance has a stand-in, ddi_em_coe_read() and ddi_em_coe_write() hand their transfers to it instead
+// of the mailbox of the slave, so the code that uses them runs unchanged against a simulated slave.
+
+/** ddi_em_coe_standin_func
+ @brief Serve one CoE transfer of a master instance in place of the slave
+ @param[in] em_handle The EtherCAT Master handle
+ @param[in] es_handle The EtherCAT slave handle
+ @param[in] index The object index
+ @param[in] subindex The object subindex
+ @param[in,out] data The data written, or the buffer read to
+ @param[in] len The length of the data written or of the read buffer
+ @param[out] out_len The bytes read, NULL for a write
+ @param[in] flags The CoE transfer flags, e.g. complete access
+ @param[in] user_data The stand-in data given to ddi_em_coe_set_standin()
+ @return ddi_em_result The result of the transfer
+ */
+typedef ddi_em_result (ddi_em_coe_standin_func)(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex,
+                                                 uint8_t *data, uint32_t len, uint32_t *out_len, uint32_t flags, void *user_data);
+
+/** ddi_em_coe_set_standin
+ @brief Set the mailbox stand-in of a master instance, before its first CoE transfer
+ @param[in] em_handle The EtherCAT Master handle
+ @param[in] standin The stand-in, NULL to transfer through the mailbox again
+ @param[in] user_data The stand-in data
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_coe_set_standin(ddi_em_handle em_handle, ddi_em_coe_standin_func *standin, void *user_data);
+
+#endif // DDI_EM_COE_STANDIN_H
@@ -55,6 +55,11 @@ prior written authorization of DDI is prohibited.
 */
 #define DDI_EM_LOG_DIR                    "/home/ddi/ddi_em/ddi_em_log_files"
 
+/*! @var DDI_EM_SII_CACHE_DIR
+  @brief Slave EEPROM (SII) image cache location, overridden by the DDI_EM_SII_CACHE_DIR environment variable
+*/
+#define DDI_EM_SII_CACHE_DIR              "/home/ddi/ddi_em/sii_cache"
+
 /*! @var DDI_EM_LOG_FILE_PREFIX
   @brief Log files start with this prefix
 */
@@ -71,9 +76,39 @@ prior written authorization of DDI is prohibited.
 #define DDI_EM_SCAN_NETWORK_TIMEOUT       10000
 
 /*! @var DDI_CYCLIC_THREAD_STACK_SIZE
-  @brief Defines the cyclic thread stack size in bytes
+  @brief Defines the minimum cyclic thread stack size in bytes, smaller cyclic_stack_size requests are rounded up
+*/
+#define DDI_CYCLIC_THREAD_STACK_SIZE      (64 * 1024)
+
+/*! @var DDI_EM_STACK_PREFAULT_GUARD
+  @brief Bytes of the cyclic thread stack left untouched by the stack prefault (already in use by the thread)
+*/
+#define DDI_EM_STACK_PREFAULT_GUARD       (8 * 1024)
+
+/*! @var DDI_EM_DEADLINE_RUNTIME_DIV
+  @brief The default SCHED_DEADLINE runtime is the deadline period divided by this value
+*/
+#define DDI_EM_DEADLINE_RUNTIME_DIV       2
+
+/*! @var DDI_EM_TELEMETRY_BUCKETS
+  @brief Number of buckets of the rolling telemetry window, the window advances one bucket at a time
+*/
+#define DDI_EM_TELEMETRY_BUCKETS          10
+
+/*! @var DDI_EM_COE_LIST_DEPTH
+  @brief Max number of SDO transfers of a CoE list queued per slave at one time
+*/
+#define DDI_EM_COE_LIST_DEPTH             4
+
+/*! @var DDI_EM_COE_LIST_MAX_QUEUED
+  @brief Max number of SDO transfers of a CoE list queued at one time, keeps room for other asynchronous CoE requests
+*/
+#define DDI_EM_COE_LIST_MAX_QUEUED        64
+
+/*! @var DDI_EM_COE_LIST_CA_READ_SIZE
+  @brief Buffer size of a complete access read of a CoE list, larger objects are read one subindex at a time
 */
-#define DDI_CYCLIC_THREAD_STACK_SIZE      2048
+#define DDI_EM_COE_LIST_CA_READ_SIZE      512
 
 /*! @var ACONTIS_SUCCESS
   @brief Defines success for the Acontis API, replaces EC_E_NO_ERROR
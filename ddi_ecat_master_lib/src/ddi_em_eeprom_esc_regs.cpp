@@ -16,6 +16,7 @@ prior written authorization of DDI is prohibited.
 #include "ddi_em_config.h"
 #include "ddi_em_translate.h"
 #include "ddi_em_logging.h"
+#include "ddi_em.h"
 
 uint32_t ddi_em_get_slave_address(ddi_em_handle em_handle, ddi_es_handle es_handle );
 
@@ -92,6 +93,15 @@ ddi_em_result ddi_em_write_eeprom(ddi_em_handle em_handle, ddi_es_handle es_hand
 
   // Write the slave eeprom
   result = emWriteSlaveEEPRom(em_handle, EC_TRUE, station_address, offset, data, write_len, timeout);
+
+  // Drop the cached SII image of the slave, even a failed write may have changed part of the EEPROM
+  if ( es_handle < DDI_EM_MAX_BUS_SLAVES )
+  {
+    ddi_em_slave_config *cfg_info = &get_slave_instance(em_handle, es_handle)->cfg_info;
+    ddi_em_sii_identity identity = { cfg_info->vendor_id, cfg_info->product_code, cfg_info->revision, cfg_info->serial_number };
+    ddi_em_sii_cache_invalidate(em_handle, &identity);
+  }
+
   if ( result != ACONTIS_SUCCESS )
   {
     ELOG(em_handle, "Master[%d] Slave[%d] retrieve slave state: emReadSlaveEEPRom %s (0x%x)\n", em_handle, es_handle, ecatGetText(result), result);
@@ -0,0 +1,709 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em_foe_stream.h"
+
+// This file implements the streaming FoE downloads and uploads. Each stream owns a slot of the per-instance stream table,
+// a thread and an Acontis mailbox transfer object of one segment. A download is started with emFoeSegmentedDownloadReq()
+// and the first segment, the master sends it from the cyclic job and sets the transfer to TferWaitingForContinue when it
+// needs the next one. The stream thread polls the transfer, copies the next segment from the source and continues the
+// request until the transfer is done. An upload runs the other way round with emFoeSegmentedUploadReq(), the master
+// stops at each segment the slave sent and the stream thread hands it to the sink before it continues the request.
+// Streams to different slaves run in parallel, so a rack is updated in the time of its slowest slave. Like the CoE
+// requests, an aborted transfer object is kept until its slot is reused.
+
+// Stream thread poll interval while the master sends a segment
+#define FOE_POLL_INTERVAL_US      500
+
+// Extra time given to the master to report a segment timeout before the stream gives up on it
+#define FOE_TIMEOUT_GRACE_MS      1000
+
+// Pause before a retry, gives a slave that dropped the transfer time to recover
+#define FOE_RETRY_DELAY_MS        100
+
+typedef enum {
+  FOE_STREAM_FREE,       // Slot can take a new stream
+  FOE_STREAM_RUNNING,    // Stream thread is transferring the file
+  FOE_STREAM_DONE        // Transfer complete, the result waits for ddi_em_foe_stream_wait()
+} foe_stream_state;
+
+typedef struct {
+  foe_stream_state         state;
+  ddi_em_handle            em_handle;
+  ddi_em_foe_stream_config config;
+  char                    *filename;      // Copy of the FoE filename
+  const uint8_t           *image;         // source_path mapping or config.data, NULL for a source or sink callback
+  size_t                   mapped_size;   // Size of the source_path mapping, 0 if not mapped
+  uint32_t                 sequence;      // Use count of the slot, makes the stream ids unique
+  volatile bool            cancel;        // Set by ddi_em_foe_stream_cancel()
+  bool                     joinable;      // Has the thread not been joined yet?
+  pthread_t                thread;
+  ddi_em_foe_progress      progress;      // Updated under the table lock
+  EC_T_MBXTFER            *tfer;          // Mailbox transfer object, kept until the slot is reused when aborted
+  uint8_t                 *tfer_data;     // Data buffer of the mailbox transfer object
+} foe_stream_slot;
+
+typedef struct {
+  pthread_mutex_t  lock;
+  pthread_cond_t   done_cond;             // Signalled when a stream is done
+  bool             lock_initialized;
+  foe_stream_slot  slots[DDI_EM_MAX_FOE_STREAMS];
+} foe_stream_table;
+
+static foe_stream_table g_foe_streams[DDI_EM_MAX_MASTER_INSTANCES];
+
+// The sequence is bounded so the highest stream id doesn't wrap to DDI_EM_FOE_INVALID_STREAM
+#define FOE_MAX_SEQUENCE (UINT32_MAX / DDI_EM_MAX_FOE_STREAMS - 1)
+
+// Return the slot of a stream id, NULL if the stream id isn't in use, called with the table lock held
+static foe_stream_slot *foe_stream_find(foe_stream_table *table, ddi_em_foe_stream_id stream_id)
+{
+  foe_stream_slot *slot;
+
+  if ( stream_id == DDI_EM_FOE_INVALID_STREAM )
+  {
+    return NULL;
+  }
+  slot = &table->slots[(stream_id - 1) % DDI_EM_MAX_FOE_STREAMS];
+  if ( (slot->state == FOE_STREAM_FREE) || (slot->progress.stream_id != stream_id) )
+  {
+    return NULL;
+  }
+  return slot;
+}
+
+// Delete the transfer object and data buffer a slot kept from its previous attempt
+static void foe_slot_reclaim(ddi_em_handle em_handle, foe_stream_slot *slot)
+{
+  if ( slot->tfer != NULL )
+  {
+    emMbxTferDelete(em_handle, slot->tfer);
+    slot->tfer = NULL;
+  }
+  free(slot->tfer_data);
+  slot->tfer_data = NULL;
+}
+
+// Release the file of a stream
+static void foe_slot_release_source(foe_stream_slot *slot)
+{
+  if ( slot->mapped_size )
+  {
+    munmap((void *)slot->image, slot->mapped_size);
+    slot->mapped_size = 0;
+  }
+  slot->image = NULL;
+  free(slot->filename);
+  slot->filename = NULL;
+}
+
+// Copy the next segment of the file into the transfer object
+static ddi_em_result foe_stream_fill(foe_stream_slot *slot, uint32_t offset, uint32_t length)
+{
+  slot->tfer->dwDataLen = length;
+  if ( slot->image != NULL )
+  {
+    memcpy(slot->tfer->pbyMbxTferData, slot->image + offset, length);
+    return DDI_EM_STATUS_OK;
+  }
+  return slot->config.source(slot->config.source_data, offset, slot->tfer->pbyMbxTferData, length);
+}
+
+// Update the progress of the current attempt and report it
+static void foe_stream_report(foe_stream_table *table, foe_stream_slot *slot, const ntime_t *start, uint32_t transferred)
+{
+  ddi_em_foe_progress progress;
+  ntime_t now;
+  int64_t elapsed_ns;
+
+  ddi_ntime_get_systime(&now);
+  elapsed_ns = ddi_ntime_diff_ns(&now, (ntime_t *)start);
+  pthread_mutex_lock(&table->lock);
+  slot->progress.transferred_bytes = transferred;
+  slot->progress.elapsed_ms = (uint32_t)(elapsed_ns / NSEC_PER_MSEC);
+  slot->progress.bytes_per_sec = (elapsed_ns > 0) ? (uint32_t)((uint64_t)transferred * NSEC_PER_SEC / elapsed_ns) : 0;
+  slot->progress.busy_done = slot->tfer->MbxData.FoE.dwBusyDone;
+  slot->progress.busy_entire = slot->tfer->MbxData.FoE.dwBusyEntire;
+  progress = slot->progress;
+  pthread_mutex_unlock(&table->lock);
+  if ( slot->config.progress != NULL )
+  {
+    slot->config.progress(&progress);
+  }
+}
+
+// Create the mailbox transfer object of an attempt, it carries one segment
+static ddi_em_result foe_stream_create_tfer(foe_stream_slot *slot)
+{
+  ddi_em_handle em_handle = slot->em_handle;
+  EC_T_MBXTFER_DESC tfer_desc;
+
+  foe_slot_reclaim(em_handle, slot);
+  slot->tfer_data = (uint8_t *)malloc(slot->config.segment_size);
+  if ( slot->tfer_data != NULL )
+  {
+    tfer_desc.dwMaxDataLen = slot->config.segment_size;
+    tfer_desc.pbyMbxTferDescData = slot->tfer_data;
+    slot->tfer = emMbxTferCreate(em_handle, &tfer_desc);
+  }
+  if ( slot->tfer == NULL )
+  {
+    ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: Cannot create the mailbox transfer (%d bytes)\n", em_handle, slot->config.es_handle,
+      slot->config.segment_size);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  slot->tfer->dwClntId = 0;
+  slot->tfer->dwTferId = slot->progress.stream_id;
+  return DDI_EM_STATUS_OK;
+}
+
+// Wait until the master is done with the current segment, it then waits for the next one or the transfer is complete
+static ddi_em_result foe_stream_wait_segment(foe_stream_table *table, foe_stream_slot *slot, const ntime_t *start, uint32_t offset,
+  uint32_t *busy_done, EC_T_MBXTFER_STATUS *status, bool *retry)
+{
+  ddi_em_handle em_handle = slot->em_handle;
+  ddi_es_handle es_handle = slot->config.es_handle;
+  ntime_t now, segment_start;
+  uint32_t result;
+
+  ddi_ntime_get_systime(&segment_start);
+  while ( (*status = *(volatile EC_T_MBXTFER_STATUS *)&slot->tfer->eTferStatus) == eMbxTferStatus_Pend )
+  {
+    if ( slot->cancel )
+    {
+      emMbxTferAbort(em_handle, slot->tfer);
+      return DDI_EM_STATUS_OP_CANCELLED;
+    }
+    ddi_ntime_get_systime(&now);
+    if ( slot->tfer->MbxData.FoE.dwBusyDone != *busy_done )
+    {
+      // The slave is busy, e.g. flashing the file after the last segment, and reports its progress
+      *busy_done = slot->tfer->MbxData.FoE.dwBusyDone;
+      segment_start = now;
+      foe_stream_report(table, slot, start, slot->tfer->MbxData.FoE.dwTransferredBytes);
+    }
+    else if ( ddi_ntime_diff_ns(&now, &segment_start) / NSEC_PER_MSEC > (int64_t)slot->config.timeout + FOE_TIMEOUT_GRACE_MS )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: no response at byte %d \n", em_handle, es_handle, offset);
+      emMbxTferAbort(em_handle, slot->tfer);
+      *retry = true;
+      return DDI_EM_STATUS_TIMEOUT;
+    }
+    usleep(FOE_POLL_INTERVAL_US);
+  }
+  if ( (*status == eMbxTferStatus_TferReqError) ||
+       ((*status == eMbxTferStatus_TferDone) && (slot->tfer->dwErrorCode != EC_E_NOERROR)) )
+  {
+    result = (slot->tfer->dwErrorCode != EC_E_NOERROR) ? slot->tfer->dwErrorCode : EC_E_ERROR;
+    ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: %s (0x%x) at byte %d \n", em_handle, es_handle, ecatGetText(result), result, offset);
+    *retry = true;
+    return translate_ddi_acontis_err_code(em_handle, result);
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Download the file once, from the first segment to the slave's acknowledgement of the last one
+static ddi_em_result foe_stream_download(foe_stream_table *table, foe_stream_slot *slot, bool *retry)
+{
+  ddi_em_handle em_handle = slot->em_handle;
+  ddi_es_handle es_handle = slot->config.es_handle;
+  uint32_t total = slot->progress.total_bytes, offset = 0, length, result, reported = 0, busy_done = 0;
+  EC_T_MBXTFER_STATUS status;
+  ntime_t start;
+  ddi_em_result em_result;
+
+  *retry = false;
+  em_result = foe_stream_create_tfer(slot);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+  ddi_ntime_get_systime(&start);
+  foe_stream_report(table, slot, &start, 0);
+  do
+  {
+    // Hand the next segment to the master, the first call also starts the download
+    length = (total - offset < slot->config.segment_size) ? total - offset : slot->config.segment_size;
+    em_result = foe_stream_fill(slot, offset, length);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: the source failed at byte %d: %s\n", em_handle, es_handle, offset,
+        ddi_em_get_error_string(em_result));
+      if ( offset != 0 )
+      {
+        emMbxTferAbort(em_handle, slot->tfer);
+      }
+      return em_result;
+    }
+    result = emFoeSegmentedDownloadReq(em_handle, slot->tfer, es_handle, slot->filename, (EC_T_DWORD)strlen(slot->filename), total,
+      slot->config.password, slot->config.timeout);
+    if ( result != EC_E_NOERROR )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: %s (0x%x)\n", em_handle, es_handle, ecatGetText(result), result);
+      *retry = true;
+      return translate_ddi_acontis_err_code(em_handle, result);
+    }
+    offset += length;
+
+    em_result = foe_stream_wait_segment(table, slot, &start, offset, &busy_done, &status, retry);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      return em_result;
+    }
+    reported = offset;
+    foe_stream_report(table, slot, &start, reported);
+  } while ( status == eMbxTferStatus_TferWaitingForContinue );
+
+  if ( reported != total )
+  {
+    foe_stream_report(table, slot, &start, total);
+  }
+  // The transfer is complete, its object can go right away
+  foe_slot_reclaim(em_handle, slot);
+  return DDI_EM_STATUS_OK;
+}
+
+// Upload the file once, the master hands over each segment the slave sent and waits to be continued
+static ddi_em_result foe_stream_upload(foe_stream_table *table, foe_stream_slot *slot, bool *retry)
+{
+  ddi_em_handle em_handle = slot->em_handle;
+  ddi_es_handle es_handle = slot->config.es_handle;
+  uint32_t offset = 0, length, result, busy_done = 0;
+  EC_T_MBXTFER_STATUS status;
+  ntime_t start;
+  ddi_em_result em_result;
+
+  *retry = false;
+  em_result = foe_stream_create_tfer(slot);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
+  ddi_ntime_get_systime(&start);
+  foe_stream_report(table, slot, &start, 0);
+  do
+  {
+    // The first call starts the upload, the next ones ask the master for the next segment
+    result = emFoeSegmentedUploadReq(em_handle, slot->tfer, es_handle, slot->filename, (EC_T_DWORD)strlen(slot->filename),
+      slot->config.size, slot->config.password, slot->config.timeout);
+    if ( result != EC_E_NOERROR )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: %s (0x%x)\n", em_handle, es_handle, ecatGetText(result), result);
+      *retry = true;
+      return translate_ddi_acontis_err_code(em_handle, result);
+    }
+
+    em_result = foe_stream_wait_segment(table, slot, &start, offset, &busy_done, &status, retry);
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      return em_result;
+    }
+    length = slot->tfer->dwDataLen;
+    if ( length != 0 )
+    {
+      em_result = slot->config.sink(slot->config.sink_data, offset, slot->tfer->pbyMbxTferData, length);
+      if ( em_result != DDI_EM_STATUS_OK )
+      {
+        ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: the sink failed at byte %d: %s\n", em_handle, es_handle, offset,
+          ddi_em_get_error_string(em_result));
+        if ( status == eMbxTferStatus_TferWaitingForContinue )
+        {
+          emMbxTferAbort(em_handle, slot->tfer);
+        }
+        return em_result;
+      }
+    }
+    offset += length;
+    foe_stream_report(table, slot, &start, offset);
+  } while ( status == eMbxTferStatus_TferWaitingForContinue );
+
+  // The size of an uploaded file is only known once the slave sent its last segment
+  pthread_mutex_lock(&table->lock);
+  slot->progress.total_bytes = offset;
+  pthread_mutex_unlock(&table->lock);
+  foe_slot_reclaim(em_handle, slot);
+  return DDI_EM_STATUS_OK;
+}
+
+// Stream thread, transfers the file and restarts the transfer after a failure
+static void *foe_stream_thread(void *arg)
+{
+  foe_stream_slot *slot = (foe_stream_slot *)arg;
+  foe_stream_table *table = &g_foe_streams[slot->em_handle];
+  ddi_em_foe_progress progress;
+  ddi_em_result result;
+  uint32_t delay_ms;
+  bool retry;
+
+  while ( 1 )
+  {
+    result = (slot->config.sink != NULL) ? foe_stream_upload(table, slot, &retry) : foe_stream_download(table, slot, &retry);
+    if ( (result == DDI_EM_STATUS_OK) || !retry || slot->cancel || (slot->progress.retries >= slot->config.max_retries) )
+    {
+      break;
+    }
+    pthread_mutex_lock(&table->lock);
+    slot->progress.retries++;
+    pthread_mutex_unlock(&table->lock);
+    WLOG(slot->em_handle, "Master[%d] Slave[%d] FoE stream: restarting the transfer of %s, retry %d of %d \n", slot->em_handle,
+      slot->config.es_handle, slot->filename, slot->progress.retries, slot->config.max_retries);
+    for ( delay_ms = 0; (delay_ms < FOE_RETRY_DELAY_MS) && !slot->cancel; delay_ms++ )
+    {
+      usleep(USEC_PER_MSEC);
+    }
+  }
+  if ( slot->cancel && (result != DDI_EM_STATUS_OK) )
+  {
+    result = DDI_EM_STATUS_OP_CANCELLED;
+  }
+  foe_slot_release_source(slot);
+
+  pthread_mutex_lock(&table->lock);
+  slot->progress.result = result;
+  slot->progress.done = 1;
+  slot->state = FOE_STREAM_DONE;
+  progress = slot->progress;
+  pthread_cond_broadcast(&table->done_cond);
+  pthread_mutex_unlock(&table->lock);
+  DLOG(slot->em_handle, "Master[%d] Slave[%d] FoE stream: %d bytes in %d ms (%d bytes/s), %d retries: %s \n", slot->em_handle,
+    progress.es_handle, progress.transferred_bytes, progress.elapsed_ms, progress.bytes_per_sec, progress.retries,
+    ddi_em_get_error_string(result));
+  if ( slot->config.progress != NULL )
+  {
+    slot->config.progress(&progress);
+  }
+  return NULL;
+}
+
+// Reset the stream table of a new master instance
+void ddi_em_foe_stream_init(ddi_em_handle em_handle)
+{
+  foe_stream_table *table = &g_foe_streams[em_handle];
+  pthread_condattr_t cond_attr;
+
+  if ( !table->lock_initialized )
+  {
+    pthread_mutex_init(&table->lock, NULL);
+    // ddi_em_foe_stream_wait() timeouts must not follow wall clock changes
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&table->done_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    table->lock_initialized = true;
+  }
+  pthread_mutex_lock(&table->lock);
+  memset(table->slots, 0, sizeof(table->slots));
+  pthread_mutex_unlock(&table->lock);
+}
+
+// Cancel the running transfers, wait for their threads and release the transfer objects
+void ddi_em_foe_stream_deinit(ddi_em_handle em_handle)
+{
+  foe_stream_table *table = &g_foe_streams[em_handle];
+  uint32_t index;
+
+  if ( !table->lock_initialized )
+  {
+    return;
+  }
+  for ( index = 0; index < DDI_EM_MAX_FOE_STREAMS; index++ )
+  {
+    table->slots[index].cancel = true;
+  }
+  for ( index = 0; index < DDI_EM_MAX_FOE_STREAMS; index++ )
+  {
+    if ( table->slots[index].joinable )
+    {
+      pthread_join(table->slots[index].thread, NULL);
+      table->slots[index].joinable = false;
+    }
+    foe_slot_reclaim(em_handle, &table->slots[index]);
+    table->slots[index].state = FOE_STREAM_FREE;
+  }
+}
+
+// Start a streaming FoE download to a slave or upload from a slave
+EM_API ddi_em_result ddi_em_foe_stream_start(ddi_em_handle em_handle, const ddi_em_foe_stream_config *config, ddi_em_foe_stream_id *stream_id)
+{
+  foe_stream_table *table;
+  foe_stream_slot *slot = NULL;
+  const uint8_t *image = NULL;
+  size_t mapped_size = 0;
+  uint32_t index, size, sources;
+  struct stat st;
+  int fd;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( stream_id == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  // Every failure below leaves an id that the wait and cancel calls reject
+  *stream_id = DDI_EM_FOE_INVALID_STREAM;
+  if ( (config == NULL) || (config->filename == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  // A download reads the file from exactly one source, an upload has no source and writes the file to the sink
+  sources = (config->source_path != NULL) + (config->data != NULL) + (config->source != NULL) + (config->sink != NULL);
+  if ( sources != 1 )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  table = &g_foe_streams[em_handle];
+  if ( !table->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+
+  size = config->size;
+  if ( config->source_path != NULL )
+  {
+    // Map the file instead of reading it, the pages are only touched as the segments are sent
+    fd = open(config->source_path, O_RDONLY);
+    if ( (fd < 0) || (fstat(fd, &st) != 0) || (st.st_size == 0) || (st.st_size > UINT32_MAX) )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: cannot open %s \n", em_handle, config->es_handle, config->source_path);
+      if ( fd >= 0 )
+      {
+        close(fd);
+      }
+      return DDI_EM_STATUS_FILE_OPEN_ERR;
+    }
+    mapped_size = (size_t)st.st_size;
+    image = (const uint8_t *)mmap(NULL, mapped_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if ( image == MAP_FAILED )
+    {
+      ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: cannot map %s \n", em_handle, config->es_handle, config->source_path);
+      return DDI_EM_STATUS_FILE_OPEN_ERR;
+    }
+    madvise((void *)image, mapped_size, MADV_SEQUENTIAL);
+    size = (uint32_t)mapped_size;
+  }
+  else if ( config->data != NULL )
+  {
+    image = config->data;
+  }
+  if ( (size == 0) && (config->sink == NULL) )
+  {
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+
+  pthread_mutex_lock(&table->lock);
+  for ( index = 0; index < DDI_EM_MAX_FOE_STREAMS; index++ )
+  {
+    if ( table->slots[index].state == FOE_STREAM_FREE )
+    {
+      slot = &table->slots[index];
+      break;
+    }
+  }
+  if ( slot == NULL )
+  {
+    pthread_mutex_unlock(&table->lock);
+    if ( mapped_size )
+    {
+      munmap((void *)image, mapped_size);
+    }
+    return DDI_EM_STATUS_BUSY;
+  }
+  slot->state = FOE_STREAM_RUNNING;
+  slot->sequence = (slot->sequence >= FOE_MAX_SEQUENCE) ? 0 : slot->sequence + 1;
+  memset(&slot->progress, 0, sizeof(ddi_em_foe_progress));
+  slot->progress.stream_id = slot->sequence * DDI_EM_MAX_FOE_STREAMS + index + 1;
+  slot->progress.es_handle = config->es_handle;
+  slot->progress.total_bytes = size;
+  slot->progress.user_data = config->user_data;
+  pthread_mutex_unlock(&table->lock);
+
+  // The running slot belongs to this call until its thread starts
+  foe_slot_reclaim(em_handle, slot);
+  slot->em_handle = em_handle;
+  slot->config = *config;
+  if ( slot->config.segment_size == 0 )
+  {
+    slot->config.segment_size = DDI_EM_FOE_SEGMENT_DEFAULT;
+  }
+  slot->image = image;
+  slot->mapped_size = mapped_size;
+  slot->cancel = false;
+  slot->filename = strdup(config->filename);
+  if ( (slot->filename == NULL) || (pthread_create(&slot->thread, NULL, foe_stream_thread, slot) != 0) )
+  {
+    ELOG(em_handle, "Master[%d] Slave[%d] FoE stream: cannot start the stream thread \n", em_handle, config->es_handle);
+    foe_slot_release_source(slot);
+    pthread_mutex_lock(&table->lock);
+    slot->state = FOE_STREAM_FREE;
+    pthread_mutex_unlock(&table->lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  slot->joinable = true;
+  *stream_id = slot->progress.stream_id;
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the progress of a streaming FoE download
+EM_API ddi_em_result ddi_em_foe_stream_get_progress(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id, ddi_em_foe_progress *progress)
+{
+  foe_stream_table *table;
+  foe_stream_slot *slot;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( progress == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  table = &g_foe_streams[em_handle];
+  pthread_mutex_lock(&table->lock);
+  slot = foe_stream_find(table, stream_id);
+  if ( slot != NULL )
+  {
+    *progress = slot->progress;
+  }
+  pthread_mutex_unlock(&table->lock);
+  return slot ? DDI_EM_STATUS_OK : DDI_EM_STATUS_NOT_FOUND;
+}
+
+// Cancel a streaming FoE download
+EM_API ddi_em_result ddi_em_foe_stream_cancel(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id)
+{
+  foe_stream_table *table;
+  foe_stream_slot *slot;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  table = &g_foe_streams[em_handle];
+  pthread_mutex_lock(&table->lock);
+  slot = foe_stream_find(table, stream_id);
+  if ( slot != NULL )
+  {
+    slot->cancel = true;
+  }
+  pthread_mutex_unlock(&table->lock);
+  return slot ? DDI_EM_STATUS_OK : DDI_EM_STATUS_NOT_FOUND;
+}
+
+// Wait for a streaming FoE download to complete and release the stream
+EM_API ddi_em_result ddi_em_foe_stream_wait(ddi_em_handle em_handle, ddi_em_foe_stream_id stream_id, uint32_t timeout_ms, ddi_em_foe_progress *progress)
+{
+  foe_stream_table *table;
+  foe_stream_slot *slot;
+  struct timespec deadline;
+  pthread_t thread;
+  int wait_result = 0;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( progress == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  table = &g_foe_streams[em_handle];
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec  += timeout_ms / MSEC_PER_SEC;
+  deadline.tv_nsec += (timeout_ms % MSEC_PER_SEC) * NSEC_PER_MSEC;
+  if ( deadline.tv_nsec >= NSEC_PER_SEC )
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= NSEC_PER_SEC;
+  }
+
+  pthread_mutex_lock(&table->lock);
+  while ( ((slot = foe_stream_find(table, stream_id)) != NULL) && (slot->state == FOE_STREAM_RUNNING) && (wait_result != ETIMEDOUT) )
+  {
+    wait_result = pthread_cond_timedwait(&table->done_cond, &table->lock, &deadline);
+  }
+  if ( (slot == NULL) || (slot->state != FOE_STREAM_DONE) || !slot->joinable )
+  {
+    // Still running, or another wait released the stream
+    pthread_mutex_unlock(&table->lock);
+    return slot ? DDI_EM_STATUS_TIMEOUT : DDI_EM_STATUS_NOT_FOUND;
+  }
+  *progress = slot->progress;
+  thread = slot->thread;
+  slot->joinable = false;
+  pthread_mutex_unlock(&table->lock);
+
+  // The thread has published its result and is about to exit
+  pthread_join(thread, NULL);
+  pthread_mutex_lock(&table->lock);
+  slot->state = FOE_STREAM_FREE;
+  pthread_mutex_unlock(&table->lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Fill in the progress of a download that didn't run to completion
+static void foe_failed_progress(ddi_em_foe_progress *progress, const ddi_em_foe_stream_config *config, ddi_em_result result)
+{
+  memset(progress, 0, sizeof(ddi_em_foe_progress));
+  progress->es_handle = config->es_handle;
+  progress->done = 1;
+  progress->result = result;
+  progress->user_data = config->user_data;
+}
+
+// Download files to several slaves in parallel and wait for all of them
+EM_API ddi_em_result ddi_em_foe_write_parallel(ddi_em_handle em_handle, const ddi_em_foe_stream_config *configs, uint32_t count, ddi_em_foe_progress *results)
+{
+  ddi_em_foe_stream_id stream_ids[DDI_EM_MAX_FOE_STREAMS];
+  ddi_em_foe_progress progress;
+  ddi_em_result result = DDI_EM_STATUS_OK, start_result, wait_result;
+  uint32_t index;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( configs == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( (count == 0) || (count > DDI_EM_MAX_FOE_STREAMS) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  for ( index = 0; index < count; index++ )
+  {
+    start_result = ddi_em_foe_stream_start(em_handle, &configs[index], &stream_ids[index]);
+    if ( start_result != DDI_EM_STATUS_OK )
+    {
+      if ( results != NULL )
+      {
+        foe_failed_progress(&results[index], &configs[index], start_result);
+      }
+      result = (result == DDI_EM_STATUS_OK) ? start_result : result;
+    }
+  }
+  for ( index = 0; index < count; index++ )
+  {
+    if ( stream_ids[index] == DDI_EM_FOE_INVALID_STREAM )
+    {
+      continue;
+    }
+    while ( (wait_result = ddi_em_foe_stream_wait(em_handle, stream_ids[index], UINT32_MAX / 2, &progress)) == DDI_EM_STATUS_TIMEOUT );
+    if ( wait_result != DDI_EM_STATUS_OK )
+    {
+      // The stream was released by another wait, its progress is gone
+      foe_failed_progress(&progress, &configs[index], wait_result);
+    }
+    if ( results != NULL )
+    {
+      results[index] = progress;
+    }
+    result = (result == DDI_EM_STATUS_OK) ? progress.result : result;
+  }
+  return result;
+}
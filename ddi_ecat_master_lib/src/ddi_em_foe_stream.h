@@ -0,0 +1,27 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_FOE_STREAM_H
+#define DDI_EM_FOE_STREAM_H
+
+// Streaming FoE downloads and uploads of a master instance
+
+#include "ddi_em_api.h"
+
+/** ddi_em_foe_stream_init
+ @brief Reset the streaming FoE table of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_foe_stream_init(ddi_em_handle em_handle);
+
+/** ddi_em_foe_stream_deinit
+ @brief Cancel the running transfers, wait for their threads and release the transfer objects
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_foe_stream_deinit(ddi_em_handle em_handle);
+
+#endif // DDI_EM_FOE_STREAM_H
@@ -5,6 +5,9 @@ confidential trade secrets belonging to DDI. Disclosure or release without
 prior written authorization of DDI is prohibited.
 **************************************************************************/
 
+#include <pthread.h>
+#include <semaphore.h>
+#include <string.h>
 #include "ddi_debug.h"
 #include "ddi_em_config.h"
 #include "ddi_em_api.h"
@@ -27,13 +30,123 @@ static EC_T_DWORD ecatNotify(
 uint32_t g_event_cb_instance[DDI_EM_MAX_MASTER_INSTANCES] = { 0 };
 static ddi_em_event_func *event_callbacks[DDI_EM_MAX_MASTER_INSTANCES]; // One callback per instance
 
+// SDK-generated events are raised in the cyclic thread, they are queued and delivered to the event handler by the
+// event thread of the instance so a slow handler does not hold up the cycle
+#define DDI_EM_EVENT_QUEUE_SIZE 32
+
+typedef struct {
+  ddi_em_event event;
+  char         event_str[DDI_EM_EVENT_MAX_STR_SIZE];
+} queued_event;
+
+typedef struct {
+  pthread_mutex_t lock;      // Taken with trylock by the cyclic thread, an event is dropped rather than waited for
+  sem_t           ready;     // Posted for each queued event and to stop the thread
+  pthread_t       thread;
+  bool            running;
+  bool            stop;
+  uint32_t        head;      // Next event to deliver
+  uint32_t        count;
+  queued_event    events[DDI_EM_EVENT_QUEUE_SIZE];
+} event_queue;
+
+static event_queue g_event_queues[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Deliver the queued events of a master instance to its event handler
+static void *event_thread (void *arg)
+{
+  ddi_em_handle em_handle = (ddi_em_handle)(intptr_t)arg;
+  event_queue *queue = &g_event_queues[em_handle];
+  ddi_em_event_func *callback;
+  queued_event delivered;
+
+  while ( 1 )
+  {
+    sem_wait(&queue->ready);
+    pthread_mutex_lock(&queue->lock);
+    if ( queue->stop )
+    {
+      pthread_mutex_unlock(&queue->lock);
+      break;
+    }
+    if ( queue->count == 0 )
+    {
+      pthread_mutex_unlock(&queue->lock);
+      continue;
+    }
+    delivered = queue->events[queue->head];
+    queue->head = (queue->head + 1) % DDI_EM_EVENT_QUEUE_SIZE;
+    queue->count--;
+    pthread_mutex_unlock(&queue->lock);
+
+    delivered.event.event_str = delivered.event_str;
+    callback = event_callbacks[em_handle];
+    if ( callback != NULL )
+    {
+      (*callback)(&delivered.event);
+    }
+  }
+  return NULL;
+}
+
+// Start the event thread of a master instance, once
+static ddi_em_result start_event_thread (ddi_em_handle em_handle)
+{
+  event_queue *queue = &g_event_queues[em_handle];
+
+  if ( queue->running )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  pthread_mutex_init(&queue->lock, NULL);
+  sem_init(&queue->ready, 0, 0);
+  queue->stop = false;
+  queue->head = 0;
+  queue->count = 0;
+  if ( pthread_create(&queue->thread, NULL, event_thread, (void *)(intptr_t)em_handle) != 0 )
+  {
+    ELOG(em_handle, "Master[%d] cannot start the event thread \n", em_handle);
+    sem_destroy(&queue->ready);
+    pthread_mutex_destroy(&queue->lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  queue->running = true;
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop the event thread of a master instance, the events still queued are dropped
+void ddi_em_notify_deinit(ddi_em_handle em_handle)
+{
+  event_queue *queue = &g_event_queues[em_handle];
+
+  event_callbacks[em_handle] = NULL;
+  if ( !queue->running )
+  {
+    return;
+  }
+  pthread_mutex_lock(&queue->lock);
+  queue->stop = true;
+  pthread_mutex_unlock(&queue->lock);
+  sem_post(&queue->ready);
+  pthread_join(queue->thread, NULL);
+  sem_destroy(&queue->ready);
+  pthread_mutex_destroy(&queue->lock);
+  queue->running = false;
+}
+
 // Register notifications with the Acontis notification subsystem
 EM_API ddi_em_result ddi_em_set_event_handler(ddi_em_handle em_handle, ddi_em_event_func *callback)
 {
   uint32_t result;
+  ddi_em_result em_result;
   ddi_em_instance *instance;
   EC_T_REGISTERRESULTS register_results;
   VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  em_result = start_event_thread(em_handle);
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    return em_result;
+  }
   g_event_cb_instance[em_handle] = em_handle;
   VLOG(em_handle, "Master[%d] register notifications: entry \n", em_handle);
   // Register notifications with the Acontis core
@@ -89,6 +202,40 @@ EM_API ddi_em_result ddi_em_enable_event_handler(ddi_em_handle em_handle, ddi_em
     return DDI_EM_STATUS_OK;
 }
 
+// Queue an SDK-generated event for the application event handler, called from the cyclic thread
+void ddi_em_notify_event(ddi_em_handle em_handle, ddi_es_handle es_handle, ddi_em_event_type event_code, const char *event_str, uint64_t event_value)
+{
+  event_queue *queue = &g_event_queues[em_handle];
+  ddi_em_master_stats *stats = &get_master_instance(em_handle)->master_status.master_stats;
+  queued_event *queued;
+
+  if ( (event_callbacks[em_handle] == NULL) || !queue->running )
+  {
+    return;
+  }
+  if ( pthread_mutex_trylock(&queue->lock) != 0 )
+  {
+    __atomic_add_fetch(&stats->event_drop_count, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  if ( queue->stop || (queue->count == DDI_EM_EVENT_QUEUE_SIZE) )
+  {
+    pthread_mutex_unlock(&queue->lock);
+    __atomic_add_fetch(&stats->event_drop_count, 1, __ATOMIC_RELAXED);
+    return;
+  }
+  queued = &queue->events[(queue->head + queue->count) % DDI_EM_EVENT_QUEUE_SIZE];
+  queued->event.master_handle = em_handle;
+  queued->event.es_handle = es_handle;
+  queued->event.event_code = event_code;
+  queued->event.event_value = event_value;
+  strncpy(queued->event_str, event_str ? event_str : "", DDI_EM_EVENT_MAX_STR_SIZE - 1);
+  queued->event_str[DDI_EM_EVENT_MAX_STR_SIZE - 1] = 0;
+  queue->count++;
+  pthread_mutex_unlock(&queue->lock);
+  sem_post(&queue->ready);
+}
+
 /***************************************************************************************/
 /** @brief  EtherCAT notification
 *
@@ -107,6 +254,7 @@ static EC_T_DWORD ecatNotify(
   em_handle = (ddi_em_handle *)pParms->pCallerData;
   DLOG(*em_handle, "Master[%d] handle notify entry: code 0x%x \n", *em_handle, dwCode);
   event_event.master_handle = *em_handle;
+  event_event.event_value = 0;
 
   // The following function translates from Acontis Notifications to DDI EM notifications
   if ( translate_acontis_ddi_event_code(*em_handle,0, dwCode, &event_event) == DDI_EM_STATUS_OK )
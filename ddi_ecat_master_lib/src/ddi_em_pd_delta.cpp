@@ -0,0 +1,514 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+#include "ddi_em_pd_delta.h"
+
+// This file detects input changes from one cycle to the next. The input image is handled in 64-bit words, loaded
+// little-endian so bit n of a word is bit n of the corresponding input bytes. The union of the watched regions is kept
+// as a bit mask and as a list of word spans, so each cycle only the words covered by a region are compared. The
+// changed bits are stored in the change bitmap, which the edge callbacks and ddi_em_pd_delta_next() scan word by word.
+// The edge callbacks run after the lock is released, so they can add and remove regions. While they run, the mask, the
+// spans and the change bitmap stay as they are and a region update only marks them for a rebuild at the start of the
+// next cycle.
+
+#define PD_DELTA_WORD_BITS 64
+
+typedef struct {
+  bool                 used;
+  uint32_t             bit_offset;
+  uint32_t             bit_size;
+  uint8_t              edges;         // Transitions reported to the callback @see ddi_em_pd_edge
+  ddi_em_pd_edge_func *callback;
+  void                *user_data;
+  uint32_t             change_count;  // Bits changed in the current cycle
+  uint32_t             sequence;      // Nonzero while registered, a callback stops once its region is removed
+} pd_delta_region;
+
+// A region with edges to report, copied under the lock so its callbacks can run unlocked
+typedef struct {
+  uint32_t        index;
+  pd_delta_region region;
+} pd_delta_dispatch;
+
+// A run of words covered by at least one region
+typedef struct {
+  uint32_t first;
+  uint32_t count;
+} pd_delta_span;
+
+typedef struct {
+  pthread_mutex_t  lock;              // Protects the regions against the cyclic thread
+  bool             lock_initialized;
+  uint8_t         *image;             // The input process data
+  uint32_t         image_size;        // Input process data size in bytes
+  uint32_t         word_count;
+  uint64_t        *prev;              // Input words of the previous cycle
+  uint64_t        *mask;              // Bits covered by a region
+  uint64_t        *changed;           // Bits changed in the current cycle
+  pd_delta_span   *spans;
+  uint32_t         span_count;
+  pd_delta_region  regions[DDI_EM_PD_DELTA_MAX_REGIONS];
+  uint32_t         sequence;          // Last region sequence handed out
+  bool             dispatching;       // Are the edge callbacks running?
+  bool             rebuild_pending;   // Was a region updated while they ran?
+  pd_delta_dispatch dispatch[DDI_EM_PD_DELTA_MAX_REGIONS];
+} pd_delta_state;
+
+static pd_delta_state g_pd_delta[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Load an input word, the last word of the image may be partial
+static inline uint64_t pd_delta_load(const pd_delta_state *state, uint32_t word)
+{
+  uint64_t value = 0;
+  uint32_t offset = word * sizeof(uint64_t);
+  uint32_t size = state->image_size - offset;
+  memcpy(&value, &state->image[offset], (size < sizeof(uint64_t)) ? size : sizeof(uint64_t));
+  return value;
+}
+
+// Return the bits of a word covered by a region
+static uint64_t pd_delta_region_mask(const pd_delta_region *region, uint32_t word)
+{
+  uint32_t word_start = word * PD_DELTA_WORD_BITS;
+  uint32_t start = (region->bit_offset > word_start) ? region->bit_offset - word_start : 0;
+  uint32_t end = region->bit_offset + region->bit_size - word_start;
+  uint64_t mask = ~0ULL << start;
+  if ( end < PD_DELTA_WORD_BITS )
+  {
+    mask &= (1ULL << end) - 1;
+  }
+  return mask;
+}
+
+// Rebuild the region mask and the word spans and clear the changes of the current cycle, called with the lock held
+static void pd_delta_rebuild(pd_delta_state *state)
+{
+  pd_delta_region *region;
+  uint32_t index, word, last;
+
+  memset(state->mask, 0, state->word_count * sizeof(uint64_t));
+  memset(state->changed, 0, state->word_count * sizeof(uint64_t));
+  for ( index = 0; index < DDI_EM_PD_DELTA_MAX_REGIONS; index++ )
+  {
+    region = &state->regions[index];
+    region->change_count = 0;
+    if ( !region->used )
+    {
+      continue;
+    }
+    last = (region->bit_offset + region->bit_size - 1) / PD_DELTA_WORD_BITS;
+    for ( word = region->bit_offset / PD_DELTA_WORD_BITS; word <= last; word++ )
+    {
+      state->mask[word] |= pd_delta_region_mask(region, word);
+    }
+  }
+
+  state->span_count = 0;
+  for ( word = 0; word < state->word_count; word++ )
+  {
+    if ( state->mask[word] == 0 )
+    {
+      continue;
+    }
+    if ( (state->span_count > 0) && (state->spans[state->span_count - 1].first + state->spans[state->span_count - 1].count == word) )
+    {
+      state->spans[state->span_count - 1].count++;
+    }
+    else
+    {
+      state->spans[state->span_count].first = word;
+      state->spans[state->span_count].count = 1;
+      state->span_count++;
+    }
+  }
+}
+
+// Return a registered region or NULL
+static pd_delta_region *pd_delta_get_region(pd_delta_state *state, uint32_t region_id)
+{
+  if ( (region_id >= DDI_EM_PD_DELTA_MAX_REGIONS) || !state->regions[region_id].used )
+  {
+    return NULL;
+  }
+  return &state->regions[region_id];
+}
+
+// Count the changed bits of a region, called with the lock held
+static void pd_delta_count_region(pd_delta_state *state, pd_delta_region *region)
+{
+  uint32_t word, last;
+
+  region->change_count = 0;
+  last = (region->bit_offset + region->bit_size - 1) / PD_DELTA_WORD_BITS;
+  for ( word = region->bit_offset / PD_DELTA_WORD_BITS; word <= last; word++ )
+  {
+    region->change_count += __builtin_popcountll(state->changed[word] & pd_delta_region_mask(region, word));
+  }
+}
+
+// Report the requested edges of a region copied for dispatch, called without the lock
+static void pd_delta_report_region(ddi_em_handle em_handle, pd_delta_state *state, const pd_delta_dispatch *dispatch)
+{
+  const pd_delta_region *region = &dispatch->region;
+  const uint32_t *sequence = &state->regions[dispatch->index].sequence;
+  uint32_t word, last, bit;
+  uint64_t bits, current;
+  uint8_t value;
+
+  last = (region->bit_offset + region->bit_size - 1) / PD_DELTA_WORD_BITS;
+  for ( word = region->bit_offset / PD_DELTA_WORD_BITS; word <= last; word++ )
+  {
+    bits = state->changed[word] & pd_delta_region_mask(region, word);
+    current = state->prev[word]; // Holds the current inputs once the cycle is compared
+    while ( bits )
+    {
+      bit = __builtin_ctzll(bits);
+      bits &= bits - 1;
+      value = (current >> bit) & 1;
+      if ( region->edges & (value ? DDI_EM_PD_EDGE_RISING : DDI_EM_PD_EDGE_FALLING) )
+      {
+        // A callback may have removed the region
+        if ( __atomic_load_n(sequence, __ATOMIC_RELAXED) != region->sequence )
+        {
+          return;
+        }
+        region->callback(em_handle, word * PD_DELTA_WORD_BITS + bit, value, region->user_data);
+      }
+    }
+  }
+}
+
+// Rebuild the mask and the spans after a region update, or leave it to the next cycle while the edge callbacks run,
+// called with the lock held
+static void pd_delta_update(pd_delta_state *state)
+{
+  if ( __atomic_load_n(&state->dispatching, __ATOMIC_ACQUIRE) )
+  {
+    state->rebuild_pending = true;
+    return;
+  }
+  pd_delta_rebuild(state);
+}
+
+// Reset the input change detection of a new master instance
+void ddi_em_pd_delta_init(ddi_em_handle em_handle)
+{
+  pd_delta_state *state = &g_pd_delta[em_handle];
+  if ( !state->lock_initialized )
+  {
+    pthread_mutex_init(&state->lock, NULL);
+    state->lock_initialized = true;
+  }
+  ddi_em_pd_delta_free(em_handle);
+}
+
+// Free the change detection buffers and drop the registered regions
+void ddi_em_pd_delta_free(ddi_em_handle em_handle)
+{
+  pd_delta_state *state = &g_pd_delta[em_handle];
+  pthread_mutex_lock(&state->lock);
+  free(state->prev);
+  free(state->mask);
+  free(state->changed);
+  free(state->spans);
+  state->prev = state->mask = state->changed = NULL;
+  state->spans = NULL;
+  state->span_count = 0;
+  state->word_count = 0;
+  state->image = NULL;
+  state->image_size = 0;
+  state->rebuild_pending = false;
+  memset(state->regions, 0, sizeof(state->regions));
+  pthread_mutex_unlock(&state->lock);
+}
+
+// Size the change detection buffers for the input process data image
+ddi_em_result ddi_em_pd_delta_build(ddi_em_handle em_handle)
+{
+  pd_delta_state *state = &g_pd_delta[em_handle];
+  EC_T_MEMREQ_DESC mem_desc;
+  EC_T_DWORD out_size = 0;
+  uint32_t result, word_count;
+
+  ddi_em_pd_delta_free(em_handle);
+  memset(&mem_desc, 0, sizeof(mem_desc));
+  result = emIoCtl(em_handle, EC_IOCTL_GET_PDMEMORYSIZE, EC_NULL, 0, (EC_T_BYTE *)&mem_desc, sizeof(mem_desc), &out_size);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] configure: Cannot read the process data size: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+    return translate_ddi_acontis_err_code(em_handle, result);
+  }
+  if ( mem_desc.dwPDInSize == 0 )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+
+  word_count = (mem_desc.dwPDInSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+  pthread_mutex_lock(&state->lock);
+  state->prev = (uint64_t *)calloc(word_count, sizeof(uint64_t));
+  state->mask = (uint64_t *)calloc(word_count, sizeof(uint64_t));
+  state->changed = (uint64_t *)calloc(word_count, sizeof(uint64_t));
+  state->spans = (pd_delta_span *)calloc(word_count, sizeof(pd_delta_span));
+  if ( (state->prev != NULL) && (state->mask != NULL) && (state->changed != NULL) && (state->spans != NULL) )
+  {
+    state->image = get_master_instance(em_handle)->master_config.pd_input;
+    state->image_size = mem_desc.dwPDInSize;
+    state->word_count = word_count;
+  }
+  pthread_mutex_unlock(&state->lock);
+  if ( state->word_count == 0 )
+  {
+    ddi_em_pd_delta_free(em_handle);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Compare the watched input regions against the previous cycle and run the edge callbacks without the lock
+void ddi_em_pd_delta_cycle(ddi_em_handle em_handle)
+{
+  pd_delta_state *state = &g_pd_delta[em_handle];
+  pd_delta_region *region;
+  uint32_t span, word, end, index, dispatch_count = 0;
+  uint64_t current, changed_any = 0;
+
+  // Never block the cyclic thread. While a region is added or removed the comparison is skipped, the previous inputs
+  // are kept so the changes show up in the next cycle, and the rebuild has already cleared the changes of this cycle
+  if ( pthread_mutex_trylock(&state->lock) != 0 )
+  {
+    return;
+  }
+  if ( state->rebuild_pending )
+  {
+    pd_delta_rebuild(state);
+    state->rebuild_pending = false;
+  }
+  for ( span = 0; span < state->span_count; span++ )
+  {
+    end = state->spans[span].first + state->spans[span].count;
+    for ( word = state->spans[span].first; word < end; word++ )
+    {
+      current = pd_delta_load(state, word);
+      state->changed[word] = (current ^ state->prev[word]) & state->mask[word];
+      state->prev[word] = current;
+      changed_any |= state->changed[word];
+    }
+  }
+  for ( index = 0; index < DDI_EM_PD_DELTA_MAX_REGIONS; index++ )
+  {
+    region = &state->regions[index];
+    if ( region->used && (changed_any || region->change_count) )
+    {
+      pd_delta_count_region(state, region);
+      if ( (region->callback != NULL) && region->change_count )
+      {
+        state->dispatch[dispatch_count].index = index;
+        state->dispatch[dispatch_count].region = *region;
+        dispatch_count++;
+      }
+    }
+  }
+  if ( dispatch_count == 0 )
+  {
+    pthread_mutex_unlock(&state->lock);
+    return;
+  }
+  __atomic_store_n(&state->dispatching, true, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&state->lock);
+
+  for ( index = 0; index < dispatch_count; index++ )
+  {
+    pd_delta_report_region(em_handle, state, &state->dispatch[index]);
+  }
+
+  // The region updates of the callbacks are applied at the start of the next cycle, so the cyclic callback still
+  // sees the changes of this one
+  __atomic_store_n(&state->dispatching, false, __ATOMIC_RELEASE);
+}
+
+// Watch a region of the input process data for changes
+EM_API ddi_em_result ddi_em_pd_delta_add_region(ddi_em_handle em_handle, uint32_t bit_offset, uint32_t bit_size, ddi_em_pd_edge edges,
+                                                ddi_em_pd_edge_func *callback, void *user_data, uint32_t *region_id)
+{
+  pd_delta_state *state;
+  pd_delta_region *region = NULL;
+  uint32_t index, word, last;
+  uint64_t mask;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( region_id == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  state = &g_pd_delta[em_handle];
+
+  pthread_mutex_lock(&state->lock);
+  if ( state->word_count == 0 )
+  {
+    pthread_mutex_unlock(&state->lock);
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  if ( (bit_size == 0) || (bit_offset + bit_size < bit_offset) || (bit_offset + bit_size > state->image_size * 8) )
+  {
+    pthread_mutex_unlock(&state->lock);
+    ELOG(em_handle, "Master[%d] change detection: region of %d bits at bit %d is outside of the %d byte input process data \n",
+      em_handle, bit_size, bit_offset, state->image_size);
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  for ( index = 0; index < DDI_EM_PD_DELTA_MAX_REGIONS; index++ )
+  {
+    if ( !state->regions[index].used )
+    {
+      region = &state->regions[index];
+      break;
+    }
+  }
+  if ( region == NULL )
+  {
+    pthread_mutex_unlock(&state->lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+
+  region->bit_offset = bit_offset;
+  region->bit_size = bit_size;
+  region->edges = (uint8_t)edges;
+  region->callback = callback;
+  region->user_data = user_data;
+  region->change_count = 0;
+  region->used = true;
+  state->sequence = (state->sequence == UINT32_MAX) ? 1 : state->sequence + 1;
+  __atomic_store_n(&region->sequence, state->sequence, __ATOMIC_RELAXED);
+  // Take the current inputs of the new region as the reference, so they don't show up as changes in the next cycle
+  last = (bit_offset + bit_size - 1) / PD_DELTA_WORD_BITS;
+  for ( word = bit_offset / PD_DELTA_WORD_BITS; word <= last; word++ )
+  {
+    mask = pd_delta_region_mask(region, word) & ~state->mask[word];
+    state->prev[word] = (state->prev[word] & ~mask) | (pd_delta_load(state, word) & mask);
+  }
+  pd_delta_update(state);
+  pthread_mutex_unlock(&state->lock);
+  *region_id = index;
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop watching an input region
+EM_API ddi_em_result ddi_em_pd_delta_remove_region(ddi_em_handle em_handle, uint32_t region_id)
+{
+  pd_delta_state *state;
+  pd_delta_region *region;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  state = &g_pd_delta[em_handle];
+
+  pthread_mutex_lock(&state->lock);
+  region = pd_delta_get_region(state, region_id);
+  if ( region == NULL )
+  {
+    pthread_mutex_unlock(&state->lock);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  __atomic_store_n(&region->sequence, 0, __ATOMIC_RELAXED);
+  region->used = false;
+  region->callback = NULL;
+  region->user_data = NULL;
+  region->change_count = 0;
+  pd_delta_update(state);
+  pthread_mutex_unlock(&state->lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the next input of a region that changed in the current cycle
+EM_API ddi_em_result ddi_em_pd_delta_next(ddi_em_handle em_handle, uint32_t region_id, uint32_t *cursor, uint32_t *bit_offset, uint8_t *value)
+{
+  pd_delta_state *state;
+  pd_delta_region *region;
+  uint32_t bit, word, last;
+  uint64_t bits;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (cursor == NULL) || (bit_offset == NULL) || (value == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  state = &g_pd_delta[em_handle];
+  region = pd_delta_get_region(state, region_id);
+  if ( region == NULL )
+  {
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+
+  // The cursor is the region-relative bit to continue from
+  if ( (region->change_count == 0) || (*cursor >= region->bit_size) )
+  {
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  bit = region->bit_offset + *cursor;
+  last = (region->bit_offset + region->bit_size - 1) / PD_DELTA_WORD_BITS;
+  for ( word = bit / PD_DELTA_WORD_BITS; word <= last; word++ )
+  {
+    bits = state->changed[word] & pd_delta_region_mask(region, word);
+    if ( word == bit / PD_DELTA_WORD_BITS )
+    {
+      bits &= ~0ULL << (bit % PD_DELTA_WORD_BITS);
+    }
+    if ( bits )
+    {
+      bit = word * PD_DELTA_WORD_BITS + __builtin_ctzll(bits);
+      *bit_offset = bit;
+      *value = (state->prev[word] >> (bit % PD_DELTA_WORD_BITS)) & 1;
+      *cursor = bit - region->bit_offset + 1;
+      return DDI_EM_STATUS_OK;
+    }
+  }
+  *cursor = region->bit_size;
+  return DDI_EM_STATUS_NOT_FOUND;
+}
+
+// Return the number of inputs of a region that changed in the current cycle
+EM_API ddi_em_result ddi_em_pd_delta_get_changes(ddi_em_handle em_handle, uint32_t region_id, uint32_t *change_count)
+{
+  pd_delta_region *region;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( change_count == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  region = pd_delta_get_region(&g_pd_delta[em_handle], region_id);
+  if ( region == NULL )
+  {
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  *change_count = region->change_count;
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the change bitmap of the current cycle
+EM_API ddi_em_result ddi_em_pd_delta_get_bitmap(ddi_em_handle em_handle, const uint64_t **bitmap, uint32_t *word_count)
+{
+  pd_delta_state *state;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (bitmap == NULL) || (word_count == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  state = &g_pd_delta[em_handle];
+  if ( state->word_count == 0 )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  *bitmap = state->changed;
+  *word_count = state->word_count;
+  return DDI_EM_STATUS_OK;
+}
@@ -0,0 +1,42 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_PD_DELTA_H
+#define DDI_EM_PD_DELTA_H
+
+// Per-cycle input change detection of a master instance
+
+#include "ddi_em_api.h"
+
+/** ddi_em_pd_delta_init
+ @brief Reset the input change detection of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_pd_delta_init(ddi_em_handle em_handle);
+
+/** ddi_em_pd_delta_build
+ @brief Size the change detection buffers for the input process data image, the registered regions are dropped
+ Must be called after emConfigureMaster()
+ @param em_handle The EtherCAT master handle
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_delta_build(ddi_em_handle em_handle);
+
+/** ddi_em_pd_delta_free
+ @brief Free the change detection buffers and drop the registered regions
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_pd_delta_free(ddi_em_handle em_handle);
+
+/** ddi_em_pd_delta_cycle
+ @brief Compare the registered input regions against the previous cycle and run the edge callbacks, called by the
+ cyclic thread after the cyclic frames were received. The cycle is skipped while a region is added or removed
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_pd_delta_cycle(ddi_em_handle em_handle);
+
+#endif // DDI_EM_PD_DELTA_H
@@ -0,0 +1,291 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+
+// This file compiles lists of process data fields into access plans. All addresses are resolved when the plan is
+// compiled. Byte aligned fields become memcpy operations, sorted by process data address and merged when they're
+// contiguous in both the process data and the user structure. The remaining fields become bit copy operations.
+
+// One copy operation of a plan
+typedef struct {
+  uint8_t  *image;        // First process data byte of the operation
+  uint32_t user_offset;   // Byte offset in the user structure
+  uint32_t size;          // Bytes for a copy operation, bits for a bit copy operation
+  uint8_t  bit_shift;     // Bit position in the first process data byte, bit copy operations only
+} pd_plan_op;
+
+// The operations of one direction, the memcpy operations first
+typedef struct {
+  pd_plan_op *ops;
+  uint32_t   copy_count;
+  uint32_t   bit_count;
+} pd_plan_ops;
+
+struct ddi_em_pd_plan_t {
+  ddi_em_handle em_handle;
+  uint32_t      field_count;
+  pd_plan_ops   gather;       // Process data -> user structure, all fields
+  pd_plan_ops   scatter;      // User structure -> output process data, output fields only
+};
+
+// Order the memcpy operations by process data address so contiguous fields end up next to each other
+static int pd_plan_op_compare(const void *a, const void *b)
+{
+  const pd_plan_op *op_a = (const pd_plan_op *)a;
+  const pd_plan_op *op_b = (const pd_plan_op *)b;
+  if ( op_a->image != op_b->image )
+  {
+    return (op_a->image < op_b->image) ? -1 : 1;
+  }
+  return (op_a->user_offset < op_b->user_offset) ? -1 : (op_a->user_offset > op_b->user_offset);
+}
+
+// Sort and merge the memcpy operations, the bit copy operations are moved behind them
+static void pd_plan_merge(pd_plan_ops *plan_ops, pd_plan_op *copy_ops, uint32_t copy_count, pd_plan_op *bit_ops, uint32_t bit_count)
+{
+  pd_plan_op *last = NULL;
+  uint32_t index;
+
+  qsort(copy_ops, copy_count, sizeof(pd_plan_op), pd_plan_op_compare);
+  plan_ops->copy_count = 0;
+  for ( index = 0; index < copy_count; index++ )
+  {
+    if ( (last != NULL) && (copy_ops[index].image == last->image + last->size) &&
+         (copy_ops[index].user_offset == last->user_offset + last->size) )
+    {
+      last->size += copy_ops[index].size;
+      continue;
+    }
+    last = &plan_ops->ops[plan_ops->copy_count++];
+    *last = copy_ops[index];
+  }
+  memcpy(&plan_ops->ops[plan_ops->copy_count], bit_ops, bit_count * sizeof(pd_plan_op));
+  plan_ops->bit_count = bit_count;
+}
+
+// Compile a list of process data fields into an access plan
+EM_API ddi_em_result ddi_em_pd_plan_create(ddi_em_handle em_handle, const ddi_em_pd_field *fields, uint32_t count, uint32_t user_size, ddi_em_pd_plan **plan)
+{
+  ddi_em_instance *instance;
+  ddi_em_pd_plan *new_plan = NULL;
+  ddi_em_pd_var_info info;
+  EC_T_MEMREQ_DESC mem_desc;
+  EC_T_DWORD out_size = 0;
+  uint32_t acontis_result, image_size;
+  pd_plan_op *copy_ops = NULL, *bit_ops = NULL, *out_copy_ops = NULL, *out_bit_ops = NULL, op;
+  uint32_t copy_count = 0, bit_count = 0, out_copy_count = 0, out_bit_count = 0, index;
+  ddi_em_result result = DDI_EM_STATUS_OK;
+  uint8_t *image;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( ((fields == NULL) && (count > 0)) || (plan == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  instance = get_master_instance(em_handle);
+  if ( (instance->master_config.pd_input == NULL) || (instance->master_config.pd_output == NULL) )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  // Every field must lie within its process data image
+  memset(&mem_desc, 0, sizeof(mem_desc));
+  acontis_result = emIoCtl(em_handle, EC_IOCTL_GET_PDMEMORYSIZE, EC_NULL, 0, (EC_T_BYTE *)&mem_desc, sizeof(mem_desc), &out_size);
+  if ( acontis_result != EC_E_NOERROR )
+  {
+    return translate_ddi_acontis_err_code(em_handle, acontis_result);
+  }
+
+  new_plan = (ddi_em_pd_plan *)calloc(1, sizeof(ddi_em_pd_plan));
+  copy_ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+  bit_ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+  out_copy_ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+  out_bit_ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+  if ( new_plan != NULL )
+  {
+    new_plan->gather.ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+    new_plan->scatter.ops = (pd_plan_op *)calloc(count + 1, sizeof(pd_plan_op));
+  }
+  if ( (new_plan == NULL) || (new_plan->gather.ops == NULL) || (new_plan->scatter.ops == NULL) || (copy_ops == NULL) ||
+       (bit_ops == NULL) || (out_copy_ops == NULL) || (out_bit_ops == NULL) )
+  {
+    result = DDI_EM_STATUS_NO_RESOURCES;
+    goto exit;
+  }
+
+  for ( index = 0; index < count; index++ )
+  {
+    if ( fields[index].name != NULL )
+    {
+      result = ddi_em_pd_lookup(em_handle, fields[index].name, &info);
+      if ( result != DDI_EM_STATUS_OK )
+      {
+        ELOG(em_handle, "Master[%d] access plan: process variable %s not found \n", em_handle, fields[index].name);
+        goto exit;
+      }
+    }
+    else
+    {
+      info.bit_offset = fields[index].pd_bit_offset;
+      info.bit_size   = fields[index].bit_size;
+      info.is_output  = fields[index].is_output;
+    }
+    if ( (info.bit_size == 0) || (fields[index].user_offset + (info.bit_size + 7) / 8 > user_size) )
+    {
+      ELOG(em_handle, "Master[%d] access plan: field %d (%d bits at byte %d) doesn't fit into the %d byte user structure \n",
+        em_handle, index, info.bit_size, fields[index].user_offset, user_size);
+      result = DDI_EM_STATUS_INVALID_SIZE;
+      goto exit;
+    }
+    image_size = info.is_output ? mem_desc.dwPDOutSize : mem_desc.dwPDInSize;
+    if ( (uint64_t)info.bit_offset + info.bit_size > (uint64_t)image_size * 8 )
+    {
+      ELOG(em_handle, "Master[%d] access plan: field %d (%d bits at bit %d) is outside of the %d byte %s process data \n",
+        em_handle, index, info.bit_size, info.bit_offset, image_size, info.is_output ? "output" : "input");
+      result = DDI_EM_STATUS_INVALID_ARG;
+      goto exit;
+    }
+
+    image = info.is_output ? instance->master_config.pd_output : instance->master_config.pd_input;
+    op.image = &image[info.bit_offset / 8];
+    op.user_offset = fields[index].user_offset;
+    op.bit_shift = info.bit_offset % 8;
+    if ( (op.bit_shift == 0) && ((info.bit_size % 8) == 0) )
+    {
+      op.size = info.bit_size / 8;
+      copy_ops[copy_count++] = op;
+      if ( info.is_output )
+      {
+        out_copy_ops[out_copy_count++] = op;
+      }
+    }
+    else
+    {
+      op.size = info.bit_size;
+      bit_ops[bit_count++] = op;
+      if ( info.is_output )
+      {
+        out_bit_ops[out_bit_count++] = op;
+      }
+    }
+  }
+
+  new_plan->em_handle = em_handle;
+  new_plan->field_count = count;
+  pd_plan_merge(&new_plan->gather, copy_ops, copy_count, bit_ops, bit_count);
+  pd_plan_merge(&new_plan->scatter, out_copy_ops, out_copy_count, out_bit_ops, out_bit_count);
+  DLOG(em_handle, "Master[%d] access plan: %d fields, %d + %d gather and %d + %d scatter operations \n", em_handle, count,
+    new_plan->gather.copy_count, new_plan->gather.bit_count, new_plan->scatter.copy_count, new_plan->scatter.bit_count);
+
+exit:
+  free(copy_ops);
+  free(bit_ops);
+  free(out_copy_ops);
+  free(out_bit_ops);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    ddi_em_pd_plan_free(new_plan);
+    return result;
+  }
+  *plan = new_plan;
+  return DDI_EM_STATUS_OK;
+}
+
+// Copy every field of the plan from the process data into the user structure
+EM_API ddi_em_result ddi_em_pd_plan_gather(const ddi_em_pd_plan *plan, void *user)
+{
+  const pd_plan_op *op, *end;
+  uint8_t *user_bytes = (uint8_t *)user;
+  if ( (plan == NULL) || (user == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  op = plan->gather.ops;
+  for ( end = op + plan->gather.copy_count; op < end; op++ )
+  {
+    memcpy(&user_bytes[op->user_offset], op->image, op->size);
+  }
+  for ( end = op + plan->gather.bit_count; op < end; op++ )
+  {
+    if ( op->size == 1 )
+    {
+      // Single bits, e.g. digital inputs, are the common case
+      user_bytes[op->user_offset] = (*op->image >> op->bit_shift) & 1;
+      continue;
+    }
+    memset(&user_bytes[op->user_offset], 0, (op->size + 7) / 8);
+    EC_COPYBITS(&user_bytes[op->user_offset], 0, op->image, op->bit_shift, op->size);
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Copy the output fields of the plan from the user structure into the output process data
+EM_API ddi_em_result ddi_em_pd_plan_scatter(const ddi_em_pd_plan *plan, const void *user)
+{
+  ddi_em_instance *instance;
+  const pd_plan_op *op, *end;
+  const uint8_t *user_bytes = (const uint8_t *)user;
+  if ( (plan == NULL) || (user == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  instance = get_master_instance(plan->em_handle);
+  // Protect updates of the process data occuring from multiple instances at the same time, once for the whole plan
+  ddi_mutex_lock(instance->master_status.pd_out_mutex, DDI_TIMEOUT_FOREVER);
+  op = plan->scatter.ops;
+  for ( end = op + plan->scatter.copy_count; op < end; op++ )
+  {
+    memcpy(op->image, &user_bytes[op->user_offset], op->size);
+  }
+  for ( end = op + plan->scatter.bit_count; op < end; op++ )
+  {
+    if ( op->size == 1 )
+    {
+      *op->image = (*op->image & ~(1 << op->bit_shift)) | ((user_bytes[op->user_offset] & 1) << op->bit_shift);
+      continue;
+    }
+    EC_COPYBITS(op->image, op->bit_shift, (uint8_t *)&user_bytes[op->user_offset], 0, op->size);
+  }
+  ddi_mutex_unlock(instance->master_status.pd_out_mutex);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the number of copy operations of a compiled plan
+EM_API ddi_em_result ddi_em_pd_plan_get_info(const ddi_em_pd_plan *plan, ddi_em_pd_plan_info *info)
+{
+  if ( (plan == NULL) || (info == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  info->field_count      = plan->field_count;
+  info->gather_copy_ops  = plan->gather.copy_count;
+  info->gather_bit_ops   = plan->gather.bit_count;
+  info->scatter_copy_ops = plan->scatter.copy_count;
+  info->scatter_bit_ops  = plan->scatter.bit_count;
+  return DDI_EM_STATUS_OK;
+}
+
+// Free an access plan
+EM_API ddi_em_result ddi_em_pd_plan_free(ddi_em_pd_plan *plan)
+{
+  if ( plan == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  free(plan->gather.ops);
+  free(plan->scatter.ops);
+  free(plan);
+  return DDI_EM_STATUS_OK;
+}
@@ -0,0 +1,308 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+#include "ddi_em_pd_symbols.h"
+
+// This file keeps the ENI process variables of each master instance in a hash table, built once when the master is
+// configured. ddi_em_pd_bind() resolves a name to a pointer into the process image so the cyclic code can access the
+// variable without a lookup. The process data is little endian like all supported targets, so the values are copied as is.
+
+#define PD_SYMBOL_EMPTY -1
+
+typedef struct {
+  ddi_em_pd_var_info *vars;        // The process variables, inputs first
+  uint32_t           var_count;
+  int32_t            *buckets;     // Open addressing hash table of var indexes
+  uint32_t           bucket_mask;  // Bucket count - 1, the bucket count is a power of 2
+} pd_symbol_table;
+
+static pd_symbol_table g_pd_symbols[DDI_EM_MAX_MASTER_INSTANCES];
+
+// FNV-1a hash of a variable name
+static uint32_t pd_symbol_hash(const char *name)
+{
+  uint32_t hash = 2166136261u;
+  while ( *name )
+  {
+    hash ^= (uint8_t)*name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Return the var index of a name, PD_SYMBOL_EMPTY if the name is unknown
+static int32_t pd_symbol_find(pd_symbol_table *table, const char *name)
+{
+  uint32_t bucket;
+  int32_t var;
+
+  if ( table->buckets == NULL )
+  {
+    return PD_SYMBOL_EMPTY;
+  }
+  for ( bucket = pd_symbol_hash(name) & table->bucket_mask; ; bucket = (bucket + 1) & table->bucket_mask )
+  {
+    var = table->buckets[bucket];
+    if ( (var == PD_SYMBOL_EMPTY) || (strcmp(table->vars[var].name, name) == 0) )
+    {
+      return var;
+    }
+  }
+}
+
+// Append the input or output variables of a configured slave to the table
+static uint32_t pd_symbols_add_slave(ddi_em_handle em_handle, pd_symbol_table *table, uint16_t station_address, uint16_t count, bool output,
+  EC_T_PROCESS_VAR_INFO_EX *var_info)
+{
+  ddi_em_pd_var_info *var;
+  uint16_t read_count = 0;
+  uint32_t result;
+  uint16_t index;
+
+  if ( count == 0 )
+  {
+    return EC_E_NOERROR;
+  }
+  if ( output )
+  {
+    result = emGetSlaveOutpVarInfoEx(em_handle, EC_TRUE, station_address, count, var_info, &read_count);
+  }
+  else
+  {
+    result = emGetSlaveInpVarInfoEx(em_handle, EC_TRUE, station_address, count, var_info, &read_count);
+  }
+  if ( result != EC_E_NOERROR )
+  {
+    return result;
+  }
+  for ( index = 0; index < read_count; index++ )
+  {
+    var = &table->vars[table->var_count++];
+    strncpy(var->name, var_info[index].szName, DDI_EM_PD_MAX_NAME_LEN - 1);
+    var->name[DDI_EM_PD_MAX_NAME_LEN - 1] = '\0';
+    var->data_type     = var_info[index].wDataType;
+    var->slave_address = var_info[index].wFixedAddr;
+    var->bit_offset    = (uint32_t)var_info[index].nBitOffs;
+    var->bit_size      = (uint32_t)var_info[index].nBitSize;
+    var->is_output     = output ? 1 : 0;
+  }
+  return EC_E_NOERROR;
+}
+
+// Free the process variable symbol table
+void ddi_em_pd_symbols_free(ddi_em_handle em_handle)
+{
+  pd_symbol_table *table = &g_pd_symbols[em_handle];
+  free(table->vars);
+  free(table->buckets);
+  memset(table, 0, sizeof(pd_symbol_table));
+}
+
+// Build the process variable symbol table from the configured slaves
+ddi_em_result ddi_em_pd_symbols_build(ddi_em_handle em_handle)
+{
+  pd_symbol_table *table = &g_pd_symbols[em_handle];
+  EC_T_PROCESS_VAR_INFO_EX *var_info = NULL;
+  EC_T_CFG_SLAVE_INFO cfg_info;
+  uint32_t slave_count, position, total = 0, max_count = 0, bucket_count, result = EC_E_NOERROR;
+  uint32_t index, bucket;
+
+  ddi_em_pd_symbols_free(em_handle);
+  slave_count = emGetNumConfiguredSlaves(em_handle);
+
+  // Size the table, the configured slaves are addressed by their auto increment address 0, -1, -2, ...
+  for ( position = 0; position < slave_count; position++ )
+  {
+    result = emGetCfgSlaveInfo(em_handle, EC_FALSE, (uint16_t)(0 - position), &cfg_info);
+    if ( result != EC_E_NOERROR )
+    {
+      goto exit;
+    }
+    total += cfg_info.wNumProcessVarsInp + cfg_info.wNumProcessVarsOutp;
+    max_count = (cfg_info.wNumProcessVarsInp > max_count) ? cfg_info.wNumProcessVarsInp : max_count;
+    max_count = (cfg_info.wNumProcessVarsOutp > max_count) ? cfg_info.wNumProcessVarsOutp : max_count;
+  }
+  if ( total == 0 )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+
+  // Keep the hash table at most half full so the probe sequences stay short
+  for ( bucket_count = 1; bucket_count < 2 * total; bucket_count <<= 1 );
+  table->vars = (ddi_em_pd_var_info *)calloc(total, sizeof(ddi_em_pd_var_info));
+  table->buckets = (int32_t *)malloc(bucket_count * sizeof(int32_t));
+  var_info = (EC_T_PROCESS_VAR_INFO_EX *)calloc(max_count, sizeof(EC_T_PROCESS_VAR_INFO_EX));
+  if ( (table->vars == NULL) || (table->buckets == NULL) || (var_info == NULL) )
+  {
+    ELOG(em_handle, "Master[%d] configure: Cannot allocate the symbol table for %d process variables\n", em_handle, total);
+    free(var_info);
+    ddi_em_pd_symbols_free(em_handle);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  table->bucket_mask = bucket_count - 1;
+
+  for ( position = 0; position < slave_count; position++ )
+  {
+    result = emGetCfgSlaveInfo(em_handle, EC_FALSE, (uint16_t)(0 - position), &cfg_info);
+    if ( result == EC_E_NOERROR )
+    {
+      result = pd_symbols_add_slave(em_handle, table, cfg_info.wStationAddress, cfg_info.wNumProcessVarsInp, false, var_info);
+    }
+    if ( result == EC_E_NOERROR )
+    {
+      result = pd_symbols_add_slave(em_handle, table, cfg_info.wStationAddress, cfg_info.wNumProcessVarsOutp, true, var_info);
+    }
+    if ( result != EC_E_NOERROR )
+    {
+      goto exit;
+    }
+  }
+
+  // Hash the names, a duplicate name keeps its first variable
+  memset(table->buckets, 0xFF, bucket_count * sizeof(int32_t));
+  for ( index = 0; index < table->var_count; index++ )
+  {
+    for ( bucket = pd_symbol_hash(table->vars[index].name) & table->bucket_mask; table->buckets[bucket] != PD_SYMBOL_EMPTY;
+          bucket = (bucket + 1) & table->bucket_mask )
+    {
+      if ( strcmp(table->vars[table->buckets[bucket]].name, table->vars[index].name) == 0 )
+      {
+        WLOG(em_handle, "Master[%d] configure: Duplicate process variable name %s \n", em_handle, table->vars[index].name);
+        break;
+      }
+    }
+    if ( table->buckets[bucket] == PD_SYMBOL_EMPTY )
+    {
+      table->buckets[bucket] = (int32_t)index;
+    }
+  }
+  DLOG(em_handle, "Master[%d] configure: %d process variables in the symbol table\n", em_handle, table->var_count);
+
+exit:
+  free(var_info);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] configure: Cannot read the process variables: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+    ddi_em_pd_symbols_free(em_handle);
+    return translate_ddi_acontis_err_code(em_handle, result); // Return the Acontis->DDI translated error code
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Look up an ENI process variable by name
+EM_API ddi_em_result ddi_em_pd_lookup(ddi_em_handle em_handle, const char *name, ddi_em_pd_var_info *info)
+{
+  pd_symbol_table *table;
+  int32_t var;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (name == NULL) || (info == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  table = &g_pd_symbols[em_handle];
+  var = pd_symbol_find(table, name);
+  if ( var == PD_SYMBOL_EMPTY )
+  {
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  *info = table->vars[var];
+  return DDI_EM_STATUS_OK;
+}
+
+// Bind an ENI process variable by name
+EM_API ddi_em_result ddi_em_pd_bind(ddi_em_handle em_handle, const char *name, ddi_em_pd_data_type data_type, ddi_em_pd_binding *binding)
+{
+  ddi_em_instance *instance;
+  ddi_em_pd_var_info info;
+  ddi_em_result result;
+  uint8_t *image;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( binding == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  result = ddi_em_pd_lookup(em_handle, name, &info);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    WLOG(em_handle, "Master[%d] process variable %s not found \n", em_handle, name ? name : "(null)");
+    return result;
+  }
+  if ( (data_type != DDI_EM_PD_TYPE_ANY) && (data_type != info.data_type) )
+  {
+    WLOG(em_handle, "Master[%d] process variable %s has data type 0x%x, not 0x%x \n", em_handle, name, info.data_type, data_type);
+    return DDI_EM_STATUS_INVALID_DATA;
+  }
+  instance = get_master_instance(em_handle);
+  image = info.is_output ? instance->master_config.pd_output : instance->master_config.pd_input;
+  if ( image == NULL )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  binding->em_handle = em_handle;
+  binding->image     = &image[info.bit_offset / 8];
+  binding->bit_shift = info.bit_offset % 8;
+  binding->is_output = info.is_output;
+  binding->data_type = info.data_type;
+  binding->bit_size  = info.bit_size;
+  return DDI_EM_STATUS_OK;
+}
+
+// Read a bound process variable
+EM_API ddi_em_result ddi_em_pd_read(const ddi_em_pd_binding *binding, void *value)
+{
+  if ( (binding == NULL) || (value == NULL) || (binding->image == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( (binding->bit_shift == 0) && ((binding->bit_size % 8) == 0) )
+  {
+    memcpy(value, binding->image, binding->bit_size / 8);
+  }
+  else
+  {
+    memset(value, 0, (binding->bit_size + 7) / 8);
+    EC_COPYBITS((uint8_t *)value, 0, binding->image, binding->bit_shift, binding->bit_size);
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Write a bound output process variable
+EM_API ddi_em_result ddi_em_pd_write(const ddi_em_pd_binding *binding, const void *value)
+{
+  ddi_em_instance *instance;
+  if ( (binding == NULL) || (value == NULL) || (binding->image == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( !binding->is_output )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  instance = get_master_instance(binding->em_handle);
+  // Protect updates of the process data occuring from multiple instances at the same time
+  ddi_mutex_lock(instance->master_status.pd_out_mutex, DDI_TIMEOUT_FOREVER);
+  if ( (binding->bit_shift == 0) && ((binding->bit_size % 8) == 0) )
+  {
+    memcpy(binding->image, value, binding->bit_size / 8);
+  }
+  else
+  {
+    EC_COPYBITS(binding->image, binding->bit_shift, (uint8_t *)value, 0, binding->bit_size);
+  }
+  ddi_mutex_unlock(instance->master_status.pd_out_mutex);
+  return DDI_EM_STATUS_OK;
+}
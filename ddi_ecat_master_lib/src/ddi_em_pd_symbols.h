@@ -0,0 +1,29 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_PD_SYMBOLS_H
+#define DDI_EM_PD_SYMBOLS_H
+
+// ENI process variable symbol table of a master instance
+
+#include "ddi_em_api.h"
+
+/** ddi_em_pd_symbols_build
+ @brief Build the process variable symbol table from the configured slaves, replacing the previous table
+ Must be called after emConfigureMaster()
+ @param em_handle The EtherCAT master handle
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_pd_symbols_build(ddi_em_handle em_handle);
+
+/** ddi_em_pd_symbols_free
+ @brief Free the process variable symbol table
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_pd_symbols_free(ddi_em_handle em_handle);
+
+#endif // DDI_EM_PD_SYMBOLS_H
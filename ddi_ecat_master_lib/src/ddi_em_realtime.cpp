@@ -0,0 +1,274 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <alloca.h>
+#include <malloc.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_realtime.h"
+
+// This file provides the real-time hardening of the cyclic thread: memory locking, stack/heap prefaulting,
+// stack size and scheduling policy selection. The common library thread API does not support stack sizes or
+// SCHED_DEADLINE, so the cyclic thread is created here with pthreads directly.
+
+#ifndef SCHED_DEADLINE
+#define SCHED_DEADLINE 6
+#endif
+
+// sched_setattr() has no glibc wrapper, this matches the kernel's struct sched_attr
+typedef struct {
+  uint32_t size;
+  uint32_t sched_policy;
+  uint64_t sched_flags;
+  int32_t  sched_nice;
+  uint32_t sched_priority;
+  uint64_t sched_runtime;
+  uint64_t sched_deadline;
+  uint64_t sched_period;
+} ddi_em_sched_attr;
+
+// Lock all current and future pages of the process into RAM
+ddi_em_result ddi_em_rt_lock_memory(ddi_em_handle em_handle)
+{
+  if ( mlockall(MCL_CURRENT | MCL_FUTURE) != 0 )
+  {
+    ELOG(em_handle, "Master[%d] init: mlockall failed: %s \n", em_handle, strerror(errno));
+    return DDI_EM_STATUS_OS_LOCK_FAILED;
+  }
+  DLOG(em_handle, "Master[%d] init: Process memory locked \n", em_handle);
+  return DDI_EM_STATUS_OK;
+}
+
+// Touch the requested heap size and keep it in the allocator so later allocations don't fault
+ddi_em_result ddi_em_rt_prefault_heap(ddi_em_handle em_handle, uint32_t size)
+{
+  long page_size = sysconf(_SC_PAGESIZE);
+  uint8_t *heap;
+  uint32_t offset;
+
+  // Don't give freed memory back to the OS and don't serve allocations from separate mmap regions
+  mallopt(M_TRIM_THRESHOLD, -1);
+  mallopt(M_MMAP_MAX, 0);
+
+  heap = (uint8_t *)malloc(size);
+  if ( heap == NULL )
+  {
+    ELOG(em_handle, "Master[%d] init: Heap prefault of %u bytes failed \n", em_handle, size);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  for ( offset = 0; offset < size; offset += page_size )
+  {
+    heap[offset] = 0;
+  }
+  free(heap);
+  DLOG(em_handle, "Master[%d] init: Prefaulted %u bytes of heap \n", em_handle, size);
+  return DDI_EM_STATUS_OK;
+}
+
+// Touch size bytes of the current stack, this must not be inlined so the stack frame is released on return
+static void __attribute__((noinline)) touch_stack(uint32_t size)
+{
+  long page_size = sysconf(_SC_PAGESIZE);
+  volatile uint8_t *stack = (volatile uint8_t *)alloca(size);
+  uint32_t offset;
+  for ( offset = 0; offset < size; offset += page_size )
+  {
+    stack[offset] = 0;
+  }
+}
+
+// Prefault the calling thread's stack, limited to the stack size of the thread
+void ddi_em_rt_prefault_stack(ddi_em_handle em_handle, uint32_t size)
+{
+  pthread_attr_t attr;
+  size_t stack_size = 0;
+
+  if ( pthread_getattr_np(pthread_self(), &attr) == 0 )
+  {
+    pthread_attr_getstacksize(&attr, &stack_size);
+    pthread_attr_destroy(&attr);
+  }
+  // Leave room for the frames already in use by this thread
+  if ( (stack_size > DDI_EM_STACK_PREFAULT_GUARD) && (size > (stack_size - DDI_EM_STACK_PREFAULT_GUARD)) )
+  {
+    WLOG(em_handle, "Master[%d] stack prefault of %u bytes limited to the %zu byte stack \n", em_handle, size, stack_size);
+    size = stack_size - DDI_EM_STACK_PREFAULT_GUARD;
+  }
+  touch_stack(size);
+  DLOG(em_handle, "Master[%d] prefaulted %u bytes of cyclic thread stack \n", em_handle, size);
+}
+
+// Validate the real-time configuration and fill in the deadline defaults
+ddi_em_result ddi_em_rt_validate_config(ddi_em_rt_config *rt_config, uint32_t bus_cycle_us, uint32_t cpu_affinity_enabled)
+{
+  switch ( rt_config->sched_policy )
+  {
+    case DDI_EM_SCHED_RR:
+    case DDI_EM_SCHED_FIFO:
+      return DDI_EM_STATUS_OK;
+    case DDI_EM_SCHED_DEADLINE:
+      break;
+    default:
+      return DDI_EM_STATUS_INVALID_ARG;
+  }
+
+  // SCHED_DEADLINE tasks must be allowed to run on every CPU of their root domain
+  if ( cpu_affinity_enabled )
+  {
+    return DDI_EM_STATUS_CPU_AFFINITY_ERR;
+  }
+  if ( rt_config->deadline_period_ns == 0 )
+  {
+    rt_config->deadline_period_ns = (uint64_t)bus_cycle_us * NSEC_PER_USEC;
+    rt_config->period_from_cycle = true;
+  }
+  if ( rt_config->deadline_runtime_ns == 0 )
+  {
+    rt_config->deadline_runtime_ns = rt_config->deadline_period_ns / DDI_EM_DEADLINE_RUNTIME_DIV;
+    rt_config->runtime_from_period = true;
+  }
+  if ( (rt_config->deadline_period_ns == 0) || (rt_config->deadline_runtime_ns > rt_config->deadline_period_ns) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Check that a new bus cycle keeps the SCHED_DEADLINE runtime within the period
+ddi_em_result ddi_em_rt_check_cycle_rate(ddi_em_rt_config *rt_config, uint32_t bus_cycle_us)
+{
+  if ( (rt_config->sched_policy != DDI_EM_SCHED_DEADLINE) || !rt_config->period_from_cycle || rt_config->runtime_from_period )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  if ( rt_config->deadline_runtime_ns > (uint64_t)bus_cycle_us * NSEC_PER_USEC )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Move the defaulted SCHED_DEADLINE parameters to the new bus cycle, must be called by the cyclic thread
+ddi_em_result ddi_em_rt_update_cycle_rate(ddi_em_handle em_handle, ddi_em_rt_config *rt_config, uint32_t bus_cycle_us)
+{
+  if ( (rt_config->sched_policy != DDI_EM_SCHED_DEADLINE) || !rt_config->period_from_cycle )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  rt_config->deadline_period_ns = (uint64_t)bus_cycle_us * NSEC_PER_USEC;
+  if ( rt_config->runtime_from_period )
+  {
+    rt_config->deadline_runtime_ns = rt_config->deadline_period_ns / DDI_EM_DEADLINE_RUNTIME_DIV;
+  }
+  return ddi_em_rt_apply_deadline(em_handle, rt_config);
+}
+
+// Create the cyclic thread with the configured stack size and scheduling policy
+ddi_em_result ddi_em_rt_thread_create(ddi_em_handle em_handle, ddi_em_rt_config *rt_config, pthread_t *tid, void *(*entry)(void *), void *arg)
+{
+  pthread_attr_t attr;
+  struct sched_param param;
+  int policy;
+  int ret;
+
+  pthread_attr_init(&attr);
+  if ( rt_config->stack_size )
+  {
+    size_t stack_size = rt_config->stack_size;
+    if ( stack_size < DDI_CYCLIC_THREAD_STACK_SIZE )
+    {
+      stack_size = DDI_CYCLIC_THREAD_STACK_SIZE;
+    }
+    if ( stack_size < (size_t)PTHREAD_STACK_MIN )
+    {
+      stack_size = PTHREAD_STACK_MIN;
+    }
+    pthread_attr_setstacksize(&attr, stack_size);
+  }
+
+  // SCHED_DEADLINE is set by the thread itself through sched_setattr(), start it as a normal thread
+  memset(&param, 0, sizeof(param));
+  if ( rt_config->sched_policy == DDI_EM_SCHED_DEADLINE )
+  {
+    policy = SCHED_OTHER;
+  }
+  else
+  {
+    policy = (rt_config->sched_policy == DDI_EM_SCHED_FIFO) ? SCHED_FIFO : SCHED_RR;
+    param.sched_priority = rt_config->priority;
+    if ( param.sched_priority < sched_get_priority_min(policy) )
+    {
+      param.sched_priority = sched_get_priority_min(policy);
+    }
+    if ( param.sched_priority > sched_get_priority_max(policy) )
+    {
+      param.sched_priority = sched_get_priority_max(policy);
+    }
+  }
+  pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+  pthread_attr_setschedpolicy(&attr, policy);
+  pthread_attr_setschedparam(&attr, &param);
+
+  ret = pthread_create(tid, &attr, entry, arg);
+  pthread_attr_destroy(&attr);
+  if ( ret != 0 )
+  {
+    ELOG(em_handle, "Master[%d] init: Creating the cyclic thread failed: %s \n", em_handle, strerror(ret));
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  pthread_setname_np(*tid, "cyclic_process_data");
+  return DDI_EM_STATUS_OK;
+}
+
+// Switch the calling thread to SCHED_DEADLINE if requested
+ddi_em_result ddi_em_rt_apply_deadline(ddi_em_handle em_handle, ddi_em_rt_config *rt_config)
+{
+  ddi_em_sched_attr attr;
+
+  if ( rt_config->sched_policy != DDI_EM_SCHED_DEADLINE )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.sched_policy   = SCHED_DEADLINE;
+  attr.sched_runtime  = rt_config->deadline_runtime_ns;
+  attr.sched_deadline = rt_config->deadline_period_ns;
+  attr.sched_period   = rt_config->deadline_period_ns;
+  if ( syscall(SYS_sched_setattr, 0, &attr, 0) != 0 )
+  {
+    ELOG(em_handle, "Master[%d] setting SCHED_DEADLINE (runtime %" PRIu64 " ns, period %" PRIu64 " ns) failed: %s \n", em_handle,
+      rt_config->deadline_runtime_ns, rt_config->deadline_period_ns, strerror(errno));
+    return DDI_EM_STATUS_NOT_SUPPORTED;
+  }
+  DLOG(em_handle, "Master[%d] cyclic thread running with SCHED_DEADLINE \n", em_handle);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the page fault counts of the calling thread
+void ddi_em_rt_get_page_faults(uint64_t *minor_faults, uint64_t *major_faults)
+{
+  struct rusage usage;
+  memset(&usage, 0, sizeof(usage));
+  getrusage(RUSAGE_THREAD, &usage);
+  *minor_faults = usage.ru_minflt;
+  *major_faults = usage.ru_majflt;
+}
@@ -0,0 +1,107 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_REALTIME_H
+#define DDI_EM_REALTIME_H
+
+// Real-time hardening helpers for the cyclic thread (memory locking, prefaulting and scheduling)
+
+#include <stdint.h>
+#include <pthread.h>
+#include "ddi_em_api.h"
+
+/** @struct ddi_em_rt_config
+ *  @brief Real-time configuration of the cyclic thread, copied from ddi_em_init_params
+ */
+typedef struct {
+  uint32_t            stack_size;              /**< Cyclic thread stack size in bytes, 0 = operating system default */
+  uint32_t            stack_prefault_size;     /**< Bytes of stack to prefault before the first cycle */
+  ddi_em_sched_policy sched_policy;            /**< Cyclic thread scheduling policy */
+  uint32_t            priority;                /**< Cyclic thread priority for SCHED_RR and SCHED_FIFO */
+  uint64_t            deadline_runtime_ns;     /**< SCHED_DEADLINE runtime in nanoseconds */
+  uint64_t            deadline_period_ns;      /**< SCHED_DEADLINE period in nanoseconds */
+  uint32_t            page_fault_check_cycles; /**< Number of cycles covered by the page fault self-check */
+  bool                period_from_cycle;       /**< SCHED_DEADLINE period defaulted to the bus cycle, follows cycle rate changes */
+  bool                runtime_from_period;     /**< SCHED_DEADLINE runtime defaulted from the period, follows period changes */
+} ddi_em_rt_config;
+
+/** ddi_em_rt_lock_memory
+ @brief Lock all current and future pages of the process into RAM
+ @param em_handle The EtherCAT master handle (used for logging)
+ @return ddi_em_result DDI_EM_STATUS_OK on success, DDI_EM_STATUS_OS_LOCK_FAILED otherwise @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_lock_memory(ddi_em_handle em_handle);
+
+/** ddi_em_rt_prefault_heap
+ @brief Touch size bytes of heap and keep them reserved by the allocator so later allocations do not fault
+ @param em_handle The EtherCAT master handle (used for logging)
+ @param size The number of heap bytes to prefault
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_prefault_heap(ddi_em_handle em_handle, uint32_t size);
+
+/** ddi_em_rt_prefault_stack
+ @brief Touch the calling thread's stack, limited to the size of the stack
+ @param em_handle The EtherCAT master handle (used for logging)
+ @param size The number of stack bytes to prefault
+ */
+void ddi_em_rt_prefault_stack(ddi_em_handle em_handle, uint32_t size);
+
+/** ddi_em_rt_validate_config
+ @brief Validate and fill in the defaults of a real-time configuration
+ @param rt_config The real-time configuration to validate
+ @param bus_cycle_us The bus cycle in microseconds, used as the default deadline period
+ @param cpu_affinity_enabled Is CPU affinity requested for the cyclic thread?
+ @return ddi_em_result DDI_EM_STATUS_OK if the configuration is usable @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_validate_config(ddi_em_rt_config *rt_config, uint32_t bus_cycle_us, uint32_t cpu_affinity_enabled);
+
+/** ddi_em_rt_check_cycle_rate
+ @brief Check that a new bus cycle keeps the SCHED_DEADLINE parameters valid
+ @param rt_config The real-time configuration
+ @param bus_cycle_us The new bus cycle in microseconds
+ @return ddi_em_result DDI_EM_STATUS_OK if the bus cycle can be used @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_check_cycle_rate(ddi_em_rt_config *rt_config, uint32_t bus_cycle_us);
+
+/** ddi_em_rt_update_cycle_rate
+ @brief Update the defaulted SCHED_DEADLINE parameters to a new bus cycle and re-apply them to the calling thread
+ @param em_handle The EtherCAT master handle (used for logging)
+ @param rt_config The real-time configuration
+ @param bus_cycle_us The new bus cycle in microseconds
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_update_cycle_rate(ddi_em_handle em_handle, ddi_em_rt_config *rt_config, uint32_t bus_cycle_us);
+
+/** ddi_em_rt_thread_create
+ @brief Create the cyclic thread with the stack size and scheduling policy of rt_config
+ SCHED_DEADLINE threads are created with SCHED_OTHER and must call ddi_em_rt_apply_deadline() from the thread itself
+ @param em_handle The EtherCAT master handle (used for logging)
+ @param rt_config The real-time configuration
+ @param tid The created thread id
+ @param entry The thread entry point
+ @param arg The thread entry argument
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_thread_create(ddi_em_handle em_handle, ddi_em_rt_config *rt_config, pthread_t *tid, void *(*entry)(void *), void *arg);
+
+/** ddi_em_rt_apply_deadline
+ @brief Switch the calling thread to SCHED_DEADLINE, if selected in rt_config
+ @param em_handle The EtherCAT master handle (used for logging)
+ @param rt_config The real-time configuration
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_rt_apply_deadline(ddi_em_handle em_handle, ddi_em_rt_config *rt_config);
+
+/** ddi_em_rt_get_page_faults
+ @brief Return the minor and major page fault counts of the calling thread
+ @param minor_faults The minor page fault count
+ @param major_faults The major page fault count
+ */
+void ddi_em_rt_get_page_faults(uint64_t *minor_faults, uint64_t *major_faults);
+
+#endif // DDI_EM_REALTIME_H
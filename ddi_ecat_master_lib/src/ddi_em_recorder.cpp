@@ -0,0 +1,385 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+#include "ddi_em_recorder.h"
+
+// This file records process data regions into a capture file. The cyclic thread is the only producer and the writer
+// thread the only consumer of a single-producer single-consumer ring, so neither takes a lock: the producer publishes a
+// record by advancing head, the consumer releases it by advancing tail. The writer writes runs of records with one
+// fwrite() and sleeps while the ring is empty. When the ring is full the cycle is counted as dropped.
+
+// Writer thread poll interval while the ring is empty
+#define RECORDER_IDLE_SLEEP_US  1000
+
+typedef struct {
+  volatile bool          active;          // Set while the cyclic thread may produce records
+  volatile bool          in_cycle;        // Set while the cyclic thread is producing a record
+  volatile bool          stop;            // Tells the writer thread to drain the ring and exit
+  ddi_em_handle          em_handle;
+  ddi_em_recorder_config config;
+  uint32_t               record_size;
+  uint32_t               data_offset;     // File offset of the first record
+  uint8_t               *ring;
+  uint32_t               ring_mask;       // Ring records - 1, the ring size is a power of two
+  uint64_t               head;            // Next record written by the cyclic thread
+  uint64_t               tail;            // Next record written to the file
+  uint64_t               cycle;           // Cycles seen since the start of the recording
+  FILE                  *file;
+  pthread_t              writer_tid;
+  ddi_em_capture_index  *index;
+  uint64_t               index_count;
+  uint64_t               index_size;
+  ddi_em_recorder_stats  stats;
+} pd_recorder;
+
+static pd_recorder g_recorder[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Serializes ddi_em_recorder_start() and ddi_em_recorder_stop()
+static pthread_mutex_t g_recorder_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Add the index entries of a run of records about to be written
+static bool recorder_index_run(pd_recorder *recorder, uint64_t first, uint32_t count)
+{
+  ddi_em_capture_index *index;
+  ddi_em_capture_record *record;
+  uint64_t number;
+
+  // The first index entry at or after the start of the run
+  number = (first + DDI_EM_CAPTURE_INDEX_INTERVAL - 1) / DDI_EM_CAPTURE_INDEX_INTERVAL * DDI_EM_CAPTURE_INDEX_INTERVAL;
+  for ( ; number < first + count; number += DDI_EM_CAPTURE_INDEX_INTERVAL )
+  {
+    if ( recorder->index_count == recorder->index_size )
+    {
+      index = (ddi_em_capture_index *)realloc(recorder->index, (recorder->index_size + 256) * sizeof(ddi_em_capture_index));
+      if ( index == NULL )
+      {
+        return false;
+      }
+      recorder->index = index;
+      recorder->index_size += 256;
+    }
+    record = (ddi_em_capture_record *)&recorder->ring[(number & recorder->ring_mask) * recorder->record_size];
+    recorder->index[recorder->index_count].cycle = record->cycle;
+    recorder->index[recorder->index_count].record = number;
+    recorder->index_count++;
+  }
+  return true;
+}
+
+// Write the index and the footer, the records are complete
+static void recorder_write_trailer(pd_recorder *recorder)
+{
+  ddi_em_capture_footer footer;
+
+  memset(&footer, 0, sizeof(footer));
+  footer.index_offset = recorder->data_offset + recorder->stats.written_records * recorder->record_size;
+  footer.index_count = recorder->index_count;
+  footer.record_count = recorder->stats.written_records;
+  footer.dropped_count = recorder->stats.dropped_records;
+  memcpy(footer.magic, DDI_EM_CAPTURE_MAGIC, sizeof(footer.magic));
+  if ( (fwrite(recorder->index, sizeof(ddi_em_capture_index), recorder->index_count, recorder->file) != recorder->index_count) ||
+       (fwrite(&footer, sizeof(footer), 1, recorder->file) != 1) )
+  {
+    ELOG(recorder->em_handle, "Master[%d] recorder: writing the capture index failed \n", recorder->em_handle);
+    __atomic_store_n(&recorder->stats.write_error, 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Writer thread, moves the records from the ring to the capture file and writes the trailer unless a write failed
+static void *recorder_writer_thread(void *arg)
+{
+  pd_recorder *recorder = (pd_recorder *)arg;
+  uint64_t head, tail;
+  uint32_t slot, count;
+  bool stop;
+
+  while ( 1 )
+  {
+    stop = __atomic_load_n(&recorder->stop, __ATOMIC_ACQUIRE);
+    head = __atomic_load_n(&recorder->head, __ATOMIC_ACQUIRE);
+    tail = recorder->tail;
+    if ( head == tail )
+    {
+      if ( stop )
+      {
+        break;
+      }
+      usleep(RECORDER_IDLE_SLEEP_US);
+      continue;
+    }
+
+    // Write up to the end of the ring in one go, the rest follows in the next pass
+    slot = tail & recorder->ring_mask;
+    count = head - tail;
+    if ( count > recorder->ring_mask + 1 - slot )
+    {
+      count = recorder->ring_mask + 1 - slot;
+    }
+    if ( !recorder_index_run(recorder, tail, count) )
+    {
+      ELOG(recorder->em_handle, "Master[%d] recorder: out of memory for the capture index \n", recorder->em_handle);
+    }
+    if ( fwrite(&recorder->ring[slot * recorder->record_size], recorder->record_size, count, recorder->file) != count )
+    {
+      // A partial run may have reached the file, a footer would vouch for records that aren't there
+      ELOG(recorder->em_handle, "Master[%d] recorder: writing the capture file failed, recording stopped \n", recorder->em_handle);
+      __atomic_store_n(&recorder->stats.write_error, 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&recorder->active, false, __ATOMIC_SEQ_CST);
+      return NULL;
+    }
+    __atomic_store_n(&recorder->tail, tail + count, __ATOMIC_RELEASE);
+    __atomic_store_n(&recorder->stats.written_records, recorder->stats.written_records + count, __ATOMIC_RELAXED);
+    __atomic_store_n(&recorder->stats.bytes_written, recorder->stats.bytes_written + (uint64_t)count * recorder->record_size, __ATOMIC_RELAXED);
+  }
+
+  recorder_write_trailer(recorder);
+  return NULL;
+}
+
+// Copy the recorded regions into the ring
+void ddi_em_recorder_cycle(ddi_em_handle em_handle, const ntime_t *cycle_start)
+{
+  pd_recorder *recorder = &g_recorder[em_handle];
+  ddi_em_instance *instance;
+  ddi_em_capture_record *record;
+  ddi_em_capture_region *region;
+  uint8_t *data;
+  uint64_t head, pending;
+  uint32_t index;
+
+  if ( !__atomic_load_n(&recorder->active, __ATOMIC_ACQUIRE) )
+  {
+    return;
+  }
+  // ddi_em_recorder_stop() waits for in_cycle to clear before releasing the ring
+  __atomic_store_n(&recorder->in_cycle, true, __ATOMIC_SEQ_CST);
+  if ( !__atomic_load_n(&recorder->active, __ATOMIC_SEQ_CST) )
+  {
+    __atomic_store_n(&recorder->in_cycle, false, __ATOMIC_RELEASE);
+    return;
+  }
+
+  recorder->cycle++;
+  if ( (recorder->config.decimation > 1) && ((recorder->cycle - 1) % recorder->config.decimation) )
+  {
+    __atomic_store_n(&recorder->in_cycle, false, __ATOMIC_RELEASE);
+    return;
+  }
+  head = recorder->head;
+  pending = head - __atomic_load_n(&recorder->tail, __ATOMIC_ACQUIRE);
+  if ( pending > recorder->ring_mask )
+  {
+    recorder->stats.dropped_records++;
+    __atomic_store_n(&recorder->in_cycle, false, __ATOMIC_RELEASE);
+    return;
+  }
+
+  instance = get_master_instance(em_handle);
+  record = (ddi_em_capture_record *)&recorder->ring[(head & recorder->ring_mask) * recorder->record_size];
+  record->cycle = recorder->cycle - 1;
+  record->timestamp_ns = (uint64_t)cycle_start->sec * NSEC_PER_SEC + cycle_start->ns;
+  data = (uint8_t *)(record + 1);
+  for ( index = 0; index < recorder->config.region_count; index++ )
+  {
+    region = &recorder->config.regions[index];
+    memcpy(data, (region->is_output ? instance->master_config.pd_output : instance->master_config.pd_input) + region->byte_offset,
+      region->byte_size);
+    data += region->byte_size;
+  }
+  __atomic_store_n(&recorder->head, head + 1, __ATOMIC_RELEASE);
+
+  recorder->stats.captured_records++;
+  if ( pending + 1 > recorder->stats.ring_high_water )
+  {
+    recorder->stats.ring_high_water = (uint32_t)(pending + 1);
+  }
+  __atomic_store_n(&recorder->in_cycle, false, __ATOMIC_RELEASE);
+}
+
+// Start recording process data regions every cycle into a capture file
+EM_API ddi_em_result ddi_em_recorder_start(ddi_em_handle em_handle, const char *filename, const ddi_em_recorder_config *config)
+{
+  pd_recorder *recorder;
+  ddi_em_instance *instance;
+  ddi_em_capture_header header;
+  EC_T_MEMREQ_DESC mem_desc;
+  EC_T_DWORD out_size = 0;
+  struct timespec now;
+  uint32_t result, index, ring_records, record_size = sizeof(ddi_em_capture_record), region_size;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (filename == NULL) || (config == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( (config->region_count == 0) || (config->region_count > DDI_EM_CAPTURE_MAX_REGIONS) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  instance = get_master_instance(em_handle);
+  if ( (instance->master_config.pd_input == NULL) || (instance->master_config.pd_output == NULL) )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  memset(&mem_desc, 0, sizeof(mem_desc));
+  result = emIoCtl(em_handle, EC_IOCTL_GET_PDMEMORYSIZE, EC_NULL, 0, (EC_T_BYTE *)&mem_desc, sizeof(mem_desc), &out_size);
+  if ( result != EC_E_NOERROR )
+  {
+    return translate_ddi_acontis_err_code(em_handle, result);
+  }
+  for ( index = 0; index < config->region_count; index++ )
+  {
+    region_size = config->regions[index].is_output ? mem_desc.dwPDOutSize : mem_desc.dwPDInSize;
+    if ( (config->regions[index].byte_size == 0) || (config->regions[index].byte_offset > region_size) ||
+         (config->regions[index].byte_size > region_size - config->regions[index].byte_offset) )
+    {
+      ELOG(em_handle, "Master[%d] recorder: region %d (%d bytes at %d) is outside of the %d byte process data \n", em_handle,
+        index, config->regions[index].byte_size, config->regions[index].byte_offset, region_size);
+      return DDI_EM_STATUS_INVALID_ARG;
+    }
+    record_size += config->regions[index].byte_size;
+  }
+  // Larger sizes would overflow the power of two the ring is rounded up to
+  if ( config->ring_records > DDI_EM_RECORDER_RING_MAX )
+  {
+    ELOG(em_handle, "Master[%d] recorder: a ring of %u records is larger than %u records \n", em_handle, config->ring_records,
+      DDI_EM_RECORDER_RING_MAX);
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  for ( ring_records = 2; ring_records < (config->ring_records ? config->ring_records : DDI_EM_RECORDER_RING_DEFAULT); ring_records <<= 1 );
+
+  pthread_mutex_lock(&g_recorder_lock);
+  recorder = &g_recorder[em_handle];
+  if ( recorder->file != NULL )
+  {
+    pthread_mutex_unlock(&g_recorder_lock);
+    return DDI_EM_STATUS_BUSY;
+  }
+  memset(recorder, 0, sizeof(pd_recorder));
+  recorder->em_handle = em_handle;
+  recorder->config = *config;
+  recorder->record_size = record_size;
+  recorder->ring_mask = ring_records - 1;
+  recorder->data_offset = sizeof(ddi_em_capture_header) + config->region_count * sizeof(ddi_em_capture_region);
+  // Touch the whole ring now so the cyclic thread doesn't take page faults on it
+  recorder->ring = (uint8_t *)malloc((size_t)ring_records * record_size);
+  if ( recorder->ring == NULL )
+  {
+    pthread_mutex_unlock(&g_recorder_lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  memset(recorder->ring, 0, (size_t)ring_records * record_size);
+
+  recorder->file = fopen(filename, "wb");
+  if ( recorder->file == NULL )
+  {
+    ELOG(em_handle, "Master[%d] recorder: cannot create %s \n", em_handle, filename);
+    free(recorder->ring);
+    recorder->ring = NULL;
+    pthread_mutex_unlock(&g_recorder_lock);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  setvbuf(recorder->file, NULL, _IOFBF, 1 << 20);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(header.magic));
+  header.version = DDI_EM_CAPTURE_VERSION;
+  header.region_count = config->region_count;
+  header.record_size = record_size;
+  header.data_offset = recorder->data_offset;
+  header.cycle_time_us = instance->master_config.bus_cycle_us;
+  header.decimation = (config->decimation > 1) ? config->decimation : 1;
+  clock_gettime(CLOCK_REALTIME, &now);
+  header.start_time_ns = (uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+  if ( (fwrite(&header, sizeof(header), 1, recorder->file) != 1) ||
+       (fwrite(config->regions, sizeof(ddi_em_capture_region), config->region_count, recorder->file) != config->region_count) ||
+       (pthread_create(&recorder->writer_tid, NULL, recorder_writer_thread, recorder) != 0) )
+  {
+    ELOG(em_handle, "Master[%d] recorder: cannot start recording to %s \n", em_handle, filename);
+    fclose(recorder->file);
+    recorder->file = NULL;
+    free(recorder->ring);
+    recorder->ring = NULL;
+    pthread_mutex_unlock(&g_recorder_lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+
+  recorder->stats.active = 1;
+  __atomic_store_n(&recorder->active, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&g_recorder_lock);
+  DLOG(em_handle, "Master[%d] recorder: recording %d regions, %d bytes per cycle, to %s \n", em_handle, config->region_count,
+    record_size, filename);
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop recording and close the capture file
+EM_API ddi_em_result ddi_em_recorder_stop(ddi_em_handle em_handle)
+{
+  pd_recorder *recorder;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  recorder = &g_recorder[em_handle];
+
+  pthread_mutex_lock(&g_recorder_lock);
+  if ( recorder->file == NULL )
+  {
+    pthread_mutex_unlock(&g_recorder_lock);
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  // Stop the producer and wait for a record in progress, then let the writer drain the ring
+  __atomic_store_n(&recorder->active, false, __ATOMIC_SEQ_CST);
+  while ( __atomic_load_n(&recorder->in_cycle, __ATOMIC_SEQ_CST) )
+  {
+    usleep(100);
+  }
+  __atomic_store_n(&recorder->stop, true, __ATOMIC_RELEASE);
+  pthread_join(recorder->writer_tid, NULL);
+
+  fclose(recorder->file);
+  recorder->file = NULL;
+  free(recorder->ring);
+  recorder->ring = NULL;
+  free(recorder->index);
+  recorder->index = NULL;
+  recorder->stats.active = 0;
+  pthread_mutex_unlock(&g_recorder_lock);
+  DLOG(em_handle, "Master[%d] recorder: %llu records written, %llu dropped \n", em_handle,
+    (unsigned long long)recorder->stats.written_records, (unsigned long long)recorder->stats.dropped_records);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the statistics of the current or last recording
+EM_API ddi_em_result ddi_em_recorder_get_stats(ddi_em_handle em_handle, ddi_em_recorder_stats *stats)
+{
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( stats == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  *stats = g_recorder[em_handle].stats;
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop a running recording
+void ddi_em_recorder_deinit(ddi_em_handle em_handle)
+{
+  if ( g_recorder[em_handle].file != NULL )
+  {
+    ddi_em_recorder_stop(em_handle);
+  }
+}
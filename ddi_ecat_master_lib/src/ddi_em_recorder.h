@@ -0,0 +1,29 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_RECORDER_H
+#define DDI_EM_RECORDER_H
+
+// Process data recorder of a master instance
+
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+
+/** ddi_em_recorder_deinit
+ @brief Stop a running recording and close its capture file
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_recorder_deinit(ddi_em_handle em_handle);
+
+/** ddi_em_recorder_cycle
+ @brief Copy the recorded regions into the ring, called by the cyclic thread after the cyclic callback
+ @param em_handle The EtherCAT master handle
+ @param cycle_start The start time of the cycle
+ */
+void ddi_em_recorder_cycle(ddi_em_handle em_handle, const ntime_t *cycle_start);
+
+#endif // DDI_EM_RECORDER_H
@@ -0,0 +1,534 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em_pd_delta.h"
+#include "ddi_em.h"
+
+// This file replays a process data capture written by the recorder through the application's control logic. The
+// replay takes the place of the link layer: instead of receiving frames it copies the input regions of the next
+// record into the input process data, runs the callback and compares the output process data against the golden
+// capture. The captures are read sequentially, the golden record of a cycle is found by skipping forward to its cycle
+// number, so cycles dropped by either recording don't shift the comparison.
+
+// Mismatches logged in detail, the rest are only counted
+#define REPLAY_MISMATCH_LOG_MAX  10
+
+typedef struct {
+  FILE                  *file;
+  ddi_em_capture_header  header;
+  ddi_em_capture_region  regions[DDI_EM_CAPTURE_MAX_REGIONS];
+  uint32_t               region_offset[DDI_EM_CAPTURE_MAX_REGIONS]; // Offset of the region bytes in a record
+  uint64_t               record_count;
+  uint64_t               next_record;
+  uint8_t               *record;           // The last record read
+} capture_reader;
+
+typedef struct {
+  FILE                  *file;
+  uint32_t               record_size;
+  uint32_t               data_offset;
+  uint64_t               record_count;
+  ddi_em_capture_index  *index;
+  uint64_t               index_count;
+  uint64_t               index_size;
+} capture_writer;
+
+// Open a capture and read its header and regions, an interrupted capture is replayed up to its last complete record
+static ddi_em_result capture_reader_open(ddi_em_handle em_handle, capture_reader *reader, const char *filename)
+{
+  ddi_em_capture_footer footer;
+  uint32_t index, offset = sizeof(ddi_em_capture_record);
+  long file_size;
+
+  memset(reader, 0, sizeof(capture_reader));
+  reader->file = fopen(filename, "rb");
+  if ( reader->file == NULL )
+  {
+    ELOG(em_handle, "Master[%d] replay: cannot open %s \n", em_handle, filename);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  if ( (fread(&reader->header, sizeof(reader->header), 1, reader->file) != 1) ||
+       memcmp(reader->header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(reader->header.magic)) ||
+       (reader->header.version != DDI_EM_CAPTURE_VERSION) || (reader->header.region_count > DDI_EM_CAPTURE_MAX_REGIONS) ||
+       (fread(reader->regions, sizeof(ddi_em_capture_region), reader->header.region_count, reader->file) != reader->header.region_count) )
+  {
+    ELOG(em_handle, "Master[%d] replay: %s is not a version %d capture file \n", em_handle, filename, DDI_EM_CAPTURE_VERSION);
+    return DDI_EM_STATUS_INVALID_DATA;
+  }
+  for ( index = 0; index < reader->header.region_count; index++ )
+  {
+    reader->region_offset[index] = offset;
+    offset += reader->regions[index].byte_size;
+  }
+  if ( offset != reader->header.record_size )
+  {
+    ELOG(em_handle, "Master[%d] replay: %s has %d byte records, its regions need %d bytes \n", em_handle, filename,
+      reader->header.record_size, offset);
+    return DDI_EM_STATUS_INVALID_DATA;
+  }
+
+  fseek(reader->file, 0, SEEK_END);
+  file_size = ftell(reader->file);
+  if ( (file_size >= (long)(reader->header.data_offset + sizeof(ddi_em_capture_footer))) &&
+       (fseek(reader->file, file_size - sizeof(ddi_em_capture_footer), SEEK_SET) == 0) &&
+       (fread(&footer, sizeof(footer), 1, reader->file) == 1) &&
+       !memcmp(footer.magic, DDI_EM_CAPTURE_MAGIC, sizeof(footer.magic)) )
+  {
+    reader->record_count = footer.record_count;
+  }
+  else if ( file_size > (long)reader->header.data_offset )
+  {
+    reader->record_count = (file_size - reader->header.data_offset) / reader->header.record_size;
+  }
+
+  reader->record = (uint8_t *)malloc(reader->header.record_size);
+  if ( (reader->record == NULL) || (fseek(reader->file, reader->header.data_offset, SEEK_SET) != 0) )
+  {
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  setvbuf(reader->file, NULL, _IOFBF, 1 << 20);
+  return DDI_EM_STATUS_OK;
+}
+
+// Read the next record, false at the end of the capture
+static bool capture_reader_next(capture_reader *reader)
+{
+  if ( (reader->next_record >= reader->record_count) ||
+       (fread(reader->record, reader->header.record_size, 1, reader->file) != 1) )
+  {
+    return false;
+  }
+  reader->next_record++;
+  return true;
+}
+
+// Return the cycle number of the last record read
+static inline uint64_t capture_reader_cycle(const capture_reader *reader)
+{
+  return ((const ddi_em_capture_record *)reader->record)->cycle;
+}
+
+// Close a capture
+static void capture_reader_close(capture_reader *reader)
+{
+  if ( reader->file != NULL )
+  {
+    fclose(reader->file);
+    reader->file = NULL;
+  }
+  free(reader->record);
+  reader->record = NULL;
+}
+
+// Create a capture and write its header and regions
+static ddi_em_result capture_writer_open(ddi_em_handle em_handle, capture_writer *writer, const char *filename,
+                                         const ddi_em_capture_header *source, const ddi_em_capture_region *regions, uint32_t region_count)
+{
+  ddi_em_capture_header header;
+  struct timespec now;
+  uint32_t index;
+
+  memset(writer, 0, sizeof(capture_writer));
+  writer->file = fopen(filename, "wb");
+  if ( writer->file == NULL )
+  {
+    ELOG(em_handle, "Master[%d] replay: cannot create %s \n", em_handle, filename);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  setvbuf(writer->file, NULL, _IOFBF, 1 << 20);
+  writer->record_size = sizeof(ddi_em_capture_record);
+  for ( index = 0; index < region_count; index++ )
+  {
+    writer->record_size += regions[index].byte_size;
+  }
+  writer->data_offset = sizeof(ddi_em_capture_header) + region_count * sizeof(ddi_em_capture_region);
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(header.magic));
+  header.version = DDI_EM_CAPTURE_VERSION;
+  header.region_count = region_count;
+  header.record_size = writer->record_size;
+  header.data_offset = writer->data_offset;
+  header.cycle_time_us = source->cycle_time_us;
+  header.decimation = source->decimation;
+  clock_gettime(CLOCK_REALTIME, &now);
+  header.start_time_ns = (uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+  if ( (fwrite(&header, sizeof(header), 1, writer->file) != 1) ||
+       (fwrite(regions, sizeof(ddi_em_capture_region), region_count, writer->file) != region_count) )
+  {
+    ELOG(em_handle, "Master[%d] replay: writing %s failed \n", em_handle, filename);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Append a record, every DDI_EM_CAPTURE_INDEX_INTERVAL records get an index entry
+static bool capture_writer_append(capture_writer *writer, const uint8_t *record)
+{
+  ddi_em_capture_index *index;
+
+  if ( (writer->record_count % DDI_EM_CAPTURE_INDEX_INTERVAL) == 0 )
+  {
+    if ( writer->index_count == writer->index_size )
+    {
+      index = (ddi_em_capture_index *)realloc(writer->index, (writer->index_size + 256) * sizeof(ddi_em_capture_index));
+      if ( index == NULL )
+      {
+        return false;
+      }
+      writer->index = index;
+      writer->index_size += 256;
+    }
+    writer->index[writer->index_count].cycle = ((const ddi_em_capture_record *)record)->cycle;
+    writer->index[writer->index_count].record = writer->record_count;
+    writer->index_count++;
+  }
+  if ( fwrite(record, writer->record_size, 1, writer->file) != 1 )
+  {
+    return false;
+  }
+  writer->record_count++;
+  return true;
+}
+
+// Write the index and the footer and close the capture
+static void capture_writer_close(ddi_em_handle em_handle, capture_writer *writer)
+{
+  ddi_em_capture_footer footer;
+
+  if ( writer->file == NULL )
+  {
+    return;
+  }
+  memset(&footer, 0, sizeof(footer));
+  footer.index_offset = writer->data_offset + writer->record_count * writer->record_size;
+  footer.index_count = writer->index_count;
+  footer.record_count = writer->record_count;
+  memcpy(footer.magic, DDI_EM_CAPTURE_MAGIC, sizeof(footer.magic));
+  if ( (fwrite(writer->index, sizeof(ddi_em_capture_index), writer->index_count, writer->file) != writer->index_count) ||
+       (fwrite(&footer, sizeof(footer), 1, writer->file) != 1) )
+  {
+    ELOG(em_handle, "Master[%d] replay: writing the capture index failed \n", em_handle);
+  }
+  fclose(writer->file);
+  writer->file = NULL;
+  free(writer->index);
+  writer->index = NULL;
+}
+
+// Check the regions of a capture against the process data sizes, and grow the sizes when the process image is allocated by the replay
+static ddi_em_result replay_check_regions(ddi_em_handle em_handle, const capture_reader *reader, bool is_output, bool grow, uint32_t *size)
+{
+  const ddi_em_capture_region *region;
+  uint32_t index;
+
+  for ( index = 0; index < reader->header.region_count; index++ )
+  {
+    region = &reader->regions[index];
+    if ( (bool)region->is_output != is_output )
+    {
+      continue;
+    }
+    if ( grow && (region->byte_offset + region->byte_size > *size) )
+    {
+      *size = region->byte_offset + region->byte_size;
+    }
+    else if ( (region->byte_offset > *size) || (region->byte_size > *size - region->byte_offset) )
+    {
+      ELOG(em_handle, "Master[%d] replay: region %d (%d bytes at %d) is outside of the %d byte process data \n", em_handle,
+        index, region->byte_size, region->byte_offset, *size);
+      return DDI_EM_STATUS_INVALID_ARG;
+    }
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Compare the output regions of a golden record against the output process data, returns the number of differing regions
+static uint32_t replay_compare(ddi_em_handle em_handle, const capture_reader *golden, const uint8_t *pd_output, uint64_t cycle,
+                               ddi_em_replay_result *result)
+{
+  const ddi_em_capture_region *region;
+  uint32_t index, mismatches = 0;
+
+  for ( index = 0; index < golden->header.region_count; index++ )
+  {
+    region = &golden->regions[index];
+    if ( !region->is_output || !memcmp(pd_output + region->byte_offset, golden->record + golden->region_offset[index], region->byte_size) )
+    {
+      continue;
+    }
+    if ( (result->mismatched_cycles == 0) && (mismatches == 0) )
+    {
+      result->first_mismatch_cycle = cycle;
+      result->first_mismatch_region = index;
+    }
+    if ( result->mismatched_cycles < REPLAY_MISMATCH_LOG_MAX )
+    {
+      WLOG(em_handle, "Master[%d] replay: cycle %llu output %.*s (%d bytes at %d) differs from the golden capture \n", em_handle,
+        (unsigned long long)cycle, DDI_EM_CAPTURE_NAME_LEN, region->name, region->byte_size, region->byte_offset);
+    }
+    result->region_mismatches[index]++;
+    mismatches++;
+  }
+  return mismatches;
+}
+
+// Replay a process data capture through the control logic and compare its outputs against a golden capture
+EM_API ddi_em_result ddi_em_replay_run(ddi_em_handle em_handle, const ddi_em_replay_config *config, ddi_em_replay_result *result)
+{
+  ddi_em_instance *instance;
+  capture_reader input, golden, *expected;
+  capture_writer writer;
+  ddi_em_capture_region regions[DDI_EM_CAPTURE_MAX_REGIONS];
+  const ddi_em_capture_region *region;
+  ddi_em_cyclic_func *callback;
+  void *user_data;
+  EC_T_MEMREQ_DESC mem_desc;
+  EC_T_DWORD out_size = 0;
+  ntime_t start, now, deadline;
+  uint64_t cycle, first_timestamp = 0, offset_ns;
+  uint32_t index, region_count = 0, input_size = 0, output_size = 0, acontis_result;
+  uint8_t *standin_input = NULL, *standin_output = NULL, *out_record = NULL, *data;
+  bool standin, standin_mutex = false, golden_valid = false, first = true;
+  ddi_em_result em_result;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (config == NULL) || (result == NULL) || (config->input_file == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  instance = get_master_instance(em_handle);
+  callback = config->callback ? config->callback : instance->master_config.cyclic_callback;
+  user_data = config->callback ? config->user_data : instance->master_config.cyclic_args;
+  if ( callback == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  // The replay and the cyclic task would both drive the process image @see cyclic_thread_scheduler()
+  if ( !__sync_bool_compare_and_swap(&instance->master_status.replay_active, false, true) )
+  {
+    return DDI_EM_STATUS_BUSY;
+  }
+  if ( __atomic_load_n(&instance->master_status.scheduler_running, __ATOMIC_SEQ_CST) )
+  {
+    __atomic_store_n(&instance->master_status.replay_active, false, __ATOMIC_SEQ_CST);
+    return DDI_EM_STATUS_BUSY;
+  }
+  memset(result, 0, sizeof(ddi_em_replay_result));
+  memset(&golden, 0, sizeof(golden));
+  memset(&writer, 0, sizeof(writer));
+  expected = &input;
+
+  em_result = capture_reader_open(em_handle, &input, config->input_file);
+  if ( (em_result == DDI_EM_STATUS_OK) && (config->golden_file != NULL) )
+  {
+    em_result = capture_reader_open(em_handle, &golden, config->golden_file);
+    expected = &golden;
+  }
+  if ( em_result != DDI_EM_STATUS_OK )
+  {
+    goto exit;
+  }
+
+  // Without a configured master the replay provides the process image, otherwise the capture must fit the master's
+  standin = (instance->master_config.pd_input == NULL) || (instance->master_config.pd_output == NULL);
+  if ( !standin )
+  {
+    memset(&mem_desc, 0, sizeof(mem_desc));
+    acontis_result = emIoCtl(em_handle, EC_IOCTL_GET_PDMEMORYSIZE, EC_NULL, 0, (EC_T_BYTE *)&mem_desc, sizeof(mem_desc), &out_size);
+    if ( acontis_result != EC_E_NOERROR )
+    {
+      em_result = translate_ddi_acontis_err_code(em_handle, acontis_result);
+      goto exit;
+    }
+    input_size = mem_desc.dwPDInSize;
+    output_size = mem_desc.dwPDOutSize;
+  }
+  if ( ((em_result = replay_check_regions(em_handle, &input, false, standin, &input_size)) != DDI_EM_STATUS_OK) ||
+       ((em_result = replay_check_regions(em_handle, expected, true, standin, &output_size)) != DDI_EM_STATUS_OK) )
+  {
+    goto exit;
+  }
+  for ( index = 0; index < expected->header.region_count; index++ )
+  {
+    result->region_count += expected->regions[index].is_output;
+  }
+  if ( result->region_count == 0 )
+  {
+    ELOG(em_handle, "Master[%d] replay: the golden capture has no output regions \n", em_handle);
+    em_result = DDI_EM_STATUS_INVALID_DATA;
+    goto exit;
+  }
+  if ( standin )
+  {
+    standin_input = (uint8_t *)calloc(input_size ? input_size : 1, 1);
+    standin_output = (uint8_t *)calloc(output_size, 1);
+    if ( (standin_input == NULL) || (standin_output == NULL) )
+    {
+      em_result = DDI_EM_STATUS_NO_RESOURCES;
+      goto exit;
+    }
+    if ( instance->master_status.pd_out_mutex == NULL )
+    {
+      if ( ddi_mutex_create(&instance->master_status.pd_out_mutex) != ddi_status_ok )
+      {
+        em_result = DDI_EM_STATUS_NO_RESOURCES;
+        goto exit;
+      }
+      standin_mutex = true;
+    }
+    instance->master_config.pd_input = standin_input;
+    instance->master_config.pd_output = standin_output;
+  }
+
+  if ( config->output_file != NULL )
+  {
+    // The replayed capture holds the inputs of the input capture and the outputs compared against the golden capture
+    for ( index = 0; index < input.header.region_count + expected->header.region_count; index++ )
+    {
+      region = (index < input.header.region_count) ? &input.regions[index] : &expected->regions[index - input.header.region_count];
+      if ( (bool)region->is_output != (index >= input.header.region_count) )
+      {
+        continue;
+      }
+      if ( region_count == DDI_EM_CAPTURE_MAX_REGIONS )
+      {
+        ELOG(em_handle, "Master[%d] replay: the replayed capture would have more than %d regions \n", em_handle, DDI_EM_CAPTURE_MAX_REGIONS);
+        em_result = DDI_EM_STATUS_INVALID_ARG;
+        goto exit;
+      }
+      regions[region_count++] = *region;
+    }
+    em_result = capture_writer_open(em_handle, &writer, config->output_file, &input.header, regions, region_count);
+    if ( em_result == DDI_EM_STATUS_OK )
+    {
+      out_record = (uint8_t *)malloc(writer.record_size);
+      em_result = out_record ? DDI_EM_STATUS_OK : DDI_EM_STATUS_NO_RESOURCES;
+    }
+    if ( em_result != DDI_EM_STATUS_OK )
+    {
+      goto exit;
+    }
+  }
+
+  DLOG(em_handle, "Master[%d] replay: %llu records of %s%s \n", em_handle, (unsigned long long)input.record_count, config->input_file,
+    standin ? ", in-memory process image" : "");
+  ddi_ntime_get_systime(&start);
+  while ( ((config->max_cycles == 0) || (result->cycles < config->max_cycles)) && capture_reader_next(&input) )
+  {
+    cycle = capture_reader_cycle(&input);
+    if ( config->speed_percent )
+    {
+      // Pace the cycles by the recorded cycle start times, scaled by the replay speed
+      if ( first )
+      {
+        first_timestamp = ((ddi_em_capture_record *)input.record)->timestamp_ns;
+        first = false;
+      }
+      offset_ns = (((ddi_em_capture_record *)input.record)->timestamp_ns - first_timestamp) * 100 / config->speed_percent;
+      deadline = start;
+      ddi_ntime_add_ns(&deadline, 0, offset_ns);
+      ddi_ntime_sleep_ns(&deadline);
+    }
+
+    // Receive: the recorded inputs take the place of the frames from the network
+    for ( index = 0; index < input.header.region_count; index++ )
+    {
+      if ( !input.regions[index].is_output )
+      {
+        memcpy(instance->master_config.pd_input + input.regions[index].byte_offset, input.record + input.region_offset[index],
+          input.regions[index].byte_size);
+      }
+    }
+    if ( !standin )
+    {
+      ddi_em_pd_delta_cycle(em_handle);
+    }
+    callback(user_data);
+    result->cycles++;
+
+    // Compare against the golden record of the same cycle, the golden capture may have gaps
+    if ( expected == &input )
+    {
+      golden_valid = true;
+    }
+    else
+    {
+      while ( (!golden_valid || (capture_reader_cycle(&golden) < cycle)) && (golden_valid = capture_reader_next(&golden)) );
+    }
+    if ( golden_valid && (capture_reader_cycle(expected) == cycle) )
+    {
+      result->compared_cycles++;
+      if ( replay_compare(em_handle, expected, instance->master_config.pd_output, cycle, result) )
+      {
+        result->mismatched_cycles++;
+      }
+    }
+
+    if ( out_record != NULL )
+    {
+      memcpy(out_record, input.record, sizeof(ddi_em_capture_record));
+      data = out_record + sizeof(ddi_em_capture_record);
+      for ( index = 0; index < region_count; index++ )
+      {
+        memcpy(data, (regions[index].is_output ? instance->master_config.pd_output : instance->master_config.pd_input) + regions[index].byte_offset,
+          regions[index].byte_size);
+        data += regions[index].byte_size;
+      }
+      if ( !capture_writer_append(&writer, out_record) )
+      {
+        ELOG(em_handle, "Master[%d] replay: writing %s failed \n", em_handle, config->output_file);
+        em_result = DDI_EM_STATUS_NO_RESOURCES;
+        break;
+      }
+    }
+    if ( config->stop_on_mismatch && result->mismatched_cycles )
+    {
+      break;
+    }
+  }
+  ddi_ntime_get_systime(&now);
+  result->elapsed_ns = ddi_ntime_diff_ns(&now, &start);
+
+  if ( (em_result == DDI_EM_STATUS_OK) && result->mismatched_cycles )
+  {
+    em_result = DDI_EM_STATUS_INVALID_DATA;
+  }
+  DLOG(em_handle, "Master[%d] replay: %llu cycles in %llu us, %llu compared, %llu mismatched \n", em_handle,
+    (unsigned long long)result->cycles, (unsigned long long)(result->elapsed_ns / NSEC_PER_USEC),
+    (unsigned long long)result->compared_cycles, (unsigned long long)result->mismatched_cycles);
+
+exit:
+  if ( (standin_input != NULL) && (instance->master_config.pd_input == standin_input) )
+  {
+    instance->master_config.pd_input = NULL;
+    instance->master_config.pd_output = NULL;
+  }
+  capture_writer_close(em_handle, &writer);
+  capture_reader_close(&input);
+  capture_reader_close(&golden);
+  free(out_record);
+  free(standin_input);
+  free(standin_output);
+  if ( standin_mutex )
+  {
+    ddi_mutex_free(instance->master_status.pd_out_mutex);
+    instance->master_status.pd_out_mutex = NULL;
+  }
+  __atomic_store_n(&instance->master_status.replay_active, false, __ATOMIC_SEQ_CST);
+  return em_result;
+}
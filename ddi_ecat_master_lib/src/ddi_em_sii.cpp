@@ -0,0 +1,532 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <AtEthercat.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+
+// This file implements the bulk slave EEPROM (SII) reader and its image cache. The connected slaves are taken from
+// the bus scan and handed out to a pool of reader threads, each thread runs the blocking EEPROM reads of one slave at
+// a time so the mailbox-less EEPROM accesses of many slaves share the cyclic frames. An image is read up to and
+// including the end category, so only the used part of large EEPROMs goes over the wire. Images are cached in one file
+// per vendor id, product code, revision and serial number. Serial numbers are often 0, so a cached image is only
+// used when the first 8 words on the slave (ESC configuration, alias and checksum) still match it.
+
+// Words read per EEPROM access
+#define SII_READ_CHUNK_WORDS     0x100
+
+// Size of the EEPROM header, the categories start behind it
+#define SII_HEADER_WORDS         0x40
+
+// Header word holding the EEPROM size in KiBit - 1
+#define SII_SIZE_WORD            0x3E
+
+// Words compared with the slave before a cached image is used
+#define SII_VALIDATE_WORDS       8
+
+// The category type ending the category list
+#define SII_CATEGORY_END         0xFFFF
+
+// Default number of reader threads
+#define SII_DEFAULT_THREADS      8
+
+#define SII_CACHE_MAGIC          "DDISII1"
+
+// Cache file header, followed by the image
+typedef struct {
+  char                magic[8];
+  ddi_em_sii_identity identity;
+  uint32_t            size;          // Image size, in words
+} sii_cache_header;
+
+// State shared by the reader threads of one ddi_em_sii_read_all() call
+typedef struct {
+  ddi_em_handle     em_handle;
+  ddi_em_sii_image *images;
+  uint32_t          count;
+  uint32_t          next;            // Next image to read, taken atomically
+  uint32_t          timeout;
+  uint32_t          flags;
+  char              cache_dir[PATH_MAX];
+} sii_read_job;
+
+static pthread_mutex_t g_sii_lock = PTHREAD_MUTEX_INITIALIZER;
+static char g_sii_cache_dir[DDI_EM_MAX_MASTER_INSTANCES][PATH_MAX]; // Empty for the default directory
+
+// Copy the cache directory of an instance
+static void sii_get_cache_dir(ddi_em_handle em_handle, char *cache_dir)
+{
+  const char *default_dir;
+
+  pthread_mutex_lock(&g_sii_lock);
+  if ( g_sii_cache_dir[em_handle][0] )
+  {
+    strcpy(cache_dir, g_sii_cache_dir[em_handle]);
+  }
+  else
+  {
+    // The DDI_EM_SII_CACHE_DIR environment variable overrides the default directory
+    default_dir = getenv("DDI_EM_SII_CACHE_DIR");
+    snprintf(cache_dir, PATH_MAX, "%s", default_dir ? default_dir : DDI_EM_SII_CACHE_DIR);
+  }
+  pthread_mutex_unlock(&g_sii_lock);
+}
+
+// Check for the cache directory and create it if needed
+static bool sii_create_cache_dir(const char *cache_dir)
+{
+  struct stat st;
+
+  if ( stat(cache_dir, &st) == 0 )
+  {
+    return S_ISDIR(st.st_mode);
+  }
+  return (mkdir(cache_dir, 0755) == 0) || (errno == EEXIST);
+}
+
+// Format the cache file name of an identity
+static void sii_cache_file_name(const char *cache_dir, const ddi_em_sii_identity *identity, char *file_name)
+{
+  snprintf(file_name, PATH_MAX, "%s/%08x_%08x_%08x_%08x.sii", cache_dir, identity->vendor_id, identity->product_code,
+    identity->revision, identity->serial_number);
+}
+
+// Load a cached image, returns false if there is no valid cache file for the identity
+static bool sii_cache_load(const char *cache_dir, const ddi_em_sii_identity *identity, uint16_t **data, uint32_t *size)
+{
+  char file_name[PATH_MAX];
+  sii_cache_header header;
+  uint16_t *image;
+  FILE *file;
+
+  sii_cache_file_name(cache_dir, identity, file_name);
+  file = fopen(file_name, "rb");
+  if ( file == NULL )
+  {
+    return false;
+  }
+  if ( (fread(&header, sizeof(header), 1, file) != 1) || memcmp(header.magic, SII_CACHE_MAGIC, sizeof(header.magic)) ||
+       memcmp(&header.identity, identity, sizeof(ddi_em_sii_identity)) ||
+       (header.size < SII_HEADER_WORDS) || (header.size > DDI_EM_SII_MAX_WORDS) )
+  {
+    fclose(file);
+    return false;
+  }
+  image = (uint16_t *)malloc(header.size * sizeof(uint16_t));
+  if ( (image == NULL) || (fread(image, sizeof(uint16_t), header.size, file) != header.size) )
+  {
+    free(image);
+    fclose(file);
+    return false;
+  }
+  fclose(file);
+  *data = image;
+  *size = header.size;
+  return true;
+}
+
+// Write an image to the cache, the file is replaced atomically so concurrent readers never see a partial image
+static bool sii_cache_store(const char *cache_dir, const ddi_em_sii_identity *identity, const uint16_t *data, uint32_t size)
+{
+  char file_name[PATH_MAX], temp_name[PATH_MAX + 32];
+  sii_cache_header header;
+  FILE *file;
+  bool written;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SII_CACHE_MAGIC, sizeof(header.magic));
+  header.identity = *identity;
+  header.size = size;
+
+  sii_cache_file_name(cache_dir, identity, file_name);
+  snprintf(temp_name, sizeof(temp_name), "%s.%d.%lx.tmp", file_name, getpid(), (unsigned long)pthread_self());
+  file = fopen(temp_name, "wb");
+  if ( file == NULL )
+  {
+    return false;
+  }
+  written = (fwrite(&header, sizeof(header), 1, file) == 1) && (fwrite(data, sizeof(uint16_t), size, file) == size);
+  written = (fclose(file) == 0) && written;
+  if ( !written || rename(temp_name, file_name) )
+  {
+    unlink(temp_name);
+    return false;
+  }
+  return true;
+}
+
+// Read EEPROM words from a slave
+static ddi_em_result sii_read_words(ddi_em_handle em_handle, uint16_t station_address, uint32_t offset, uint16_t *data,
+  uint32_t length, uint32_t timeout)
+{
+  uint32_t result, out_len;
+
+  while ( length > 0 )
+  {
+    out_len = 0;
+    result = emReadSlaveEEPRom(em_handle, EC_TRUE, station_address, (EC_T_WORD)offset, data, length, &out_len, timeout);
+    if ( result != ACONTIS_SUCCESS )
+    {
+      ELOG(em_handle, "Master[%d] station 0x%04x SII read: emReadSlaveEEPRom %s (0x%x)\n", em_handle, station_address, ecatGetText(result), result);
+      return translate_ddi_acontis_err_code(em_handle, result);
+    }
+    if ( (out_len == 0) || (out_len > length) )
+    {
+      return DDI_ES_EEPROM_RD_ERR;
+    }
+    offset += out_len;
+    data += out_len;
+    length -= out_len;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Read the image of a slave, from word 0 up to and including the end category
+static ddi_em_result sii_read_image(ddi_em_handle em_handle, uint16_t station_address, uint32_t timeout, uint16_t **data, uint32_t *size)
+{
+  ddi_em_result result;
+  uint16_t *image, *trimmed;
+  uint32_t limit, loaded, position, end, chunk;
+
+  image = (uint16_t *)malloc(DDI_EM_SII_MAX_WORDS * sizeof(uint16_t));
+  if ( image == NULL )
+  {
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  result = sii_read_words(em_handle, station_address, 0, image, SII_HEADER_WORDS, timeout);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    free(image);
+    return result;
+  }
+
+  // The category walk never reads past the EEPROM size from the header
+  limit = ((uint32_t)image[SII_SIZE_WORD] + 1) * 1024 / 16;
+  if ( limit > DDI_EM_SII_MAX_WORDS )
+  {
+    limit = DDI_EM_SII_MAX_WORDS;
+  }
+  loaded = SII_HEADER_WORDS;
+  position = SII_HEADER_WORDS;
+  end = limit;
+  while ( position + 2 <= limit )
+  {
+    // Load the next category header, the chunks also bring in the category data
+    while ( loaded < position + 2 )
+    {
+      chunk = (limit - loaded < SII_READ_CHUNK_WORDS) ? (limit - loaded) : SII_READ_CHUNK_WORDS;
+      result = sii_read_words(em_handle, station_address, loaded, &image[loaded], chunk, timeout);
+      if ( result != DDI_EM_STATUS_OK )
+      {
+        free(image);
+        return result;
+      }
+      loaded += chunk;
+    }
+    if ( image[position] == SII_CATEGORY_END )
+    {
+      end = position + 1;
+      break;
+    }
+    position += 2 + image[position + 1];
+  }
+  if ( end > limit )
+  {
+    end = limit;
+  }
+
+  // Read the data of a last category that runs up to the EEPROM size
+  if ( loaded < end )
+  {
+    result = sii_read_words(em_handle, station_address, loaded, &image[loaded], end - loaded, timeout);
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      free(image);
+      return result;
+    }
+  }
+
+  trimmed = (uint16_t *)realloc(image, end * sizeof(uint16_t));
+  *data = trimmed ? trimmed : image;
+  *size = end;
+  return DDI_EM_STATUS_OK;
+}
+
+// Read one slave, from the cache if the cached image still matches the slave
+static void sii_read_slave(sii_read_job *job, ddi_em_sii_image *image)
+{
+  uint16_t validate[SII_VALIDATE_WORDS];
+  EC_T_BOOL is_slave_access_active;
+  uint16_t *cached = NULL;
+  uint32_t result, cached_size = 0;
+  bool use_cache = !(job->flags & (DDI_EM_SII_REFRESH | DDI_EM_SII_NO_CACHE));
+  ntime_t start_time, end_time;
+
+  ddi_ntime_get_systime(&start_time);
+
+  // Make sure the EtherCAT master has access to the EEPROM
+  result = emActiveSlaveEEPRom(job->em_handle, EC_TRUE, image->station_address, &is_slave_access_active, job->timeout);
+  if ( result != ACONTIS_SUCCESS )
+  {
+    ELOG(job->em_handle, "Master[%d] station 0x%04x SII read: emActiveSlaveEEPRom %s (0x%x)\n", job->em_handle, image->station_address, ecatGetText(result), result);
+    image->result = translate_ddi_acontis_err_code(job->em_handle, result);
+  }
+  else if ( is_slave_access_active )
+  {
+    ELOG(job->em_handle, "Master[%d] station 0x%04x SII read: the master does not have access to the PDI EEPROM\n", job->em_handle, image->station_address);
+    image->result = DDI_ES_EEPROM_BUSY;
+  }
+  else if ( use_cache && sii_cache_load(job->cache_dir, &image->identity, &cached, &cached_size) )
+  {
+    image->result = sii_read_words(job->em_handle, image->station_address, 0, validate, SII_VALIDATE_WORDS, job->timeout);
+    if ( (image->result == DDI_EM_STATUS_OK) && !memcmp(validate, cached, sizeof(validate)) )
+    {
+      image->data = cached;
+      image->size = cached_size;
+      image->from_cache = 1;
+    }
+    else
+    {
+      DLOG(job->em_handle, "Master[%d] station 0x%04x SII read: the cached image is stale\n", job->em_handle, image->station_address);
+      free(cached);
+    }
+  }
+  else
+  {
+    image->result = DDI_EM_STATUS_OK;
+  }
+
+  if ( (image->result == DDI_EM_STATUS_OK) && !image->from_cache )
+  {
+    image->result = sii_read_image(job->em_handle, image->station_address, job->timeout, &image->data, &image->size);
+    if ( (image->result == DDI_EM_STATUS_OK) && !(job->flags & DDI_EM_SII_NO_CACHE) &&
+         !sii_cache_store(job->cache_dir, &image->identity, image->data, image->size) )
+    {
+      WLOG(job->em_handle, "Master[%d] station 0x%04x SII read: cannot write the image to %s\n", job->em_handle, image->station_address, job->cache_dir);
+    }
+  }
+
+  ddi_ntime_get_systime(&end_time);
+  image->read_time_us = (uint32_t)(ddi_ntime_diff_ns(&end_time, &start_time) / NSEC_PER_USEC);
+}
+
+// Reader thread, reads slaves until all of them are taken
+static void *sii_read_thread(void *arg)
+{
+  sii_read_job *job = (sii_read_job *)arg;
+  uint32_t index;
+
+  while ( (index = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->count )
+  {
+    // Slaves missing from the bus scan keep its error
+    if ( job->images[index].result == DDI_EM_STATUS_OK )
+    {
+      sii_read_slave(job, &job->images[index]);
+    }
+  }
+  return NULL;
+}
+
+// Read the EEPROM images of all connected slaves concurrently
+EM_API ddi_em_result ddi_em_sii_read_all(ddi_em_handle em_handle, ddi_em_sii_image *images, uint32_t max_count, uint32_t *count, uint32_t threads, uint32_t timeout, uint32_t flags)
+{
+  EC_T_BUS_SLAVE_INFO bus_slave_info;
+  sii_read_job *job;
+  pthread_t *thread_ids;
+  uint32_t slave_count, position, result, started = 0;
+  ddi_em_result status = DDI_EM_STATUS_OK;
+  ntime_t start_time, end_time;
+
+  VALIDATE_INSTANCE(em_handle);
+
+  if ( (count == NULL) || ((images == NULL) && (max_count > 0)) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+
+  slave_count = emGetNumConnectedSlaves(em_handle);
+  *count = slave_count;
+  if ( slave_count > max_count )
+  {
+    ELOG(em_handle, "Master[%d] SII read: %u slaves are connected, the image array holds %u\n", em_handle, slave_count, max_count);
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+  if ( slave_count == 0 )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+
+  job = (sii_read_job *)calloc(1, sizeof(sii_read_job));
+  if ( job == NULL )
+  {
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  job->em_handle = em_handle;
+  job->images = images;
+  job->count = slave_count;
+  job->timeout = timeout;
+  job->flags = flags;
+  sii_get_cache_dir(em_handle, job->cache_dir);
+  if ( !(flags & DDI_EM_SII_NO_CACHE) && !sii_create_cache_dir(job->cache_dir) )
+  {
+    WLOG(em_handle, "Master[%d] SII read: cannot create the cache directory %s, reading without the cache\n", em_handle, job->cache_dir);
+    job->flags |= DDI_EM_SII_NO_CACHE;
+  }
+
+  // Take the slave identities from the bus scan, the auto increment address of a slave is the negative bus position
+  memset(images, 0, slave_count * sizeof(ddi_em_sii_image));
+  for ( position = 0; position < slave_count; position++ )
+  {
+    result = emGetBusSlaveInfo(em_handle, EC_FALSE, (uint16_t)(0 - position), &bus_slave_info);
+    if ( result != ACONTIS_SUCCESS )
+    {
+      ELOG(em_handle, "Master[%d] SII read: slave %u information %s (0x%x)\n", em_handle, position, ecatGetText(result), result);
+      images[position].result = translate_ddi_acontis_err_code(em_handle, result);
+      continue;
+    }
+    images[position].station_address = bus_slave_info.wStationAddress;
+    images[position].identity.vendor_id = bus_slave_info.dwVendorId;
+    images[position].identity.product_code = bus_slave_info.dwProductCode;
+    images[position].identity.revision = bus_slave_info.dwRevisionNumber;
+    images[position].identity.serial_number = bus_slave_info.dwSerialNumber;
+    images[position].result = DDI_EM_STATUS_OK;
+  }
+
+  if ( threads == 0 )
+  {
+    threads = SII_DEFAULT_THREADS;
+  }
+  if ( threads > slave_count )
+  {
+    threads = slave_count;
+  }
+  ddi_ntime_get_systime(&start_time);
+  thread_ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+  if ( thread_ids != NULL )
+  {
+    for ( started = 0; started < threads; started++ )
+    {
+      if ( pthread_create(&thread_ids[started], NULL, sii_read_thread, job) )
+      {
+        break;
+      }
+    }
+  }
+  // Read on the calling thread if no reader thread could be started
+  if ( started == 0 )
+  {
+    sii_read_thread(job);
+  }
+  for ( position = 0; position < started; position++ )
+  {
+    pthread_join(thread_ids[position], NULL);
+  }
+  ddi_ntime_get_systime(&end_time);
+  free(thread_ids);
+
+  for ( position = 0; position < slave_count; position++ )
+  {
+    if ( (images[position].result != DDI_EM_STATUS_OK) && (status == DDI_EM_STATUS_OK) )
+    {
+      status = images[position].result;
+    }
+  }
+  DLOG(em_handle, "Master[%d] SII read: %u slaves in %u ms with %u threads\n", em_handle, slave_count,
+    (uint32_t)(ddi_ntime_diff_ns(&end_time, &start_time) / NSEC_PER_MSEC), started ? started : 1);
+  free(job);
+  return status;
+}
+
+// Release the image data returned by ddi_em_sii_read_all()
+EM_API void ddi_em_sii_free(ddi_em_sii_image *images, uint32_t count)
+{
+  uint32_t index;
+
+  if ( images == NULL )
+  {
+    return;
+  }
+  for ( index = 0; index < count; index++ )
+  {
+    free(images[index].data);
+    images[index].data = NULL;
+    images[index].size = 0;
+  }
+}
+
+// Set the EEPROM image cache directory of a master instance
+EM_API ddi_em_result ddi_em_sii_set_cache_dir(ddi_em_handle em_handle, const char *cache_dir)
+{
+  VALIDATE_INSTANCE(em_handle);
+
+  if ( cache_dir && (strlen(cache_dir) >= PATH_MAX) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  if ( cache_dir && !sii_create_cache_dir(cache_dir) )
+  {
+    ELOG(em_handle, "Master[%d] SII cache: cannot create %s\n", em_handle, cache_dir);
+    return DDI_EM_STATUS_FILE_OPEN_ERR;
+  }
+  pthread_mutex_lock(&g_sii_lock);
+  strcpy(g_sii_cache_dir[em_handle], cache_dir ? cache_dir : "");
+  pthread_mutex_unlock(&g_sii_lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Remove cached EEPROM images
+EM_API ddi_em_result ddi_em_sii_cache_invalidate(ddi_em_handle em_handle, const ddi_em_sii_identity *identity)
+{
+  char cache_dir[PATH_MAX], file_name[PATH_MAX + NAME_MAX + 2];
+  struct dirent *entry;
+  size_t length;
+  DIR *dir;
+
+  VALIDATE_INSTANCE(em_handle);
+
+  sii_get_cache_dir(em_handle, cache_dir);
+  if ( identity != NULL )
+  {
+    sii_cache_file_name(cache_dir, identity, file_name);
+    if ( unlink(file_name) )
+    {
+      return (errno == ENOENT) ? DDI_EM_STATUS_NOT_FOUND : DDI_EM_STATUS_FILE_OPEN_ERR;
+    }
+    return DDI_EM_STATUS_OK;
+  }
+
+  // Remove every image file, other files in the directory are left alone
+  dir = opendir(cache_dir);
+  if ( dir == NULL )
+  {
+    return (errno == ENOENT) ? DDI_EM_STATUS_OK : DDI_EM_STATUS_FILE_OPEN_ERR;
+  }
+  while ( (entry = readdir(dir)) != NULL )
+  {
+    length = strlen(entry->d_name);
+    if ( (length > 4) && !strcmp(&entry->d_name[length - 4], ".sii") )
+    {
+      snprintf(file_name, sizeof(file_name), "%s/%s", cache_dir, entry->d_name);
+      unlink(file_name);
+    }
+  }
+  closedir(dir);
+  return DDI_EM_STATUS_OK;
+}
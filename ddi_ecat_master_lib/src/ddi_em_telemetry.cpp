@@ -0,0 +1,265 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_translate.h"
+#include "ddi_em.h"
+#include "ddi_em_telemetry.h"
+
+// This file keeps the per-instance frame-loss and working counter telemetry. Lost frames are reported by the
+// cyclic thread, WKC mismatches by an internal Acontis notification client. Both are counted in a rolling window
+// made of DDI_EM_TELEMETRY_BUCKETS buckets so the window can advance without keeping one entry per cycle.
+
+// Caller data of the telemetry notification client, must outlive the registration
+static ddi_em_handle g_telemetry_cb_instance[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Clear the rolling window and size the buckets from the configured window length
+static void telemetry_restart_window (ddi_em_instance *instance)
+{
+  ddi_em_telemetry *telemetry = &instance->master_status.telemetry;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  uint32_t window_cycles = telemetry->config.window_cycles;
+
+  if ( window_cycles == 0 )
+  {
+    window_cycles = DDI_EM_TELEMETRY_WINDOW_DEFAULT;
+  }
+  telemetry->bucket_len = window_cycles / DDI_EM_TELEMETRY_BUCKETS;
+  if ( telemetry->bucket_len == 0 )
+  {
+    telemetry->bucket_len = 1;
+  }
+  telemetry->bucket_idx = 0;
+  memset(telemetry->bucket_cycles, 0, sizeof(telemetry->bucket_cycles));
+  memset(telemetry->bucket_lost, 0, sizeof(telemetry->bucket_lost));
+  memset(telemetry->bucket_wkc, 0, sizeof(telemetry->bucket_wkc));
+  stats->window_cycles = 0;
+  stats->window_lost_frame_count = 0;
+  stats->window_wkc_error_count = 0;
+}
+
+// Record a cyclic WKC mismatch in the current bucket and the per-command table
+static void telemetry_wkc_error (ddi_em_instance *instance, EC_T_WKCERR_DESC *wkc_desc)
+{
+  ddi_em_telemetry *telemetry = &instance->master_status.telemetry;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  ddi_em_cyc_cmd_stats *cmd = NULL;
+  uint32_t index;
+
+  stats->wkc_error_count++;
+  stats->window_wkc_error_count++;
+  telemetry->bucket_wkc[telemetry->bucket_idx]++;
+
+  for ( index = 0; index < telemetry->cmd_count; index++ )
+  {
+    if ( (telemetry->cmd_stats[index].command == wkc_desc->byCmd) && (telemetry->cmd_stats[index].address == wkc_desc->dwAddr) )
+    {
+      cmd = &telemetry->cmd_stats[index];
+      break;
+    }
+  }
+  if ( cmd == NULL )
+  {
+    // Further commands are still counted in the totals, they just don't get their own entry
+    if ( telemetry->cmd_count == DDI_EM_MAX_CYC_CMD_STATS )
+    {
+      return;
+    }
+    cmd = &telemetry->cmd_stats[telemetry->cmd_count++];
+    cmd->command = wkc_desc->byCmd;
+    cmd->address = wkc_desc->dwAddr;
+  }
+  cmd->wkc_expected = wkc_desc->wWkcSet;
+  cmd->wkc_last = wkc_desc->wWkcAct;
+  cmd->mismatch_count++;
+}
+
+// Acontis notification handler of the telemetry client, only the cyclic WKC errors are of interest
+static EC_T_DWORD telemetry_notify(EC_T_DWORD code, EC_T_NOTIFYPARMS *parms)
+{
+  ddi_em_handle em_handle = *(ddi_em_handle *)parms->pCallerData;
+  EC_T_ERROR_NOTIFICATION_DESC *error_desc;
+
+  if ( (code == EC_NOTIFY_CYCCMD_WKC_ERROR) && (parms->pbyInBuf != NULL) )
+  {
+    error_desc = (EC_T_ERROR_NOTIFICATION_DESC *)parms->pbyInBuf;
+    telemetry_wkc_error(get_master_instance(em_handle), &error_desc->desc.WkcErrDesc);
+  }
+  return EC_E_NOERROR;
+}
+
+// Raise a limit event once when the value reaches the limit, re-arm it when the value drops below the limit
+static void telemetry_check_limit (ddi_em_instance *instance, bool *raised, uint32_t value, uint32_t limit,
+  ddi_em_event_type event_code, const char *description)
+{
+  if ( (limit == 0) || (value < limit) )
+  {
+    *raised = false;
+    return;
+  }
+  if ( *raised )
+  {
+    return;
+  }
+  *raised = true;
+  snprintf(instance->master_status.event_str, sizeof(instance->master_status.event_str),
+    "%s: %u (limit %u)", description, value, limit);
+  WLOG(instance->master_config.em_handle, "Master[%d] %s \n", instance->master_config.em_handle, instance->master_status.event_str);
+  ddi_em_notify_event(instance->master_config.em_handle, DDI_EM_INVALID_HANDLE, event_code, instance->master_status.event_str, value);
+}
+
+// Reset the telemetry of a new master instance
+void ddi_em_telemetry_init(ddi_em_handle em_handle)
+{
+  ddi_em_instance *instance = get_master_instance(em_handle);
+  ddi_em_telemetry *telemetry = &instance->master_status.telemetry;
+
+  memset(telemetry, 0, sizeof(ddi_em_telemetry));
+  telemetry->config.window_cycles = DDI_EM_TELEMETRY_WINDOW_DEFAULT;
+  telemetry_restart_window(instance);
+}
+
+// Register the notification client, emConfigureMaster() drops the clients registered before it
+ddi_em_result ddi_em_telemetry_register(ddi_em_handle em_handle)
+{
+  ddi_em_telemetry *telemetry = &get_master_instance(em_handle)->master_status.telemetry;
+  EC_T_REGISTERRESULTS register_results;
+  uint32_t result;
+
+  g_telemetry_cb_instance[em_handle] = em_handle;
+  memset(&register_results, 0, sizeof(EC_T_REGISTERRESULTS));
+  result = emRegisterClient(em_handle, telemetry_notify, &g_telemetry_cb_instance[em_handle], &register_results);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] configure: Cannot register the telemetry client: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+    return translate_ddi_acontis_err_code(em_handle, result);
+  }
+  telemetry->client_id = register_results.dwClntId;
+  telemetry->client_registered = true;
+  return DDI_EM_STATUS_OK;
+}
+
+// Unregister the telemetry notification client
+void ddi_em_telemetry_deinit(ddi_em_handle em_handle)
+{
+  ddi_em_telemetry *telemetry = &get_master_instance(em_handle)->master_status.telemetry;
+  uint32_t result;
+
+  if ( !telemetry->client_registered )
+  {
+    return;
+  }
+  result = emUnregisterClient(em_handle, telemetry->client_id);
+  if ( result != EC_E_NOERROR )
+  {
+    ELOG(em_handle, "Master[%d] deinit: Cannot unregister the telemetry client: %s (0x%x)\n", em_handle, ecatGetText(result), result);
+  }
+  telemetry->client_registered = false;
+}
+
+// Account for one cycle in the rolling window and check the notification limits
+void ddi_em_telemetry_cycle(ddi_em_handle em_handle, bool frame_lost)
+{
+  ddi_em_instance *instance = get_master_instance(em_handle);
+  ddi_em_telemetry *telemetry = &instance->master_status.telemetry;
+  ddi_em_master_stats *stats = &instance->master_status.master_stats;
+  uint32_t idx;
+
+  if ( telemetry->restart_pending )
+  {
+    telemetry_restart_window(instance);
+    telemetry->restart_pending = false;
+  }
+
+  idx = telemetry->bucket_idx;
+  telemetry->bucket_cycles[idx]++;
+  stats->window_cycles++;
+  if ( frame_lost )
+  {
+    telemetry->bucket_lost[idx]++;
+    stats->window_lost_frame_count++;
+    ddi_ntime_get_systime(&telemetry->last_frame_loss);
+    telemetry->frame_loss_seen = true;
+  }
+
+  telemetry_check_limit(instance, &telemetry->lost_limit_raised, stats->window_lost_frame_count,
+    telemetry->config.window_lost_frame_limit, DDI_EM_EVENT_ERR_FRAMELOSS_LIMIT, "Lost frames in the telemetry window");
+  telemetry_check_limit(instance, &telemetry->streak_limit_raised, stats->cur_consecutive_err_frame_count,
+    telemetry->config.lost_frame_streak_limit, DDI_EM_EVENT_ERR_FRAMELOSS_STREAK, "Consecutive lost frames");
+  telemetry_check_limit(instance, &telemetry->wkc_limit_raised, stats->window_wkc_error_count,
+    telemetry->config.window_wkc_error_limit, DDI_EM_EVENT_ERR_WKC_LIMIT, "WKC mismatches in the telemetry window");
+
+  // Once the bucket is full, advance to the next one and drop the oldest bucket from the window
+  if ( telemetry->bucket_cycles[idx] == telemetry->bucket_len )
+  {
+    idx = (idx + 1) % DDI_EM_TELEMETRY_BUCKETS;
+    stats->window_cycles           -= telemetry->bucket_cycles[idx];
+    stats->window_lost_frame_count -= telemetry->bucket_lost[idx];
+    stats->window_wkc_error_count  -= telemetry->bucket_wkc[idx];
+    telemetry->bucket_cycles[idx] = 0;
+    telemetry->bucket_lost[idx] = 0;
+    telemetry->bucket_wkc[idx] = 0;
+    telemetry->bucket_idx = idx;
+  }
+}
+
+// Return the milliseconds since the last lost frame
+uint64_t ddi_em_telemetry_ms_since_frame_loss(ddi_em_handle em_handle)
+{
+  ddi_em_telemetry *telemetry = &get_master_instance(em_handle)->master_status.telemetry;
+  ntime_t now;
+
+  if ( !telemetry->frame_loss_seen )
+  {
+    return DDI_EM_NO_FRAME_LOSS;
+  }
+  ddi_ntime_get_systime(&now);
+  return ddi_ntime_diff_ns(&now, &telemetry->last_frame_loss) / NSEC_PER_MSEC;
+}
+
+// Set the window length and notification limits of the telemetry
+EM_API ddi_em_result ddi_em_set_telemetry_config(ddi_em_handle em_handle, ddi_em_telemetry_config *config)
+{
+  ddi_em_telemetry *telemetry;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( config == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  telemetry = &get_master_instance(em_handle)->master_status.telemetry;
+  telemetry->config.window_lost_frame_limit = config->window_lost_frame_limit;
+  telemetry->config.lost_frame_streak_limit = config->lost_frame_streak_limit;
+  telemetry->config.window_wkc_error_limit  = config->window_wkc_error_limit;
+  if ( telemetry->config.window_cycles != config->window_cycles )
+  {
+    // The cyclic thread owns the window, it restarts the window at its next cycle
+    telemetry->config.window_cycles = config->window_cycles;
+    telemetry->restart_pending = true;
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Copy out the per-command working counter mismatch statistics
+EM_API ddi_em_result ddi_em_get_cyc_cmd_stats(ddi_em_handle em_handle, ddi_em_cyc_cmd_stats *cmd_stats, uint32_t max_count, uint32_t *count)
+{
+  ddi_em_telemetry *telemetry;
+  VALIDATE_INSTANCE(em_handle); // Validate the instance argument
+  if ( (cmd_stats == NULL) || (count == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  telemetry = &get_master_instance(em_handle)->master_status.telemetry;
+  *count = (telemetry->cmd_count < max_count) ? telemetry->cmd_count : max_count;
+  memcpy(cmd_stats, telemetry->cmd_stats, *count * sizeof(ddi_em_cyc_cmd_stats));
+  return DDI_EM_STATUS_OK;
+}
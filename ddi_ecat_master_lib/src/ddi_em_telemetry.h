@@ -0,0 +1,74 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef DDI_EM_TELEMETRY_H
+#define DDI_EM_TELEMETRY_H
+
+// Frame-loss and working counter telemetry of a master instance
+
+#include <stdint.h>
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+
+/** @struct ddi_em_telemetry
+ *  @brief Rolling window and working counter state of a master instance, updated by the cyclic thread
+ */
+typedef struct {
+  ddi_em_telemetry_config config;                               /**< Window length and notification limits */
+  volatile bool           restart_pending;                      /**< Restart the window on the next cycle (window length changed) */
+  uint32_t                bucket_len;                           /**< Cycles per bucket */
+  uint32_t                bucket_idx;                           /**< Bucket receiving the current cycle */
+  uint32_t                bucket_cycles[DDI_EM_TELEMETRY_BUCKETS]; /**< Cycles counted in each bucket */
+  uint32_t                bucket_lost[DDI_EM_TELEMETRY_BUCKETS];   /**< Lost frames counted in each bucket */
+  uint32_t                bucket_wkc[DDI_EM_TELEMETRY_BUCKETS];    /**< WKC mismatches counted in each bucket */
+  bool                    frame_loss_seen;                      /**< Has a frame been lost since initialization? */
+  ntime_t                 last_frame_loss;                      /**< Time of the last lost frame */
+  bool                    lost_limit_raised;                    /**< DDI_EM_EVENT_ERR_FRAMELOSS_LIMIT raised and not yet re-armed */
+  bool                    streak_limit_raised;                  /**< DDI_EM_EVENT_ERR_FRAMELOSS_STREAK raised and not yet re-armed */
+  bool                    wkc_limit_raised;                     /**< DDI_EM_EVENT_ERR_WKC_LIMIT raised and not yet re-armed */
+  ddi_em_cyc_cmd_stats    cmd_stats[DDI_EM_MAX_CYC_CMD_STATS];  /**< Per-command WKC mismatch statistics */
+  uint32_t                cmd_count;                            /**< Number of valid entries in cmd_stats */
+  bool                    client_registered;                    /**< Is the internal notification client registered? */
+  uint32_t                client_id;                            /**< The acontis-based notification client id */
+} ddi_em_telemetry;
+
+/** ddi_em_telemetry_init
+ @brief Reset the telemetry of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_telemetry_init(ddi_em_handle em_handle);
+
+/** ddi_em_telemetry_register
+ @brief Register the notification client that counts the working counter mismatches
+ Must be called after emConfigureMaster(), which drops the clients registered before it
+ @param em_handle The EtherCAT master handle
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_telemetry_register(ddi_em_handle em_handle);
+
+/** ddi_em_telemetry_deinit
+ @brief Unregister the telemetry notification client
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_em_telemetry_deinit(ddi_em_handle em_handle);
+
+/** ddi_em_telemetry_cycle
+ @brief Account for one cycle in the rolling window and raise the limit events, called by the cyclic thread
+ @param em_handle The EtherCAT master handle
+ @param frame_lost Was a cyclic frame lost in this cycle?
+ */
+void ddi_em_telemetry_cycle(ddi_em_handle em_handle, bool frame_lost);
+
+/** ddi_em_telemetry_ms_since_frame_loss
+ @brief Return the milliseconds since the last lost frame
+ @param em_handle The EtherCAT master handle
+ @return uint64_t The milliseconds since the last lost frame, DDI_EM_NO_FRAME_LOSS if no frame was lost
+ */
+uint64_t ddi_em_telemetry_ms_since_frame_loss(ddi_em_handle em_handle);
+
+#endif // DDI_EM_TELEMETRY_H
@@ -36,20 +36,26 @@ static ddi_em_result get_next_fusion_instance (ddi_em_handle em_handle, ddi_fusi
 // Handle Fusion-specific extensions to process data
 void ddi_em_fusion_handle_process_data (ddi_em_handle em_handle)
 {
-  ddi_em_instance *em_instance = get_master_instance(em_handle);
   fusion_instance_type *fusion_instance;
   uint fusion_count = 0;
-  uint64_t uart_count = 0;
+  bool is_uart_event_registered = false;
   for ( fusion_count = 0; fusion_count < DDI_MAX_FUSION_INSTANCES; fusion_count++ )
   {
     fusion_instance = &g_fusion_instance[em_handle][fusion_count];
     if ( fusion_instance->is_uart_event_registered == 0 )
     {
-      // No UART instances are registered: exit
+      // No further UART instances are registered
       break;
     }
+    is_uart_event_registered = true;
+  }
+
+  // Keep the UART status mirror current for the status getters
+  ddi_fusion_uart_update_status(em_handle);
 
-    // Process any detected UART events
+  // Process any detected UART events, the event check covers all UART handles so it runs once per cycle
+  if ( is_uart_event_registered || ddi_fusion_uart_is_event_fd_enabled() )
+  {
     ddi_fusion_uart_check_for_events (em_handle);
   }
 }
@@ -86,7 +92,7 @@ ddi_em_result ddi_em_fusion_close_all_handles (ddi_em_handle em_handle)
   {
      g_fusion_instance[em_handle][fusion_count].is_allocated = 0;
   }
-  ddi_fusion_uart_close_all_handles();
+  ddi_fusion_uart_close_all_handles(em_handle);
   return DDI_EM_STATUS_OK;
 }
 
@@ -165,13 +171,13 @@ ddi_em_result ddi_em_open_fusion_interface (ddi_em_handle em_handle, EC_T_BUS_SL
         output_byte_offset = master_instance->master_config.pd_output;
 
         // Get the UART process data descriptor pointer
-        uart_pd_desc = ddi_fusion_uart_get_pd_desc(physical_uart_channel_count);
+        uart_pd_desc = ddi_fusion_uart_get_pd_desc(em_handle, physical_uart_channel_count);
         setup_em_pd_desc(entry,uart_pd_desc, input_byte_offset, output_byte_offset);
 
         // Calculate the slot number
         slot = (entry->wIndex / DDI_FUSION_SLOT_INCREMENT) & 0xFF;
         // Map the EtherCAT index to the physical uart_channel (0-63)
-        ddi_fusion_uart_map_slot_to_channel(slot, physical_uart_channel_count);
+        ddi_fusion_uart_map_slot_to_channel(em_handle, slot, physical_uart_channel_count);
         if ( uart_channel_count % MAX_NUMBER_UART_PER_MODULE == (MAX_NUMBER_UART_PER_MODULE-1))  // New module type every 4 UART channels
         {
           // Reset the uart_channel_count variable every 4 channels
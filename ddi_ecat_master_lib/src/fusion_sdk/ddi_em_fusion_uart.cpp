@@ -19,6 +19,19 @@ prior written authorization of DDI is prohibited.
 #include "ddi_em_logging.h"
 #include "ddi_em.h"
 #include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_tx.h"
+#include "ddi_em_fusion_uart_framing.h"
+#include "ddi_em_fusion_uart_pty.h"
+#include "ddi_em_fusion_uart_rx_timing.h"
+#include "ddi_em_fusion_uart_lease.h"
+#ifdef DDI_EM_TEST_STANDIN
+#include "ddi_em_fusion_uart_standin.h"
+#endif
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "ddi_ntime.h"
 
 // Store the EtherCAT slot and UART process data descriptor
 // This information is used to map a UART logical instance (aka the 'UART handle')
@@ -26,6 +39,8 @@ prior written authorization of DDI is prohibited.
 typedef struct {
   uint16_t slot;
   fusion_pd_desc_t uart_pd_desc;
+  uint16_t status;                // Status word mirrored from the process data every cycle
+  uint64_t status_timestamp_ns;   // Cycle time of the status, 0 until the first cycle, written after the status
 } uart_input_pd_mapping;
 
 /** @struct uart_instance
@@ -56,36 +71,232 @@ typedef struct {
   ddi_uart_event_func *event_callback;             /**< @brief The UART event callback registered */
   uint32_t      threshold_event_flags;             /**< @brief Stores the UART threshold event flags */
   void          *event_user_data;                  /**< @brief Event callback user data */
+  // Event file descriptor section
+  int           event_fd;                          /**< @brief The eventfd returned to the application, -1 if not enabled */
+  uint32_t      fd_event_flags;                    /**< @brief The events signalled on event_fd @see uart_fd_event_type */
+  uint16_t      fd_rx_threshold;                   /**< @brief The Rx bytes available that signal UART_FD_EVENT_RX_THRESHOLD */
+  uint32_t      fd_pending_events;                 /**< @brief Events not yet returned by ddi_fusion_uart_get_fd_events() */
+  uint16_t      fd_prev_status;                    /**< @brief The status word of the previous cycle, used for edge detection */
+  uint8_t       fd_prev_status_valid;              /**< @brief Is fd_prev_status set? */
+  // Registry section
+  uint32_t      master_slot;                       /**< @brief Position of the handle in the open handle list of its master */
 } uart_instance;
 
-// 64 logical UART handles
-static uart_instance g_uart_instance[MAX_UART_INSTANCES];
+// The open UART handles of a master instance, the cyclic thread only walks the handles of its own master
+typedef struct {
+  pthread_mutex_t         lock;                    // Protects the list, the cyclic thread never waits for it
+  bool                    lock_initialized;
+  ddi_fusion_uart_handle *handles;                 // Grown as needed, never shrunk
+  uint32_t                count;
+  uint32_t                capacity;
+  ddi_fusion_uart_handle *event_handles;           // The cyclic thread's copy of the list, the event callbacks run without the lock
+  uint32_t                event_capacity;
+} uart_master_handles;
+
+// The UART handles are allocated in segments of UART_SEGMENT_SIZE instances as they are opened. A segment never moves
+// or goes away once allocated, so an instance pointer stays valid while other handles are opened and closed.
+#define UART_SEGMENT_SIZE  64
+#define UART_SEGMENT_COUNT ((MAX_UART_INSTANCES + UART_SEGMENT_SIZE - 1) / UART_SEGMENT_SIZE)
+#define UART_MASTER_HANDLES_INITIAL 16
+
+// Protects the segments and the free list
+static pthread_mutex_t g_uart_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uart_instance *g_uart_segments[UART_SEGMENT_COUNT];
+
+// The handles below the limit have an instance, the limit only grows
+static uint32_t g_uart_handle_limit;
+
+// Closed handles, reused last in first out
+static ddi_fusion_uart_handle g_uart_free_handles[MAX_UART_INSTANCES];
+static uint32_t g_uart_free_count;
 
-// Maps UART physical channels to EtherCAT indices
-static uart_input_pd_mapping g_uart_pd_mapping[MAX_UART_INSTANCES];
+// Stands in for the instance of an invalid handle, never allocated
+static uart_instance g_uart_unused_instance;
+
+static uart_master_handles g_uart_masters[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Maps UART physical channels to EtherCAT indices, per master instance
+static uart_input_pd_mapping g_uart_pd_mapping[DDI_EM_MAX_MASTER_INSTANCES][MAX_UART_PHYSICAL_CHANNELS];
+
+// Protects the event file descriptors against a close while the cyclic thread signals them
+static pthread_mutex_t g_uart_fd_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// The number of UART handles with an event file descriptor, the cyclic thread checks for events while it is non-zero
+static uint32_t g_uart_fd_count;
+
+// Return the instance of a UART handle, the unused instance if the handle has none
+static uart_instance *get_uart_instance (ddi_fusion_uart_handle handle)
+{
+  if ( (handle < 0) || ((uint32_t)handle >= __atomic_load_n(&g_uart_handle_limit, __ATOMIC_ACQUIRE)) )
+  {
+    return &g_uart_unused_instance;
+  }
+  return &g_uart_segments[handle / UART_SEGMENT_SIZE][handle % UART_SEGMENT_SIZE];
+}
+
+// Return the physical channel mapping of a UART instance
+static uart_input_pd_mapping *get_pd_mapping (uart_instance *instance)
+{
+  return &g_uart_pd_mapping[instance->em_handle][instance->uart_physical_channel];
+}
+
+// Return the number of UART handles that have an instance
+uint32_t ddi_fusion_uart_get_handle_limit (void)
+{
+  return __atomic_load_n(&g_uart_handle_limit, __ATOMIC_ACQUIRE);
+}
 
 // Set the EtherCAT index of a physical UART channel
-void ddi_fusion_uart_map_slot_to_channel(uint16_t slot, uint16_t uart_channel)
+void ddi_fusion_uart_map_slot_to_channel(ddi_em_handle em_handle, uint16_t slot, uint16_t uart_channel)
 {
-  g_uart_pd_mapping[uart_channel].slot = slot;
+  g_uart_pd_mapping[em_handle][uart_channel].slot = slot;
 }
 
-// Get the next available UART instance, generates an index from 0 to 63
+// Get the next available UART instance, a closed handle if there is one, otherwise a handle that never had an instance
 static ddi_em_result get_next_uart_instance (ddi_fusion_uart_handle *handle)
 {
-  int count;
-  for ( count = 0; count < MAX_UART_INSTANCES; count++)
+  uart_instance *segment, *instance;
+  uint32_t limit;
+
+  pthread_mutex_lock(&g_uart_registry_lock);
+  if ( g_uart_free_count != 0 )
   {
-    if ( g_uart_instance[count].is_allocated == 0 )
+    *handle = g_uart_free_handles[--g_uart_free_count];
+  }
+  else
+  {
+    limit = g_uart_handle_limit;
+    if ( limit == MAX_UART_INSTANCES )
+    {
+      pthread_mutex_unlock(&g_uart_registry_lock);
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+    if ( g_uart_segments[limit / UART_SEGMENT_SIZE] == NULL )
+    {
+      segment = (uart_instance *)calloc(UART_SEGMENT_SIZE, sizeof(uart_instance));
+      if ( segment == NULL )
+      {
+        pthread_mutex_unlock(&g_uart_registry_lock);
+        return DDI_EM_STATUS_NO_RESOURCES;
+      }
+      g_uart_segments[limit / UART_SEGMENT_SIZE] = segment;
+    }
+    *handle = limit;
+    // The segment is in place before the handle becomes valid
+    __atomic_store_n(&g_uart_handle_limit, limit + 1, __ATOMIC_RELEASE);
+  }
+  // Clear the instance state and configuration data
+  instance = get_uart_instance(*handle);
+  memset(instance, 0, sizeof(uart_instance));
+  instance->event_fd = -1;
+  instance->is_allocated = 1;
+  pthread_mutex_unlock(&g_uart_registry_lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return a closed UART handle to the free list
+static void release_uart_instance (ddi_fusion_uart_handle handle)
+{
+  pthread_mutex_lock(&g_uart_registry_lock);
+  get_uart_instance(handle)->is_allocated = 0;
+  g_uart_free_handles[g_uart_free_count++] = handle;
+  pthread_mutex_unlock(&g_uart_registry_lock);
+}
+
+// Add an opened UART handle to the open handle list of its master instance
+static ddi_em_result link_master_handle (ddi_em_handle em_handle, ddi_fusion_uart_handle handle)
+{
+  uart_master_handles *master = &g_uart_masters[em_handle];
+  ddi_fusion_uart_handle *handles;
+  uint32_t capacity;
+
+  // The list lock of a master instance is created by its first open
+  pthread_mutex_lock(&g_uart_registry_lock);
+  if ( !master->lock_initialized )
+  {
+    pthread_mutex_init(&master->lock, NULL);
+    __atomic_store_n(&master->lock_initialized, true, __ATOMIC_RELEASE);
+  }
+  pthread_mutex_unlock(&g_uart_registry_lock);
+
+  pthread_mutex_lock(&master->lock);
+  if ( master->count == master->capacity )
+  {
+    capacity = master->capacity ? master->capacity * 2 : UART_MASTER_HANDLES_INITIAL;
+    handles = (ddi_fusion_uart_handle *)realloc(master->handles, capacity * sizeof(ddi_fusion_uart_handle));
+    if ( handles == NULL )
     {
-      // Clear the instance state and configuration data
-      memset(&g_uart_instance[count], 0, sizeof(uart_instance));
-      *handle = count;
-      g_uart_instance[count].is_allocated = 1;
-      return DDI_EM_STATUS_OK;
+      pthread_mutex_unlock(&master->lock);
+      return DDI_EM_STATUS_NO_RESOURCES;
     }
+    master->handles = handles;
+    master->capacity = capacity;
   }
-  return DDI_EM_STATUS_NO_RESOURCES;
+  get_uart_instance(handle)->master_slot = master->count;
+  master->handles[master->count++] = handle;
+  pthread_mutex_unlock(&master->lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Remove a UART handle being closed from the open handle list of its master instance, the last handle takes its place
+static void unlink_master_handle (ddi_em_handle em_handle, ddi_fusion_uart_handle handle)
+{
+  uart_master_handles *master = &g_uart_masters[em_handle];
+  uint32_t slot = get_uart_instance(handle)->master_slot;
+  ddi_fusion_uart_handle last;
+
+  pthread_mutex_lock(&master->lock);
+  if ( (slot < master->count) && (master->handles[slot] == handle) )
+  {
+    last = master->handles[--master->count];
+    master->handles[slot] = last;
+    get_uart_instance(last)->master_slot = slot;
+  }
+  pthread_mutex_unlock(&master->lock);
+}
+
+// Try to take the open handle list lock of a master instance, the cyclic thread skips the UART handles for a cycle
+// while a handle of its master is being opened or closed
+static bool try_lock_master_handles (ddi_em_handle em_handle)
+{
+  uart_master_handles *master = &g_uart_masters[em_handle];
+
+  return __atomic_load_n(&master->lock_initialized, __ATOMIC_ACQUIRE) && (pthread_mutex_trylock(&master->lock) == 0);
+}
+
+// Copy the open handle list of a master instance into a buffer that grows as needed
+uint32_t ddi_fusion_uart_get_master_handles (ddi_em_handle em_handle, ddi_fusion_uart_handle **handles, uint32_t *capacity)
+{
+  uart_master_handles *master = &g_uart_masters[em_handle];
+  ddi_fusion_uart_handle *buffer;
+  uint32_t count;
+
+  if ( !__atomic_load_n(&master->lock_initialized, __ATOMIC_ACQUIRE) )
+  {
+    return 0;
+  }
+  pthread_mutex_lock(&master->lock);
+  count = master->count;
+  if ( count > *capacity )
+  {
+    buffer = (ddi_fusion_uart_handle *)realloc(*handles, master->capacity * sizeof(ddi_fusion_uart_handle));
+    if ( buffer != NULL )
+    {
+      *handles = buffer;
+      *capacity = master->capacity;
+    }
+    else
+    {
+      count = *capacity;
+    }
+  }
+  if ( count != 0 )
+  {
+    memcpy(*handles, master->handles, count * sizeof(ddi_fusion_uart_handle));
+  }
+  pthread_mutex_unlock(&master->lock);
+  return count;
 }
 
 // Detect Rx overflow event from the UART input process data
@@ -280,29 +491,209 @@ static void handle_uart_events (uart_instance *uart_instance_ptr, fusion_pd_desc
   }
 }
 
+// Detect the event file descriptor events on the edges of the UART status word, the cyclic thread only sets the
+// pending events and wakes up the application, which reads them with ddi_fusion_uart_get_fd_events()
+static void signal_uart_fd_events (uart_instance *uart_instance_ptr, fusion_pd_desc_t *uart_status_pd)
+{
+  uint16_t status = *(uint16_t *)&uart_status_pd->pd_input[uart_status_pd->byte_offset];
+  uint16_t prev_status = uart_instance_ptr->fd_prev_status_valid ? uart_instance_ptr->fd_prev_status : 0;
+  uint16_t rx_level = status & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
+  uint16_t prev_rx_level = prev_status & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
+  uint32_t events = 0, prev_pending;
+  uint64_t count = 1;
+
+  // Without a previous status, conditions already present when the fd was enabled are signalled
+  if ( (rx_level >= uart_instance_ptr->fd_rx_threshold) && (prev_rx_level < uart_instance_ptr->fd_rx_threshold) )
+  {
+    events |= UART_FD_EVENT_RX_THRESHOLD;
+  }
+  if ( !(status & DDI_FUSION_UART_STATUS_TX_BUFFER_ALMOST_FULL) &&
+       (!uart_instance_ptr->fd_prev_status_valid || (prev_status & DDI_FUSION_UART_STATUS_TX_BUFFER_ALMOST_FULL)) )
+  {
+    events |= UART_FD_EVENT_TX_READY;
+  }
+  if ( (status & DDI_FUSION_UART_STATUS_ERROR_CONDITION) && !(prev_status & DDI_FUSION_UART_STATUS_ERROR_CONDITION) )
+  {
+    events |= UART_FD_EVENT_ERROR;
+  }
+  if ( (status & DDI_FUSION_UART_STATUS_RX_BUFFER_ALMOST_FULL) && !(prev_status & DDI_FUSION_UART_STATUS_RX_BUFFER_ALMOST_FULL) )
+  {
+    events |= UART_FD_EVENT_RX_ALMOST_FULL;
+  }
+  uart_instance_ptr->fd_prev_status = status;
+  uart_instance_ptr->fd_prev_status_valid = 1;
+
+  events &= uart_instance_ptr->fd_event_flags;
+  if ( events == 0 )
+  {
+    return;
+  }
+  // Only the first pending event writes to the eventfd, it stays readable until the events are read
+  prev_pending = __atomic_fetch_or(&uart_instance_ptr->fd_pending_events, events, __ATOMIC_ACQ_REL);
+  if ( prev_pending == 0 )
+  {
+    if ( write(uart_instance_ptr->event_fd, &count, sizeof(count)) != sizeof(count) )
+    {
+      DLOG(uart_instance_ptr->em_handle, "UART event fd write failed: %s\n", strerror(errno));
+    }
+  }
+}
+
+// Mirror the status words of the open UART handles of a master instance, called every cycle
+void ddi_fusion_uart_update_status (ddi_em_handle em_handle)
+{
+  uart_master_handles *master = &g_uart_masters[em_handle];
+  uart_input_pd_mapping *mapping;
+  ddi_fusion_uart_handle handle;
+  uint64_t timestamp_ns, cycle;
+  uint32_t slot;
+  uint16_t status;
+  bool timing_locked;
+
+  timestamp_ns = ddi_fusion_uart_time_ns();
+  cycle = ddi_fusion_uart_rx_timing_next_cycle(em_handle);
+  if ( !try_lock_master_handles(em_handle) )
+  {
+    return;
+  }
+  // When a reader holds the timeline lock, the Rx level rises of this cycle are recorded in the next one
+  timing_locked = ddi_fusion_uart_rx_timing_lock(em_handle);
+  for ( slot = 0; slot < master->count; slot++ )
+  {
+    handle = master->handles[slot];
+    mapping = get_pd_mapping(get_uart_instance(handle));
+    if ( mapping->uart_pd_desc.pd_input != NULL )
+    {
+      status = *(uint16_t *)&mapping->uart_pd_desc.pd_input[mapping->uart_pd_desc.byte_offset];
+      __atomic_store_n(&mapping->status, status, __ATOMIC_RELAXED);
+      __atomic_store_n(&mapping->status_timestamp_ns, timestamp_ns, __ATOMIC_RELEASE);
+      if ( timing_locked )
+      {
+        ddi_fusion_uart_rx_timing_update(handle, cycle, timestamp_ns, status & DDI_FUSION_UART_STATUS_RX_BYTE_MASK);
+      }
+    }
+  }
+  if ( timing_locked )
+  {
+    ddi_fusion_uart_rx_timing_unlock(em_handle);
+  }
+  pthread_mutex_unlock(&master->lock);
+}
+
+// Return the mirrored status word of a UART handle if it is younger than max_age_ns
+static bool get_status_mirror (uart_instance *instance, uint64_t max_age_ns, uint16_t *status, uint64_t *timestamp_ns, uint64_t *age_ns)
+{
+  uart_input_pd_mapping *mapping = get_pd_mapping(instance);
+  uint64_t timestamp, now_ns;
+
+  // The timestamp is read first, the status is then at least as recent as the timestamp
+  timestamp = __atomic_load_n(&mapping->status_timestamp_ns, __ATOMIC_ACQUIRE);
+  if ( timestamp == 0 )
+  {
+    return false;
+  }
+  *status = __atomic_load_n(&mapping->status, __ATOMIC_RELAXED);
+  now_ns = ddi_fusion_uart_time_ns();
+  *age_ns = (now_ns > timestamp) ? now_ns - timestamp : 0;
+  *timestamp_ns = timestamp;
+  return *age_ns <= max_age_ns;
+}
+
 // Return a UART process data descriptor pointer
-fusion_pd_desc_t* ddi_fusion_uart_get_pd_desc(uint16_t uart_physical_channel)
+fusion_pd_desc_t* ddi_fusion_uart_get_pd_desc(ddi_em_handle em_handle, uint16_t uart_physical_channel)
 {
-  return &g_uart_pd_mapping[uart_physical_channel].uart_pd_desc;
+  return &g_uart_pd_mapping[em_handle][uart_physical_channel].uart_pd_desc;
+}
+
+#ifdef DDI_EM_TEST_STANDIN // Only built into the library variant the hardware-free tests link
+// Map the status words of a UART module to a stand-in image, channel n reads the nth word
+ddi_em_result ddi_fusion_uart_map_standin_status (ddi_em_handle em_handle, uint16_t index, uint16_t physical_channel, uint16_t *status_image)
+{
+  fusion_pd_desc_t *desc;
+  uint16_t channel;
+  VALIDATE_INSTANCE(em_handle);
+  if ( ((index & DDI_FUSION_UART_CONFIG_SDO_INDEX) != DDI_FUSION_UART_CONFIG_SDO_INDEX) ||
+       (physical_channel % MAX_NUMBER_UART_PER_MODULE != 0) || (physical_channel >= MAX_UART_PHYSICAL_CHANNELS) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  for ( channel = 0; channel < MAX_NUMBER_UART_PER_MODULE; channel++ )
+  {
+    desc = ddi_fusion_uart_get_pd_desc(em_handle, physical_channel + channel);
+    memset(desc, 0, sizeof(fusion_pd_desc_t));
+    desc->pd_input = (uint8_t *)status_image;
+    desc->byte_offset = channel * sizeof(uint16_t);
+    desc->hi = 15;
+    desc->mask = 0xFFFF;
+    desc->size = sizeof(uint16_t);
+    ddi_fusion_uart_map_slot_to_channel(em_handle, (index / DDI_FUSION_SLOT_INCREMENT) & 0xFF, physical_channel + channel);
+  }
+  return DDI_EM_STATUS_OK;
 }
+#endif // DDI_EM_TEST_STANDIN
 
 // Check for UART events
 ddi_em_result ddi_fusion_uart_check_for_events (ddi_em_handle em_handle)
 {
+  uart_master_handles *master = &g_uart_masters[em_handle];
   uint8_t is_event_registered = false;
-  uint16_t uart_count = 0;
+  uint32_t slot, count;
   uart_instance *uart_instance_ptr;
   fusion_pd_desc_t *uart_desc_ptr;
+  ddi_fusion_uart_handle *handles;
+
+  if ( !try_lock_master_handles(em_handle) )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  // The event callbacks may open or close UART handles, they run from a copy of the list after the lock is released.
+  // The copy only grows when the list did, if it can't grow the handles past its end are checked in a later cycle.
+  if ( master->count > master->event_capacity )
+  {
+    handles = (ddi_fusion_uart_handle *)realloc(master->event_handles, master->capacity * sizeof(ddi_fusion_uart_handle));
+    if ( handles != NULL )
+    {
+      master->event_handles = handles;
+      master->event_capacity = master->capacity;
+    }
+  }
+  count = (master->count < master->event_capacity) ? master->count : master->event_capacity;
+  if ( count != 0 )
+  {
+    memcpy(master->event_handles, master->handles, count * sizeof(ddi_fusion_uart_handle));
+  }
 
-  // Check for UART events - iterate through all UART instances
-  for ( uart_count = 0; uart_count < MAX_UART_INSTANCES; uart_count++ )
+  // Signal the event file descriptors of this master instance. The lock is never waited for in the cyclic thread, while
+  // a handle enables or disables its fd the edges are detected on the next cycle
+  if ( __atomic_load_n(&g_uart_fd_count, __ATOMIC_ACQUIRE) && (pthread_mutex_trylock(&g_uart_fd_lock) == 0) )
   {
-    uart_instance_ptr = &g_uart_instance[uart_count];
-    uart_desc_ptr = &g_uart_pd_mapping[g_uart_instance[uart_count].uart_physical_channel].uart_pd_desc;
+    for ( slot = 0; slot < master->count; slot++ )
+    {
+      uart_instance_ptr = get_uart_instance(master->handles[slot]);
+      uart_desc_ptr = &get_pd_mapping(uart_instance_ptr)->uart_pd_desc;
+      if ( (uart_instance_ptr->event_fd >= 0) && (uart_desc_ptr->pd_input != NULL) )
+      {
+        signal_uart_fd_events(uart_instance_ptr, uart_desc_ptr);
+      }
+    }
+    pthread_mutex_unlock(&g_uart_fd_lock);
+  }
+  pthread_mutex_unlock(&master->lock);
+
+  // Check for UART events - iterate through the UART instances of this master instance
+  for ( slot = 0; slot < count; slot++ )
+  {
+    uart_instance_ptr = get_uart_instance(master->event_handles[slot]);
+    // A callback of an earlier handle may have closed this one
+    if ( !uart_instance_ptr->is_allocated || (uart_instance_ptr->em_handle != em_handle) )
+    {
+      continue;
+    }
+    uart_desc_ptr = &get_pd_mapping(uart_instance_ptr)->uart_pd_desc;
 
     // Determine if the UART event handling is registered for this event
     is_event_registered = uart_instance_ptr->error_event_registered | uart_instance_ptr->threshold_event_registered;
-    if (uart_instance_ptr->is_allocated && is_event_registered)
+    if ( is_event_registered && (uart_desc_ptr->pd_input != NULL) )
     {
       // Detect any new UART events or errors using the process data allocated for this channel
       handle_uart_events(uart_instance_ptr, uart_desc_ptr);
@@ -311,6 +702,24 @@ ddi_em_result ddi_fusion_uart_check_for_events (ddi_em_handle em_handle)
   return DDI_EM_STATUS_OK;
 }
 
+// Are there UART handles with an event file descriptor?
+bool ddi_fusion_uart_is_event_fd_enabled (void)
+{
+  return __atomic_load_n(&g_uart_fd_count, __ATOMIC_ACQUIRE) != 0;
+}
+
+// Close the event file descriptor of a UART handle, called with the fd lock held
+static void close_uart_event_fd (uart_instance *uart_instance_ptr)
+{
+  if ( uart_instance_ptr->event_fd >= 0 )
+  {
+    close(uart_instance_ptr->event_fd);
+    uart_instance_ptr->event_fd = -1;
+    uart_instance_ptr->fd_event_flags = 0;
+    __atomic_fetch_sub(&g_uart_fd_count, 1, __ATOMIC_ACQ_REL);
+  }
+}
+
 // Open a UART handle
 ddi_em_result ddi_fusion_uart_open (ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uart_channel channel,
                                       uint32_t flags, ddi_fusion_uart_handle *handle)
@@ -318,6 +727,7 @@ ddi_em_result ddi_fusion_uart_open (ddi_em_handle em_handle, ddi_es_handle es_ha
   uint uart_instance_count = 0;
   ddi_em_result result;
   ddi_fusion_uart_handle uart_handle;
+  uart_instance *instance;
   // Validate the master instance
   VALIDATE_INSTANCE(em_handle);
   // Validate the return parameter has a valid address
@@ -347,103 +757,209 @@ ddi_em_result ddi_fusion_uart_open (ddi_em_handle em_handle, ddi_es_handle es_ha
     ELOG(em_handle, "No available UART channels were detected \n");
     return result;
   }
-  *handle = uart_handle;
-  g_uart_instance[uart_handle].config_index  = index;     // e.g., 5005
-  g_uart_instance[uart_handle].info_index    = index + 1; // e.g., 5006
-  g_uart_instance[uart_handle].tx_index_base = index + 2; // e.g., 5007
-  g_uart_instance[uart_handle].rx_index_base = index + 6; // e.g., 500B
-  g_uart_instance[uart_handle].es_handle     = es_handle;
-  g_uart_instance[uart_handle].em_handle     = em_handle;
-  g_uart_instance[uart_handle].channel       = channel;
-
-  // Map the physical channel that matches this UART instance
-  for ( uart_instance_count = 0; uart_instance_count < MAX_UART_INSTANCES; uart_instance_count++)
+  instance = get_uart_instance(uart_handle);
+  instance->config_index  = index;     // e.g., 5005
+  instance->info_index    = index + 1; // e.g., 5006
+  instance->tx_index_base = index + 2; // e.g., 5007
+  instance->rx_index_base = index + 6; // e.g., 500B
+  instance->es_handle     = es_handle;
+  instance->em_handle     = em_handle;
+  instance->channel       = channel;
+
+  // Map the physical channel of this master instance that matches this UART instance
+  for ( uart_instance_count = 0; uart_instance_count < MAX_UART_PHYSICAL_CHANNELS; uart_instance_count++)
   {
     uint16_t slot = (index / DDI_FUSION_SLOT_INCREMENT) & 0xFF; // Calculate the slot number
-    if (g_uart_pd_mapping[uart_instance_count].slot == slot)
+    if (g_uart_pd_mapping[em_handle][uart_instance_count].slot == slot)
     {
       // Found an matching physical uart channel
-      g_uart_instance[uart_handle].uart_physical_channel = uart_instance_count + channel;
+      instance->uart_physical_channel = uart_instance_count + channel;
       break;
     }
   }
+
+  // The transmit channel is in place before the scheduler thread can find the handle in the list
+  result = ddi_fusion_uart_tx_attach(uart_handle, em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    release_uart_instance(uart_handle);
+    return result;
+  }
+  // The cyclic thread of the master instance picks the handle up once it is complete
+  result = link_master_handle(em_handle, uart_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    ELOG(em_handle, "No memory for the UART handle list \n");
+    ddi_fusion_uart_tx_detach(uart_handle);
+    release_uart_instance(uart_handle);
+    return result;
+  }
+  ddi_fusion_uart_rx_timing_attach(uart_handle, em_handle);
+  *handle = uart_handle;
   return DDI_EM_STATUS_OK;
 }
 
 // Close a UART handle
 ddi_em_result ddi_fusion_uart_close (ddi_fusion_uart_handle handle)
 {
-  g_uart_instance[handle].is_allocated = 0;
+  uart_instance *instance;
+  VALIDATE_UART_INSTANCE(handle);
+  instance = get_uart_instance(handle);
+  // A closed handle may already be on the free list
+  if ( !instance->is_allocated )
+  {
+    return DDI_EM_STATUS_OK;
+  }
+  ddi_fusion_uart_pty_detach(handle);
+  ddi_fusion_uart_lease_detach(handle);
+  ddi_fusion_uart_framing_detach(handle, instance->em_handle);
+  ddi_fusion_uart_tx_reset_channel(handle, instance->em_handle);
+  ddi_fusion_uart_rx_timing_detach(handle, instance->em_handle);
+  // The cyclic thread no longer looks at the handle once it is off the list
+  unlink_master_handle(instance->em_handle, handle);
+  pthread_mutex_lock(&g_uart_fd_lock);
+  close_uart_event_fd(instance);
+  pthread_mutex_unlock(&g_uart_fd_lock);
+  release_uart_instance(handle);
   return DDI_EM_STATUS_OK;
 }
 
-// Close a UART handle
-ddi_em_result ddi_fusion_uart_close_all_handles (void)
+// Close the UART handles of a master instance
+ddi_em_result ddi_fusion_uart_close_all_handles (ddi_em_handle em_handle)
 {
-  int count = 0;
-  for ( count = 0; count < MAX_UART_INSTANCES; count++)
+  ddi_fusion_uart_handle *handles = NULL;
+  uint32_t capacity = 0, count, index;
+
+  VALIDATE_INSTANCE(em_handle);
+  // Each close takes the list lock, the handles are closed from a copy of the list
+  count = ddi_fusion_uart_get_master_handles(em_handle, &handles, &capacity);
+  for ( index = 0; index < count; index++ )
   {
-    g_uart_instance[count].is_allocated = 0;
+    ddi_fusion_uart_close(handles[index]);
   }
+  free(handles);
   return DDI_EM_STATUS_OK;
 }
 
-// Transmit data to a UART channel, use complete access (starting the write from subindex 0)
-EM_API ddi_em_result ddi_fusion_uart_tx_data (ddi_fusion_uart_handle handle, uint8_t *source_buffer, uint32_t tx_length)
+// Write data to the Tx object of a UART handle, use complete access (starting the write from subindex 0)
+ddi_em_result ddi_fusion_uart_write_tx_data (ddi_fusion_uart_handle handle, const uint8_t *data, uint32_t length)
 {
-  ddi_em_result result;
-  uint16_t *SI0;
   // Copy the transmitted data into a contiguous buffer so the write can be used staring from SI0
-  uint8_t tx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX + SIZEOF_SI0];
+  uint8_t tx_data[UART_SDO_IMAGE_SIZE];
+  memcpy(&tx_data[SIZEOF_SI0], data, length);
+  return ddi_fusion_uart_write_tx_image(handle, tx_data, length);
+}
+
+// Write up to 255 bytes that follow room for SI0 to the Tx object of a UART handle, the image is sent in place
+ddi_em_result ddi_fusion_uart_write_tx_image (ddi_fusion_uart_handle handle, uint8_t *image, uint32_t length)
+{
+  uint16_t *SI0;
   uart_instance *instance;
   uint16_t tx_index;
-  instance = &g_uart_instance[handle];
-  if ( (tx_length > DDI_FUSION_UART_SDO_DATA_SIZE_MAX) || (source_buffer == NULL) )
-  {
-    return DDI_EM_STATUS_INVALID_ARG;
-  }
+  instance = get_uart_instance(handle);
   // Calculate the Tx index from the base tx index plus the channel number
   tx_index = instance->tx_index_base + instance->channel;
   // Set Subindex 0 to the size of the transmit
-  SI0 = (uint16_t *)tx_data;
-  *SI0 = tx_length;
-  memcpy(&tx_data[SIZEOF_SI0], source_buffer, tx_length);
+  SI0 = (uint16_t *)image;
+  *SI0 = length;
   // Write the UART Tx data
-  result = ddi_em_coe_write(instance->em_handle, instance->es_handle, tx_index, 0, tx_data, tx_length + SIZEOF_SI0, UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
-  return result;
+  return ddi_em_coe_write(instance->em_handle, instance->es_handle, tx_index, 0, image, length + SIZEOF_SI0, UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
 }
 
-// Transmit data from a UART channel, use complete access (starting the read from subindex 0)
-EM_API ddi_em_result ddi_fusion_uart_rx_data (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length)
+// Return the EtherCAT master handle of an open UART handle
+ddi_em_result ddi_fusion_uart_get_em_handle (ddi_fusion_uart_handle handle, ddi_em_handle *em_handle)
+{
+  if ( !get_uart_instance(handle)->is_allocated )
+  {
+    return DDI_EM_STATUS_INVALID_INSTANCE;
+  }
+  *em_handle = get_uart_instance(handle)->em_handle;
+  return DDI_EM_STATUS_OK;
+}
+
+// Return the event callback registered on an open UART handle
+ddi_em_result ddi_fusion_uart_get_event_callback (ddi_fusion_uart_handle handle, ddi_uart_event_func **callback, void **user_data)
+{
+  if ( !get_uart_instance(handle)->is_allocated )
+  {
+    return DDI_EM_STATUS_INVALID_INSTANCE;
+  }
+  *callback = get_uart_instance(handle)->event_callback;
+  *user_data = get_uart_instance(handle)->event_user_data;
+  return DDI_EM_STATUS_OK;
+}
+
+// Transmit data to a UART channel, through the transmit scheduler of the master instance when it is running
+EM_API ddi_em_result ddi_fusion_uart_tx_data (ddi_fusion_uart_handle handle, uint8_t *source_buffer, uint32_t tx_length)
+{
+  uart_instance *instance;
+  instance = get_uart_instance(handle);
+  if ( (tx_length > DDI_FUSION_UART_SDO_DATA_SIZE_MAX) || (source_buffer == NULL) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  if ( ddi_fusion_uart_tx_is_scheduled(instance->em_handle) )
+  {
+    return ddi_fusion_uart_tx_send_wait(handle, instance->em_handle, source_buffer, tx_length);
+  }
+  return ddi_fusion_uart_write_tx_data(handle, source_buffer, tx_length);
+}
+
+// Read up to 255 bytes from the Rx object of a UART handle, use complete access (starting the read from subindex 0)
+ddi_em_result ddi_fusion_uart_read_rx_data (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length, uint64_t *rx_position)
 {
   ddi_em_result result;
-  uint32_t length;
   // Copy the received data into a contiguous buffer so the amount of bytes read can be determined from SI0
-  uint8_t rx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX + SIZEOF_SI0];
-  uart_instance *instance;
-  uint16_t rx_index, *SI0;
-  instance = &g_uart_instance[handle];
+  uint8_t rx_data[UART_SDO_IMAGE_SIZE];
   if ( (dest_buffer == NULL) || ( rx_length == NULL ) )
   {
     return DDI_EM_STATUS_INVALID_ARG;
   }
+  result = ddi_fusion_uart_read_rx_image(handle, rx_data, rx_length, rx_position);
+  if ( result == DDI_EM_STATUS_OK )
+  {
+    // Copy the read bytes
+    memcpy(dest_buffer, &rx_data[SIZEOF_SI0], *rx_length);
+  }
+  return result;
+}
+
+// Read up to 255 bytes from the Rx object of a UART handle into an image, the bytes follow SI0
+ddi_em_result ddi_fusion_uart_read_rx_image (ddi_fusion_uart_handle handle, uint8_t *image, uint32_t *rx_length, uint64_t *rx_position)
+{
+  ddi_em_result result;
+  uint32_t length;
+  uart_instance *instance;
+  uint16_t rx_index, *SI0;
+  uint64_t position;
+  instance = get_uart_instance(handle);
 
   rx_index = instance->rx_index_base + instance->channel;
   // Read the UART Rx data
-  result = ddi_em_coe_read(instance->em_handle, instance->es_handle, rx_index, 0, rx_data,
-    DDI_FUSION_UART_SDO_DATA_SIZE_MAX + SIZEOF_SI0, &length, UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
+  result = ddi_em_coe_read(instance->em_handle, instance->es_handle, rx_index, 0, image,
+    UART_SDO_IMAGE_SIZE, &length, UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
   if ( result == DDI_EM_STATUS_OK )
   {
     // Copy the amount of bytes back read in SI0
-    SI0 = (uint16_t *)rx_data;
+    SI0 = (uint16_t *)image;
     // Set the received length to the value in SI0
     *rx_length = *(uint8_t *)SI0;
-    // Copy the read bytes
-    memcpy(dest_buffer, &rx_data[SIZEOF_SI0], *rx_length);
+    // Keep the receive timeline in step with the bytes read
+    position = ddi_fusion_uart_rx_timing_consume(handle, instance->em_handle, *rx_length);
+    if ( rx_position != NULL )
+    {
+      *rx_position = position;
+    }
   }
   return result;
 }
 
+// Transmit data from a UART channel
+EM_API ddi_em_result ddi_fusion_uart_rx_data (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length)
+{
+  return ddi_fusion_uart_read_rx_data(handle, dest_buffer, rx_length, NULL);
+}
+
 // Return a 16-bit status reading of the object at index.subindex
 static ddi_em_result get_uart_status (ddi_fusion_uart_handle handle, uint16_t *status)
 {
@@ -451,11 +967,11 @@ static ddi_em_result get_uart_status (ddi_fusion_uart_handle handle, uint16_t *s
   uint32_t len;
   uart_instance *instance;
   uint16_t si;
-  instance = &g_uart_instance[handle];
+  instance = get_uart_instance(handle);
   si = DDI_FUSION_UART_STATUS_CH0_SI + instance->channel;
   // Write the parameter selection
   result = ddi_em_coe_read(instance->em_handle, instance->es_handle, instance->info_index, si,
-   (uint8_t *)status, sizeof(status), &len, UART_DEFAULT_TIMEOUT_MS, 0);
+   (uint8_t *)status, sizeof(*status), &len, UART_DEFAULT_TIMEOUT_MS, 0);
   if ( result != DDI_EM_STATUS_OK )
   {
     return result;
@@ -463,22 +979,15 @@ static ddi_em_result get_uart_status (ddi_fusion_uart_handle handle, uint16_t *s
   return result;
 }
 
-// Return a 8-bit status/control reading of the object at index.subindex
-static ddi_em_result get_uart_control (ddi_fusion_uart_handle handle, uint8_t *param)
+// Return the 8-bit error details of the object at index.subindex
+static ddi_em_result get_uart_error_details (ddi_fusion_uart_handle handle, uint8_t *error_details)
 {
-  ddi_em_result result;
   uint32_t len;
   uart_instance *instance;
   uint16_t si;
-  instance = &g_uart_instance[handle];
-  si = DDI_FUSION_UART_CONTROL_CH0_SI + instance->channel;
-  // Write the parameter selection
-  result = ddi_em_coe_read(instance->em_handle, instance->es_handle, instance->info_index, si, param, sizeof(param), &len, UART_DEFAULT_TIMEOUT_MS, 0);
-  if ( result != DDI_EM_STATUS_OK )
-  {
-    return result;
-  }
-  return result;
+  instance = get_uart_instance(handle);
+  si = DDI_FUSION_UART_ERR_DETAILS_CH0_SI + instance->channel;
+  return ddi_em_coe_read(instance->em_handle, instance->es_handle, instance->info_index, si, error_details, sizeof(uint8_t), &len, UART_DEFAULT_TIMEOUT_MS, 0);
 }
 
 // Set a 8-bit control paramter of the object at index.subindex
@@ -487,7 +996,7 @@ static ddi_em_result set_uart_control (ddi_fusion_uart_handle handle, uint8_t pa
   ddi_em_result result;
   uart_instance *instance;
   uint16_t si;
-  instance = &g_uart_instance[handle];
+  instance = get_uart_instance(handle);
   si = DDI_FUSION_UART_CONTROL_CH0_SI + instance->channel;
   // Write the parameter selection
   result = ddi_em_coe_write(instance->em_handle, instance->es_handle, instance->info_index, si, &param, sizeof(uint8_t), UART_DEFAULT_TIMEOUT_MS, 0);
@@ -505,7 +1014,7 @@ static ddi_em_result set_uart_config (ddi_fusion_uart_handle handle, uint16_t su
   ddi_em_result result;
   uart_instance *instance;
   uint16_t config_subindex;
-  instance = &g_uart_instance[handle];
+  instance = get_uart_instance(handle);
   // Calculate the configuration subindex using the subindex base + channel index being indexed
   config_subindex = subindex + instance->channel * SIZEOF_5005_CHANNEL;
   // Write the parameter selection
@@ -528,10 +1037,10 @@ static ddi_em_result get_uart_config (ddi_fusion_uart_handle handle, uint16_t su
   uint16_t config_subindex;
   if ( param == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Param argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "Param argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
-  instance = &g_uart_instance[handle];
+  instance = get_uart_instance(handle);
   // Calculate the configuration subindex using the subindex base + channel index being indexed
   config_subindex = subindex + instance->channel * SIZEOF_5005_CHANNEL;
   // Read the UART Parameter
@@ -544,6 +1053,180 @@ static ddi_em_result get_uart_config (ddi_fusion_uart_handle handle, uint16_t su
   return result;
 }
 
+// Size of a complete access transfer of the 0x5nn5 object, the SI0 word followed by the settings of every channel
+#define UART_CONFIG_OBJECT_SIZE (SIZEOF_SI0 + MAX_NUMBER_UART_PER_MODULE * SIZEOF_5005_CHANNEL)
+
+// Return the settings of a channel in a complete access image of the 0x5nn5 object, indexed by the subindex - 1
+static uint8_t *get_channel_config_entry (uint8_t *object, uart_channel channel)
+{
+  return &object[SIZEOF_SI0 + channel * SIZEOF_5005_CHANNEL];
+}
+
+// Check the settings of a channel configuration before they are written
+static bool is_channel_config_valid (const uart_channel_config *config)
+{
+  return ((uint32_t)config->interface <= UART_INTERFACE_RS485_WITH_TERMINATION_RESISTOR) && ((uint32_t)config->baud <= UART_BAUD_115200) &&
+         ((uint32_t)config->parity <= UART_PARITY_ODD) && ((uint32_t)config->data_bits <= UART_DATA_BITS_8) &&
+         ((uint32_t)config->stop_bits <= UART_STOP_BITS_2) && ((uint32_t)config->flow_control <= UART_FLOW_CONTROL_RTS_CTS);
+}
+
+// The progress of one channel of a configuration list transfer
+typedef struct {
+  ddi_em_result result;
+  bool          done;
+  bool          in_module;   // Belongs to the UART module being transferred
+} uart_config_transfer;
+
+// Read or write the configuration of a list of UART channels. The channels of one UART module share one complete access
+// read of the 0x5nn5 object, the settings of the listed channels are then copied out of it or into it and written back
+// in one complete access write. The read keeps the settings of the channels not in the list.
+static ddi_em_result transfer_config_list (const ddi_fusion_uart_handle *handles, uart_channel_config *configs, uint32_t count,
+                                           ddi_em_result *results, bool write)
+{
+  uint8_t object[UART_CONFIG_OBJECT_SIZE], *entry;
+  uart_config_transfer *transfers;
+  ddi_em_result result, first_error = DDI_EM_STATUS_OK;
+  uart_instance *module, *instance;
+  uint32_t first, index, length;
+  bool is_written;
+
+  if ( (handles == NULL) || (configs == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( (count == 0) || (count > MAX_UART_INSTANCES) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  // A list can hold every UART handle, the per channel state is kept off the stack
+  transfers = (uart_config_transfer *)calloc(count, sizeof(uart_config_transfer));
+  if ( transfers == NULL )
+  {
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  for ( index = 0; index < count; index++ )
+  {
+    if ( (handles[index] < 0) || ((uint32_t)handles[index] >= ddi_fusion_uart_get_handle_limit()) || !get_uart_instance(handles[index])->is_allocated )
+    {
+      transfers[index].result = DDI_EM_STATUS_INVALID_INSTANCE;
+      transfers[index].done = true;
+    }
+    else if ( write && !is_channel_config_valid(&configs[index]) )
+    {
+      transfers[index].result = DDI_EM_STATUS_INVALID_ARG;
+      transfers[index].done = true;
+    }
+  }
+
+  for ( first = 0; first < count; first++ )
+  {
+    if ( transfers[first].done )
+    {
+      continue;
+    }
+    // Collect the channels of this UART module
+    module = get_uart_instance(handles[first]);
+    for ( index = first; index < count; index++ )
+    {
+      instance = get_uart_instance(handles[index]);
+      transfers[index].in_module = !transfers[index].done && (instance->em_handle == module->em_handle) &&
+                                   (instance->es_handle == module->es_handle) && (instance->config_index == module->config_index);
+    }
+
+    result = ddi_em_coe_read(module->em_handle, module->es_handle, module->config_index, 0, object, sizeof(object), &length,
+                             UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
+    if ( (result == DDI_EM_STATUS_OK) && (length < sizeof(object)) )
+    {
+      ELOG(module->em_handle, "UART configuration 0x%04x: complete access read returned %u bytes\n", module->config_index, length);
+      result = DDI_EM_STATUS_INVALID_SIZE;
+    }
+    is_written = false;
+    for ( index = first; index < count; index++ )
+    {
+      if ( !transfers[index].in_module )
+      {
+        continue;
+      }
+      entry = get_channel_config_entry(object, get_uart_instance(handles[index])->channel);
+      if ( (result == DDI_EM_STATUS_OK) && write )
+      {
+        entry[DDI_FUSION_UART_CONFIG_INTERFACE_SI - SIO_OFFSET]    = (uint8_t)configs[index].interface;
+        entry[DDI_FUSION_UART_CONFIG_BAUD_SI - SIO_OFFSET]         = (uint8_t)configs[index].baud;
+        entry[DDI_FUSION_UART_CONFIG_PARITY_SI - SIO_OFFSET]       = (uint8_t)configs[index].parity;
+        entry[DDI_FUSION_UART_CONFIG_DATA_BITS_SI - SIO_OFFSET]    = (uint8_t)configs[index].data_bits;
+        entry[DDI_FUSION_UART_CONFIG_STOP_BITS_SI - SIO_OFFSET]    = (uint8_t)configs[index].stop_bits;
+        entry[DDI_FUSION_UART_CONFIG_FLOW_CONTROL_SI - SIO_OFFSET] = (uint8_t)configs[index].flow_control;
+        is_written = true;
+      }
+      else if ( result == DDI_EM_STATUS_OK )
+      {
+        configs[index].interface    = (uart_interface)entry[DDI_FUSION_UART_CONFIG_INTERFACE_SI - SIO_OFFSET];
+        configs[index].baud         = (uart_baud)entry[DDI_FUSION_UART_CONFIG_BAUD_SI - SIO_OFFSET];
+        configs[index].parity       = (uart_parity)entry[DDI_FUSION_UART_CONFIG_PARITY_SI - SIO_OFFSET];
+        configs[index].data_bits    = (uart_data_bits)entry[DDI_FUSION_UART_CONFIG_DATA_BITS_SI - SIO_OFFSET];
+        configs[index].stop_bits    = (uart_stop_bits)entry[DDI_FUSION_UART_CONFIG_STOP_BITS_SI - SIO_OFFSET];
+        configs[index].flow_control = (uart_flow_control)entry[DDI_FUSION_UART_CONFIG_FLOW_CONTROL_SI - SIO_OFFSET];
+      }
+    }
+    if ( is_written )
+    {
+      result = ddi_em_coe_write(module->em_handle, module->es_handle, module->config_index, 0, object, sizeof(object),
+                                UART_DEFAULT_TIMEOUT_MS, UART_COMPLETE_ACCESS);
+    }
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      ELOG(module->em_handle, "Error %s UART configuration 0x%04x: %s \n", write ? "writing" : "reading", module->config_index,
+           ddi_em_get_error_string(result));
+    }
+    for ( index = first; index < count; index++ )
+    {
+      if ( transfers[index].in_module )
+      {
+        transfers[index].result = result;
+        transfers[index].done = true;
+      }
+    }
+  }
+
+  for ( index = 0; index < count; index++ )
+  {
+    if ( results != NULL )
+    {
+      results[index] = transfers[index].result;
+    }
+    if ( (transfers[index].result != DDI_EM_STATUS_OK) && (first_error == DDI_EM_STATUS_OK) )
+    {
+      first_error = transfers[index].result;
+    }
+  }
+  free(transfers);
+  return first_error;
+}
+
+// Set the complete configuration of a UART channel
+EM_API ddi_em_result ddi_fusion_uart_apply_config (ddi_fusion_uart_handle handle, const uart_channel_config *config)
+{
+  return transfer_config_list(&handle, (uart_channel_config *)config, 1, NULL, true);
+}
+
+// Get the complete configuration of a UART channel
+EM_API ddi_em_result ddi_fusion_uart_read_config (ddi_fusion_uart_handle handle, uart_channel_config *config)
+{
+  return transfer_config_list(&handle, config, 1, NULL, false);
+}
+
+// Set the configuration of several UART channels, one read and one write per UART module
+EM_API ddi_em_result ddi_fusion_uart_apply_config_list (const ddi_fusion_uart_handle *handles, const uart_channel_config *configs, uint32_t count, ddi_em_result *results)
+{
+  return transfer_config_list(handles, (uart_channel_config *)configs, count, results, true);
+}
+
+// Get the configuration of several UART channels, one read per UART module
+EM_API ddi_em_result ddi_fusion_uart_read_config_list (const ddi_fusion_uart_handle *handles, uart_channel_config *configs, uint32_t count, ddi_em_result *results)
+{
+  return transfer_config_list(handles, configs, count, results, false);
+}
+
 // Set a UART baud rate
 EM_API ddi_em_result ddi_fusion_uart_set_baud (ddi_fusion_uart_handle handle, uart_baud baud)
 {
@@ -551,7 +1234,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_baud (ddi_fusion_uart_handle handle, ua
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_BAUD_SI, (uint8_t)baud);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting baud rate: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting baud rate: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -562,13 +1245,13 @@ EM_API ddi_em_result ddi_fusion_uart_get_baud (ddi_fusion_uart_handle handle, ua
   ddi_em_result result;
   if ( baud == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_baud: baud rate NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_baud: baud rate NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_BAUD_SI, (uint8_t*)baud);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting baud rate: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting baud rate: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -580,7 +1263,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_interface (ddi_fusion_uart_handle handl
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_INTERFACE_SI, (uint8_t)interface);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART interface: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART interface: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -591,13 +1274,13 @@ EM_API ddi_em_result ddi_fusion_uart_get_interface (ddi_fusion_uart_handle handl
   ddi_em_result result;
   if ( interface == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_interface: Argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_interface: Argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_INTERFACE_SI, (uint8_t*)interface);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART interface: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART interface: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -609,7 +1292,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_parity_mode (ddi_fusion_uart_handle han
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_PARITY_SI, (uint8_t)parity);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART parity: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART parity: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -621,12 +1304,12 @@ EM_API ddi_em_result ddi_fusion_uart_get_parity_mode (ddi_fusion_uart_handle han
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_PARITY_SI, (uint8_t*)parity);
   if ( parity == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_parity_mode: Argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_parity_mode: Argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART parity: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART parity: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -638,7 +1321,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_stop_bits (ddi_fusion_uart_handle handl
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_STOP_BITS_SI, (uint8_t)stop_bits);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART interface: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART interface: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -649,13 +1332,13 @@ EM_API ddi_em_result ddi_fusion_uart_get_stop_bits (ddi_fusion_uart_handle handl
   ddi_em_result result;
   if ( stop_bits == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_stop_bits: Argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_stop_bits: Argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_STOP_BITS_SI, (uint8_t*)stop_bits);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART parity: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART parity: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -667,7 +1350,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_data_bits (ddi_fusion_uart_handle handl
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_DATA_BITS_SI, (uint8_t)data_bits);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART data bits: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART data bits: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -678,13 +1361,13 @@ EM_API ddi_em_result ddi_fusion_uart_get_data_bits (ddi_fusion_uart_handle handl
   ddi_em_result result;
   if ( data_bits == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_data_bits: Argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_data_bits: Argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_DATA_BITS_SI, (uint8_t*)data_bits);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART data bits: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART data bits: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -696,7 +1379,7 @@ EM_API ddi_em_result ddi_fusion_uart_set_flow_control (ddi_fusion_uart_handle ha
   result = set_uart_config(handle, DDI_FUSION_UART_CONFIG_FLOW_CONTROL_SI, (uint8_t)flow_control);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART flow control: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART flow control: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -707,13 +1390,13 @@ EM_API ddi_em_result ddi_fusion_uart_get_flow_control (ddi_fusion_uart_handle ha
   ddi_em_result result;
   if ( flow_control == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "ddi_fusion_uart_get_flow_control: Argument NULL\n");
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_flow_control: Argument NULL\n");
     return DDI_EM_STATUS_INVALID_ARG;
   }
   result = get_uart_config(handle, DDI_FUSION_UART_CONFIG_FLOW_CONTROL_SI, (uint8_t*)flow_control);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting flow control: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting flow control: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
@@ -724,10 +1407,10 @@ EM_API ddi_em_result ddi_fusion_uart_channel_flush (ddi_fusion_uart_handle handl
   ddi_em_result result;
   // Don't update the control byte for the flush message, the flush is a one-time only message
   // that doesn't need to be retained in the UART channel instance
-  result = set_uart_control(handle, g_uart_instance[handle].control_byte | DDI_FUSION_UART_CONTROL_FLUSH);
+  result = set_uart_control(handle, get_uart_instance(handle)->control_byte | DDI_FUSION_UART_CONTROL_FLUSH);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error flushing UART channel: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error flushing UART channel: %s \n", ddi_em_get_error_string(result));
   }
   
   return result;
@@ -738,12 +1421,12 @@ EM_API ddi_em_result ddi_fusion_uart_set_transmit_hold (ddi_fusion_uart_handle h
 {
   ddi_em_result result;
   // Update the control byte to indicate the hold message, this state needs to be retained in the UART channel instance
-  g_uart_instance[handle].control_byte |= DDI_FUSION_UART_CONTROL_HOLD;
+  get_uart_instance(handle)->control_byte |= DDI_FUSION_UART_CONTROL_HOLD;
   // Send the control message to the UART channel
-  result = set_uart_control(handle, g_uart_instance[handle].control_byte);
+  result = set_uart_control(handle, get_uart_instance(handle)->control_byte);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART transmit hold: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART transmit hold: %s \n", ddi_em_get_error_string(result));
   }
 
   return result;
@@ -754,54 +1437,108 @@ EM_API ddi_em_result ddi_fusion_uart_enable_transmit (ddi_fusion_uart_handle han
 {
   ddi_em_result result;
   // Update the control byte to indicate the hold message, this state needs to be retained in the EtherCAT master SDK
-  g_uart_instance[handle].control_byte &= ~DDI_FUSION_UART_CONTROL_HOLD;
+  get_uart_instance(handle)->control_byte &= ~DDI_FUSION_UART_CONTROL_HOLD;
   // Send the control message to the UART channel
-  result = set_uart_control(handle, g_uart_instance[handle].control_byte);
+  result = set_uart_control(handle, get_uart_instance(handle)->control_byte);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART transmit hold: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error setting UART transmit hold: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
 
-// Enables transmit hold for a UART channel
+// Return the transmit hold status for a UART channel, the control byte is only changed by this SDK so no SDO is needed
 EM_API ddi_em_result ddi_fusion_uart_get_transmit_hold_status (ddi_fusion_uart_handle handle, uint8_t *is_hold_enabled)
 {
-  ddi_em_result result;
-  result = get_uart_control(handle, is_hold_enabled);
-  if ( result != DDI_EM_STATUS_OK )
+  VALIDATE_UART_INSTANCE(handle);
+  if ( is_hold_enabled == NULL )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART flow control: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_transmit_hold_status: Argument NULL\n");
+    return DDI_EM_STATUS_INVALID_ARG;
   }
-  return result;
+  *is_hold_enabled = (get_uart_instance(handle)->control_byte & DDI_FUSION_UART_CONTROL_HOLD) ? 1 : 0;
+  return DDI_EM_STATUS_OK;
 }
 
-// Retreives the error details for a UART channel
+// Retreives the error details for a UART channel, the details are only read while the status reports an error
 EM_API ddi_em_result ddi_fusion_uart_get_error_status (ddi_fusion_uart_handle handle, uint8_t *error_details)
 {
   ddi_em_result result;
-  result = get_uart_control(handle, error_details);
+  uint16_t status;
+  uint64_t timestamp_ns, age_ns;
+  VALIDATE_UART_INSTANCE(handle);
+  if ( error_details == NULL )
+  {
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_error_status: Argument NULL\n");
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  if ( get_status_mirror(get_uart_instance(handle), (uint64_t)DDI_FUSION_UART_STATUS_MAX_AGE_MS * NSEC_PER_MSEC, &status, &timestamp_ns, &age_ns) &&
+       !(status & DDI_FUSION_UART_STATUS_ERROR_CONDITION) )
+  {
+    *error_details = 0;
+    return DDI_EM_STATUS_OK;
+  }
+  result = get_uart_error_details(handle, error_details);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error getting UART error details: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART error details: %s \n", ddi_em_get_error_string(result));
   }
   return result;
 }
 
-// Retreives the Rx bytes available for a UART channel
+// Retreives the Rx bytes available for a UART channel, from the process data status while it is fresh
 EM_API ddi_em_result ddi_fusion_uart_get_rx_bytes_avail (ddi_fusion_uart_handle handle, uint16_t *bytes_avail)
 {
   ddi_em_result result;
   uint16_t status;
+  uint64_t timestamp_ns, age_ns;
+  VALIDATE_UART_INSTANCE(handle);
+  if ( bytes_avail == NULL )
+  {
+    ELOG(get_uart_instance(handle)->em_handle, "ddi_fusion_uart_get_rx_bytes_avail: Argument NULL\n");
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  if ( get_status_mirror(get_uart_instance(handle), (uint64_t)DDI_FUSION_UART_STATUS_MAX_AGE_MS * NSEC_PER_MSEC, &status, &timestamp_ns, &age_ns) )
+  {
+    *bytes_avail = status & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
+    return DDI_EM_STATUS_OK;
+  }
   result = get_uart_status(handle, &status);
   if ( result != DDI_EM_STATUS_OK )
   {
-    ELOG(g_uart_instance[handle].em_handle, "Error setting UART flow control: %s \n", ddi_em_get_error_string(result));
+    ELOG(get_uart_instance(handle)->em_handle, "Error getting UART Rx bytes available: %s \n", ddi_em_get_error_string(result));
+    return result;
   }
   *bytes_avail = status & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
   return result;
 }
 
+// Return the UART channel status mirrored from the process data
+EM_API ddi_em_result ddi_fusion_uart_get_status (ddi_fusion_uart_handle handle, ddi_fusion_uart_status *status)
+{
+  uint16_t status_word;
+  uint64_t timestamp_ns, age_ns;
+  VALIDATE_UART_INSTANCE(handle);
+  if ( status == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  // Any age is accepted, the caller decides from age_ns
+  if ( !get_uart_instance(handle)->is_allocated ||
+       !get_status_mirror(get_uart_instance(handle), UINT64_MAX, &status_word, &timestamp_ns, &age_ns) )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  status->status = status_word;
+  status->rx_bytes_avail = status_word & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
+  status->error = (status_word & DDI_FUSION_UART_STATUS_ERROR_CONDITION) ? 1 : 0;
+  status->tx_almost_full = (status_word & DDI_FUSION_UART_STATUS_TX_BUFFER_ALMOST_FULL) ? 1 : 0;
+  status->rx_almost_full = (status_word & DDI_FUSION_UART_STATUS_RX_BUFFER_ALMOST_FULL) ? 1 : 0;
+  status->timestamp_ns = timestamp_ns;
+  status->age_ns = age_ns;
+  return DDI_EM_STATUS_OK;
+}
+
 // Registers a UART event handler
 EM_API ddi_em_result ddi_fusion_uart_register_event (ddi_fusion_uart_handle handle, ddi_uart_event_func *callback, void *user_data)
 {
@@ -811,11 +1548,12 @@ EM_API ddi_em_result ddi_fusion_uart_register_event (ddi_fusion_uart_handle hand
   VALIDATE_UART_INSTANCE(handle);
 
   // Enable the UART channel in the is_uart_event_registered master field
-  sdk_handle = get_fusion_sdk_handle(g_uart_instance[handle].em_handle, g_uart_instance[handle].es_handle);
-  ddi_em_fusion_set_registered_uart_events(g_uart_instance[handle].em_handle, sdk_handle, 1 << handle);
+  sdk_handle = get_fusion_sdk_handle(get_uart_instance(handle)->em_handle, get_uart_instance(handle)->es_handle);
+  ddi_em_fusion_set_registered_uart_events(get_uart_instance(handle)->em_handle, sdk_handle,
+    1ULL << get_uart_instance(handle)->uart_physical_channel);
 
   // Register callback function and corresponding user data
-  uart_instance_ptr = &g_uart_instance[handle];
+  uart_instance_ptr = get_uart_instance(handle);
   uart_instance_ptr->event_callback = callback;
   uart_instance_ptr->event_user_data = user_data;
 
@@ -828,7 +1566,7 @@ EM_API ddi_em_result ddi_fusion_uart_enable_threshold_event (ddi_fusion_uart_han
 {
   uart_instance *uart_instance_ptr;
   VALIDATE_UART_INSTANCE(handle);
-  uart_instance_ptr = &g_uart_instance[handle];
+  uart_instance_ptr = get_uart_instance(handle);
   uart_instance_ptr->threshold_event_registered = DDI_EM_TRUE;
   uart_instance_ptr->threshold_event_level = threshold;
   uart_instance_ptr->threshold_event_flags |= (uint32_t)event_flags;
@@ -843,7 +1581,7 @@ EM_API ddi_em_result ddi_fusion_uart_disable_threshold_event (ddi_fusion_uart_ha
 
   VALIDATE_UART_INSTANCE(handle);
 
-  uart_instance_ptr = &g_uart_instance[handle];
+  uart_instance_ptr = get_uart_instance(handle);
   uart_instance_ptr->threshold_event_registered = DDI_EM_FALSE;
   uart_instance_ptr->threshold_event_flags &= ~event_flags;
   return DDI_EM_STATUS_OK;
@@ -857,7 +1595,7 @@ EM_API ddi_em_result ddi_fusion_uart_enable_error_event (ddi_fusion_uart_handle
 
   VALIDATE_UART_INSTANCE(handle);
 
-  uart_instance_ptr = &g_uart_instance[handle];
+  uart_instance_ptr = get_uart_instance(handle);
   uart_instance_ptr->error_event_registered = DDI_EM_TRUE;
   return DDI_EM_STATUS_OK;
 }
@@ -869,7 +1607,83 @@ EM_API ddi_em_result ddi_fusion_uart_disable_error_event (ddi_fusion_uart_handle
 
   VALIDATE_UART_INSTANCE(handle);
 
-  uart_instance_ptr = &g_uart_instance[handle];
+  uart_instance_ptr = get_uart_instance(handle);
   uart_instance_ptr->error_event_registered = DDI_EM_FALSE;
   return DDI_EM_STATUS_OK;
 }
+
+// Return a pollable event file descriptor for a UART channel
+EM_API ddi_em_result ddi_fusion_uart_enable_event_fd (ddi_fusion_uart_handle handle, uint32_t event_flags, uint16_t rx_threshold, int *fd)
+{
+  uart_instance *uart_instance_ptr;
+
+  VALIDATE_UART_INSTANCE(handle);
+
+  if ( fd == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  uart_instance_ptr = get_uart_instance(handle);
+  if ( !uart_instance_ptr->is_allocated )
+  {
+    return DDI_EM_STATUS_INVALID_INSTANCE;
+  }
+
+  pthread_mutex_lock(&g_uart_fd_lock);
+  if ( uart_instance_ptr->event_fd < 0 )
+  {
+    uart_instance_ptr->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if ( uart_instance_ptr->event_fd < 0 )
+    {
+      pthread_mutex_unlock(&g_uart_fd_lock);
+      ELOG(uart_instance_ptr->em_handle, "UART event fd: eventfd failed: %s\n", strerror(errno));
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+    __atomic_fetch_add(&g_uart_fd_count, 1, __ATOMIC_ACQ_REL);
+  }
+  // Restart the edge detection, conditions that are already present are signalled on the next cycle
+  uart_instance_ptr->fd_event_flags = event_flags;
+  uart_instance_ptr->fd_rx_threshold = rx_threshold ? rx_threshold : 1;
+  uart_instance_ptr->fd_prev_status_valid = 0;
+  *fd = uart_instance_ptr->event_fd;
+  pthread_mutex_unlock(&g_uart_fd_lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop signalling events for a UART channel and close its event file descriptor
+EM_API ddi_em_result ddi_fusion_uart_disable_event_fd (ddi_fusion_uart_handle handle)
+{
+  VALIDATE_UART_INSTANCE(handle);
+
+  pthread_mutex_lock(&g_uart_fd_lock);
+  close_uart_event_fd(get_uart_instance(handle));
+  get_uart_instance(handle)->fd_pending_events = 0;
+  pthread_mutex_unlock(&g_uart_fd_lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return and clear the events signalled on the event file descriptor of a UART channel
+EM_API ddi_em_result ddi_fusion_uart_get_fd_events (ddi_fusion_uart_handle handle, uint32_t *events)
+{
+  uart_instance *uart_instance_ptr;
+  uint64_t count;
+
+  VALIDATE_UART_INSTANCE(handle);
+
+  if ( events == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  uart_instance_ptr = get_uart_instance(handle);
+  if ( uart_instance_ptr->event_fd < 0 )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  // Reset the eventfd before taking the events, an event set in between writes the eventfd again
+  if ( read(uart_instance_ptr->event_fd, &count, sizeof(count)) < 0 && (errno != EAGAIN) )
+  {
+    return DDI_EM_STATUS_FILE_OPEN_ERR;
+  }
+  *events = __atomic_exchange_n(&uart_instance_ptr->fd_pending_events, 0, __ATOMIC_ACQ_REL);
+  return DDI_EM_STATUS_OK;
+}
@@ -15,9 +15,12 @@ prior written authorization of DDI is prohibited.
 #include "ddi_em_translate.h"
 #include "ddi_em_fusion_uart_api.h"
 #include "ddi_em_pd.h"
+#include "ddi_ntime.h"
 
-// There are 64 UART handles total in Version 1.3 across all EtherCAT Master handles
-#define MAX_UART_INSTANCES 64
+// UART handles are shared by all EtherCAT Master handles, up to DDI_FUSION_UART_MAX_HANDLES are open at once
+#define MAX_UART_INSTANCES DDI_FUSION_UART_MAX_HANDLES
+// Physical UART channels per master instance
+#define MAX_UART_PHYSICAL_CHANNELS 64
 
 #define UART_DEFAULT_TIMEOUT_MS 100
 // Each 5nn5 channel has 7 channels
@@ -26,20 +29,50 @@ prior written authorization of DDI is prohibited.
 
 #define UART_COMPLETE_ACCESS 1
 #define SIZEOF_SI0 (sizeof(uint16_t))
+// A complete access image of a Tx or Rx object, SI0 followed by up to 255 bytes
+#define UART_SDO_IMAGE_SIZE (DDI_FUSION_UART_SDO_DATA_SIZE_MAX + SIZEOF_SI0)
+
+/** ddi_fusion_uart_time_ns
+ @brief Return the time in nanoseconds on the clock of ddi_ntime_get_systime(), the time base of the UART statistics and timeouts
+ @return The current time in nanoseconds
+ */
+static inline uint64_t ddi_fusion_uart_time_ns(void)
+{
+  ntime_t now;
+
+  ddi_ntime_get_systime(&now);
+  return (uint64_t)now.sec * NSEC_PER_SEC + now.ns;
+}
 
 /** ddi_fusion_uart_get_pd_desc
  @brief Return the process data copy for the physical UART channel
+ @param[in] em_handle The EtherCAT Master handle
  @param[in] The UART physical channel (0 to 63)
  @return The fusion process data pointer for this physical UART channel
  */
-fusion_pd_desc_t* ddi_fusion_uart_get_pd_desc(uint16_t uart_physical_channel);
+fusion_pd_desc_t* ddi_fusion_uart_get_pd_desc(ddi_em_handle em_handle, uint16_t uart_physical_channel);
 
 /** ddi_fusion_uart_map_slot_to_channel
  @brief Map the UART EtherCAT slot to a physical UART channel
+ @param[in] em_handle The EtherCAT Master handle
  @param[in] index The UART EtherCAT index
  @param[in] uart_channel The UART channel
  */
-void ddi_fusion_uart_map_slot_to_channel(uint16_t index, uint16_t uart_channel);
+void ddi_fusion_uart_map_slot_to_channel(ddi_em_handle em_handle, uint16_t index, uint16_t uart_channel);
+
+/** ddi_fusion_uart_get_handle_limit
+ @brief Return the number of UART handles allocated so far, open or closed. Every UART handle is below it.
+ */
+uint32_t ddi_fusion_uart_get_handle_limit (void);
+
+/** ddi_fusion_uart_get_master_handles
+ @brief Copy the open UART handles of a master instance. Waits for the handle list lock, not for the cyclic thread.
+ @param[in] em_handle The EtherCAT Master handle
+ @param[in,out] handles The caller's buffer, grown as needed, freed by the caller
+ @param[in,out] capacity The number of handles the buffer holds
+ @return uint32_t The number of handles copied, fewer than open if the buffer can't grow
+ */
+uint32_t ddi_fusion_uart_get_master_handles (ddi_em_handle em_handle, ddi_fusion_uart_handle **handles, uint32_t *capacity);
 
 /** ddi_fusion_uart_check_for_events
  @brief Check for UART events on the given EtherCAT Master handle
@@ -47,15 +80,77 @@ void ddi_fusion_uart_map_slot_to_channel(uint16_t index, uint16_t uart_channel);
  */
 ddi_em_result ddi_fusion_uart_check_for_events (ddi_em_handle em_handle);
 
+/** ddi_fusion_uart_update_status
+ @brief Mirror the UART status process data of the open UART handles, called every cycle
+ @param[in] em_handle The EtherCAT Master handle
+ */
+void ddi_fusion_uart_update_status (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_is_event_fd_enabled
+ @brief Are there UART handles with an event file descriptor? The cyclic thread then checks for UART events
+ */
+bool ddi_fusion_uart_is_event_fd_enabled (void);
+
+/** ddi_fusion_uart_write_tx_data
+ @brief Write up to 255 bytes to the Tx object of a UART handle with one SDO, bypassing the transmit scheduler
+ @param[in] handle The UART handle
+ @param[in] data The data to send
+ @param[in] length The data length
+ */
+ddi_em_result ddi_fusion_uart_write_tx_data (ddi_fusion_uart_handle handle, const uint8_t *data, uint32_t length);
+
+/** ddi_fusion_uart_write_tx_image
+ @brief Write up to 255 bytes to the Tx object of a UART handle with one SDO, without copying them
+ @param[in] handle The UART handle
+ @param[in] image UART_SDO_IMAGE_SIZE bytes, the data starts after SIZEOF_SI0 bytes that are set to the length
+ @param[in] length The data length
+ */
+ddi_em_result ddi_fusion_uart_write_tx_image (ddi_fusion_uart_handle handle, uint8_t *image, uint32_t length);
+
+/** ddi_fusion_uart_read_rx_image
+ @brief Read up to 255 bytes from the Rx object of a UART handle with one SDO and advance its receive timeline, without
+        copying them
+ @param[in] handle The UART handle
+ @param[out] image UART_SDO_IMAGE_SIZE bytes, the data is read to the bytes after SIZEOF_SI0
+ @param[out] rx_length The bytes read
+ @param[out] rx_position The position of the first byte read in the bytes received since the handle was opened, may be NULL
+ */
+ddi_em_result ddi_fusion_uart_read_rx_image (ddi_fusion_uart_handle handle, uint8_t *image, uint32_t *rx_length, uint64_t *rx_position);
+
+/** ddi_fusion_uart_read_rx_data
+ @brief Read up to 255 bytes from the Rx object of a UART handle with one SDO and advance its receive timeline
+ @param[in] handle The UART handle
+ @param[out] dest_buffer The destination buffer, at least 255 bytes
+ @param[out] rx_length The bytes read
+ @param[out] rx_position The position of the first byte read in the bytes received since the handle was opened, may be NULL
+ */
+ddi_em_result ddi_fusion_uart_read_rx_data (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length, uint64_t *rx_position);
+
+/** ddi_fusion_uart_get_em_handle
+ @brief Return the EtherCAT Master handle of an open UART handle
+ @param[in] handle The UART handle
+ @param[out] em_handle The EtherCAT Master handle
+ */
+ddi_em_result ddi_fusion_uart_get_em_handle (ddi_fusion_uart_handle handle, ddi_em_handle *em_handle);
+
+/** ddi_fusion_uart_get_event_callback
+ @brief Return the event callback registered on an open UART handle with ddi_fusion_uart_register_event()
+ @param[in] handle The UART handle
+ @param[out] callback The event callback, NULL if none was registered
+ @param[out] user_data The event callback user data
+ */
+ddi_em_result ddi_fusion_uart_get_event_callback (ddi_fusion_uart_handle handle, ddi_uart_event_func **callback, void **user_data);
+
 /** ddi_fusion_uart_close_all_handles
- @brief Close any open UART handles.  Used when the EtherCAT Master instance is de-initialized
+ @brief Close the open UART handles of an EtherCAT Master instance.  Used when the instance is de-initialized
+ @param[in] em_handle The EtherCAT Master handle
  */
-ddi_em_result ddi_fusion_uart_close_all_handles (void);
+ddi_em_result ddi_fusion_uart_close_all_handles (ddi_em_handle em_handle);
 
 /*! @var VALIDATE_UART_INSTANCE
   @brief  Macro to validate the UART instance argument to a function
 */
-#define VALIDATE_UART_INSTANCE(instance) do{ if ((instance > MAX_UART_INSTANCES) || (instance < 0))\
+#define VALIDATE_UART_INSTANCE(instance) do{ if ((instance < 0) || ((uint32_t)instance >= ddi_fusion_uart_get_handle_limit()))\
                                          { printf("DDI ECAT SDK UART: Invalid instance %d \n", instance); return DDI_EM_STATUS_INVALID_INSTANCE;\
                                          }\
                                       }while(0)
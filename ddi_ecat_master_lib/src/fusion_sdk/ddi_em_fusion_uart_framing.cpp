@@ -0,0 +1,469 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_framing.h"
+
+// UART receive framing engine
+// Every master instance with framed UART handles has one framing thread. It polls the Rx bytes available of each
+// framed handle from the status process data mirror, reads the bytes with ddi_fusion_uart_rx_data() and splits them
+// into frames, which are delivered to the event callback of the handle. Received bytes are timestamped with the cycle
+// time of the status that reported them, the inter-byte timeout is measured on these timestamps.
+
+// The framing state of a UART handle, protected by the lock of the handle's master instance
+// The partial frame is only touched by the framing thread while the handle is active
+typedef struct {
+  bool                active;
+  ddi_em_handle       em_handle;
+  uart_framing_config config;
+  uint8_t            *frame;
+  uint32_t            length;           // Bytes of the partial frame
+  uint32_t            expected_length;  // UART_FRAMING_LENGTH_PREFIX: the frame length once the length field was received
+  uint64_t            frame_start_ns;
+  uint64_t            last_byte_ns;
+} uart_framer;
+
+// The framing engine of a master instance
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t  idle_cond;           // Signalled when the framing thread is done with a handle
+  bool            lock_initialized;
+  bool            running;
+  bool            stop;
+  pthread_t       thread;
+  ddi_fusion_uart_handle busy_handle;  // The handle the framing thread works on outside the lock, -1 if none
+  uint32_t        generation;          // Counts the detaches, a polling pass is cut short by a detach during a poll
+} uart_framing_engine;
+
+static uart_framing_engine g_uart_framing[DDI_EM_MAX_MASTER_INSTANCES];
+
+// The framer of a UART handle opened with framing, NULL for the other handles. Allocated by the open and freed when
+// the handle stops framing.
+static uart_framer *g_uart_framers[MAX_UART_INSTANCES];
+
+// Validate a framing configuration and fill in the default frame size limit
+static bool is_framing_config_valid (uart_framing_config *config)
+{
+  if ( config->max_frame_length == 0 )
+  {
+    config->max_frame_length = DDI_FUSION_UART_FRAME_SIZE_DEFAULT;
+  }
+  if ( config->max_frame_length > DDI_FUSION_UART_FRAME_SIZE_MAX )
+  {
+    return false;
+  }
+  switch ( config->mode )
+  {
+    case UART_FRAMING_DELIMITER:
+      return (config->delimiter_length >= 1) && (config->delimiter_length <= DDI_FUSION_UART_DELIMITER_MAX);
+    case UART_FRAMING_FIXED_LENGTH:
+      return (config->frame_length >= 1) && (config->frame_length <= config->max_frame_length);
+    case UART_FRAMING_LENGTH_PREFIX:
+      return ((config->length_size == 1) || (config->length_size == 2)) &&
+             ((uint32_t)config->length_offset + config->length_size <= config->max_frame_length);
+    case UART_FRAMING_TIMEOUT:
+      return config->inter_byte_timeout_us != 0;
+    default:
+      return false;
+  }
+}
+
+// Free the framer of a UART handle, called with the engine lock held
+static void release_framer (ddi_fusion_uart_handle handle)
+{
+  free(g_uart_framers[handle]->frame);
+  free(g_uart_framers[handle]);
+  g_uart_framers[handle] = NULL;
+}
+
+// Discard the partial frame
+static void reset_frame (uart_framer *framer)
+{
+  framer->length = 0;
+  framer->expected_length = 0;
+}
+
+// Deliver the first length bytes of the partial frame to the event callback and start the next frame
+static void deliver_frame (ddi_fusion_uart_handle handle, uart_framer *framer, uint32_t length)
+{
+  ddi_uart_event_func *callback;
+  void *user_data;
+  uart_event event;
+
+  if ( (length != 0) && (ddi_fusion_uart_get_event_callback(handle, &callback, &user_data) == DDI_EM_STATUS_OK) &&
+       (callback != NULL) )
+  {
+    memset(&event, 0, sizeof(event));
+    event.event = UART_EVENT_FRAME;
+    event.uart_handle = handle;
+    event.frame = framer->frame;
+    event.frame_length = length;
+    event.frame_start_ns = framer->frame_start_ns;
+    event.frame_end_ns = framer->last_byte_ns;
+    callback(&event, user_data);
+  }
+  reset_frame(framer);
+}
+
+// Return the frame length coded in the length field of a UART_FRAMING_LENGTH_PREFIX frame header, 0 if it is invalid
+static uint32_t get_prefixed_length (uart_framer *framer)
+{
+  const uint8_t *field = &framer->frame[framer->config.length_offset];
+  int64_t length;
+
+  if ( framer->config.length_size == 1 )
+  {
+    length = field[0];
+  }
+  else if ( framer->config.length_big_endian )
+  {
+    length = (field[0] << 8) | field[1];
+  }
+  else
+  {
+    length = field[0] | (field[1] << 8);
+  }
+  length += framer->config.length_adjust;
+  if ( (length < (int64_t)framer->config.length_offset + framer->config.length_size) || (length > framer->config.max_frame_length) )
+  {
+    return 0;
+  }
+  return (uint32_t)length;
+}
+
+// Add received bytes to the partial frame of a framed handle, delivering the frames they complete
+static void frame_rx_bytes (ddi_fusion_uart_handle handle, uart_framer *framer, const uint8_t *data, uint32_t length, uint64_t timestamp_ns)
+{
+  uart_framing_config *config = &framer->config;
+  uint64_t timeout_ns = (uint64_t)config->inter_byte_timeout_us * NSEC_PER_USEC;
+  uint32_t index;
+
+  // An inter-byte gap ends a timeout frame and discards the partial frame of the other modes
+  if ( (framer->length != 0) && (timeout_ns != 0) && (timestamp_ns - framer->last_byte_ns > timeout_ns) )
+  {
+    if ( config->mode == UART_FRAMING_TIMEOUT )
+    {
+      deliver_frame(handle, framer, framer->length);
+    }
+    else
+    {
+      DLOG(framer->em_handle, "UART %d: partial frame of %u bytes timed out\n", handle, framer->length);
+      reset_frame(framer);
+    }
+  }
+
+  for ( index = 0; (index < length) && framer->active; index++ )
+  {
+    if ( framer->length == config->max_frame_length )
+    {
+      DLOG(framer->em_handle, "UART %d: frame longer than %u bytes dropped\n", handle, config->max_frame_length);
+      reset_frame(framer);
+    }
+    if ( framer->length == 0 )
+    {
+      framer->frame_start_ns = timestamp_ns;
+    }
+    framer->frame[framer->length++] = data[index];
+    framer->last_byte_ns = timestamp_ns;
+
+    switch ( config->mode )
+    {
+      case UART_FRAMING_DELIMITER:
+        if ( (framer->length >= config->delimiter_length) &&
+             !memcmp(&framer->frame[framer->length - config->delimiter_length], config->delimiter, config->delimiter_length) )
+        {
+          deliver_frame(handle, framer, framer->length - config->delimiter_length);
+        }
+        break;
+      case UART_FRAMING_FIXED_LENGTH:
+        if ( framer->length == config->frame_length )
+        {
+          deliver_frame(handle, framer, framer->length);
+        }
+        break;
+      case UART_FRAMING_LENGTH_PREFIX:
+        if ( (framer->expected_length == 0) && (framer->length == (uint32_t)config->length_offset + config->length_size) )
+        {
+          framer->expected_length = get_prefixed_length(framer);
+          if ( framer->expected_length == 0 )
+          {
+            DLOG(framer->em_handle, "UART %d: invalid frame length field, resynchronizing\n", handle);
+            reset_frame(framer);
+            break;
+          }
+        }
+        if ( (framer->expected_length != 0) && (framer->length == framer->expected_length) )
+        {
+          deliver_frame(handle, framer, framer->length);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+// Read the received bytes of a framed handle and frame them, return true if bytes were received
+static bool poll_framer (ddi_fusion_uart_handle handle, uart_framer *framer)
+{
+  uint8_t data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  ddi_fusion_uart_status status;
+  uint32_t rx_length;
+  uint16_t bytes_avail = 0;
+  uint64_t timestamp_ns;
+  bool received = false;
+
+  // The status mirror gives the cycle the bytes were reported in, without it the bytes are stamped when polled
+  if ( (ddi_fusion_uart_get_status(handle, &status) == DDI_EM_STATUS_OK) &&
+       (status.age_ns <= (uint64_t)DDI_FUSION_UART_STATUS_MAX_AGE_MS * NSEC_PER_MSEC) )
+  {
+    bytes_avail = status.rx_bytes_avail;
+    timestamp_ns = status.timestamp_ns;
+  }
+  else
+  {
+    timestamp_ns = ddi_fusion_uart_time_ns();
+    if ( ddi_fusion_uart_get_rx_bytes_avail(handle, &bytes_avail) != DDI_EM_STATUS_OK )
+    {
+      bytes_avail = 0;
+    }
+  }
+
+  while ( (bytes_avail != 0) && framer->active )
+  {
+    if ( (ddi_fusion_uart_rx_data(handle, data, &rx_length) != DDI_EM_STATUS_OK) || (rx_length == 0) )
+    {
+      break;
+    }
+    frame_rx_bytes(handle, framer, data, rx_length, timestamp_ns);
+    received = true;
+    bytes_avail = (bytes_avail > rx_length) ? bytes_avail - rx_length : 0;
+  }
+
+  // A timeout frame also ends while no more bytes are received
+  if ( framer->active && (framer->config.mode == UART_FRAMING_TIMEOUT) && (framer->length != 0) &&
+       (ddi_fusion_uart_time_ns() - framer->last_byte_ns > (uint64_t)framer->config.inter_byte_timeout_us * NSEC_PER_USEC) )
+  {
+    deliver_frame(handle, framer, framer->length);
+  }
+  return received;
+}
+
+// The framing thread of a master instance
+static void *uart_framing_thread (void *arg)
+{
+  ddi_em_handle em_handle = (ddi_em_handle)(intptr_t)arg;
+  uart_framing_engine *engine = &g_uart_framing[em_handle];
+  uart_framer *framer;
+  ddi_fusion_uart_handle *handles = NULL, handle;
+  uint32_t capacity = 0, count, index, generation;
+  bool received;
+
+  pthread_mutex_lock(&engine->lock);
+  while ( !engine->stop )
+  {
+    received = false;
+    // Only the open handles of this master instance are framed here. A handle closed while it is polled may be opened
+    // on another master instance right after, the pass ends there and the next one takes a new list.
+    count = ddi_fusion_uart_get_master_handles(em_handle, &handles, &capacity);
+    generation = engine->generation;
+    for ( index = 0; (index < count) && !engine->stop && (engine->generation == generation); index++ )
+    {
+      handle = handles[index];
+      framer = g_uart_framers[handle];
+      if ( (framer == NULL) || !framer->active )
+      {
+        continue;
+      }
+      engine->busy_handle = handle;
+      pthread_mutex_unlock(&engine->lock);
+      received |= poll_framer(handle, framer);
+      pthread_mutex_lock(&engine->lock);
+      engine->busy_handle = -1;
+      // The handle was closed meanwhile, possibly from its own frame callback
+      if ( !framer->active )
+      {
+        release_framer(handle);
+      }
+      pthread_cond_broadcast(&engine->idle_cond);
+    }
+    if ( !received && !engine->stop )
+    {
+      pthread_mutex_unlock(&engine->lock);
+      usleep(UART_FRAMING_POLL_US);
+      pthread_mutex_lock(&engine->lock);
+    }
+  }
+  pthread_mutex_unlock(&engine->lock);
+  free(handles);
+  return NULL;
+}
+
+// Reset the framing engine of a new master instance
+void ddi_fusion_uart_framing_init (ddi_em_handle em_handle)
+{
+  uart_framing_engine *engine = &g_uart_framing[em_handle];
+
+  if ( !engine->lock_initialized )
+  {
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->idle_cond, NULL);
+    engine->lock_initialized = true;
+  }
+  pthread_mutex_lock(&engine->lock);
+  engine->running = false;
+  engine->stop = false;
+  engine->busy_handle = -1;
+  pthread_mutex_unlock(&engine->lock);
+}
+
+// Stop the framing thread of a master instance and release the partial frames
+void ddi_fusion_uart_framing_deinit (ddi_em_handle em_handle)
+{
+  uart_framing_engine *engine = &g_uart_framing[em_handle];
+  ddi_fusion_uart_handle *handles = NULL;
+  uint32_t capacity = 0, count, index;
+
+  if ( !engine->lock_initialized )
+  {
+    return;
+  }
+  pthread_mutex_lock(&engine->lock);
+  if ( engine->running )
+  {
+    engine->stop = true;
+    pthread_mutex_unlock(&engine->lock);
+    pthread_join(engine->thread, NULL);
+    pthread_mutex_lock(&engine->lock);
+    engine->running = false;
+    engine->stop = false;
+  }
+  count = ddi_fusion_uart_get_master_handles(em_handle, &handles, &capacity);
+  for ( index = 0; index < count; index++ )
+  {
+    if ( g_uart_framers[handles[index]] != NULL )
+    {
+      release_framer(handles[index]);
+    }
+  }
+  pthread_mutex_unlock(&engine->lock);
+  free(handles);
+}
+
+// Stop framing the received bytes of a UART handle being closed
+void ddi_fusion_uart_framing_detach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle)
+{
+  uart_framing_engine *engine = &g_uart_framing[em_handle];
+  uart_framer *framer;
+
+  if ( !engine->lock_initialized )
+  {
+    return;
+  }
+  pthread_mutex_lock(&engine->lock);
+  framer = g_uart_framers[handle];
+  if ( (framer != NULL) && framer->active )
+  {
+    framer->active = false;
+    engine->generation++;
+    if ( engine->busy_handle != handle )
+    {
+      release_framer(handle);
+    }
+    else if ( !pthread_equal(pthread_self(), engine->thread) )
+    {
+      // The framing thread releases the framer when it is done with the handle
+      while ( engine->busy_handle == handle )
+      {
+        pthread_cond_wait(&engine->idle_cond, &engine->lock);
+      }
+    }
+  }
+  pthread_mutex_unlock(&engine->lock);
+}
+
+// Open a UART handle with receive framing
+EM_API ddi_em_result ddi_fusion_uart_open_framed (ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t module_index, uart_channel channel,
+                                                    uint32_t flags, const uart_framing_config *framing, ddi_fusion_uart_handle *handle)
+{
+  uart_framing_engine *engine;
+  uart_framing_config config;
+  uart_framer *framer;
+  uint8_t *frame;
+  ddi_em_result result;
+  int thread_result;
+
+  VALIDATE_INSTANCE(em_handle);
+  if ( framing == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( framing->mode == UART_FRAMING_NONE )
+  {
+    return ddi_fusion_uart_open(em_handle, es_handle, module_index, channel, flags, handle);
+  }
+  config = *framing;
+  if ( !is_framing_config_valid(&config) )
+  {
+    ELOG(em_handle, "Invalid UART framing configuration, mode %d\n", framing->mode);
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  engine = &g_uart_framing[em_handle];
+  if ( !engine->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  framer = (uart_framer *)calloc(1, sizeof(uart_framer));
+  frame = (uint8_t *)malloc(config.max_frame_length);
+  if ( (framer == NULL) || (frame == NULL) )
+  {
+    free(framer);
+    free(frame);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  result = ddi_fusion_uart_open(em_handle, es_handle, module_index, channel, flags, handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    free(framer);
+    free(frame);
+    return result;
+  }
+
+  pthread_mutex_lock(&engine->lock);
+  g_uart_framers[*handle] = framer;
+  framer->em_handle = em_handle;
+  framer->config = config;
+  framer->frame = frame;
+  framer->active = true;
+  if ( !engine->running )
+  {
+    engine->stop = false;
+    thread_result = pthread_create(&engine->thread, NULL, uart_framing_thread, (void *)(intptr_t)em_handle);
+    if ( thread_result != 0 )
+    {
+      pthread_mutex_unlock(&engine->lock);
+      ELOG(em_handle, "UART framing thread create failed %d\n", thread_result);
+      ddi_fusion_uart_close(*handle);
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+    engine->running = true;
+  }
+  pthread_mutex_unlock(&engine->lock);
+  return DDI_EM_STATUS_OK;
+}
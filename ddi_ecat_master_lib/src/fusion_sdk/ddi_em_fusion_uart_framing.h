@@ -0,0 +1,41 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_framing.h
+
+#ifndef DDI_EM_UART_FRAMING_H
+#define DDI_EM_UART_FRAMING_H
+
+// UART receive framing engine of a master instance
+
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+
+// The framing thread polls the framed handles at this interval while no bytes are received
+#define UART_FRAMING_POLL_US 1000
+
+/** ddi_fusion_uart_framing_init
+ @brief Reset the UART framing engine of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_framing_init (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_framing_deinit
+ @brief Stop the framing thread of a master instance and release the partial frames
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_framing_deinit (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_framing_detach
+ @brief Stop framing the received bytes of a UART handle being closed
+ The call waits until the framing thread is done with the handle, unless it is made from a frame callback
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ */
+void ddi_fusion_uart_framing_detach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle);
+
+#endif // DDI_EM_UART_FRAMING_H
@@ -0,0 +1,300 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_tx.h"
+#include "ddi_em_fusion_uart_lease.h"
+
+// Leased UART transfer buffers
+// Each buffer is a complete access image of the Tx or Rx object, the data the caller sees starts after SI0. A transmit
+// buffer is written by the caller and sent from the image, a receive buffer is read into by the SDO upload. The caller
+// gets a description of the buffer with a new lease number. A buffer is only given back with the number of its current
+// lease, so a buffer kept past the close of its handle cannot give back the lease of the next owner. While an SDO
+// transfers the image the buffer is in flight, a close leaves it leased and the transfer gives it back when it ends.
+
+typedef struct {
+  uint32_t lease;      // 0 while the buffer is free
+  uint8_t  in_flight;  // An SDO is transferring the image
+  uint8_t  image[UART_SDO_IMAGE_SIZE];
+} uart_lease_buffer;
+
+// The buffers of a UART handle
+typedef struct {
+  uart_lease_buffer buffers[DDI_FUSION_UART_LEASE_BUFFERS];
+  uint32_t          closes;    // Counts the closes of the handle, a transfer that spans one gives its buffer back
+} uart_lease_pool;
+
+// Protects the pools and the leases
+static pthread_mutex_t g_uart_lease_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t g_uart_next_lease;
+
+// Lease pools, a handle gets its pool with its first lease and the pool outlives a close for the next user
+static uart_lease_pool *g_uart_lease_pools[MAX_UART_INSTANCES];
+
+// Lease a free buffer of a UART handle, in_flight is set for a buffer that is transferred at once and closes returns the
+// close count of the handle for it
+static ddi_em_result lease_buffer (ddi_fusion_uart_handle handle, uart_lease_buffer **leased, ddi_fusion_uart_buffer *caller_buffer,
+                                   bool in_flight, uint32_t *closes)
+{
+  uart_lease_pool *pool;
+  uart_lease_buffer *buffer;
+  uint32_t index;
+
+  pthread_mutex_lock(&g_uart_lease_lock);
+  pool = g_uart_lease_pools[handle];
+  if ( pool == NULL )
+  {
+    pool = (uart_lease_pool *)calloc(1, sizeof(uart_lease_pool));
+    if ( pool == NULL )
+    {
+      pthread_mutex_unlock(&g_uart_lease_lock);
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+    g_uart_lease_pools[handle] = pool;
+  }
+  for ( index = 0; index < DDI_FUSION_UART_LEASE_BUFFERS; index++ )
+  {
+    buffer = &pool->buffers[index];
+    if ( buffer->lease == 0 )
+    {
+      // Lease 0 marks a free buffer
+      if ( ++g_uart_next_lease == 0 )
+      {
+        g_uart_next_lease = 1;
+      }
+      buffer->lease = g_uart_next_lease;
+      buffer->in_flight = in_flight;
+      caller_buffer->data = &buffer->image[SIZEOF_SI0];
+      caller_buffer->length = 0;
+      caller_buffer->lease = buffer->lease;
+      *leased = buffer;
+      if ( closes != NULL )
+      {
+        *closes = pool->closes;
+      }
+      pthread_mutex_unlock(&g_uart_lease_lock);
+      return DDI_EM_STATUS_OK;
+    }
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+  return DDI_EM_STATUS_NO_RESOURCES;
+}
+
+// Return the buffer of a UART handle the caller holds the lease of, NULL if it does not or the buffer is in flight,
+// called with the lock held
+static uart_lease_buffer *find_leased_buffer (ddi_fusion_uart_handle handle, const ddi_fusion_uart_buffer *caller_buffer)
+{
+  uart_lease_pool *pool = g_uart_lease_pools[handle];
+  uart_lease_buffer *buffer;
+  uint32_t index;
+
+  if ( pool == NULL )
+  {
+    return NULL;
+  }
+  for ( index = 0; index < DDI_FUSION_UART_LEASE_BUFFERS; index++ )
+  {
+    buffer = &pool->buffers[index];
+    if ( (&buffer->image[SIZEOF_SI0] == caller_buffer->data) && (buffer->lease != 0) && (buffer->lease == caller_buffer->lease) &&
+         !buffer->in_flight )
+    {
+      return buffer;
+    }
+  }
+  return NULL;
+}
+
+// End the transfer of a buffer and give back its lease
+static void release_lease (uart_lease_buffer *buffer, uint32_t lease)
+{
+  pthread_mutex_lock(&g_uart_lease_lock);
+  buffer->in_flight = 0;
+  if ( buffer->lease == lease )
+  {
+    buffer->lease = 0;
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+}
+
+// Give back the buffers leased from a UART handle being closed, the buffers in flight are given back by their transfers
+void ddi_fusion_uart_lease_detach (ddi_fusion_uart_handle handle)
+{
+  uart_lease_pool *pool;
+  uint32_t index;
+
+  pthread_mutex_lock(&g_uart_lease_lock);
+  pool = g_uart_lease_pools[handle];
+  if ( pool != NULL )
+  {
+    pool->closes++;
+    for ( index = 0; index < DDI_FUSION_UART_LEASE_BUFFERS; index++ )
+    {
+      if ( !pool->buffers[index].in_flight )
+      {
+        pool->buffers[index].lease = 0;
+      }
+    }
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+}
+
+// Free the buffer pools, the outstanding leases end with them
+void ddi_fusion_uart_lease_deinit (void)
+{
+  uint32_t handle;
+
+  pthread_mutex_lock(&g_uart_lease_lock);
+  for ( handle = 0; handle < MAX_UART_INSTANCES; handle++ )
+  {
+    free(g_uart_lease_pools[handle]);
+    g_uart_lease_pools[handle] = NULL;
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+}
+
+// Lease a transmit buffer of a UART handle
+EM_API ddi_em_result ddi_fusion_uart_tx_lease (ddi_fusion_uart_handle handle, ddi_fusion_uart_buffer *buffer)
+{
+  uart_lease_buffer *leased;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( buffer == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  return lease_buffer(handle, &leased, buffer, false, NULL);
+}
+
+// Send a leased transmit buffer and give it back
+EM_API ddi_em_result ddi_fusion_uart_tx_commit (ddi_fusion_uart_handle handle, const ddi_fusion_uart_buffer *buffer)
+{
+  uart_lease_buffer *leased;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  uint32_t lease, length;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( buffer == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  pthread_mutex_lock(&g_uart_lease_lock);
+  leased = find_leased_buffer(handle, buffer);
+  if ( leased == NULL )
+  {
+    pthread_mutex_unlock(&g_uart_lease_lock);
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  // The image is sent without the lock, a close in the meantime must not give the buffer to the next owner
+  leased->in_flight = 1;
+  lease = leased->lease;
+  length = buffer->length;
+  pthread_mutex_unlock(&g_uart_lease_lock);
+
+  if ( length > DDI_FUSION_UART_SDO_DATA_SIZE_MAX )
+  {
+    result = DDI_EM_STATUS_INVALID_ARG;
+  }
+  else if ( ddi_fusion_uart_tx_is_scheduled(em_handle) )
+  {
+    // The caller waits, the queued write refers to the buffer until it is sent
+    result = ddi_fusion_uart_tx_send_wait(handle, em_handle, &leased->image[SIZEOF_SI0], length);
+  }
+  else
+  {
+    result = ddi_fusion_uart_write_tx_image(handle, leased->image, length);
+  }
+  release_lease(leased, lease);
+  return result;
+}
+
+// Receive up to 255 bytes into a leased buffer of a UART handle
+EM_API ddi_em_result ddi_fusion_uart_rx_borrow (ddi_fusion_uart_handle handle, ddi_fusion_uart_buffer *buffer)
+{
+  uart_lease_buffer *leased;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  uint32_t length, closes;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( buffer == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  result = lease_buffer(handle, &leased, buffer, true, &closes);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  result = ddi_fusion_uart_read_rx_image(handle, leased->image, &length, NULL);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    release_lease(leased, buffer->lease);
+    memset(buffer, 0, sizeof(ddi_fusion_uart_buffer));
+    return result;
+  }
+  // The caller holds the lease from here, unless the handle was closed during the read
+  pthread_mutex_lock(&g_uart_lease_lock);
+  leased->in_flight = 0;
+  if ( g_uart_lease_pools[handle]->closes != closes )
+  {
+    leased->lease = 0;
+    pthread_mutex_unlock(&g_uart_lease_lock);
+    memset(buffer, 0, sizeof(ddi_fusion_uart_buffer));
+    return DDI_EM_STATUS_OP_CANCELLED;
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+  buffer->length = length;
+  return DDI_EM_STATUS_OK;
+}
+
+// Give back a buffer leased from a UART handle
+EM_API ddi_em_result ddi_fusion_uart_release_buffer (ddi_fusion_uart_handle handle, const ddi_fusion_uart_buffer *buffer)
+{
+  uart_lease_buffer *leased;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( buffer == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  pthread_mutex_lock(&g_uart_lease_lock);
+  leased = find_leased_buffer(handle, buffer);
+  if ( leased != NULL )
+  {
+    leased->lease = 0;
+  }
+  pthread_mutex_unlock(&g_uart_lease_lock);
+  return leased ? DDI_EM_STATUS_OK : DDI_EM_STATUS_INVALID_ARG;
+}
@@ -0,0 +1,30 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_lease.h
+
+#ifndef DDI_EM_UART_LEASE_H
+#define DDI_EM_UART_LEASE_H
+
+// Leased UART transfer buffers
+
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+
+/** ddi_fusion_uart_lease_detach
+ @brief Give back the buffers leased from a UART handle being closed
+ @param handle The UART handle
+ */
+void ddi_fusion_uart_lease_detach (ddi_fusion_uart_handle handle);
+
+/** ddi_fusion_uart_lease_deinit
+ @brief Free the buffer pools kept for the reopens of the UART handles, called by ddi_em_sdk_deinit() once every master
+ instance is de-initialized
+ */
+void ddi_fusion_uart_lease_deinit (void);
+
+#endif // DDI_EM_UART_LEASE_H
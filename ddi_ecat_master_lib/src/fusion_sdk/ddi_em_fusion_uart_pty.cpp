@@ -0,0 +1,452 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <pthread.h>
+#include "ddi_debug.h"
+#include "ddi_ntime.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_pty.h"
+
+// UART pseudo-terminal bridges
+// Each bridge has a thread that moves the bytes between the master side of a pseudo-terminal and a UART handle with
+// the public UART transfer functions. Bytes read from the pty are batched into transmits of up to tx_batch_bytes, a
+// partial batch is sent tx_batch_timeout_us after its first byte. The channel is polled for received bytes every
+// rx_poll_interval_us while it is idle and right away while it has data. Received bytes the pty reader has not taken
+// yet are kept in a ring buffer, the bridge stops reading the channel while the ring is full so the Fusion flow
+// control applies. The bridge keeps the slave side of the pty open, the master side would report a hangup otherwise
+// whenever no application has the pty open.
+
+typedef struct {
+  ddi_fusion_uart_handle     handle;
+  ddi_em_handle              em_handle;
+  ddi_fusion_uart_pty_config config;
+  int                        master_fd;
+  int                        slave_fd;
+  pthread_t                  thread;
+  bool                       stop;
+  // Received bytes toward the pty
+  uint8_t                   *rx_ring;
+  uint32_t                   rx_head;
+  uint32_t                   rx_count;
+  // Bytes from the pty toward the channel
+  uint8_t                    tx_batch[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t                   tx_length;
+  uint64_t                   tx_deadline_ns;
+  // Counters, protected by stats_lock
+  pthread_mutex_t            stats_lock;
+  ddi_fusion_uart_pty_stats  stats;
+  uint64_t                   stats_start_ns;
+} uart_pty_bridge;
+
+// The bridge of a UART handle while it is exposed as a pty, NULL otherwise
+static uart_pty_bridge *g_uart_ptys[MAX_UART_INSTANCES];
+
+// Serializes the bridge open and close calls
+static pthread_mutex_t g_uart_pty_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Send the pending batch to the channel
+static void send_tx_batch (ddi_fusion_uart_handle handle, uart_pty_bridge *bridge)
+{
+  ddi_em_result result;
+
+  result = ddi_fusion_uart_tx_data(handle, bridge->tx_batch, bridge->tx_length);
+  pthread_mutex_lock(&bridge->stats_lock);
+  bridge->stats.tx_transfers++;
+  if ( result == DDI_EM_STATUS_OK )
+  {
+    bridge->stats.tx_bytes += bridge->tx_length;
+  }
+  else
+  {
+    bridge->stats.tx_errors++;
+  }
+  pthread_mutex_unlock(&bridge->stats_lock);
+  bridge->tx_length = 0;
+}
+
+// Read the received bytes of the channel into the ring buffer while it has room for a whole transfer
+// Return true if bytes were received
+static bool receive_rx_bytes (ddi_fusion_uart_handle handle, uart_pty_bridge *bridge)
+{
+  uint8_t data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t rx_length, index, tail;
+  uint16_t bytes_avail;
+  ddi_em_result result;
+  bool received = false;
+
+  if ( (bridge->config.rx_buffer_size - bridge->rx_count < DDI_FUSION_UART_SDO_DATA_SIZE_MAX) ||
+       (ddi_fusion_uart_get_rx_bytes_avail(handle, &bytes_avail) != DDI_EM_STATUS_OK) )
+  {
+    return false;
+  }
+  while ( (bytes_avail != 0) && (bridge->config.rx_buffer_size - bridge->rx_count >= DDI_FUSION_UART_SDO_DATA_SIZE_MAX) )
+  {
+    result = ddi_fusion_uart_rx_data(handle, data, &rx_length);
+    pthread_mutex_lock(&bridge->stats_lock);
+    bridge->stats.rx_transfers++;
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      bridge->stats.rx_errors++;
+    }
+    pthread_mutex_unlock(&bridge->stats_lock);
+    if ( (result != DDI_EM_STATUS_OK) || (rx_length == 0) )
+    {
+      break;
+    }
+    tail = (bridge->rx_head + bridge->rx_count) % bridge->config.rx_buffer_size;
+    for ( index = 0; index < rx_length; index++ )
+    {
+      bridge->rx_ring[(tail + index) % bridge->config.rx_buffer_size] = data[index];
+    }
+    bridge->rx_count += rx_length;
+    bytes_avail = (bytes_avail > rx_length) ? bytes_avail - rx_length : 0;
+    received = true;
+  }
+  return received;
+}
+
+// Write the buffered received bytes to the pty, as many as it takes
+static void write_rx_ring (uart_pty_bridge *bridge)
+{
+  uint32_t length;
+  ssize_t written;
+
+  while ( bridge->rx_count != 0 )
+  {
+    // The bytes up to the end of the ring, then the wrapped part
+    length = bridge->config.rx_buffer_size - bridge->rx_head;
+    if ( length > bridge->rx_count )
+    {
+      length = bridge->rx_count;
+    }
+    written = write(bridge->master_fd, &bridge->rx_ring[bridge->rx_head], length);
+    if ( written <= 0 )
+    {
+      return;
+    }
+    bridge->rx_head = (bridge->rx_head + written) % bridge->config.rx_buffer_size;
+    bridge->rx_count -= written;
+    pthread_mutex_lock(&bridge->stats_lock);
+    bridge->stats.rx_bytes += written;
+    pthread_mutex_unlock(&bridge->stats_lock);
+  }
+}
+
+// The bridge thread of a UART handle
+static void *uart_pty_thread (void *arg)
+{
+  uart_pty_bridge *bridge = (uart_pty_bridge *)arg;
+  ddi_fusion_uart_handle handle = bridge->handle;
+  uint64_t now_ns, wait_ns, tx_wait_ns, next_rx_poll_ns = 0;
+  struct pollfd poll_fd;
+  struct timespec timeout;
+  ssize_t length;
+
+  while ( !__atomic_load_n(&bridge->stop, __ATOMIC_ACQUIRE) )
+  {
+    // Sleep until the pty has data, the batch is due or the next receive poll
+    now_ns = ddi_fusion_uart_time_ns();
+    wait_ns = (next_rx_poll_ns > now_ns) ? next_rx_poll_ns - now_ns : 0;
+    if ( bridge->tx_length != 0 )
+    {
+      tx_wait_ns = (bridge->tx_deadline_ns > now_ns) ? bridge->tx_deadline_ns - now_ns : 0;
+      if ( tx_wait_ns < wait_ns )
+      {
+        wait_ns = tx_wait_ns;
+      }
+    }
+    timeout.tv_sec = wait_ns / NSEC_PER_SEC;
+    timeout.tv_nsec = wait_ns % NSEC_PER_SEC;
+    poll_fd.fd = bridge->master_fd;
+    poll_fd.events = (bridge->tx_length < bridge->config.tx_batch_bytes) ? POLLIN : 0;
+    if ( bridge->rx_count != 0 )
+    {
+      poll_fd.events |= POLLOUT;
+    }
+    poll_fd.revents = 0;
+    if ( (ppoll(&poll_fd, 1, &timeout, NULL) < 0) && (errno != EINTR) )
+    {
+      ELOG(bridge->em_handle, "UART %d pty poll failed: %s\n", handle, strerror(errno));
+      break;
+    }
+
+    // Bytes from the pty toward the channel
+    now_ns = ddi_fusion_uart_time_ns();
+    if ( poll_fd.revents & POLLIN )
+    {
+      length = read(bridge->master_fd, &bridge->tx_batch[bridge->tx_length], bridge->config.tx_batch_bytes - bridge->tx_length);
+      if ( length > 0 )
+      {
+        if ( bridge->tx_length == 0 )
+        {
+          bridge->tx_deadline_ns = now_ns + (uint64_t)bridge->config.tx_batch_timeout_us * NSEC_PER_USEC;
+        }
+        bridge->tx_length += length;
+      }
+    }
+    if ( (bridge->tx_length != 0) && ((bridge->tx_length >= bridge->config.tx_batch_bytes) || (now_ns >= bridge->tx_deadline_ns)) )
+    {
+      send_tx_batch(handle, bridge);
+    }
+
+    // Bytes from the channel toward the pty
+    if ( poll_fd.revents & POLLOUT )
+    {
+      write_rx_ring(bridge);
+    }
+    if ( now_ns >= next_rx_poll_ns )
+    {
+      if ( receive_rx_bytes(handle, bridge) )
+      {
+        // Poll again right away while the channel has data
+        next_rx_poll_ns = now_ns;
+        write_rx_ring(bridge);
+      }
+      else
+      {
+        next_rx_poll_ns = now_ns + (uint64_t)bridge->config.rx_poll_interval_us * NSEC_PER_USEC;
+      }
+    }
+  }
+  return NULL;
+}
+
+// Stop a bridge and release its pseudo-terminal, called with g_uart_pty_lock held
+static void stop_bridge (ddi_fusion_uart_handle handle)
+{
+  uart_pty_bridge *bridge = g_uart_ptys[handle];
+
+  __atomic_store_n(&bridge->stop, true, __ATOMIC_RELEASE);
+  pthread_join(bridge->thread, NULL);
+  close(bridge->slave_fd);
+  close(bridge->master_fd);
+  free(bridge->rx_ring);
+  pthread_mutex_destroy(&bridge->stats_lock);
+  free(bridge);
+  g_uart_ptys[handle] = NULL;
+}
+
+// Stop the bridge of a UART handle being closed
+void ddi_fusion_uart_pty_detach (ddi_fusion_uart_handle handle)
+{
+  pthread_mutex_lock(&g_uart_pty_lock);
+  if ( g_uart_ptys[handle] != NULL )
+  {
+    stop_bridge(handle);
+  }
+  pthread_mutex_unlock(&g_uart_pty_lock);
+}
+
+// Stop the bridges of the UART handles of a master instance
+void ddi_fusion_uart_pty_deinit (ddi_em_handle em_handle)
+{
+  ddi_fusion_uart_handle handle;
+
+  pthread_mutex_lock(&g_uart_pty_lock);
+  for ( handle = 0; (uint32_t)handle < ddi_fusion_uart_get_handle_limit(); handle++ )
+  {
+    if ( (g_uart_ptys[handle] != NULL) && (g_uart_ptys[handle]->em_handle == em_handle) )
+    {
+      stop_bridge(handle);
+    }
+  }
+  pthread_mutex_unlock(&g_uart_pty_lock);
+}
+
+// Create a pseudo-terminal in raw mode, return its master and slave file descriptors
+static ddi_em_result create_pty (ddi_em_handle em_handle, int *master_fd, int *slave_fd, char *pty_name, uint32_t pty_name_size)
+{
+  struct termios attributes;
+
+  *master_fd = posix_openpt(O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if ( *master_fd < 0 )
+  {
+    ELOG(em_handle, "posix_openpt failed: %s\n", strerror(errno));
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  if ( (grantpt(*master_fd) != 0) || (unlockpt(*master_fd) != 0) || (ptsname_r(*master_fd, pty_name, pty_name_size) != 0) )
+  {
+    ELOG(em_handle, "pty setup failed: %s\n", strerror(errno));
+    close(*master_fd);
+    return (errno == ERANGE) ? DDI_EM_STATUS_INVALID_SIZE : DDI_EM_STATUS_NO_RESOURCES;
+  }
+  *slave_fd = open(pty_name, O_RDWR | O_NOCTTY | O_CLOEXEC);
+  if ( *slave_fd < 0 )
+  {
+    ELOG(em_handle, "Cannot open %s: %s\n", pty_name, strerror(errno));
+    close(*master_fd);
+    return DDI_EM_STATUS_FILE_OPEN_ERR;
+  }
+  // Serial data passes unmodified, applications can still change the mode with termios
+  if ( tcgetattr(*slave_fd, &attributes) == 0 )
+  {
+    cfmakeraw(&attributes);
+    tcsetattr(*slave_fd, TCSANOW, &attributes);
+  }
+  fcntl(*master_fd, F_SETFL, fcntl(*master_fd, F_GETFL) | O_NONBLOCK);
+  return DDI_EM_STATUS_OK;
+}
+
+// Expose a UART handle as a pseudo-terminal
+EM_API ddi_em_result ddi_fusion_uart_pty_open (ddi_fusion_uart_handle handle, const ddi_fusion_uart_pty_config *config, char *pty_name, uint32_t pty_name_size)
+{
+  uart_pty_bridge *bridge;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  int thread_result;
+
+  VALIDATE_UART_INSTANCE(handle);
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  if ( pty_name == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( config && (config->tx_batch_bytes > DDI_FUSION_UART_SDO_DATA_SIZE_MAX) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+
+  pthread_mutex_lock(&g_uart_pty_lock);
+  if ( g_uart_ptys[handle] != NULL )
+  {
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_BUSY;
+  }
+  bridge = (uart_pty_bridge *)calloc(1, sizeof(uart_pty_bridge));
+  if ( bridge == NULL )
+  {
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  if ( config != NULL )
+  {
+    bridge->config = *config;
+  }
+  if ( bridge->config.tx_batch_bytes == 0 )
+  {
+    bridge->config.tx_batch_bytes = DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+  }
+  if ( bridge->config.rx_poll_interval_us == 0 )
+  {
+    bridge->config.rx_poll_interval_us = UART_PTY_RX_POLL_INTERVAL_US_DEFAULT;
+  }
+  if ( bridge->config.rx_buffer_size == 0 )
+  {
+    bridge->config.rx_buffer_size = UART_PTY_RX_BUFFER_SIZE_DEFAULT;
+  }
+  // The ring takes whole receive transfers
+  if ( bridge->config.rx_buffer_size < DDI_FUSION_UART_SDO_DATA_SIZE_MAX )
+  {
+    bridge->config.rx_buffer_size = DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+  }
+  bridge->handle = handle;
+  bridge->em_handle = em_handle;
+  bridge->rx_ring = (uint8_t *)malloc(bridge->config.rx_buffer_size);
+  if ( bridge->rx_ring == NULL )
+  {
+    free(bridge);
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  result = create_pty(em_handle, &bridge->master_fd, &bridge->slave_fd, pty_name, pty_name_size);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    free(bridge->rx_ring);
+    free(bridge);
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return result;
+  }
+  pthread_mutex_init(&bridge->stats_lock, NULL);
+  bridge->stats_start_ns = ddi_fusion_uart_time_ns();
+  thread_result = pthread_create(&bridge->thread, NULL, uart_pty_thread, bridge);
+  if ( thread_result != 0 )
+  {
+    ELOG(em_handle, "UART pty bridge thread create failed %d\n", thread_result);
+    close(bridge->slave_fd);
+    close(bridge->master_fd);
+    free(bridge->rx_ring);
+    pthread_mutex_destroy(&bridge->stats_lock);
+    free(bridge);
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  g_uart_ptys[handle] = bridge;
+  pthread_mutex_unlock(&g_uart_pty_lock);
+  DLOG(em_handle, "UART %d bridged to %s\n", handle, pty_name);
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop the pseudo-terminal bridge of a UART handle
+EM_API ddi_em_result ddi_fusion_uart_pty_close (ddi_fusion_uart_handle handle)
+{
+  VALIDATE_UART_INSTANCE(handle);
+  pthread_mutex_lock(&g_uart_pty_lock);
+  if ( g_uart_ptys[handle] == NULL )
+  {
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  stop_bridge(handle);
+  pthread_mutex_unlock(&g_uart_pty_lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Get the throughput counters of a pseudo-terminal bridge
+EM_API ddi_em_result ddi_fusion_uart_pty_get_stats (ddi_fusion_uart_handle handle, ddi_fusion_uart_pty_stats *stats, bool reset)
+{
+  uart_pty_bridge *bridge;
+  uint64_t now_ns, elapsed_ns;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( stats == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  pthread_mutex_lock(&g_uart_pty_lock);
+  bridge = g_uart_ptys[handle];
+  if ( bridge == NULL )
+  {
+    pthread_mutex_unlock(&g_uart_pty_lock);
+    return DDI_EM_STATUS_NOT_FOUND;
+  }
+  pthread_mutex_lock(&bridge->stats_lock);
+  *stats = bridge->stats;
+  // rx_count is only written by the bridge thread, the value may be one transfer old
+  stats->rx_buffered = __atomic_load_n(&bridge->rx_count, __ATOMIC_RELAXED);
+  now_ns = ddi_fusion_uart_time_ns();
+  elapsed_ns = now_ns - bridge->stats_start_ns;
+  if ( elapsed_ns != 0 )
+  {
+    stats->tx_bytes_per_sec = (uint32_t)((stats->tx_bytes * NSEC_PER_SEC) / elapsed_ns);
+    stats->rx_bytes_per_sec = (uint32_t)((stats->rx_bytes * NSEC_PER_SEC) / elapsed_ns);
+  }
+  if ( reset )
+  {
+    memset(&bridge->stats, 0, sizeof(bridge->stats));
+    bridge->stats_start_ns = now_ns;
+  }
+  pthread_mutex_unlock(&bridge->stats_lock);
+  pthread_mutex_unlock(&g_uart_pty_lock);
+  return DDI_EM_STATUS_OK;
+}
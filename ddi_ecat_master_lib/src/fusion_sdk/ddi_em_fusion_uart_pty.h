@@ -0,0 +1,33 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_pty.h
+
+#ifndef DDI_EM_UART_PTY_H
+#define DDI_EM_UART_PTY_H
+
+// UART pseudo-terminal bridges
+
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+
+#define UART_PTY_RX_POLL_INTERVAL_US_DEFAULT 1000
+#define UART_PTY_RX_BUFFER_SIZE_DEFAULT      4096
+
+/** ddi_fusion_uart_pty_detach
+ @brief Stop the pseudo-terminal bridge of a UART handle being closed, if it has one
+ @param handle The UART handle
+ */
+void ddi_fusion_uart_pty_detach (ddi_fusion_uart_handle handle);
+
+/** ddi_fusion_uart_pty_deinit
+ @brief Stop the pseudo-terminal bridges of the UART handles of a master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_pty_deinit (ddi_em_handle em_handle);
+
+#endif // DDI_EM_UART_PTY_H
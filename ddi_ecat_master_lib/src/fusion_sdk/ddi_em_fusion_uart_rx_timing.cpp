@@ -0,0 +1,331 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_rx_timing.h"
+
+// UART receive arrival timestamps
+// The bytes received on a UART handle since it was opened form a stream, every byte has a position in it. Each cycle the
+// cyclic thread adds the bytes read so far to the Rx bytes available in the status process data, which gives the
+// position the received bytes have reached. When it moves forward, a mark with the new position, the cycle number and
+// the cycle time is recorded. A read only counts once the status can reflect it, UART_RX_TIMING_READ_LAG_CYCLES after
+// it completes, so the position never runs ahead of the bytes really received. Bytes that arrive while a read is
+// pending are marked when the read is counted, up to UART_RX_TIMING_READ_LAG_CYCLES late.
+// ddi_fusion_uart_rx_data_timed() matches the positions of the bytes it reads against the marks.
+
+// A rise of the Rx bytes available
+typedef struct {
+  uint64_t end;           // Stream position after the last byte of the rise
+  uint64_t cycle;
+  uint64_t timestamp_ns;
+} uart_rx_mark;
+
+// A read not yet reflected in the status
+typedef struct {
+  uint64_t cycle;         // Cycle the read completed in
+  uint32_t length;
+} uart_rx_read;
+
+// The receive timeline of a UART handle, protected by the lock of the handle's master instance
+typedef struct {
+  bool         active;
+  uart_rx_mark marks[UART_RX_TIMING_MARKS];
+  uint32_t     mark_head;
+  uint32_t     mark_count;
+  uint64_t     marks_start;  // Stream position of the first byte of the oldest mark
+  uint64_t     seen;         // Stream position reached by the received bytes
+  uint64_t     consumed;     // Bytes read
+  uint64_t     applied;      // Bytes read that the status reflects
+  uart_rx_read reads[UART_RX_TIMING_READS];
+  uint32_t     read_head;
+  uint32_t     read_count;
+} uart_rx_timeline;
+
+// The receive timing of a master instance
+typedef struct {
+  pthread_mutex_t lock;
+  bool            lock_initialized;
+  uint64_t        cycle;     // Cycles since ddi_em_init(), written by the cyclic thread
+} uart_rx_timing;
+
+static uart_rx_timing g_uart_rx_timing[DDI_EM_MAX_MASTER_INSTANCES];
+
+// Receive timelines, created when a handle is opened for the first time and restarted by every later open
+static uart_rx_timeline *g_uart_rx_timelines[MAX_UART_INSTANCES];
+
+// Drop the marks whose bytes were all read, called with the lock held
+static void drop_consumed_marks (uart_rx_timeline *timeline, uint64_t position)
+{
+  while ( (timeline->mark_count != 0) && (timeline->marks[timeline->mark_head].end <= position) )
+  {
+    timeline->marks_start = timeline->marks[timeline->mark_head].end;
+    timeline->mark_head = (timeline->mark_head + 1) % UART_RX_TIMING_MARKS;
+    timeline->mark_count--;
+  }
+}
+
+// Count the oldest pending read as reflected in the status, called with the lock held
+static void apply_oldest_read (uart_rx_timeline *timeline)
+{
+  timeline->applied += timeline->reads[timeline->read_head].length;
+  timeline->read_head = (timeline->read_head + 1) % UART_RX_TIMING_READS;
+  timeline->read_count--;
+}
+
+// Add the bytes of a read to the chunks, a full chunk array extends its last chunk
+static void add_chunk (ddi_fusion_uart_rx_chunk *chunks, uint32_t max_chunks, uint32_t *chunk_count, uint32_t offset,
+                       uint32_t length, uint64_t cycle, uint64_t timestamp_ns, uint32_t flags)
+{
+  ddi_fusion_uart_rx_chunk *chunk;
+
+  if ( *chunk_count == max_chunks )
+  {
+    chunk = &chunks[*chunk_count - 1];
+    chunk->length += length;
+    chunk->flags |= DDI_FUSION_UART_RX_CHUNK_MERGED;
+    return;
+  }
+  chunk = &chunks[(*chunk_count)++];
+  chunk->offset = offset;
+  chunk->length = length;
+  chunk->cycle = cycle;
+  chunk->timestamp_ns = timestamp_ns;
+  chunk->flags = flags;
+}
+
+// Reset the cycle count and the receive timelines of a new master instance
+void ddi_fusion_uart_rx_timing_init (ddi_em_handle em_handle)
+{
+  uart_rx_timing *timing = &g_uart_rx_timing[em_handle];
+
+  if ( !timing->lock_initialized )
+  {
+    pthread_mutex_init(&timing->lock, NULL);
+    timing->lock_initialized = true;
+  }
+  __atomic_store_n(&timing->cycle, 0, __ATOMIC_RELAXED);
+}
+
+// Free the receive timelines, no master instance is left to update them
+void ddi_fusion_uart_rx_timing_deinit (void)
+{
+  uint32_t handle;
+
+  for ( handle = 0; handle < MAX_UART_INSTANCES; handle++ )
+  {
+    free(g_uart_rx_timelines[handle]);
+    g_uart_rx_timelines[handle] = NULL;
+  }
+}
+
+// Start the receive timeline of a UART handle being opened
+void ddi_fusion_uart_rx_timing_attach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle)
+{
+  uart_rx_timing *timing = &g_uart_rx_timing[em_handle];
+
+  if ( !timing->lock_initialized )
+  {
+    return;
+  }
+  pthread_mutex_lock(&timing->lock);
+  if ( g_uart_rx_timelines[handle] == NULL )
+  {
+    g_uart_rx_timelines[handle] = (uart_rx_timeline *)malloc(sizeof(uart_rx_timeline));
+  }
+  // Without a timeline the bytes read from the handle are untimed
+  if ( g_uart_rx_timelines[handle] != NULL )
+  {
+    memset(g_uart_rx_timelines[handle], 0, sizeof(uart_rx_timeline));
+    g_uart_rx_timelines[handle]->active = true;
+  }
+  pthread_mutex_unlock(&timing->lock);
+}
+
+// Stop the receive timeline of a UART handle being closed
+void ddi_fusion_uart_rx_timing_detach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle)
+{
+  uart_rx_timing *timing = &g_uart_rx_timing[em_handle];
+
+  if ( !timing->lock_initialized )
+  {
+    return;
+  }
+  pthread_mutex_lock(&timing->lock);
+  if ( g_uart_rx_timelines[handle] != NULL )
+  {
+    g_uart_rx_timelines[handle]->active = false;
+  }
+  pthread_mutex_unlock(&timing->lock);
+}
+
+// Count a cycle of a master instance
+uint64_t ddi_fusion_uart_rx_timing_next_cycle (ddi_em_handle em_handle)
+{
+  return __atomic_add_fetch(&g_uart_rx_timing[em_handle].cycle, 1, __ATOMIC_RELAXED);
+}
+
+// Try to take the receive timeline lock of a master instance
+bool ddi_fusion_uart_rx_timing_lock (ddi_em_handle em_handle)
+{
+  uart_rx_timing *timing = &g_uart_rx_timing[em_handle];
+
+  return timing->lock_initialized && (pthread_mutex_trylock(&timing->lock) == 0);
+}
+
+// Release the receive timeline lock of a master instance
+void ddi_fusion_uart_rx_timing_unlock (ddi_em_handle em_handle)
+{
+  pthread_mutex_unlock(&g_uart_rx_timing[em_handle].lock);
+}
+
+// Record a rise of the Rx bytes available of a UART handle
+void ddi_fusion_uart_rx_timing_update (ddi_fusion_uart_handle handle, uint64_t cycle, uint64_t timestamp_ns, uint16_t rx_level)
+{
+  uart_rx_timeline *timeline = g_uart_rx_timelines[handle];
+  uart_rx_mark *mark;
+  uint64_t position;
+
+  if ( (timeline == NULL) || !timeline->active )
+  {
+    return;
+  }
+  while ( (timeline->read_count != 0) && (timeline->reads[timeline->read_head].cycle + UART_RX_TIMING_READ_LAG_CYCLES <= cycle) )
+  {
+    apply_oldest_read(timeline);
+  }
+  position = timeline->applied + rx_level;
+  if ( position <= timeline->seen )
+  {
+    return;
+  }
+  drop_consumed_marks(timeline, timeline->consumed);
+  // Nobody reads the bytes of the oldest mark, they lose their timestamp
+  if ( timeline->mark_count == UART_RX_TIMING_MARKS )
+  {
+    drop_consumed_marks(timeline, timeline->marks[timeline->mark_head].end);
+  }
+  if ( timeline->mark_count == 0 )
+  {
+    timeline->marks_start = timeline->seen;
+  }
+  mark = &timeline->marks[(timeline->mark_head + timeline->mark_count) % UART_RX_TIMING_MARKS];
+  mark->end = position;
+  mark->cycle = cycle;
+  mark->timestamp_ns = timestamp_ns;
+  timeline->mark_count++;
+  timeline->seen = position;
+}
+
+// Account for bytes read from a UART handle
+uint64_t ddi_fusion_uart_rx_timing_consume (ddi_fusion_uart_handle handle, ddi_em_handle em_handle, uint32_t length)
+{
+  uart_rx_timing *timing = &g_uart_rx_timing[em_handle];
+  uart_rx_timeline *timeline = g_uart_rx_timelines[handle];
+  uart_rx_read *read;
+  uint64_t position;
+
+  if ( !timing->lock_initialized || (timeline == NULL) )
+  {
+    return 0;
+  }
+  pthread_mutex_lock(&timing->lock);
+  position = timeline->consumed;
+  timeline->consumed += length;
+  if ( timeline->read_count == UART_RX_TIMING_READS )
+  {
+    apply_oldest_read(timeline);
+  }
+  read = &timeline->reads[(timeline->read_head + timeline->read_count) % UART_RX_TIMING_READS];
+  read->cycle = __atomic_load_n(&timing->cycle, __ATOMIC_RELAXED);
+  read->length = length;
+  timeline->read_count++;
+  pthread_mutex_unlock(&timing->lock);
+  return position;
+}
+
+// Receive up to 255 bytes from a UART channel and split them into chunks by arrival cycle
+EM_API ddi_em_result ddi_fusion_uart_rx_data_timed (ddi_fusion_uart_handle handle, uint8_t *dest_buffer, uint32_t *rx_length,
+                                                    ddi_fusion_uart_rx_chunk *chunks, uint32_t max_chunks, uint32_t *chunk_count)
+{
+  uart_rx_timeline *timeline;
+  uart_rx_timing *timing;
+  uart_rx_mark *mark;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  uint64_t position, read_cycle, read_time_ns;
+  uint32_t offset, length;
+
+  VALIDATE_UART_INSTANCE(handle);
+  if ( (dest_buffer == NULL) || (rx_length == NULL) || (chunks == NULL) || (chunk_count == NULL) )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  if ( max_chunks == 0 )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  *chunk_count = 0;
+  result = ddi_fusion_uart_read_rx_data(handle, dest_buffer, rx_length, &position);
+  if ( (result != DDI_EM_STATUS_OK) || (*rx_length == 0) )
+  {
+    return result;
+  }
+
+  // Bytes without a mark carry the cycle and time of the read
+  timeline = g_uart_rx_timelines[handle];
+  timing = &g_uart_rx_timing[em_handle];
+  read_cycle = __atomic_load_n(&timing->cycle, __ATOMIC_RELAXED);
+  read_time_ns = ddi_fusion_uart_time_ns();
+  if ( (timeline == NULL) || !timing->lock_initialized )
+  {
+    add_chunk(chunks, max_chunks, chunk_count, 0, *rx_length, read_cycle, read_time_ns, DDI_FUSION_UART_RX_CHUNK_UNTIMED);
+    return DDI_EM_STATUS_OK;
+  }
+  pthread_mutex_lock(&timing->lock);
+  drop_consumed_marks(timeline, position);
+  offset = 0;
+  while ( offset < *rx_length )
+  {
+    length = *rx_length - offset;
+    if ( (timeline->mark_count == 0) || (position < timeline->marks_start) )
+    {
+      if ( (timeline->mark_count != 0) && (timeline->marks_start - position < length) )
+      {
+        length = timeline->marks_start - position;
+      }
+      add_chunk(chunks, max_chunks, chunk_count, offset, length, read_cycle, read_time_ns, DDI_FUSION_UART_RX_CHUNK_UNTIMED);
+    }
+    else
+    {
+      mark = &timeline->marks[timeline->mark_head];
+      if ( mark->end - position < length )
+      {
+        length = mark->end - position;
+      }
+      add_chunk(chunks, max_chunks, chunk_count, offset, length, mark->cycle, mark->timestamp_ns, 0);
+    }
+    offset += length;
+    position += length;
+    drop_consumed_marks(timeline, position);
+  }
+  pthread_mutex_unlock(&timing->lock);
+  return DDI_EM_STATUS_OK;
+}
@@ -0,0 +1,90 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_rx_timing.h
+
+#ifndef DDI_EM_UART_RX_TIMING_H
+#define DDI_EM_UART_RX_TIMING_H
+
+// UART receive arrival timestamps
+
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+
+// Rx buffer level rises remembered per UART handle until their bytes are read
+#define UART_RX_TIMING_MARKS        128
+// Reads waiting to show up in the status process data, per UART handle
+#define UART_RX_TIMING_READS        16
+// Cycles after its completion a read is assumed to be reflected in the Rx bytes available of the status
+#define UART_RX_TIMING_READ_LAG_CYCLES DDI_FUSION_UART_RX_CHUNK_LAG_CYCLES
+
+/** ddi_fusion_uart_rx_timing_init
+ @brief Reset the cycle count and the receive timelines of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_rx_timing_init (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_deinit
+ @brief Free the receive timelines kept for the reopens of the UART handles, called by ddi_em_sdk_deinit() once every
+ master instance is de-initialized
+ */
+void ddi_fusion_uart_rx_timing_deinit (void);
+
+/** ddi_fusion_uart_rx_timing_attach
+ @brief Start the receive timeline of a UART handle being opened
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ */
+void ddi_fusion_uart_rx_timing_attach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_detach
+ @brief Stop the receive timeline of a UART handle being closed
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ */
+void ddi_fusion_uart_rx_timing_detach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_next_cycle
+ @brief Count a cycle of a master instance, called by the cyclic thread before the status mirror is updated
+ @param em_handle The EtherCAT master handle
+ @return The number of the cycle
+ */
+uint64_t ddi_fusion_uart_rx_timing_next_cycle (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_lock
+ @brief Try to take the receive timeline lock of a master instance, the cyclic thread never waits for it
+ @param em_handle The EtherCAT master handle
+ @return true if the lock was taken, the cycle then updates the timelines and releases it with
+         ddi_fusion_uart_rx_timing_unlock()
+ */
+bool ddi_fusion_uart_rx_timing_lock (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_unlock
+ @brief Release the receive timeline lock taken by ddi_fusion_uart_rx_timing_lock()
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_rx_timing_unlock (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_rx_timing_update
+ @brief Record a rise of the Rx bytes available of a UART handle, called by the cyclic thread with the timeline lock held
+ @param handle The UART handle
+ @param cycle The cycle number
+ @param timestamp_ns The monotonic time of the status
+ @param rx_level The Rx bytes available in the status
+ */
+void ddi_fusion_uart_rx_timing_update (ddi_fusion_uart_handle handle, uint64_t cycle, uint64_t timestamp_ns, uint16_t rx_level);
+
+/** ddi_fusion_uart_rx_timing_consume
+ @brief Account for bytes read from a UART handle
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ @param length The bytes read
+ @return The position of the first byte read in the stream of bytes received on the handle since it was opened
+ */
+uint64_t ddi_fusion_uart_rx_timing_consume (ddi_fusion_uart_handle handle, ddi_em_handle em_handle, uint32_t length);
+
+#endif // DDI_EM_UART_RX_TIMING_H
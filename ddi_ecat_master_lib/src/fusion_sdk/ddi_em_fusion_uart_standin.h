@@ -0,0 +1,31 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_standin.h
+
+#ifndef DDI_EM_FUSION_UART_STANDIN_H
+#define DDI_EM_FUSION_UART_STANDIN_H
+
+#include "ddi_em_api.h"
+
+#ifndef DDI_EM_TEST_STANDIN
+#error "The stand-ins are only built into the test variant of the library, define DDI_EM_TEST_STANDIN"
+#endif
+
+/** ddi_fusion_uart_map_standin_status
+ @brief Map the UART status words of a module to a stand-in image instead of the process data of a Fusion slave, used
+        by the tests that run without EtherCAT hardware. The status mirror, the events and the receive timelines then
+        follow the image every cycle. Called before the UART handles of the module are opened.
+ @param[in] em_handle The EtherCAT Master handle
+ @param[in] index The UART configuration index of the module (0x5nn5)
+ @param[in] physical_channel The physical UART channel of channel 0 of the module, a multiple of 4 below 64
+ @param[in] status_image The status words of the 4 channels of the module, NULL to unmap them
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_fusion_uart_map_standin_status (ddi_em_handle em_handle, uint16_t index, uint16_t physical_channel, uint16_t *status_image);
+
+#endif // DDI_EM_FUSION_UART_STANDIN_H
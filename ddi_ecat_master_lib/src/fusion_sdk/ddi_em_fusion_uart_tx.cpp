@@ -0,0 +1,706 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include "ddi_debug.h"
+#include "ddi_em_api.h"
+#include "ddi_em_config.h"
+#include "ddi_em_logging.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_fusion_uart.h"
+#include "ddi_em_fusion_uart_tx.h"
+
+// UART transmit scheduler
+// Every master instance has one scheduler thread that makes the UART Tx SDO transfers of all its UART handles, so
+// concurrent transmits queue up here instead of racing for the mailbox. The channels are served in deficit round-robin
+// order: each turn a channel with queued data gets its weight times DDI_FUSION_UART_SDO_DATA_SIZE_MAX bytes of credit
+// and sends SDOs while the credit lasts. Consecutive queued writes are coalesced into one SDO of up to
+// DDI_FUSION_UART_SDO_DATA_SIZE_MAX bytes, a write is never split across two SDOs.
+
+#define UART_TX_WEIGHT_MAX 64
+
+// Completion of a ddi_fusion_uart_tx_data() write, lives on the waiting thread's stack
+typedef struct {
+  bool          done;
+  ddi_em_result result;
+} uart_tx_waiter;
+
+// One queued write of up to DDI_FUSION_UART_SDO_DATA_SIZE_MAX bytes
+typedef struct uart_tx_write {
+  struct uart_tx_write *next;
+  const uint8_t        *data;       // Follows the structure, or the caller's data of a ddi_fusion_uart_tx_send_wait() write
+  uint32_t              length;
+  uint64_t              queued_ns;
+  uart_tx_waiter       *waiter;     // NULL for ddi_fusion_uart_tx_queue() writes
+} uart_tx_write;
+
+// The transmit queue and statistics of a UART handle, protected by the lock of the handle's master instance
+typedef struct {
+  uart_tx_write *head;
+  uart_tx_write *tail;
+  uint32_t       queued_bytes;
+  uint32_t       queued_writes;
+  uint32_t       inflight_writes;  // Writes taken off the queue by the running SDO
+  uint32_t       weight;           // 0 until set, which is the same as 1
+  uint32_t       deficit;          // Bytes the channel may still send this round
+  ddi_em_result  flush_result;     // First failed SDO since the previous ddi_fusion_uart_tx_flush_queue()
+  // Statistics
+  uint64_t       bytes_sent;
+  uint64_t       writes_sent;
+  uint64_t       sdo_count;
+  uint64_t       errors;
+  uint64_t       latency_sum_us;
+  uint32_t       max_latency_us;
+  ddi_em_result  last_error;
+  uint64_t       stats_start_ns;   // Start of the throughput interval, 0 until the first write after a reset
+} uart_tx_channel;
+
+// The transmit scheduler of a master instance
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t  work_cond;       // Signals the scheduler thread: data queued or stop requested
+  pthread_cond_t  done_cond;       // Signals the waiters: writes completed or dropped
+  bool            lock_initialized;
+  bool            running;
+  bool            stop;
+  pthread_t       thread;
+  uint32_t        queue_limit;
+  uint32_t        next_channel;    // The open handle list position the next round starts with
+  uint32_t        generation;      // Counts the channel resets, a round is cut short by a reset during an SDO
+} uart_tx_scheduler;
+
+static uart_tx_scheduler g_uart_tx[DDI_EM_MAX_MASTER_INSTANCES];
+
+// The transmit channel of a UART handle is allocated by its first open and reused when the handle is opened again
+static uart_tx_channel *g_uart_tx_channels[MAX_UART_INSTANCES];
+
+// Allocate a write, the data of a write without a waiter is copied. A waiter keeps its data until the write completes.
+static uart_tx_write *alloc_tx_write (const uint8_t *data, uint32_t length, uint64_t queued_ns, uart_tx_waiter *waiter)
+{
+  uart_tx_write *write = (uart_tx_write *)malloc(sizeof(uart_tx_write) + (waiter ? 0 : length));
+
+  if ( write != NULL )
+  {
+    write->next = NULL;
+    write->length = length;
+    write->queued_ns = queued_ns;
+    write->waiter = waiter;
+    write->data = data;
+    if ( waiter == NULL )
+    {
+      memcpy(write + 1, data, length);
+      write->data = (const uint8_t *)(write + 1);
+    }
+  }
+  return write;
+}
+
+// Complete and free a list of writes, called with the scheduler lock held
+static void complete_tx_writes (uart_tx_write *write, ddi_em_result result)
+{
+  uart_tx_write *next;
+
+  for ( ; write != NULL; write = next )
+  {
+    next = write->next;
+    if ( write->waiter != NULL )
+    {
+      write->waiter->result = result;
+      write->waiter->done = true;
+    }
+    free(write);
+  }
+}
+
+// Drop the queued writes of a channel, called with the scheduler lock held
+static void drop_tx_queue (uart_tx_channel *channel)
+{
+  complete_tx_writes(channel->head, DDI_EM_STATUS_OP_CANCELLED);
+  channel->head = NULL;
+  channel->tail = NULL;
+  channel->queued_bytes = 0;
+  channel->queued_writes = 0;
+  channel->deficit = 0;
+}
+
+// Update the statistics of a channel with a completed SDO, called with the scheduler lock held
+static void update_tx_stats (uart_tx_channel *channel, uart_tx_write *writes, uint32_t length, ddi_em_result result, uint64_t now_ns)
+{
+  uint64_t latency_us;
+
+  channel->sdo_count++;
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    channel->errors++;
+    channel->last_error = result;
+    if ( channel->flush_result == DDI_EM_STATUS_OK )
+    {
+      channel->flush_result = result;
+    }
+    return;
+  }
+  channel->bytes_sent += length;
+  for ( ; writes != NULL; writes = writes->next )
+  {
+    latency_us = (now_ns - writes->queued_ns) / NSEC_PER_USEC;
+    channel->writes_sent++;
+    channel->latency_sum_us += latency_us;
+    if ( latency_us > channel->max_latency_us )
+    {
+      channel->max_latency_us = (uint32_t)latency_us;
+    }
+  }
+}
+
+// Send the coalesced writes at the head of a channel queue while its deficit lasts
+// Called with the scheduler lock held, the lock is released during the SDO transfers
+static void service_tx_channel (uart_tx_scheduler *scheduler, uart_tx_channel *channel, ddi_fusion_uart_handle handle)
+{
+  uint8_t image[UART_SDO_IMAGE_SIZE];
+  uart_tx_write *first, *last;
+  uint32_t length, write_count;
+  ddi_em_result result;
+
+  while ( (channel->head != NULL) && !scheduler->stop )
+  {
+    // Coalesce the writes at the head of the queue
+    first = last = channel->head;
+    length = first->length;
+    write_count = 1;
+    while ( (last->next != NULL) && (length + last->next->length <= DDI_FUSION_UART_SDO_DATA_SIZE_MAX) )
+    {
+      last = last->next;
+      length += last->length;
+      write_count++;
+    }
+    if ( length > channel->deficit )
+    {
+      return;
+    }
+    // Take the writes off the queue, so more writes can be queued during the transfer
+    channel->head = last->next;
+    if ( channel->head == NULL )
+    {
+      channel->tail = NULL;
+    }
+    last->next = NULL;
+    channel->queued_bytes -= length;
+    channel->queued_writes -= write_count;
+    channel->inflight_writes = write_count;
+    channel->deficit -= length;
+    // The writes are copied once, into the SDO image
+    length = 0;
+    for ( last = first; last != NULL; last = last->next )
+    {
+      memcpy(&image[SIZEOF_SI0 + length], last->data, last->length);
+      length += last->length;
+    }
+
+    pthread_mutex_unlock(&scheduler->lock);
+    result = ddi_fusion_uart_write_tx_image(handle, image, length);
+    pthread_mutex_lock(&scheduler->lock);
+
+    update_tx_stats(channel, first, length, result, ddi_fusion_uart_time_ns());
+    complete_tx_writes(first, result);
+    channel->inflight_writes = 0;
+    pthread_cond_broadcast(&scheduler->done_cond);
+  }
+  // Credit is not carried over by a channel without queued data
+  channel->deficit = 0;
+}
+
+// The scheduler thread of a master instance
+static void *uart_tx_thread (void *arg)
+{
+  ddi_em_handle em_handle = (ddi_em_handle)(intptr_t)arg;
+  uart_tx_scheduler *scheduler = &g_uart_tx[em_handle];
+  ddi_fusion_uart_handle *handles = NULL, handle;
+  uart_tx_channel *channel;
+  uint32_t capacity = 0, count, index, weight, generation;
+  bool queued;
+
+  pthread_mutex_lock(&scheduler->lock);
+  while ( !scheduler->stop )
+  {
+    queued = false;
+    // Only the open handles of this master instance can have queued data. A handle closed while an SDO runs may be
+    // opened on another master instance right after, the round ends there and the next one takes a new list.
+    count = ddi_fusion_uart_get_master_handles(em_handle, &handles, &capacity);
+    generation = scheduler->generation;
+    for ( index = 0; (index < count) && !scheduler->stop && (scheduler->generation == generation); index++ )
+    {
+      handle = handles[(scheduler->next_channel + index) % count];
+      channel = g_uart_tx_channels[handle];
+      if ( channel->head == NULL )
+      {
+        continue;
+      }
+      weight = __atomic_load_n(&channel->weight, __ATOMIC_RELAXED);
+      channel->deficit += (weight ? weight : 1) * DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+      service_tx_channel(scheduler, channel, handle);
+      queued = true;
+    }
+    // Rotate the start of the round so the first open handles are not always served first
+    scheduler->next_channel = count ? (scheduler->next_channel + 1) % count : 0;
+    if ( !queued && !scheduler->stop )
+    {
+      pthread_cond_wait(&scheduler->work_cond, &scheduler->lock);
+    }
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+  free(handles);
+  return NULL;
+}
+
+// Reset the transmit scheduler of a new master instance
+void ddi_fusion_uart_tx_init (ddi_em_handle em_handle)
+{
+  uart_tx_scheduler *scheduler = &g_uart_tx[em_handle];
+  pthread_condattr_t cond_attr;
+
+  if ( !scheduler->lock_initialized )
+  {
+    pthread_mutex_init(&scheduler->lock, NULL);
+    // ddi_fusion_uart_tx_flush_queue() timeouts must not follow wall clock changes
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&scheduler->done_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+    pthread_cond_init(&scheduler->work_cond, NULL);
+    scheduler->lock_initialized = true;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  scheduler->running = false;
+  scheduler->stop = false;
+  scheduler->next_channel = 0;
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+// Stop the transmit scheduler of a master instance
+void ddi_fusion_uart_tx_deinit (ddi_em_handle em_handle)
+{
+  ddi_fusion_uart_tx_scheduler_stop(em_handle);
+}
+
+// Free the transmit channels, no master instance is left to schedule them
+void ddi_fusion_uart_tx_free_channels (void)
+{
+  uint32_t handle;
+
+  for ( handle = 0; handle < MAX_UART_INSTANCES; handle++ )
+  {
+    free(g_uart_tx_channels[handle]);
+    g_uart_tx_channels[handle] = NULL;
+  }
+}
+
+// Allocate the transmit channel of a UART handle being opened
+ddi_em_result ddi_fusion_uart_tx_attach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle)
+{
+  // No scheduler finds the handle before the open links it to its master instance, a channel left by a previous open
+  // was cleared by its close
+  if ( g_uart_tx_channels[handle] == NULL )
+  {
+    g_uart_tx_channels[handle] = (uart_tx_channel *)calloc(1, sizeof(uart_tx_channel));
+    if ( g_uart_tx_channels[handle] == NULL )
+    {
+      ELOG(em_handle, "No memory for the transmit channel of UART %d\n", handle);
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+  }
+  return DDI_EM_STATUS_OK;
+}
+
+// Free the transmit channel of a UART handle whose open failed
+void ddi_fusion_uart_tx_detach (ddi_fusion_uart_handle handle)
+{
+  // The handle never reached the open handle list of its master instance, no scheduler has seen the channel
+  free(g_uart_tx_channels[handle]);
+  g_uart_tx_channels[handle] = NULL;
+}
+
+// Is the transmit scheduler of the master instance running?
+bool ddi_fusion_uart_tx_is_scheduled (ddi_em_handle em_handle)
+{
+  return __atomic_load_n(&g_uart_tx[em_handle].running, __ATOMIC_ACQUIRE);
+}
+
+// Queue a write on the scheduler and wait until it was sent
+ddi_em_result ddi_fusion_uart_tx_send_wait (ddi_fusion_uart_handle handle, ddi_em_handle em_handle, const uint8_t *data, uint32_t length)
+{
+  uart_tx_scheduler *scheduler = &g_uart_tx[em_handle];
+  uart_tx_channel *channel = g_uart_tx_channels[handle];
+  uart_tx_waiter waiter = { false, DDI_EM_STATUS_OK };
+  uart_tx_write *write;
+
+  write = alloc_tx_write(data, length, ddi_fusion_uart_time_ns(), &waiter);
+  if ( write == NULL )
+  {
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  if ( !scheduler->running || scheduler->stop )
+  {
+    pthread_mutex_unlock(&scheduler->lock);
+    free(write);
+    // The scheduler stopped in the meantime, send directly
+    return ddi_fusion_uart_write_tx_data(handle, data, length);
+  }
+  // A synchronous write is not held back by the queue limit, the caller waits for it anyway
+  if ( channel->tail != NULL )
+  {
+    channel->tail->next = write;
+  }
+  else
+  {
+    channel->head = write;
+  }
+  channel->tail = write;
+  channel->queued_bytes += length;
+  channel->queued_writes++;
+  if ( channel->stats_start_ns == 0 )
+  {
+    channel->stats_start_ns = write->queued_ns;
+  }
+  pthread_cond_signal(&scheduler->work_cond);
+  while ( !waiter.done )
+  {
+    pthread_cond_wait(&scheduler->done_cond, &scheduler->lock);
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+  return waiter.result;
+}
+
+// Drop the queued writes of a closed UART handle and reset its weight and statistics
+void ddi_fusion_uart_tx_reset_channel (ddi_fusion_uart_handle handle, ddi_em_handle em_handle)
+{
+  uart_tx_scheduler *scheduler = &g_uart_tx[em_handle];
+  uart_tx_channel *channel = g_uart_tx_channels[handle];
+
+  if ( channel == NULL )
+  {
+    return;
+  }
+  if ( !scheduler->lock_initialized )
+  {
+    memset(channel, 0, sizeof(uart_tx_channel));
+    return;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  // The scheduler thread drops the handle from the round it is in
+  scheduler->generation++;
+  drop_tx_queue(channel);
+  // Wait for the running SDO of the channel, its completion must not update the statistics of the next user
+  while ( channel->inflight_writes != 0 )
+  {
+    pthread_cond_wait(&scheduler->done_cond, &scheduler->lock);
+  }
+  memset(channel, 0, sizeof(uart_tx_channel));
+  pthread_cond_broadcast(&scheduler->done_cond);
+  pthread_mutex_unlock(&scheduler->lock);
+}
+
+// Start the UART transmit scheduler of a master instance
+EM_API ddi_em_result ddi_fusion_uart_tx_scheduler_start (ddi_em_handle em_handle, uint32_t queue_limit)
+{
+  uart_tx_scheduler *scheduler;
+  int thread_result;
+
+  VALIDATE_INSTANCE(em_handle);
+  scheduler = &g_uart_tx[em_handle];
+  if ( !scheduler->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  if ( scheduler->running )
+  {
+    pthread_mutex_unlock(&scheduler->lock);
+    return DDI_EM_STATUS_BUSY;
+  }
+  scheduler->queue_limit = queue_limit ? queue_limit : DDI_FUSION_UART_TX_QUEUE_DEFAULT;
+  scheduler->stop = false;
+  thread_result = pthread_create(&scheduler->thread, NULL, uart_tx_thread, (void *)(intptr_t)em_handle);
+  if ( thread_result != 0 )
+  {
+    pthread_mutex_unlock(&scheduler->lock);
+    ELOG(em_handle, "UART transmit scheduler thread create failed %d\n", thread_result);
+    return DDI_EM_STATUS_NO_RESOURCES;
+  }
+  __atomic_store_n(&scheduler->running, true, __ATOMIC_RELEASE);
+  pthread_mutex_unlock(&scheduler->lock);
+  DLOG(em_handle, "UART transmit scheduler started, queue limit %u bytes\n", scheduler->queue_limit);
+  return DDI_EM_STATUS_OK;
+}
+
+// Stop the UART transmit scheduler of a master instance, queued writes are dropped
+EM_API ddi_em_result ddi_fusion_uart_tx_scheduler_stop (ddi_em_handle em_handle)
+{
+  uart_tx_scheduler *scheduler;
+  ddi_fusion_uart_handle *handles = NULL;
+  uint32_t capacity = 0, count, index;
+
+  VALIDATE_INSTANCE(em_handle);
+  scheduler = &g_uart_tx[em_handle];
+  if ( !scheduler->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  pthread_mutex_lock(&scheduler->lock);
+  if ( !scheduler->running || scheduler->stop )
+  {
+    pthread_mutex_unlock(&scheduler->lock);
+    return DDI_EM_STATUS_NOT_READY;
+  }
+  scheduler->stop = true;
+  pthread_cond_signal(&scheduler->work_cond);
+  pthread_mutex_unlock(&scheduler->lock);
+  // The thread finishes the SDO it is making, then leaves
+  pthread_join(scheduler->thread, NULL);
+
+  pthread_mutex_lock(&scheduler->lock);
+  count = ddi_fusion_uart_get_master_handles(em_handle, &handles, &capacity);
+  for ( index = 0; index < count; index++ )
+  {
+    drop_tx_queue(g_uart_tx_channels[handles[index]]);
+  }
+  __atomic_store_n(&scheduler->running, false, __ATOMIC_RELEASE);
+  scheduler->stop = false;
+  pthread_cond_broadcast(&scheduler->done_cond);
+  pthread_mutex_unlock(&scheduler->lock);
+  free(handles);
+  DLOG(em_handle, "UART transmit scheduler stopped\n");
+  return DDI_EM_STATUS_OK;
+}
+
+// Set the scheduler weight of a UART handle
+EM_API ddi_em_result ddi_fusion_uart_set_tx_weight (ddi_fusion_uart_handle handle, uint32_t weight)
+{
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+
+  VALIDATE_UART_INSTANCE(handle);
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  if ( (weight == 0) || (weight > UART_TX_WEIGHT_MAX) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  __atomic_store_n(&g_uart_tx_channels[handle]->weight, weight, __ATOMIC_RELAXED);
+  return DDI_EM_STATUS_OK;
+}
+
+// Queue data for a UART handle without waiting
+EM_API ddi_em_result ddi_fusion_uart_tx_queue (ddi_fusion_uart_handle handle, const uint8_t *source_buffer, uint32_t tx_length)
+{
+  uart_tx_scheduler *scheduler;
+  uart_tx_channel *channel;
+  uart_tx_write *first = NULL, *last = NULL, *write;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  uint64_t queued_ns;
+  uint32_t offset, length, write_count = 0;
+
+  VALIDATE_UART_INSTANCE(handle);
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  if ( (source_buffer == NULL) || (tx_length == 0) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  scheduler = &g_uart_tx[em_handle];
+  channel = g_uart_tx_channels[handle];
+  if ( !ddi_fusion_uart_tx_is_scheduled(em_handle) )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+
+  // Split the data into writes of up to one SDO payload before taking the lock
+  queued_ns = ddi_fusion_uart_time_ns();
+  for ( offset = 0; offset < tx_length; offset += length )
+  {
+    length = tx_length - offset;
+    if ( length > DDI_FUSION_UART_SDO_DATA_SIZE_MAX )
+    {
+      length = DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+    }
+    write = alloc_tx_write(&source_buffer[offset], length, queued_ns, NULL);
+    if ( write == NULL )
+    {
+      complete_tx_writes(first, DDI_EM_STATUS_NO_RESOURCES);
+      return DDI_EM_STATUS_NO_RESOURCES;
+    }
+    if ( last != NULL )
+    {
+      last->next = write;
+    }
+    else
+    {
+      first = write;
+    }
+    last = write;
+    write_count++;
+  }
+
+  pthread_mutex_lock(&scheduler->lock);
+  if ( !scheduler->running || scheduler->stop )
+  {
+    result = DDI_EM_STATUS_NOT_READY;
+  }
+  else if ( channel->queued_bytes + tx_length > scheduler->queue_limit )
+  {
+    result = DDI_EM_STATUS_BUSY;
+  }
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    pthread_mutex_unlock(&scheduler->lock);
+    complete_tx_writes(first, result);
+    return result;
+  }
+  if ( channel->tail != NULL )
+  {
+    channel->tail->next = first;
+  }
+  else
+  {
+    channel->head = first;
+  }
+  channel->tail = last;
+  channel->queued_bytes += tx_length;
+  channel->queued_writes += write_count;
+  if ( channel->stats_start_ns == 0 )
+  {
+    channel->stats_start_ns = queued_ns;
+  }
+  pthread_cond_signal(&scheduler->work_cond);
+  pthread_mutex_unlock(&scheduler->lock);
+  return DDI_EM_STATUS_OK;
+}
+
+// Wait until the transmit queue of a UART handle is empty
+EM_API ddi_em_result ddi_fusion_uart_tx_flush_queue (ddi_fusion_uart_handle handle, uint32_t timeout_ms)
+{
+  uart_tx_scheduler *scheduler;
+  uart_tx_channel *channel;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  struct timespec deadline;
+  int wait_result = 0;
+
+  VALIDATE_UART_INSTANCE(handle);
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  scheduler = &g_uart_tx[em_handle];
+  channel = g_uart_tx_channels[handle];
+  if ( !scheduler->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec  += timeout_ms / MSEC_PER_SEC;
+  deadline.tv_nsec += (timeout_ms % MSEC_PER_SEC) * NSEC_PER_MSEC;
+  if ( deadline.tv_nsec >= NSEC_PER_SEC )
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= NSEC_PER_SEC;
+  }
+
+  pthread_mutex_lock(&scheduler->lock);
+  while ( ((channel->head != NULL) || (channel->inflight_writes != 0)) && (wait_result != ETIMEDOUT) )
+  {
+    wait_result = pthread_cond_timedwait(&scheduler->done_cond, &scheduler->lock, &deadline);
+  }
+  if ( (channel->head != NULL) || (channel->inflight_writes != 0) )
+  {
+    result = DDI_EM_STATUS_TIMEOUT;
+  }
+  else
+  {
+    result = channel->flush_result;
+    channel->flush_result = DDI_EM_STATUS_OK;
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+  return result;
+}
+
+// Get the transmit statistics of a UART handle
+EM_API ddi_em_result ddi_fusion_uart_get_tx_stats (ddi_fusion_uart_handle handle, ddi_fusion_uart_tx_stats *stats, bool reset)
+{
+  uart_tx_scheduler *scheduler;
+  uart_tx_channel *channel;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  uint64_t elapsed_ns;
+
+  VALIDATE_UART_INSTANCE(handle);
+  result = ddi_fusion_uart_get_em_handle(handle, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return result;
+  }
+  if ( stats == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  scheduler = &g_uart_tx[em_handle];
+  channel = g_uart_tx_channels[handle];
+  if ( !scheduler->lock_initialized )
+  {
+    return DDI_EM_STATUS_NOT_READY;
+  }
+
+  pthread_mutex_lock(&scheduler->lock);
+  memset(stats, 0, sizeof(ddi_fusion_uart_tx_stats));
+  stats->bytes_sent     = channel->bytes_sent;
+  stats->writes_sent    = channel->writes_sent;
+  stats->sdo_count      = channel->sdo_count;
+  stats->errors         = channel->errors;
+  stats->queued_bytes   = channel->queued_bytes;
+  stats->queued_writes  = channel->queued_writes;
+  stats->max_latency_us = channel->max_latency_us;
+  stats->last_error     = channel->last_error;
+  if ( channel->writes_sent != 0 )
+  {
+    stats->avg_latency_us = (uint32_t)(channel->latency_sum_us / channel->writes_sent);
+  }
+  if ( channel->stats_start_ns != 0 )
+  {
+    elapsed_ns = ddi_fusion_uart_time_ns() - channel->stats_start_ns;
+    if ( elapsed_ns != 0 )
+    {
+      stats->bytes_per_sec = (uint32_t)((channel->bytes_sent * NSEC_PER_SEC) / elapsed_ns);
+    }
+  }
+  if ( reset )
+  {
+    channel->bytes_sent = 0;
+    channel->writes_sent = 0;
+    channel->sdo_count = 0;
+    channel->errors = 0;
+    channel->latency_sum_us = 0;
+    channel->max_latency_us = 0;
+    channel->last_error = DDI_EM_STATUS_OK;
+    channel->stats_start_ns = ddi_fusion_uart_time_ns();
+  }
+  pthread_mutex_unlock(&scheduler->lock);
+  return DDI_EM_STATUS_OK;
+}
@@ -0,0 +1,72 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+/// @file ddi_em_fusion_uart_tx.h
+
+#ifndef DDI_EM_UART_TX_H
+#define DDI_EM_UART_TX_H
+
+// UART transmit scheduler of a master instance
+
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+
+/** ddi_fusion_uart_tx_init
+ @brief Reset the UART transmit scheduler of a new master instance
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_tx_init (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_tx_deinit
+ @brief Stop the UART transmit scheduler of a master instance, queued transmits are dropped
+ @param em_handle The EtherCAT master handle
+ */
+void ddi_fusion_uart_tx_deinit (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_tx_free_channels
+ @brief Free the transmit channels of the UART handles, called by ddi_em_sdk_deinit() after every master instance stopped
+ */
+void ddi_fusion_uart_tx_free_channels (void);
+
+/** ddi_fusion_uart_tx_attach
+ @brief Allocate the transmit channel of a UART handle being opened, the channel is kept for the reopens of the handle
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ @return ddi_em_result DDI_EM_STATUS_NO_RESOURCES if the channel can't be allocated
+ */
+ddi_em_result ddi_fusion_uart_tx_attach (ddi_fusion_uart_handle handle, ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_tx_detach
+ @brief Free the transmit channel of a UART handle whose open failed after ddi_fusion_uart_tx_attach()
+ @param handle The UART handle
+ */
+void ddi_fusion_uart_tx_detach (ddi_fusion_uart_handle handle);
+
+/** ddi_fusion_uart_tx_is_scheduled
+ @brief Is the UART transmit scheduler of the master instance running?
+ @param em_handle The EtherCAT master handle
+ */
+bool ddi_fusion_uart_tx_is_scheduled (ddi_em_handle em_handle);
+
+/** ddi_fusion_uart_tx_send_wait
+ @brief Queue a transmit of up to 255 bytes on the scheduler and wait until it was sent
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ @param data The data to send
+ @param length The data length
+ @return ddi_em_result The SDO result, or DDI_EM_STATUS_OP_CANCELLED if the scheduler stopped first
+ */
+ddi_em_result ddi_fusion_uart_tx_send_wait (ddi_fusion_uart_handle handle, ddi_em_handle em_handle, const uint8_t *data, uint32_t length);
+
+/** ddi_fusion_uart_tx_reset_channel
+ @brief Drop the queued transmits of a UART handle being closed and reset its weight and statistics
+ @param handle The UART handle
+ @param em_handle The EtherCAT master handle of the UART handle
+ */
+void ddi_fusion_uart_tx_reset_channel (ddi_fusion_uart_handle handle, ddi_em_handle em_handle);
+
+#endif // DDI_EM_UART_TX_H
@@ -0,0 +1,190 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Live cycle rate change test program
+// Runs the master over the in-memory loopback link and switches the cycle rate while the cyclic thread is running.
+// Usage: ddi_em_cycle_rate_test [eni file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ddi_em_api.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_SLOW_RATE_US       4000
+#define TEST_FAST_RATE_US       1000
+#define TEST_CYCLES_PER_PHASE   200
+#define TEST_MAX_SAMPLES        2048
+#define TEST_SWITCH_TIMEOUT_MS  1000
+// The test may run without real-time priority, allow for scheduling latency
+#define TEST_LATENCY_ALLOWANCE_NS (2 * 1000 * 1000)
+
+// Cycle timestamps recorded by the cyclic callback
+typedef struct {
+  volatile uint32_t count;
+  uint64_t          timestamp_ns[TEST_MAX_SAMPLES];
+} cycle_samples;
+
+static cycle_samples g_samples;
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void cyclic_callback(void *arg)
+{
+  cycle_samples *samples = (cycle_samples *)arg;
+  if ( samples->count < TEST_MAX_SAMPLES )
+  {
+    samples->timestamp_ns[samples->count] = monotonic_ns();
+    samples->count++;
+  }
+}
+
+// Wait until the cyclic thread reports the given cycle rate
+static bool wait_for_cycle_rate(ddi_em_handle em_handle, uint32_t cycle_rate_us)
+{
+  ddi_em_master_stats stats;
+  uint32_t waited_ms;
+  for ( waited_ms = 0; waited_ms < TEST_SWITCH_TIMEOUT_MS; waited_ms++ )
+  {
+    ddi_em_get_master_stats(em_handle, &stats);
+    if ( stats.cycle_rate_us == cycle_rate_us )
+    {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+// Wait for count more cycles
+static void wait_for_cycles(uint32_t count)
+{
+  uint32_t target = g_samples.count + count;
+  while ( (g_samples.count < target) && (g_samples.count < TEST_MAX_SAMPLES) )
+  {
+    usleep(1000);
+  }
+}
+
+// Check the cycle intervals between two sample indexes against the expected rate
+static void check_intervals(const char *phase, uint32_t first, uint32_t last, uint32_t cycle_rate_us)
+{
+  uint64_t period_ns = (uint64_t)cycle_rate_us * 1000;
+  uint64_t sum_ns = 0;
+  uint64_t max_ns = 0;
+  uint32_t index;
+  for ( index = first + 1; index <= last; index++ )
+  {
+    uint64_t delta_ns = g_samples.timestamp_ns[index] - g_samples.timestamp_ns[index - 1];
+    sum_ns += delta_ns;
+    if ( delta_ns > max_ns )
+    {
+      max_ns = delta_ns;
+    }
+  }
+  uint64_t average_ns = sum_ns / (last - first);
+  printf("%s: %u cycles, average %lu ns, max %lu ns (expected %lu ns)\n", phase, last - first,
+    (unsigned long)average_ns, (unsigned long)max_ns, (unsigned long)period_ns);
+  // The scheduler uses absolute deadlines, so the average is exact even when single cycles are late
+  TEST_CHECK((average_ns > period_ns * 95 / 100) && (average_ns < period_ns * 105 / 100), "%s average interval %lu ns", phase, (unsigned long)average_ns);
+  // A restart of the task would show up as a gap of several cycles
+  TEST_CHECK(max_ns < 2 * period_ns + TEST_LATENCY_ALLOWANCE_NS, "%s max interval %lu ns", phase, (unsigned long)max_ns);
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_em_master_stats stats;
+  ddi_em_state master_state;
+  uint32_t switch_index, switch_back_index, end_index;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = TEST_FAST_RATE_US;
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  ddi_em_register_cyclic_callback(em_handle, cyclic_callback, &g_samples);
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  TEST_CHECK(ddi_em_set_cycle_rate(em_handle, 0) == DDI_EM_STATUS_INVALID_ARG, "a cycle rate of 0 was accepted");
+
+  // Fast phase, then slow down while the task runs
+  wait_for_cycles(TEST_CYCLES_PER_PHASE);
+  ddi_em_get_master_state(em_handle, &master_state);
+  result = ddi_em_set_cycle_rate(em_handle, TEST_SLOW_RATE_US);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_set_cycle_rate(%d) returned 0x%04x", TEST_SLOW_RATE_US, result);
+  TEST_CHECK(wait_for_cycle_rate(em_handle, TEST_SLOW_RATE_US), "the cycle rate did not change to %d us", TEST_SLOW_RATE_US);
+  switch_index = g_samples.count;
+  wait_for_cycles(TEST_CYCLES_PER_PHASE / 4);
+
+  // The timestamp statistics restart with the new rate, so no fast cycle is left in them
+  ddi_em_get_master_stats(em_handle, &stats);
+  TEST_CHECK(stats.min_cyclic_timestamp_diff_ns > TEST_SLOW_RATE_US * 1000 / 2, "min cyclic delta %u ns still holds the old rate",
+    stats.min_cyclic_timestamp_diff_ns);
+  TEST_CHECK(stats.cycle_rate_change_count == 1, "cycle rate change count %u", stats.cycle_rate_change_count);
+
+  // And back to the fast rate
+  result = ddi_em_set_cycle_rate(em_handle, TEST_FAST_RATE_US);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_set_cycle_rate(%d) returned 0x%04x", TEST_FAST_RATE_US, result);
+  TEST_CHECK(wait_for_cycle_rate(em_handle, TEST_FAST_RATE_US), "the cycle rate did not change to %d us", TEST_FAST_RATE_US);
+  switch_back_index = g_samples.count;
+  wait_for_cycles(TEST_CYCLES_PER_PHASE);
+  end_index = g_samples.count - 1;
+
+  // The switches must not restart the task or the network
+  ddi_em_state state_after;
+  ddi_em_get_master_state(em_handle, &state_after);
+  TEST_CHECK(state_after == master_state, "master state changed from %d to %d", master_state, state_after);
+  ddi_em_get_master_stats(em_handle, &stats);
+  TEST_CHECK(stats.cyclic_err_frame_count == 0, "%u lost frames", stats.cyclic_err_frame_count);
+
+  check_intervals("slow phase", switch_index, switch_back_index - 2, TEST_SLOW_RATE_US);
+  check_intervals("fast phase", switch_back_index, end_index, TEST_FAST_RATE_US);
+
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
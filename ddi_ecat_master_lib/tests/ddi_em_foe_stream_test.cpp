@@ -0,0 +1,257 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Streaming FoE transfer test program
+// Runs the master over the in-memory loopback link, which has no slaves, so every download and upload fails. Checks the
+// argument checks of ddi_em_foe_stream_start(), the retries of a download and an upload and the per-slave results of
+// ddi_em_foe_write_parallel(), including a configuration that can't be started. The download to a real slave is tested
+// by ddi_em_foe.
+// Usage: ddi_em_foe_stream_test [eni file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ddi_em_api.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_FILE_SIZE          4096
+// No slave behind the loopback link has this handle
+#define TEST_ES_HANDLE          7
+#define TEST_STREAMS            3
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+static uint8_t g_file[TEST_FILE_SIZE];
+static uint32_t g_done_count[TEST_STREAMS];
+static uint32_t g_sink_bytes;
+
+// Progress callback, counts the completions per stream
+static void count_done(const ddi_em_foe_progress *progress)
+{
+  uint32_t index = (uint32_t)(uintptr_t)progress->user_data;
+  if ( progress->done && (index < TEST_STREAMS) )
+  {
+    __atomic_add_fetch(&g_done_count[index], 1, __ATOMIC_RELAXED);
+  }
+}
+
+// Chunk source of the test file
+static ddi_em_result read_chunk(void *user_data, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  memcpy(buffer, (const uint8_t *)user_data + offset, length);
+  return DDI_EM_STATUS_OK;
+}
+
+// Chunk sink of an upload, counts the bytes
+static ddi_em_result write_chunk(void *user_data, uint32_t offset, const uint8_t *buffer, uint32_t length)
+{
+  __atomic_add_fetch(&g_sink_bytes, length, __ATOMIC_RELAXED);
+  return DDI_EM_STATUS_OK;
+}
+
+// Return a download of the test file from memory
+static ddi_em_foe_stream_config make_config(uint32_t index)
+{
+  ddi_em_foe_stream_config config;
+  memset(&config, 0, sizeof(config));
+  config.es_handle = TEST_ES_HANDLE;
+  config.filename = "test.efw";
+  config.timeout = 100;
+  config.data = g_file;
+  config.size = sizeof(g_file);
+  config.progress = count_done;
+  config.user_data = (void *)(uintptr_t)index;
+  return config;
+}
+
+// The argument checks leave an invalid stream id
+static void test_start_checks(ddi_em_handle em_handle)
+{
+  ddi_em_foe_stream_config config;
+  ddi_em_foe_stream_id stream_id;
+  ddi_em_foe_progress progress;
+
+  stream_id = 0x5a5a5a5a;
+  TEST_CHECK(ddi_em_foe_stream_start(em_handle, NULL, &stream_id) == DDI_EM_STATUS_NULL_ARGUMENT, "a NULL configuration was accepted");
+  TEST_CHECK(stream_id == DDI_EM_FOE_INVALID_STREAM, "a NULL configuration left the stream id 0x%x", stream_id);
+
+  config = make_config(0);
+  config.filename = NULL;
+  stream_id = 0x5a5a5a5a;
+  TEST_CHECK(ddi_em_foe_stream_start(em_handle, &config, &stream_id) == DDI_EM_STATUS_NULL_ARGUMENT, "a NULL filename was accepted");
+  TEST_CHECK(stream_id == DDI_EM_FOE_INVALID_STREAM, "a NULL filename left the stream id 0x%x", stream_id);
+
+  config = make_config(0);
+  config.source = read_chunk;
+  stream_id = 0x5a5a5a5a;
+  TEST_CHECK(ddi_em_foe_stream_start(em_handle, &config, &stream_id) == DDI_EM_STATUS_INVALID_ARG, "two file sources were accepted");
+  TEST_CHECK(stream_id == DDI_EM_FOE_INVALID_STREAM, "two file sources left the stream id 0x%x", stream_id);
+
+  config = make_config(0);
+  config.sink = write_chunk;
+  stream_id = 0x5a5a5a5a;
+  TEST_CHECK(ddi_em_foe_stream_start(em_handle, &config, &stream_id) == DDI_EM_STATUS_INVALID_ARG, "a source and a sink were accepted");
+  TEST_CHECK(stream_id == DDI_EM_FOE_INVALID_STREAM, "a source and a sink left the stream id 0x%x", stream_id);
+
+  config = make_config(0);
+  config.size = 0;
+  TEST_CHECK(ddi_em_foe_stream_start(em_handle, &config, &stream_id) == DDI_EM_STATUS_INVALID_SIZE, "an empty file was accepted");
+
+  TEST_CHECK(ddi_em_foe_stream_wait(em_handle, DDI_EM_FOE_INVALID_STREAM, 0, &progress) == DDI_EM_STATUS_NOT_FOUND,
+    "waiting for the invalid stream id didn't fail");
+  TEST_CHECK(ddi_em_foe_stream_cancel(em_handle, DDI_EM_FOE_INVALID_STREAM) == DDI_EM_STATUS_NOT_FOUND,
+    "cancelling the invalid stream id didn't fail");
+}
+
+// A single stream fails after its retries and is released by the wait
+static void test_stream(ddi_em_handle em_handle)
+{
+  ddi_em_foe_stream_config config = make_config(0);
+  ddi_em_foe_stream_id stream_id;
+  ddi_em_foe_progress progress;
+  ddi_em_result result;
+
+  g_done_count[0] = 0;
+  config.max_retries = 1;
+  result = ddi_em_foe_stream_start(em_handle, &config, &stream_id);
+  TEST_CHECK((result == DDI_EM_STATUS_OK) && (stream_id != DDI_EM_FOE_INVALID_STREAM), "ddi_em_foe_stream_start returned 0x%04x", result);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return;
+  }
+  memset(&progress, 0, sizeof(progress));
+  result = ddi_em_foe_stream_wait(em_handle, stream_id, 10000, &progress);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_foe_stream_wait returned 0x%04x", result);
+  TEST_CHECK(progress.done && (progress.result != DDI_EM_STATUS_OK) && (progress.retries == 1) && (progress.stream_id == stream_id) &&
+    (progress.total_bytes == TEST_FILE_SIZE), "download to a missing slave: done %u, result 0x%04x, %u retries", progress.done,
+    progress.result, progress.retries);
+  TEST_CHECK(g_done_count[0] == 1, "%u completions reported", g_done_count[0]);
+  TEST_CHECK(ddi_em_foe_stream_wait(em_handle, stream_id, 0, &progress) == DDI_EM_STATUS_NOT_FOUND, "the stream was released twice");
+}
+
+// An upload without a size fails after its retries, the sink never sees a byte
+static void test_upload(ddi_em_handle em_handle)
+{
+  ddi_em_foe_stream_config config = make_config(0);
+  ddi_em_foe_stream_id stream_id;
+  ddi_em_foe_progress progress;
+  ddi_em_result result;
+
+  g_done_count[0] = 0;
+  g_sink_bytes = 0;
+  config.data = NULL;
+  config.size = 0;
+  config.sink = write_chunk;
+  config.max_retries = 1;
+  result = ddi_em_foe_stream_start(em_handle, &config, &stream_id);
+  TEST_CHECK((result == DDI_EM_STATUS_OK) && (stream_id != DDI_EM_FOE_INVALID_STREAM), "ddi_em_foe_stream_start returned 0x%04x", result);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    return;
+  }
+  memset(&progress, 0, sizeof(progress));
+  result = ddi_em_foe_stream_wait(em_handle, stream_id, 10000, &progress);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_foe_stream_wait returned 0x%04x", result);
+  TEST_CHECK(progress.done && (progress.result != DDI_EM_STATUS_OK) && (progress.retries == 1) && (progress.transferred_bytes == 0),
+    "upload from a missing slave: done %u, result 0x%04x, %u retries, %u bytes", progress.done, progress.result, progress.retries,
+    progress.transferred_bytes);
+  TEST_CHECK(g_sink_bytes == 0, "the sink took %u bytes from a missing slave", g_sink_bytes);
+  TEST_CHECK(g_done_count[0] == 1, "%u completions reported", g_done_count[0]);
+}
+
+// Every slave of a parallel download gets its own result, a configuration that can't be started among them
+static void test_parallel(ddi_em_handle em_handle)
+{
+  ddi_em_foe_stream_config configs[TEST_STREAMS];
+  ddi_em_foe_progress results[TEST_STREAMS];
+  ddi_em_result result;
+  uint32_t index;
+
+  for ( index = 0; index < TEST_STREAMS; index++ )
+  {
+    configs[index] = make_config(index);
+    g_done_count[index] = 0;
+  }
+  configs[1].filename = NULL;
+  configs[2].data = NULL;
+  configs[2].source = read_chunk;
+  configs[2].source_data = g_file;
+  memset(results, 0xa5, sizeof(results));
+  result = ddi_em_foe_write_parallel(em_handle, configs, TEST_STREAMS, results);
+  TEST_CHECK(result != DDI_EM_STATUS_OK, "a parallel download to missing slaves succeeded");
+
+  TEST_CHECK(results[1].done && (results[1].result == DDI_EM_STATUS_NULL_ARGUMENT) && (results[1].user_data == configs[1].user_data) &&
+    (results[1].es_handle == TEST_ES_HANDLE), "the NULL filename has result 0x%04x, done %u", results[1].result, results[1].done);
+  TEST_CHECK(g_done_count[1] == 0, "the download that didn't start reported progress");
+  for ( index = 0; index < TEST_STREAMS; index += 2 )
+  {
+    TEST_CHECK(results[index].done && (results[index].result != DDI_EM_STATUS_OK) && (results[index].user_data == configs[index].user_data) &&
+      (results[index].stream_id != DDI_EM_FOE_INVALID_STREAM), "download %u has result 0x%04x, done %u", index, results[index].result,
+      results[index].done);
+    TEST_CHECK(g_done_count[index] == 1, "download %u reported %u completions", index, g_done_count[index]);
+  }
+
+  TEST_CHECK(ddi_em_foe_write_parallel(em_handle, configs, 0, results) == DDI_EM_STATUS_INVALID_ARG, "an empty download was accepted");
+  TEST_CHECK(ddi_em_foe_write_parallel(em_handle, configs, DDI_EM_MAX_FOE_STREAMS + 1, results) == DDI_EM_STATUS_INVALID_ARG,
+    "too many downloads were accepted");
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  uint32_t index;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+  for ( index = 0; index < TEST_FILE_SIZE; index++ )
+  {
+    g_file[index] = (uint8_t)(index * 31);
+  }
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  test_start_checks(em_handle);
+  test_stream(em_handle);
+  test_upload(em_handle);
+  test_parallel(em_handle);
+
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// In-memory loopback link layer, replaces the i8254 optimized link layer in the hardware-free tests
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <AtEthercat.h>
+#include "ddi_em_loopback_link.h"
+
+#define LOOPBACK_QUEUE_SIZE   64    // Frames in flight between send and receive
+#define LOOPBACK_FRAME_SIZE   1536  // Maximum Ethernet frame size
+#define LOOPBACK_SRC_MAC_OFS  6     // Offset of the source MAC address in the Ethernet header
+
+typedef enum {
+  LOOPBACK_SLOT_FREE,    // Slot can take the next sent frame
+  LOOPBACK_SLOT_QUEUED,  // Slot holds a frame waiting to be received
+  LOOPBACK_SLOT_HELD     // Slot was handed to the master, released by FreeRecvFrame
+} loopback_slot_state;
+
+typedef struct {
+  loopback_slot_state state;
+  uint32_t            size;
+  uint8_t             frame[LOOPBACK_FRAME_SIZE];
+} loopback_slot;
+
+typedef struct {
+  pthread_mutex_t             lock;
+  loopback_slot               slots[LOOPBACK_QUEUE_SIZE];
+  uint32_t                    head;          // Next slot to receive
+  uint32_t                    tail;          // Next slot to send into
+  uint32_t                    drop_count;    // Frames still to be dropped
+  ddi_em_loopback_frame_func *handler;
+  void                       *handler_data;
+  ddi_em_loopback_stats       stats;
+} loopback_link;
+
+static loopback_link g_loopback = { PTHREAD_MUTEX_INITIALIZER };
+
+static const uint8_t g_loopback_mac[6] = { 0x02, 0xdd, 0x1e, 0x00, 0x00, 0x01 };
+
+// Queue a sent frame so it's returned by the next receive poll
+static void loopback_queue_frame(EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  loopback_slot *slot;
+
+  pthread_mutex_lock(&g_loopback.lock);
+  g_loopback.stats.tx_frames++;
+  slot = &g_loopback.slots[g_loopback.tail];
+  if ( g_loopback.drop_count || (slot->state != LOOPBACK_SLOT_FREE) || (frame_desc->dwSize > LOOPBACK_FRAME_SIZE) )
+  {
+    if ( g_loopback.drop_count )
+    {
+      g_loopback.drop_count--;
+    }
+    g_loopback.stats.dropped_frames++;
+    pthread_mutex_unlock(&g_loopback.lock);
+    return;
+  }
+  memcpy(slot->frame, frame_desc->pbyFrame, frame_desc->dwSize);
+  slot->size = frame_desc->dwSize;
+  // EtherCAT slaves set the locally administered bit of the source MAC address on the way back
+  slot->frame[LOOPBACK_SRC_MAC_OFS] |= 0x02;
+  if ( g_loopback.handler )
+  {
+    g_loopback.handler(slot->frame, slot->size, g_loopback.handler_data);
+  }
+  slot->state = LOOPBACK_SLOT_QUEUED;
+  g_loopback.tail = (g_loopback.tail + 1) % LOOPBACK_QUEUE_SIZE;
+  pthread_mutex_unlock(&g_loopback.lock);
+}
+
+static EC_T_DWORD loopback_open(EC_T_VOID *link_parms, EC_T_RECEIVEFRAMECALLBACK receive_callback, EC_T_LINK_NOTIFY notify_callback,
+  EC_T_VOID *context, EC_T_VOID **instance)
+{
+  pthread_mutex_lock(&g_loopback.lock);
+  memset(g_loopback.slots, 0, sizeof(g_loopback.slots));
+  g_loopback.head = 0;
+  g_loopback.tail = 0;
+  pthread_mutex_unlock(&g_loopback.lock);
+  *instance = &g_loopback;
+  return EC_E_NOERROR;
+}
+
+static EC_T_DWORD loopback_close(EC_T_VOID *instance)
+{
+  return EC_E_NOERROR;
+}
+
+static EC_T_DWORD loopback_send_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  loopback_queue_frame(frame_desc);
+  return EC_E_NOERROR;
+}
+
+static EC_T_DWORD loopback_alloc_send_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc, EC_T_DWORD size)
+{
+  frame_desc->pbyFrame = (EC_T_BYTE *)calloc(1, size);
+  if ( frame_desc->pbyFrame == NULL )
+  {
+    return EC_E_NOMEMORY;
+  }
+  frame_desc->dwSize = size;
+  return EC_E_NOERROR;
+}
+
+static EC_T_VOID loopback_free_send_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  free(frame_desc->pbyFrame);
+  frame_desc->pbyFrame = EC_NULL;
+}
+
+static EC_T_DWORD loopback_send_and_free_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  loopback_queue_frame(frame_desc);
+  loopback_free_send_frame(instance, frame_desc);
+  return EC_E_NOERROR;
+}
+
+// Polling mode receive, hand the oldest queued frame to the master
+static EC_T_DWORD loopback_recv_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  loopback_slot *slot;
+
+  pthread_mutex_lock(&g_loopback.lock);
+  slot = &g_loopback.slots[g_loopback.head];
+  if ( slot->state != LOOPBACK_SLOT_QUEUED )
+  {
+    frame_desc->pbyFrame = EC_NULL;
+    frame_desc->dwSize = 0;
+    pthread_mutex_unlock(&g_loopback.lock);
+    return EC_E_NOERROR;
+  }
+  slot->state = LOOPBACK_SLOT_HELD;
+  g_loopback.head = (g_loopback.head + 1) % LOOPBACK_QUEUE_SIZE;
+  g_loopback.stats.rx_frames++;
+  frame_desc->pbyFrame = slot->frame;
+  frame_desc->dwSize = slot->size;
+  frame_desc->pvContext = slot;
+  pthread_mutex_unlock(&g_loopback.lock);
+  return EC_E_NOERROR;
+}
+
+static EC_T_VOID loopback_free_recv_frame(EC_T_VOID *instance, EC_T_LINK_FRAMEDESC *frame_desc)
+{
+  loopback_slot *slot = (loopback_slot *)frame_desc->pvContext;
+  if ( slot != NULL )
+  {
+    pthread_mutex_lock(&g_loopback.lock);
+    slot->state = LOOPBACK_SLOT_FREE;
+    pthread_mutex_unlock(&g_loopback.lock);
+  }
+}
+
+static EC_T_DWORD loopback_get_ethernet_address(EC_T_VOID *instance, EC_T_BYTE *mac_address)
+{
+  memcpy(mac_address, g_loopback_mac, sizeof(g_loopback_mac));
+  return EC_E_NOERROR;
+}
+
+static EC_T_LINKSTATUS loopback_get_status(EC_T_VOID *instance)
+{
+  return eLinkStatus_OK;
+}
+
+static EC_T_DWORD loopback_get_speed(EC_T_VOID *instance)
+{
+  return 100;
+}
+
+static EC_T_LINKMODE loopback_get_mode(EC_T_VOID *instance)
+{
+  return EcLinkMode_POLLING;
+}
+
+static EC_T_DWORD loopback_ioctl(EC_T_VOID *instance, EC_T_DWORD code, EC_T_LINK_IOCTLPARMS *parms)
+{
+  if ( code == EC_LINKIOCTL_GET_ETHERNET_ADDRESS )
+  {
+    if ( (parms == EC_NULL) || (parms->pbyOutBuf == EC_NULL) || (parms->dwOutBufSize < sizeof(g_loopback_mac)) )
+    {
+      return EC_E_INVALIDPARM;
+    }
+    memcpy(parms->pbyOutBuf, g_loopback_mac, sizeof(g_loopback_mac));
+    if ( parms->pdwNumOutData != EC_NULL )
+    {
+      *parms->pdwNumOutData = sizeof(g_loopback_mac);
+    }
+    return EC_E_NOERROR;
+  }
+  return EC_E_NOTSUPPORTED;
+}
+
+// Stand-in for the i8254 link layer registration exported by libemllI8254x.so
+ATEMLL_API EC_T_DWORD emllRegisterI8254x(EC_T_LINK_DRV_DESC *link_drv_desc, EC_T_DWORD link_drv_desc_size)
+{
+  if ( link_drv_desc_size < sizeof(EC_T_LINK_DRV_DESC) )
+  {
+    return EC_E_INVALIDSIZE;
+  }
+  link_drv_desc->pfEcLinkOpen               = loopback_open;
+  link_drv_desc->pfEcLinkClose              = loopback_close;
+  link_drv_desc->pfEcLinkSendFrame          = loopback_send_frame;
+  link_drv_desc->pfEcLinkSendAndFreeFrame   = loopback_send_and_free_frame;
+  link_drv_desc->pfEcLinkRecvFrame          = loopback_recv_frame;
+  link_drv_desc->pfEcLinkAllocSendFrame     = loopback_alloc_send_frame;
+  link_drv_desc->pfEcLinkFreeSendFrame      = loopback_free_send_frame;
+  link_drv_desc->pfEcLinkFreeRecvFrame      = loopback_free_recv_frame;
+  link_drv_desc->pfEcLinkGetEthernetAddress = loopback_get_ethernet_address;
+  link_drv_desc->pfEcLinkGetStatus          = loopback_get_status;
+  link_drv_desc->pfEcLinkGetSpeed           = loopback_get_speed;
+  link_drv_desc->pfEcLinkGetMode            = loopback_get_mode;
+  link_drv_desc->pfEcLinkIoctl              = loopback_ioctl;
+  return EC_E_NOERROR;
+}
+
+// Set the frame handler used to emulate slaves
+void ddi_em_loopback_set_frame_handler(ddi_em_loopback_frame_func *handler, void *user_data)
+{
+  pthread_mutex_lock(&g_loopback.lock);
+  g_loopback.handler = handler;
+  g_loopback.handler_data = user_data;
+  pthread_mutex_unlock(&g_loopback.lock);
+}
+
+// Drop the next frames sent by the master
+void ddi_em_loopback_drop_frames(uint32_t count)
+{
+  pthread_mutex_lock(&g_loopback.lock);
+  g_loopback.drop_count += count;
+  pthread_mutex_unlock(&g_loopback.lock);
+}
+
+// Return the frame counters
+void ddi_em_loopback_get_stats(ddi_em_loopback_stats *stats)
+{
+  pthread_mutex_lock(&g_loopback.lock);
+  *stats = g_loopback.stats;
+  pthread_mutex_unlock(&g_loopback.lock);
+}
@@ -0,0 +1,53 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef __DDI_EM_LOOPBACK_LINK_H__
+#define __DDI_EM_LOOPBACK_LINK_H__
+
+// In-memory loopback stand-in for the i8254 link layer, used by the tests that run without EtherCAT hardware.
+// Linking this file into a test replaces emllRegisterI8254x(), every frame the master sends is returned to it on
+// the next receive poll as if it had passed through a network.
+
+#include <stdint.h>
+
+/** ddi_em_loopback_frame_func
+ @brief Frame handler called for each frame before it is looped back, used to emulate slaves
+ @param frame The EtherCAT frame, including the Ethernet header
+ @param size The frame size in bytes
+ @param user_data The handler data given to ddi_em_loopback_set_frame_handler()
+ */
+typedef void (ddi_em_loopback_frame_func)(uint8_t *frame, uint32_t size, void *user_data);
+
+/** ddi_em_loopback_stats
+ @brief Frame counters of the loopback link
+ */
+typedef struct {
+  uint64_t tx_frames;      /**< Frames sent by the master */
+  uint64_t rx_frames;      /**< Frames returned to the master */
+  uint64_t dropped_frames; /**< Frames dropped by ddi_em_loopback_drop_frames() or a full queue */
+} ddi_em_loopback_stats;
+
+/** ddi_em_loopback_set_frame_handler
+ @brief Set the frame handler called for each frame before it is looped back
+ @param handler The frame handler, NULL for a plain loopback
+ @param user_data The handler data
+ */
+void ddi_em_loopback_set_frame_handler(ddi_em_loopback_frame_func *handler, void *user_data);
+
+/** ddi_em_loopback_drop_frames
+ @brief Drop the next frames sent by the master to emulate frame loss
+ @param count The number of frames to drop
+ */
+void ddi_em_loopback_drop_frames(uint32_t count);
+
+/** ddi_em_loopback_get_stats
+ @brief Return the frame counters of the loopback link
+ @param stats The frame counters
+ */
+void ddi_em_loopback_get_stats(ddi_em_loopback_stats *stats);
+
+#endif // __DDI_EM_LOOPBACK_LINK_H__
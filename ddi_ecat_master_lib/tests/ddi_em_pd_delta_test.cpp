@@ -0,0 +1,315 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Input change detection test program
+// Configures the master over the in-memory loopback link, stops the cyclic task and replays a generated capture, so
+// every record is one cycle of known inputs. Checks the change counts, the edge callbacks, ddi_em_pd_delta_next() and
+// the change bitmap of every cycle, and an edge callback that removes its own region.
+// Usage: ddi_em_pd_delta_test [eni file]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ddi_em_api.h"
+#include "ddi_em_capture.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_CAPTURE_FILE       "/tmp/ddi_em_pd_delta_test.cap"
+// The replayed inputs, bits 768-895 of the input process data
+#define TEST_INPUT_BYTE         96
+#define TEST_INPUT_BYTES        16
+#define TEST_INPUT_BIT          (TEST_INPUT_BYTE * 8)
+#define TEST_CYCLES             5
+#define TEST_MAX_EDGES          16
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+// The inputs of every cycle
+static const uint8_t g_inputs[TEST_CYCLES][TEST_INPUT_BYTES] = {
+  { 0 },
+  { 0x05 },                                     // Bits 768 and 770 rise
+  { 0x05 },                                     // No change
+  { 0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x80 },       // Bit 768 falls, bit 847 rises
+  { 0x04, 0, 0, 0, 0, 0, 0, 0, 0, 0x80, 0, 0, 0, 0, 0, 0xff }, // Bits 888-895 rise
+};
+
+typedef struct {
+  uint32_t bit_offset;
+  uint8_t  value;
+} test_edge;
+
+// The edges reported in the current cycle
+typedef struct {
+  test_edge edges[TEST_MAX_EDGES];
+  uint32_t  count;
+} test_edges;
+
+typedef struct {
+  ddi_em_handle em_handle;
+  uint32_t      word_region;    // Bits 768-831, one word, both edges reported
+  uint32_t      span_region;    // Bits 764-771, across two words, falling edges reported
+  uint32_t      poll_region;    // Bits 840-895, polled with ddi_em_pd_delta_next()
+  test_edges    word_edges;
+  test_edges    span_edges;
+  uint32_t      once_region;    // Bits 768-771, rising edges reported, removed by its callback
+  uint32_t      once_calls;
+  uint32_t      cycle;
+} test_state;
+
+// Edge callback, records the reported edges
+static void record_edge(ddi_em_handle em_handle, uint32_t bit_offset, uint8_t value, void *user_data)
+{
+  test_edges *edges = (test_edges *)user_data;
+  if ( edges->count < TEST_MAX_EDGES )
+  {
+    edges->edges[edges->count].bit_offset = bit_offset;
+    edges->edges[edges->count].value = value;
+  }
+  edges->count++;
+}
+
+// Edge callback that removes its own region on the first edge
+static void remove_on_edge(ddi_em_handle em_handle, uint32_t bit_offset, uint8_t value, void *user_data)
+{
+  test_state *state = (test_state *)user_data;
+  state->once_calls++;
+  TEST_CHECK(ddi_em_pd_delta_remove_region(em_handle, state->once_region) == DDI_EM_STATUS_OK,
+    "cycle %u: the callback couldn't remove its region", state->cycle);
+}
+
+// Check the number of changes of a region
+static void check_changes(test_state *state, uint32_t region_id, uint32_t expected, const char *name)
+{
+  uint32_t change_count = 0xffffffff;
+  TEST_CHECK(ddi_em_pd_delta_get_changes(state->em_handle, region_id, &change_count) == DDI_EM_STATUS_OK,
+    "cycle %u: ddi_em_pd_delta_get_changes(%s) failed", state->cycle, name);
+  TEST_CHECK(change_count == expected, "cycle %u: %s has %u changes, expected %u", state->cycle, name, change_count, expected);
+}
+
+// Check the edges reported to a callback
+static void check_edges(test_state *state, const test_edges *edges, const test_edge *expected, uint32_t count, const char *name)
+{
+  uint32_t index;
+  TEST_CHECK(edges->count == count, "cycle %u: %u %s edges, expected %u", state->cycle, edges->count, name, count);
+  for ( index = 0; (index < count) && (index < edges->count); index++ )
+  {
+    TEST_CHECK((edges->edges[index].bit_offset == expected[index].bit_offset) && (edges->edges[index].value == expected[index].value),
+      "cycle %u: %s edge %u is bit %u = %u, expected bit %u = %u", state->cycle, name, index, edges->edges[index].bit_offset,
+      edges->edges[index].value, expected[index].bit_offset, expected[index].value);
+  }
+}
+
+// Check the changed bits returned by ddi_em_pd_delta_next(), first_bit to first_bit + count - 1 rose
+static void check_next(test_state *state, uint32_t first_bit, uint32_t count)
+{
+  uint32_t cursor = 0, bit_offset, found = 0;
+  uint8_t value;
+  while ( ddi_em_pd_delta_next(state->em_handle, state->poll_region, &cursor, &bit_offset, &value) == DDI_EM_STATUS_OK )
+  {
+    TEST_CHECK((bit_offset == first_bit + found) && (value == 1), "cycle %u: change %u is bit %u = %u, expected bit %u = 1",
+      state->cycle, found, bit_offset, value, first_bit + found);
+    found++;
+  }
+  TEST_CHECK(found == count, "cycle %u: ddi_em_pd_delta_next returned %u changes, expected %u", state->cycle, found, count);
+}
+
+// Cyclic callback of the replay, runs after the change detection of the cycle
+static void check_cycle(void *arg)
+{
+  test_state *state = (test_state *)arg;
+  static const test_edge rise_768_770[] = { { 768, 1 }, { 770, 1 } };
+  static const test_edge fall_768[] = { { 768, 0 } };
+  const uint64_t *bitmap = NULL;
+  uint32_t word_count = 0;
+
+  switch ( state->cycle )
+  {
+    case 1:
+      check_changes(state, state->word_region, 2, "word region");
+      check_changes(state, state->span_region, 2, "span region");
+      check_changes(state, state->poll_region, 0, "polled region");
+      check_edges(state, &state->word_edges, rise_768_770, 2, "word region");
+      check_edges(state, &state->span_edges, NULL, 0, "span region");
+      // Bits 768 and 770 rose, the region was gone after the first
+      TEST_CHECK(state->once_calls == 1, "cycle 1: the removed region got %u callbacks", state->once_calls);
+      break;
+    case 3:
+      check_changes(state, state->word_region, 1, "word region");
+      check_changes(state, state->span_region, 1, "span region");
+      check_changes(state, state->poll_region, 1, "polled region");
+      check_edges(state, &state->word_edges, fall_768, 1, "word region");
+      check_edges(state, &state->span_edges, fall_768, 1, "span region");
+      check_next(state, 847, 1);
+      TEST_CHECK(ddi_em_pd_delta_get_bitmap(state->em_handle, &bitmap, &word_count) == DDI_EM_STATUS_OK, "ddi_em_pd_delta_get_bitmap failed");
+      TEST_CHECK((bitmap != NULL) && (word_count > 13) && (bitmap[11] == 0) && (bitmap[12] == 0x1) && (bitmap[13] == (1ULL << 15)),
+        "cycle 3: unexpected change bitmap");
+      break;
+    case 4:
+      check_changes(state, state->word_region, 0, "word region");
+      check_changes(state, state->poll_region, 8, "polled region");
+      check_edges(state, &state->word_edges, NULL, 0, "word region");
+      check_next(state, 888, 8);
+      break;
+    default:
+      // The first cycle is the reference, the third doesn't change
+      check_changes(state, state->word_region, 0, "word region");
+      check_changes(state, state->span_region, 0, "span region");
+      check_changes(state, state->poll_region, 0, "polled region");
+      check_edges(state, &state->word_edges, NULL, 0, "word region");
+      check_next(state, 0, 0);
+      break;
+  }
+  state->word_edges.count = 0;
+  state->span_edges.count = 0;
+  state->cycle++;
+}
+
+// The cyclic task of the configuration, the master timer runs the network scan and the state changes
+static void *cyclic_task(void *arg)
+{
+  ddi_em_cyclic_task_start(*(ddi_em_handle *)arg);
+  return NULL;
+}
+
+// Write a capture with one record per cycle of g_inputs, and an empty output region the replay compares against
+static bool write_capture(const char *filename)
+{
+  ddi_em_capture_header header;
+  ddi_em_capture_region regions[2];
+  ddi_em_capture_record record;
+  uint32_t outputs = 0, cycle;
+  FILE *file = fopen(filename, "wb");
+  bool ok;
+
+  if ( file == NULL )
+  {
+    return false;
+  }
+  memset(regions, 0, sizeof(regions));
+  strcpy(regions[0].name, "Inputs");
+  regions[0].byte_offset = TEST_INPUT_BYTE;
+  regions[0].byte_size = TEST_INPUT_BYTES;
+  strcpy(regions[1].name, "Outputs");
+  regions[1].byte_size = sizeof(outputs);
+  regions[1].is_output = 1;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(header.magic));
+  header.version = DDI_EM_CAPTURE_VERSION;
+  header.region_count = 2;
+  header.record_size = sizeof(record) + TEST_INPUT_BYTES + sizeof(outputs);
+  header.data_offset = sizeof(header) + sizeof(regions);
+  header.cycle_time_us = 1000;
+  header.decimation = 1;
+  ok = (fwrite(&header, sizeof(header), 1, file) == 1) && (fwrite(regions, sizeof(regions), 1, file) == 1);
+  for ( cycle = 0; ok && (cycle < TEST_CYCLES); cycle++ )
+  {
+    record.cycle = cycle;
+    record.timestamp_ns = cycle * 1000000ULL;
+    ok = (fwrite(&record, sizeof(record), 1, file) == 1) && (fwrite(g_inputs[cycle], TEST_INPUT_BYTES, 1, file) == 1) &&
+         (fwrite(&outputs, sizeof(outputs), 1, file) == 1);
+  }
+  fclose(file);
+  return ok;
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_em_replay_config config;
+  ddi_em_replay_result replay;
+  uint32_t region_id, change_count;
+  test_state state;
+  pthread_t cyclic_tid;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+  if ( !write_capture(TEST_CAPTURE_FILE) )
+  {
+    printf("Cannot write %s \n", TEST_CAPTURE_FILE);
+    return -1;
+  }
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  // The replay runs the cycles, the cyclic task is only run while the master is configured
+  init_params.enable_cyclic_thread  = 0;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  if ( pthread_create(&cyclic_tid, NULL, cyclic_task, &em_handle) != 0 )
+  {
+    printf("Cannot start the cyclic task \n");
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+  result = ddi_em_configure_master(em_handle, eni_file);
+  ddi_em_cyclic_task_stop(em_handle);
+  pthread_join(cyclic_tid, NULL);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  memset(&state, 0, sizeof(state));
+  state.em_handle = em_handle;
+  TEST_CHECK(ddi_em_pd_delta_add_region(em_handle, TEST_INPUT_BIT, 64, DDI_EM_PD_EDGE_BOTH, record_edge, &state.word_edges,
+    &state.word_region) == DDI_EM_STATUS_OK, "adding the word region failed");
+  TEST_CHECK(ddi_em_pd_delta_add_region(em_handle, TEST_INPUT_BIT - 4, 8, DDI_EM_PD_EDGE_FALLING, record_edge, &state.span_edges,
+    &state.span_region) == DDI_EM_STATUS_OK, "adding the span region failed");
+  TEST_CHECK(ddi_em_pd_delta_add_region(em_handle, TEST_INPUT_BIT + 72, 56, DDI_EM_PD_EDGE_BOTH, NULL, NULL,
+    &state.poll_region) == DDI_EM_STATUS_OK, "adding the polled region failed");
+  TEST_CHECK(ddi_em_pd_delta_add_region(em_handle, TEST_INPUT_BIT, 4, DDI_EM_PD_EDGE_RISING, remove_on_edge, &state,
+    &state.once_region) == DDI_EM_STATUS_OK, "adding the self-removing region failed");
+  TEST_CHECK(ddi_em_pd_delta_add_region(em_handle, 1536 * 8 - 4, 8, DDI_EM_PD_EDGE_BOTH, NULL, NULL, &region_id) ==
+    DDI_EM_STATUS_INVALID_ARG, "a region across the end of the input process data was accepted");
+
+  // Every replayed record is one cycle of change detection followed by the checks
+  memset(&config, 0, sizeof(config));
+  config.input_file = TEST_CAPTURE_FILE;
+  config.callback = check_cycle;
+  config.user_data = &state;
+  result = ddi_em_replay_run(em_handle, &config, &replay);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_replay_run returned 0x%04x", result);
+  TEST_CHECK(state.cycle == TEST_CYCLES, "%u cycles checked", state.cycle);
+  TEST_CHECK(state.once_calls == 1, "the self-removing region got %u callbacks", state.once_calls);
+  TEST_CHECK(ddi_em_pd_delta_get_changes(em_handle, state.once_region, &change_count) == DDI_EM_STATUS_NOT_FOUND,
+    "the region removed by its callback is still registered");
+
+  // Removing a region clears its changes
+  TEST_CHECK(ddi_em_pd_delta_remove_region(em_handle, state.poll_region) == DDI_EM_STATUS_OK, "removing the polled region failed");
+  TEST_CHECK(ddi_em_pd_delta_get_changes(em_handle, state.poll_region, &change_count) == DDI_EM_STATUS_NOT_FOUND,
+    "the removed region still reports changes");
+  TEST_CHECK(ddi_em_pd_delta_remove_region(em_handle, state.poll_region) == DDI_EM_STATUS_NOT_FOUND, "the region was removed twice");
+
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+  remove(TEST_CAPTURE_FILE);
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,165 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Process data access plan test program
+// Runs the master over the in-memory loopback link, compiles access plans and checks the merged copy operations,
+// the copied data and the rejection of fields outside of the process data.
+// Usage: ddi_em_pd_plan_test [eni file]
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ddi_em_api.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+// The input and output process data size of the test ENI file
+#define TEST_PD_IMAGE_BYTES     1536
+#define TEST_AOUT0_NAME         "Box 1 (Fusion.IO).Module 4 (8xAOUT).Outputs.AOUT[0]"
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+// The user structure of the test plan
+typedef struct {
+  uint32_t in_a;        // Input bits 800-831
+  uint32_t in_b;        // Input bits 832-863, contiguous with in_a in both places
+  uint32_t pad;
+  uint32_t pad2;
+  uint16_t in_c;        // Input bits 864-879, contiguous with in_b in the process data only
+  uint16_t pad3;
+  uint8_t  in_bit;      // Input bit 3
+  uint8_t  pad4[3];
+  uint16_t out_a;       // Output bits 400-415
+  uint16_t out_b;       // Output bits 416-431, contiguous with out_a in both places
+  uint8_t  out_bits;    // Output bits 437-441
+  uint8_t  pad5;
+  uint16_t aout0;       // Output variable looked up by name
+} __attribute__((packed)) test_user;
+
+// Fields in no particular order, the plan sorts them
+static const ddi_em_pd_field g_fields[] = {
+  { NULL,            832, 32, 0, offsetof(test_user, in_b) },
+  { NULL,            416, 16, 1, offsetof(test_user, out_b) },
+  { NULL,            800, 32, 0, offsetof(test_user, in_a) },
+  { NULL,            3,   1,  0, offsetof(test_user, in_bit) },
+  { NULL,            864, 16, 0, offsetof(test_user, in_c) },
+  { TEST_AOUT0_NAME, 0,   0,  0, offsetof(test_user, aout0) },
+  { NULL,            437, 5,  1, offsetof(test_user, out_bits) },
+  { NULL,            400, 16, 1, offsetof(test_user, out_a) },
+};
+
+// Compile a plan of one raw field and return the result
+static ddi_em_result create_single(ddi_em_handle em_handle, uint32_t bit_offset, uint32_t bit_size, uint8_t is_output)
+{
+  ddi_em_pd_field field = { NULL, bit_offset, bit_size, is_output, 0 };
+  ddi_em_pd_plan *plan = NULL;
+  ddi_em_result result;
+  uint8_t user[8];
+
+  result = ddi_em_pd_plan_create(em_handle, &field, 1, sizeof(user), &plan);
+  if ( result == DDI_EM_STATUS_OK )
+  {
+    ddi_em_pd_plan_free(plan);
+  }
+  return result;
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_em_pd_plan *plan = NULL;
+  ddi_em_pd_plan_info info;
+  ddi_em_pd_field field;
+  test_user written, read;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  // Contiguous fields are merged, the bit fields are kept apart
+  result = ddi_em_pd_plan_create(em_handle, g_fields, sizeof(g_fields) / sizeof(g_fields[0]), sizeof(test_user), &plan);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_pd_plan_create returned 0x%04x", result);
+  if ( result == DDI_EM_STATUS_OK )
+  {
+    TEST_CHECK(ddi_em_pd_plan_get_info(plan, &info) == DDI_EM_STATUS_OK, "ddi_em_pd_plan_get_info failed");
+    printf("%u fields: gather %u + %u, scatter %u + %u operations\n", info.field_count, info.gather_copy_ops, info.gather_bit_ops,
+      info.scatter_copy_ops, info.scatter_bit_ops);
+    TEST_CHECK(info.field_count == sizeof(g_fields) / sizeof(g_fields[0]), "%u fields", info.field_count);
+    // in_a + in_b, in_c, out_a + out_b, aout0
+    TEST_CHECK(info.gather_copy_ops == 4, "%u gather copy operations", info.gather_copy_ops);
+    TEST_CHECK(info.gather_bit_ops == 2, "%u gather bit operations", info.gather_bit_ops);
+    TEST_CHECK(info.scatter_copy_ops == 2, "%u scatter copy operations", info.scatter_copy_ops);
+    TEST_CHECK(info.scatter_bit_ops == 1, "%u scatter bit operations", info.scatter_bit_ops);
+
+    // The outputs read back as written through the merged operations
+    memset(&written, 0, sizeof(written));
+    written.out_a = 0x1234;
+    written.out_b = 0xabcd;
+    written.out_bits = 0x15;
+    written.aout0 = 0x5a5a;
+    TEST_CHECK(ddi_em_pd_plan_scatter(plan, &written) == DDI_EM_STATUS_OK, "ddi_em_pd_plan_scatter failed");
+    memset(&read, 0xff, sizeof(read));
+    TEST_CHECK(ddi_em_pd_plan_gather(plan, &read) == DDI_EM_STATUS_OK, "ddi_em_pd_plan_gather failed");
+    TEST_CHECK((read.out_a == written.out_a) && (read.out_b == written.out_b), "merged outputs read back as 0x%04x 0x%04x",
+      read.out_a, read.out_b);
+    TEST_CHECK(read.out_bits == written.out_bits, "bit field read back as 0x%02x", read.out_bits);
+    TEST_CHECK(read.aout0 == written.aout0, "named output read back as 0x%04x", read.aout0);
+    TEST_CHECK(read.in_bit <= 1, "single input bit read as %u", read.in_bit);
+    ddi_em_pd_plan_free(plan);
+  }
+
+  // Fields must lie within the process data image
+  TEST_CHECK(create_single(em_handle, TEST_PD_IMAGE_BYTES * 8 - 16, 16, 0) == DDI_EM_STATUS_OK, "the last input word was rejected");
+  TEST_CHECK(create_single(em_handle, TEST_PD_IMAGE_BYTES * 8 - 1, 1, 1) == DDI_EM_STATUS_OK, "the last output bit was rejected");
+  TEST_CHECK(create_single(em_handle, TEST_PD_IMAGE_BYTES * 8 - 8, 16, 0) == DDI_EM_STATUS_INVALID_ARG,
+    "a field across the end of the input image was accepted");
+  TEST_CHECK(create_single(em_handle, TEST_PD_IMAGE_BYTES * 8, 1, 1) == DDI_EM_STATUS_INVALID_ARG,
+    "a field after the output image was accepted");
+  TEST_CHECK(create_single(em_handle, 0xfffffff0, 32, 0) == DDI_EM_STATUS_INVALID_ARG, "a wrapping bit offset was accepted");
+  TEST_CHECK(create_single(em_handle, 0, 65, 0) == DDI_EM_STATUS_INVALID_SIZE, "a field larger than the user structure was accepted");
+  memset(&field, 0, sizeof(field));
+  field.name = "No such variable";
+  TEST_CHECK(ddi_em_pd_plan_create(em_handle, &field, 1, sizeof(test_user), &plan) == DDI_EM_STATUS_NOT_FOUND,
+    "an unknown variable was accepted");
+
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,251 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Process data replay test program
+// Replays generated captures through a known control function, first with the in-memory process image of an
+// unconfigured master, then through the process image of a master configured over the in-memory loopback link.
+// Checks the golden comparison, the replayed capture and that a replay and the cyclic task exclude each other.
+// Usage: ddi_em_replay_test [eni file]
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ddi_em_api.h"
+#include "ddi_em_capture.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_INPUT_FILE         "/tmp/ddi_em_replay_test_input.cap"
+#define TEST_GOLDEN_FILE        "/tmp/ddi_em_replay_test_golden.cap"
+#define TEST_OUTPUT_FILE        "/tmp/ddi_em_replay_test_output.cap"
+#define TEST_CYCLES             100
+#define TEST_BAD_CYCLE          37
+// The replayed process data, within the process image of the test ENI file
+#define TEST_INPUT_BYTE         100
+#define TEST_OUTPUT_BYTE        200
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+typedef struct {
+  ddi_em_handle em_handle;
+  uint32_t      bad_cycle;       // Cycle whose output is wrong, 0 = none
+  uint32_t      cycle;
+  ddi_em_result task_result;     // Result of starting the cyclic task during the replay
+  bool          start_task;
+} test_state;
+
+// The control function under test
+static uint32_t control(uint32_t input)
+{
+  return input * 3 + 1;
+}
+
+// Replay callback, runs the control function on the replayed inputs
+static void control_cycle(void *arg)
+{
+  test_state *state = (test_state *)arg;
+  uint32_t input = 0, output;
+
+  ddi_em_get_process_data(state->em_handle, TEST_INPUT_BYTE, (uint8_t *)&input, sizeof(input), 0); // Input process data
+  output = control(input);
+  if ( state->bad_cycle && (state->cycle == state->bad_cycle) )
+  {
+    output++;
+  }
+  ddi_em_set_process_data(state->em_handle, TEST_OUTPUT_BYTE, (uint8_t *)&output, sizeof(output));
+  if ( state->start_task )
+  {
+    // Must return at once instead of running a cyclic task next to the replay
+    state->task_result = ddi_em_cyclic_task_start(state->em_handle);
+    state->start_task = false;
+  }
+  state->cycle++;
+}
+
+// Write a capture of one input and one output region, every step-th cycle is recorded
+static bool write_capture(const char *filename, uint32_t step)
+{
+  ddi_em_capture_header header;
+  ddi_em_capture_region regions[2];
+  ddi_em_capture_record record;
+  uint32_t cycle, data[2];
+  FILE *file = fopen(filename, "wb");
+  bool ok;
+
+  if ( file == NULL )
+  {
+    return false;
+  }
+  memset(regions, 0, sizeof(regions));
+  strcpy(regions[0].name, "Input");
+  regions[0].byte_offset = TEST_INPUT_BYTE;
+  regions[0].byte_size = sizeof(uint32_t);
+  strcpy(regions[1].name, "Output");
+  regions[1].byte_offset = TEST_OUTPUT_BYTE;
+  regions[1].byte_size = sizeof(uint32_t);
+  regions[1].is_output = 1;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(header.magic));
+  header.version = DDI_EM_CAPTURE_VERSION;
+  header.region_count = 2;
+  header.record_size = sizeof(record) + sizeof(data);
+  header.data_offset = sizeof(header) + sizeof(regions);
+  header.cycle_time_us = 1000;
+  header.decimation = step;
+  ok = (fwrite(&header, sizeof(header), 1, file) == 1) && (fwrite(regions, sizeof(regions), 1, file) == 1);
+  for ( cycle = 0; ok && (cycle < TEST_CYCLES); cycle += step )
+  {
+    record.cycle = cycle;
+    record.timestamp_ns = cycle * 1000000ULL;
+    data[0] = cycle * 7919;
+    data[1] = control(data[0]);
+    ok = (fwrite(&record, sizeof(record), 1, file) == 1) && (fwrite(data, sizeof(data), 1, file) == 1);
+  }
+  fclose(file);
+  return ok;
+}
+
+// Replay a capture through the control function
+static ddi_em_result replay(test_state *state, const char *golden_file, const char *output_file, ddi_em_replay_result *result)
+{
+  ddi_em_replay_config config;
+
+  memset(&config, 0, sizeof(config));
+  config.input_file = TEST_INPUT_FILE;
+  config.golden_file = golden_file;
+  config.output_file = output_file;
+  config.callback = control_cycle;
+  config.user_data = state;
+  state->cycle = 0;
+  return ddi_em_replay_run(state->em_handle, &config, result);
+}
+
+// The cyclic task of the configured master
+static void *cyclic_task(void *arg)
+{
+  ddi_em_cyclic_task_start(*(ddi_em_handle *)arg);
+  return NULL;
+}
+
+// Replay with the in-memory process image of an unconfigured master
+static void test_standin(test_state *state)
+{
+  ddi_em_replay_result result;
+  ddi_em_result em_result;
+
+  // The outputs of the input capture are the golden outputs
+  em_result = replay(state, NULL, TEST_OUTPUT_FILE, &result);
+  TEST_CHECK(em_result == DDI_EM_STATUS_OK, "replay returned 0x%04x", em_result);
+  TEST_CHECK((result.cycles == TEST_CYCLES) && (result.compared_cycles == TEST_CYCLES) && (result.mismatched_cycles == 0),
+    "%llu cycles, %llu compared, %llu mismatched", (unsigned long long)result.cycles, (unsigned long long)result.compared_cycles,
+    (unsigned long long)result.mismatched_cycles);
+  TEST_CHECK(result.region_count == 1, "%u compared regions", result.region_count);
+
+  // The replayed capture has the same outputs
+  em_result = replay(state, TEST_OUTPUT_FILE, NULL, &result);
+  TEST_CHECK((em_result == DDI_EM_STATUS_OK) && (result.compared_cycles == TEST_CYCLES),
+    "replay against the replayed capture returned 0x%04x after %llu compared cycles", em_result, (unsigned long long)result.compared_cycles);
+
+  // Only the cycles of the golden capture are compared
+  em_result = replay(state, TEST_GOLDEN_FILE, NULL, &result);
+  TEST_CHECK((em_result == DDI_EM_STATUS_OK) && (result.cycles == TEST_CYCLES) && (result.compared_cycles == TEST_CYCLES / 4),
+    "replay against a decimated capture returned 0x%04x after %llu compared cycles", em_result, (unsigned long long)result.compared_cycles);
+
+  // A wrong output is found in the cycle it happened
+  state->bad_cycle = TEST_BAD_CYCLE;
+  em_result = replay(state, NULL, NULL, &result);
+  TEST_CHECK(em_result == DDI_EM_STATUS_INVALID_DATA, "a wrong output returned 0x%04x", em_result);
+  TEST_CHECK((result.mismatched_cycles == 1) && (result.first_mismatch_cycle == TEST_BAD_CYCLE) &&
+    (result.first_mismatch_region == 1) && (result.region_mismatches[1] == 1), "%llu mismatched cycles, first in cycle %llu region %u",
+    (unsigned long long)result.mismatched_cycles, (unsigned long long)result.first_mismatch_cycle, result.first_mismatch_region);
+  state->bad_cycle = 0;
+
+  em_result = replay(state, "/tmp/no_such_capture.cap", NULL, &result);
+  TEST_CHECK(em_result == DDI_EM_STATUS_NOT_FOUND, "a missing golden capture returned 0x%04x", em_result);
+}
+
+// Replay through the process image of a configured master, a replay and the cyclic task exclude each other
+static void test_configured(test_state *state, const char *eni_file)
+{
+  ddi_em_replay_result result;
+  ddi_em_result em_result;
+  pthread_t cyclic_tid;
+
+  if ( pthread_create(&cyclic_tid, NULL, cyclic_task, &state->em_handle) != 0 )
+  {
+    TEST_CHECK(false, "Cannot start the cyclic task");
+    return;
+  }
+  em_result = ddi_em_configure_master(state->em_handle, eni_file);
+  TEST_CHECK(em_result == DDI_EM_STATUS_OK, "ddi_em_configure_master(%s) returned 0x%04x", eni_file, em_result);
+
+  // The cyclic task ran the configuration, a replay would race it for the process image
+  em_result = replay(state, NULL, NULL, &result);
+  TEST_CHECK(em_result == DDI_EM_STATUS_BUSY, "a replay next to the cyclic task returned 0x%04x", em_result);
+  TEST_CHECK(state->cycle == 0, "the rejected replay ran %u cycles", state->cycle);
+  ddi_em_cyclic_task_stop(state->em_handle);
+  pthread_join(cyclic_tid, NULL);
+
+  // Without the cyclic task the replay runs through the master's process image and keeps the cyclic task out
+  state->start_task = true;
+  em_result = replay(state, NULL, NULL, &result);
+  TEST_CHECK((em_result == DDI_EM_STATUS_OK) && (result.compared_cycles == TEST_CYCLES),
+    "replay on the configured master returned 0x%04x after %llu compared cycles", em_result, (unsigned long long)result.compared_cycles);
+  TEST_CHECK(state->task_result == DDI_EM_STATUS_BUSY, "starting the cyclic task during a replay returned 0x%04x", state->task_result);
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  test_state state;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+  if ( !write_capture(TEST_INPUT_FILE, 1) || !write_capture(TEST_GOLDEN_FILE, 4) )
+  {
+    printf("Cannot write the test captures \n");
+    return -1;
+  }
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  // The test runs the cyclic task itself, so it can be stopped for the replays
+  init_params.enable_cyclic_thread  = 0;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  memset(&state, 0, sizeof(state));
+  result = ddi_em_init(&init_params, &state.em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  test_standin(&state);
+  test_configured(&state, eni_file);
+
+  ddi_em_deinit(state.em_handle);
+  ddi_em_sdk_deinit();
+  remove(TEST_INPUT_FILE);
+  remove(TEST_GOLDEN_FILE);
+  remove(TEST_OUTPUT_FILE);
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,590 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// UART throughput and latency benchmark
+// Runs the master over the in-memory loopback link with simulated UART modules and sweeps the transmit path, channel
+// count, payload size, baud and cycle time. The modules are simulated below the library, at the mailbox and the status
+// process data, so the measured transfers run through the library's SDO images, transmit scheduler, status mirror and
+// receive timelines. Channel n is channel n % 4 of module n / 4 + 1. Every channel has a thread that keeps up to window
+// payloads in flight with ddi_fusion_uart_tx_data() and polls ddi_fusion_uart_get_rx_bytes_avail() and
+// ddi_fusion_uart_rx_data() for them. The transmits either go straight to the mailbox or through the transmit
+// scheduler. The latency of a payload runs from its transmit call to the read that completes it.
+// One CSV line per sweep point is written to stdout, progress goes to stderr. The exit code is non-zero when data was
+// lost or corrupted.
+// Usage: ddi_em_uart_bench [-q] [-d duration_ms] [-x tx_paths] [-c channels] [-p payloads] [-b bauds] [-t cycles_us]
+//                          [-s sdo_latency_us] [-w window] [eni file]
+//        The sweep options take comma separated lists, the transmit paths are direct and scheduled. -q runs a short
+//        sweep.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <inttypes.h>
+#include "ddi_em_api.h"
+#include "ddi_em_fusion.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_loopback_link.h"
+#include "ddi_em_uart_sim.h"
+
+#define BENCH_ENI_FILE          "tests/config/cram_eni.xml"
+#define BENCH_MAX_VALUES        16
+#define BENCH_MAX_CHANNELS      (MAX_NUMBER_UART_ETHERCAT_MODULES * MAX_NUMBER_UART_PER_MODULE)
+#define BENCH_MAX_WINDOW        16
+#define BENCH_POLL_US           50
+#define BENCH_SWITCH_TIMEOUT_MS 1000
+// Time after the end of a sweep point the channels get to receive the payloads in flight
+#define BENCH_DRAIN_MS          2000
+// The transmit paths
+#define BENCH_TX_DIRECT         (1 << 0)
+#define BENCH_TX_SCHEDULED      (1 << 1)
+
+// A list of sweep values
+typedef struct {
+  uint32_t values[BENCH_MAX_VALUES];
+  uint32_t count;
+} bench_list;
+
+typedef struct {
+  bench_list channels;
+  bench_list payloads;
+  bench_list bauds;
+  bench_list cycles_us;
+  uint32_t   tx_paths;           // BENCH_TX_ flags
+  uint32_t   duration_ms;
+  uint32_t   sdo_latency_us;
+  uint32_t   window;
+} bench_config;
+
+// The state of one channel thread
+typedef struct {
+  ddi_fusion_uart_handle handle;
+  uint32_t  payload;
+  uint32_t  window;
+  uint64_t  stop_ns;             // No payload is sent after it
+  uint64_t  drain_ns;            // Payloads still in flight then are lost
+  pthread_t thread;
+  // Send times of the payloads in flight
+  uint64_t  sent_ns[BENCH_MAX_WINDOW];
+  uint32_t  sent_head;
+  uint32_t  sent_count;
+  // Counters
+  uint64_t  tx_bytes;
+  uint64_t  rx_bytes;
+  uint64_t  last_rx_ns;
+  uint32_t  errors;              // Failed transfers
+  uint32_t  data_errors;         // Received bytes that differ from the sent pattern
+  uint32_t  lost_payloads;
+  // Latency of every payload received, in microseconds
+  uint32_t *latency_us;
+  uint32_t  latency_count;
+  uint32_t  latency_capacity;
+} bench_channel;
+
+static bench_channel g_channels[BENCH_MAX_CHANNELS];
+
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void cyclic_callback(void *arg)
+{
+  ddi_em_uart_sim_cycle();
+}
+
+// The byte at a position of the stream of a channel
+static uint8_t pattern_byte(ddi_fusion_uart_handle handle, uint64_t position)
+{
+  return (uint8_t)(position * 7 + handle);
+}
+
+// Parse a comma separated list of sweep values
+static bool parse_list(const char *text, bench_list *list)
+{
+  char *end;
+
+  list->count = 0;
+  while ( *text != '\0' )
+  {
+    if ( list->count == BENCH_MAX_VALUES )
+    {
+      return false;
+    }
+    list->values[list->count] = strtoul(text, &end, 0);
+    if ( (end == text) || (list->values[list->count] == 0) )
+    {
+      return false;
+    }
+    list->count++;
+    text = (*end == ',') ? end + 1 : end;
+  }
+  return list->count != 0;
+}
+
+// Parse a comma separated list of transmit paths
+static bool parse_tx_paths(const char *text, uint32_t *tx_paths)
+{
+  const char *end;
+  size_t length;
+
+  *tx_paths = 0;
+  while ( *text != '\0' )
+  {
+    end = strchr(text, ',');
+    length = end ? (size_t)(end - text) : strlen(text);
+    if ( (length == strlen("direct")) && (strncmp(text, "direct", length) == 0) )
+    {
+      *tx_paths |= BENCH_TX_DIRECT;
+    }
+    else if ( (length == strlen("scheduled")) && (strncmp(text, "scheduled", length) == 0) )
+    {
+      *tx_paths |= BENCH_TX_SCHEDULED;
+    }
+    else
+    {
+      return false;
+    }
+    text = end ? end + 1 : text + length;
+  }
+  return *tx_paths != 0;
+}
+
+static void set_list(bench_list *list, const uint32_t *values, uint32_t count)
+{
+  memcpy(list->values, values, count * sizeof(uint32_t));
+  list->count = count;
+}
+
+static void record_latency(bench_channel *channel, uint64_t latency_ns)
+{
+  uint32_t *latency_us;
+  uint32_t capacity;
+
+  if ( channel->latency_count == channel->latency_capacity )
+  {
+    capacity = channel->latency_capacity ? channel->latency_capacity * 2 : 1024;
+    latency_us = (uint32_t *)realloc(channel->latency_us, capacity * sizeof(uint32_t));
+    if ( latency_us == NULL )
+    {
+      return;
+    }
+    channel->latency_us = latency_us;
+    channel->latency_capacity = capacity;
+  }
+  channel->latency_us[channel->latency_count++] = (uint32_t)(latency_ns / 1000);
+}
+
+// Read the bytes the status reports, returns true if there were any
+static bool receive(bench_channel *channel)
+{
+  uint8_t data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint16_t bytes_avail = 0;
+  uint32_t length, index;
+  uint64_t now_ns, completed;
+
+  if ( (ddi_fusion_uart_get_rx_bytes_avail(channel->handle, &bytes_avail) != DDI_EM_STATUS_OK) || (bytes_avail == 0) )
+  {
+    return false;
+  }
+  if ( ddi_fusion_uart_rx_data(channel->handle, data, &length) != DDI_EM_STATUS_OK )
+  {
+    channel->errors++;
+    return false;
+  }
+  now_ns = monotonic_ns();
+  for ( index = 0; index < length; index++ )
+  {
+    if ( data[index] != pattern_byte(channel->handle, channel->rx_bytes + index) )
+    {
+      channel->data_errors++;
+    }
+  }
+  // Every payload completed by this read has its latency
+  completed = channel->rx_bytes / channel->payload;
+  channel->rx_bytes += length;
+  while ( (completed < channel->rx_bytes / channel->payload) && (channel->sent_count != 0) )
+  {
+    record_latency(channel, now_ns - channel->sent_ns[channel->sent_head]);
+    channel->sent_head = (channel->sent_head + 1) % BENCH_MAX_WINDOW;
+    channel->sent_count--;
+    completed++;
+  }
+  if ( length != 0 )
+  {
+    channel->last_rx_ns = now_ns;
+  }
+  return length != 0;
+}
+
+// Send one payload
+static void transmit(bench_channel *channel)
+{
+  uint8_t data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t index;
+  uint64_t sent_ns = monotonic_ns();
+
+  for ( index = 0; index < channel->payload; index++ )
+  {
+    data[index] = pattern_byte(channel->handle, channel->tx_bytes + index);
+  }
+  if ( ddi_fusion_uart_tx_data(channel->handle, data, channel->payload) != DDI_EM_STATUS_OK )
+  {
+    // The payload is not in the stream, the next transmit sends the same bytes
+    channel->errors++;
+    return;
+  }
+  channel->tx_bytes += channel->payload;
+  channel->sent_ns[(channel->sent_head + channel->sent_count) % BENCH_MAX_WINDOW] = sent_ns;
+  channel->sent_count++;
+}
+
+static void *channel_thread(void *arg)
+{
+  bench_channel *channel = (bench_channel *)arg;
+  uint64_t now_ns;
+  bool busy;
+
+  while ( true )
+  {
+    now_ns = monotonic_ns();
+    if ( (now_ns >= channel->stop_ns) && ((channel->sent_count == 0) || (now_ns >= channel->drain_ns)) )
+    {
+      break;
+    }
+    busy = false;
+    if ( (now_ns < channel->stop_ns) && (channel->sent_count < channel->window) )
+    {
+      transmit(channel);
+      busy = true;
+    }
+    busy |= receive(channel);
+    if ( !busy )
+    {
+      usleep(BENCH_POLL_US);
+    }
+  }
+  channel->lost_payloads = channel->sent_count;
+  return NULL;
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+  uint32_t left = *(const uint32_t *)a, right = *(const uint32_t *)b;
+  return (left > right) - (left < right);
+}
+
+// Nearest rank percentile of sorted samples
+static uint32_t percentile(const uint32_t *sorted, uint32_t count, uint32_t percent)
+{
+  uint32_t rank;
+
+  if ( count == 0 )
+  {
+    return 0;
+  }
+  rank = (count * percent + 99) / 100;
+  return sorted[(rank ? rank : 1) - 1];
+}
+
+// Wait until the cyclic thread reports the given cycle rate
+static bool wait_for_cycle_rate(ddi_em_handle em_handle, uint32_t cycle_rate_us)
+{
+  ddi_em_master_stats stats;
+  uint32_t waited_ms;
+  for ( waited_ms = 0; waited_ms < BENCH_SWITCH_TIMEOUT_MS; waited_ms++ )
+  {
+    ddi_em_get_master_stats(em_handle, &stats);
+    if ( stats.cycle_rate_us == cycle_rate_us )
+    {
+      return true;
+    }
+    usleep(1000);
+  }
+  return false;
+}
+
+// Run one sweep point and print its CSV line, returns false if data was lost or corrupted
+static bool run_point(const ddi_fusion_uart_handle *handles, uint32_t tx_path, uint32_t channel_count, uint32_t payload,
+                      uint32_t baud, uint32_t cycle_us, const bench_config *config)
+{
+  ddi_em_uart_sim_config sim_config;
+  ddi_em_uart_sim_stats sim_stats;
+  bench_channel *channel;
+  uint32_t *latency_us, latency_count = 0, errors = 0, data_errors = 0, lost_payloads = 0, index;
+  uint64_t start_ns, end_ns = 0, tx_bytes = 0, rx_bytes = 0, elapsed_ns;
+
+  memset(&sim_config, 0, sizeof(sim_config));
+  sim_config.bytes_per_sec = baud / 10;   // 8 data bits, start and stop bit
+  sim_config.sdo_latency_us = config->sdo_latency_us;
+  ddi_em_uart_sim_configure(&sim_config);
+
+  start_ns = monotonic_ns();
+  for ( index = 0; index < channel_count; index++ )
+  {
+    channel = &g_channels[index];
+    channel->handle = handles[index];
+    channel->payload = payload;
+    channel->window = config->window;
+    channel->stop_ns = start_ns + (uint64_t)config->duration_ms * 1000000;
+    channel->drain_ns = channel->stop_ns + (uint64_t)BENCH_DRAIN_MS * 1000000;
+    pthread_create(&channel->thread, NULL, channel_thread, channel);
+  }
+  for ( index = 0; index < channel_count; index++ )
+  {
+    channel = &g_channels[index];
+    pthread_join(channel->thread, NULL);
+    tx_bytes += channel->tx_bytes;
+    rx_bytes += channel->rx_bytes;
+    errors += channel->errors;
+    data_errors += channel->data_errors;
+    lost_payloads += channel->lost_payloads;
+    latency_count += channel->latency_count;
+    if ( channel->last_rx_ns > end_ns )
+    {
+      end_ns = channel->last_rx_ns;
+    }
+  }
+  ddi_em_uart_sim_get_stats(&sim_stats);
+  elapsed_ns = (end_ns > start_ns) ? end_ns - start_ns : 1;
+
+  // The latencies of all channels
+  latency_us = (uint32_t *)malloc((latency_count ? latency_count : 1) * sizeof(uint32_t));
+  latency_count = 0;
+  for ( index = 0; index < channel_count; index++ )
+  {
+    channel = &g_channels[index];
+    if ( latency_us != NULL )
+    {
+      memcpy(&latency_us[latency_count], channel->latency_us, channel->latency_count * sizeof(uint32_t));
+      latency_count += channel->latency_count;
+    }
+    free(channel->latency_us);
+    memset(channel, 0, sizeof(bench_channel));
+  }
+  if ( latency_us != NULL )
+  {
+    qsort(latency_us, latency_count, sizeof(uint32_t), compare_latency);
+  }
+
+  printf("%s,%u,%u,%u,%u,%u,%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%u,%u,%u,%u,%u,%.3f,%" PRIu64 ",%" PRIu64 ",%u,%u,%u,%" PRIu64 "\n",
+    (tx_path == BENCH_TX_SCHEDULED) ? "scheduled" : "direct", channel_count, payload, baud, cycle_us, (uint32_t)(elapsed_ns / 1000000), tx_bytes, rx_bytes,
+    (uint64_t)(rx_bytes * 1000000000ULL / elapsed_ns), latency_count,
+    latency_us ? percentile(latency_us, latency_count, 50) : 0, latency_us ? percentile(latency_us, latency_count, 90) : 0,
+    latency_us ? percentile(latency_us, latency_count, 99) : 0, latency_count && latency_us ? latency_us[latency_count - 1] : 0,
+    (double)sim_stats.mailbox_busy_ns / elapsed_ns, sim_stats.tx_transfers + sim_stats.rx_transfers, sim_stats.status_reads,
+    errors, data_errors, lost_payloads, sim_stats.overflow_bytes);
+  fflush(stdout);
+  free(latency_us);
+  return (data_errors == 0) && (lost_payloads == 0) && (sim_stats.overflow_bytes == 0) && (sim_stats.rejected == 0) &&
+         (rx_bytes == tx_bytes);
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr, "Usage: %s [-q] [-d duration_ms] [-x tx_paths] [-c channels] [-p payloads] [-b bauds] [-t cycles_us] [-s sdo_latency_us] "
+                  "[-w window] [eni file]\n", name);
+}
+
+int main (int argc, char **argv)
+{
+  static const uint32_t default_channels[] = { 1, 4, 16 };
+  static const uint32_t default_payloads[] = { 16, 64, 255 };
+  static const uint32_t default_bauds[] = { 9600, 115200 };
+  static const uint32_t default_cycles_us[] = { 1000, 4000 };
+  static const uint32_t quick_channels[] = { 1, 4 };
+  static const uint32_t quick_payloads[] = { 64 };
+  static const uint32_t quick_bauds[] = { 115200 };
+  static const uint32_t quick_cycles_us[] = { 1000 };
+  const char *eni_file = BENCH_ENI_FILE;
+  bench_config config;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_fusion_uart_handle handles[BENCH_MAX_CHANNELS];
+  uint32_t max_channels = 0, index, cycle, tx_path, baud, payload, channels;
+  int option, failures = 0;
+
+  memset(&config, 0, sizeof(config));
+  set_list(&config.channels, default_channels, sizeof(default_channels) / sizeof(uint32_t));
+  set_list(&config.payloads, default_payloads, sizeof(default_payloads) / sizeof(uint32_t));
+  set_list(&config.bauds, default_bauds, sizeof(default_bauds) / sizeof(uint32_t));
+  set_list(&config.cycles_us, default_cycles_us, sizeof(default_cycles_us) / sizeof(uint32_t));
+  config.tx_paths = BENCH_TX_DIRECT | BENCH_TX_SCHEDULED;
+  config.duration_ms = 1000;
+  config.sdo_latency_us = 200;
+  config.window = 4;
+  while ( (option = getopt(argc, argv, "qd:x:c:p:b:t:s:w:")) != -1 )
+  {
+    bool valid = true;
+    switch ( option )
+    {
+      case 'q':
+        set_list(&config.channels, quick_channels, sizeof(quick_channels) / sizeof(uint32_t));
+        set_list(&config.payloads, quick_payloads, sizeof(quick_payloads) / sizeof(uint32_t));
+        set_list(&config.bauds, quick_bauds, sizeof(quick_bauds) / sizeof(uint32_t));
+        set_list(&config.cycles_us, quick_cycles_us, sizeof(quick_cycles_us) / sizeof(uint32_t));
+        config.duration_ms = 200;
+        break;
+      case 'd': config.duration_ms = strtoul(optarg, NULL, 0); valid = config.duration_ms != 0; break;
+      case 'x': valid = parse_tx_paths(optarg, &config.tx_paths); break;
+      case 'c': valid = parse_list(optarg, &config.channels); break;
+      case 'p': valid = parse_list(optarg, &config.payloads); break;
+      case 'b': valid = parse_list(optarg, &config.bauds); break;
+      case 't': valid = parse_list(optarg, &config.cycles_us); break;
+      case 's': config.sdo_latency_us = strtoul(optarg, NULL, 0); break;
+      case 'w': config.window = strtoul(optarg, NULL, 0); break;
+      default: valid = false; break;
+    }
+    if ( !valid )
+    {
+      usage(argv[0]);
+      return -1;
+    }
+  }
+  if ( optind < argc )
+  {
+    eni_file = argv[optind];
+  }
+  for ( index = 0; index < config.channels.count; index++ )
+  {
+    if ( config.channels.values[index] > max_channels )
+    {
+      max_channels = config.channels.values[index];
+    }
+  }
+  for ( index = 0; index < config.payloads.count; index++ )
+  {
+    // The window of payloads in flight has to fit in the Rx buffer of the simulated channel
+    if ( (config.payloads.values[index] > DDI_FUSION_UART_SDO_DATA_SIZE_MAX) ||
+         (config.payloads.values[index] * config.window > DDI_EM_UART_SIM_BUFFER_SIZE) )
+    {
+      fprintf(stderr, "A payload of %u bytes is too large\n", config.payloads.values[index]);
+      return -1;
+    }
+  }
+  if ( (max_channels > BENCH_MAX_CHANNELS) || (config.window == 0) || (config.window > BENCH_MAX_WINDOW) )
+  {
+    fprintf(stderr, "At most %d channels and a window of 1 to %d payloads\n", BENCH_MAX_CHANNELS, BENCH_MAX_WINDOW);
+    return -1;
+  }
+
+  // The benchmark doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    fprintf(stderr, "ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = config.cycles_us.values[0];
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link, the UART modules are simulated
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    fprintf(stderr, "ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  ddi_em_register_cyclic_callback(em_handle, cyclic_callback, NULL);
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    fprintf(stderr, "ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  result = ddi_em_uart_sim_attach(em_handle, (max_channels + MAX_NUMBER_UART_PER_MODULE - 1) / MAX_NUMBER_UART_PER_MODULE);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    fprintf(stderr, "ddi_em_uart_sim_attach failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+  for ( index = 0; index < max_channels; index++ )
+  {
+    result = ddi_fusion_uart_open(em_handle, 0, DDI_FUSION_UART_ETHERCAT_MODULE(index / MAX_NUMBER_UART_PER_MODULE + 1),
+      (uart_channel)(index % MAX_NUMBER_UART_PER_MODULE), 0, &handles[index]);
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      fprintf(stderr, "ddi_fusion_uart_open(%u) failed: 0x%04x (%s) \n", index, result, ddi_em_get_error_string(result));
+      ddi_em_deinit(em_handle);
+      return -1;
+    }
+  }
+
+  printf("tx_path,channels,payload_bytes,baud,cycle_us,elapsed_ms,tx_bytes,rx_bytes,rx_bytes_per_sec,payloads,latency_p50_us,"
+         "latency_p90_us,latency_p99_us,latency_max_us,mailbox_utilization,mailbox_transfers,status_reads,errors,"
+         "data_errors,lost_payloads,overflow_bytes\n");
+  for ( cycle = 0; cycle < config.cycles_us.count; cycle++ )
+  {
+    result = ddi_em_set_cycle_rate(em_handle, config.cycles_us.values[cycle]);
+    if ( (result != DDI_EM_STATUS_OK) || !wait_for_cycle_rate(em_handle, config.cycles_us.values[cycle]) )
+    {
+      fprintf(stderr, "Cannot set a cycle time of %u us: 0x%04x (%s) \n", config.cycles_us.values[cycle], result,
+        ddi_em_get_error_string(result));
+      failures++;
+      continue;
+    }
+    for ( tx_path = BENCH_TX_DIRECT; tx_path <= BENCH_TX_SCHEDULED; tx_path <<= 1 )
+    {
+      if ( !(config.tx_paths & tx_path) )
+      {
+        continue;
+      }
+      // While the scheduler runs, ddi_fusion_uart_tx_data() queues the payload and waits until it was sent
+      result = (tx_path == BENCH_TX_SCHEDULED) ? ddi_fusion_uart_tx_scheduler_start(em_handle, 0) : DDI_EM_STATUS_OK;
+      if ( result != DDI_EM_STATUS_OK )
+      {
+        fprintf(stderr, "ddi_fusion_uart_tx_scheduler_start failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+        failures++;
+        continue;
+      }
+      for ( baud = 0; baud < config.bauds.count; baud++ )
+      {
+        for ( payload = 0; payload < config.payloads.count; payload++ )
+        {
+          for ( channels = 0; channels < config.channels.count; channels++ )
+          {
+            fprintf(stderr, "%s transmits, %u channels, %u byte payloads, %u baud, %u us cycle\n",
+              (tx_path == BENCH_TX_SCHEDULED) ? "Scheduled" : "Direct", config.channels.values[channels],
+              config.payloads.values[payload], config.bauds.values[baud], config.cycles_us.values[cycle]);
+            if ( !run_point(handles, tx_path, config.channels.values[channels], config.payloads.values[payload],
+                            config.bauds.values[baud], config.cycles_us.values[cycle], &config) )
+            {
+              fprintf(stderr, "Data was lost or corrupted\n");
+              failures++;
+            }
+          }
+        }
+      }
+      if ( tx_path == BENCH_TX_SCHEDULED )
+      {
+        ddi_fusion_uart_tx_scheduler_stop(em_handle);
+      }
+    }
+  }
+
+  for ( index = 0; index < max_channels; index++ )
+  {
+    ddi_fusion_uart_close(handles[index]);
+  }
+  ddi_em_uart_sim_detach(em_handle);
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+  return failures ? 1 : 0;
+}
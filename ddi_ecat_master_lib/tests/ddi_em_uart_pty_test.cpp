@@ -0,0 +1,201 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// UART pseudo-terminal bridge test program
+// Runs the master over the in-memory loopback link with a UART module simulated at the mailbox and the status process
+// data, bridges two of its channels to ptys and sends data through the ptys, the library transfers and back.
+// Usage: ddi_em_uart_pty_test [eni file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+#include <inttypes.h>
+#include "ddi_em_api.h"
+#include "ddi_em_fusion.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_loopback_link.h"
+#include "ddi_em_uart_sim.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_UART_INDEX         DDI_FUSION_UART_ETHERCAT_MODULE(1)
+#define TEST_BYTES              2000
+#define TEST_BATCH_BYTES        64
+#define TEST_TIMEOUT_MS         5000
+// 115200 baud, 10 bits per byte
+#define TEST_LINE_BYTES_PER_SEC 11520
+#define TEST_SDO_LATENCY_US     200
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+// Latches the status process data of the simulated module
+static void cyclic_callback(void *arg)
+{
+  ddi_em_uart_sim_cycle();
+}
+
+static uint64_t monotonic_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Write a pattern to a pty and read it back through the looped back channel
+static bool pty_round_trip(const char *pty_name, uint8_t seed)
+{
+  uint8_t tx_data[TEST_BYTES], rx_data[TEST_BYTES];
+  uint32_t index, received = 0;
+  uint64_t deadline = monotonic_ms() + TEST_TIMEOUT_MS;
+  struct pollfd poll_fd;
+  struct termios attributes;
+  ssize_t length;
+  int fd;
+
+  fd = open(pty_name, O_RDWR | O_NOCTTY);
+  if ( fd < 0 )
+  {
+    printf("Cannot open %s\n", pty_name);
+    return false;
+  }
+  TEST_CHECK(isatty(fd) && (tcgetattr(fd, &attributes) == 0), "%s is not a tty", pty_name);
+  for ( index = 0; index < TEST_BYTES; index++ )
+  {
+    tx_data[index] = (uint8_t)(index * 7 + seed);
+  }
+  TEST_CHECK(write(fd, tx_data, TEST_BYTES) == TEST_BYTES, "write to %s failed", pty_name);
+
+  poll_fd.fd = fd;
+  poll_fd.events = POLLIN;
+  while ( (received < TEST_BYTES) && (monotonic_ms() < deadline) )
+  {
+    if ( poll(&poll_fd, 1, 100) > 0 )
+    {
+      length = read(fd, &rx_data[received], TEST_BYTES - received);
+      if ( length > 0 )
+      {
+        received += length;
+      }
+    }
+  }
+  close(fd);
+  TEST_CHECK(received == TEST_BYTES, "%s: %u of %d bytes received", pty_name, received, TEST_BYTES);
+  return (received == TEST_BYTES) && (memcmp(tx_data, rx_data, TEST_BYTES) == 0);
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_em_uart_sim_config sim_config;
+  ddi_fusion_uart_pty_config pty_config;
+  ddi_fusion_uart_pty_stats stats[2];
+  ddi_fusion_uart_handle uart_handle[2];
+  char pty_name[2][64];
+  uint32_t channel;
+  uint64_t deadline;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link, the UART module is simulated
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  ddi_em_register_cyclic_callback(em_handle, cyclic_callback, NULL);
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  memset(&sim_config, 0, sizeof(sim_config));
+  sim_config.bytes_per_sec = TEST_LINE_BYTES_PER_SEC;
+  sim_config.sdo_latency_us = TEST_SDO_LATENCY_US;
+  ddi_em_uart_sim_configure(&sim_config);
+  result = ddi_em_uart_sim_attach(em_handle, 1);
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_em_uart_sim_attach returned 0x%04x", result);
+
+  for ( channel = 0; channel < 2; channel++ )
+  {
+    result = ddi_fusion_uart_open(em_handle, 0, TEST_UART_INDEX, (uart_channel)channel, 0, &uart_handle[channel]);
+    TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_fusion_uart_open(%u) returned 0x%04x", channel, result);
+  }
+  TEST_CHECK(ddi_fusion_uart_pty_close(uart_handle[0]) == DDI_EM_STATUS_NOT_FOUND, "closed a bridge that was not open");
+
+  // Channel 0 forwards every byte at once, channel 1 batches
+  result = ddi_fusion_uart_pty_open(uart_handle[0], NULL, pty_name[0], sizeof(pty_name[0]));
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_fusion_uart_pty_open(0) returned 0x%04x", result);
+  memset(&pty_config, 0, sizeof(pty_config));
+  pty_config.tx_batch_bytes = TEST_BATCH_BYTES;
+  pty_config.tx_batch_timeout_us = 2000;
+  result = ddi_fusion_uart_pty_open(uart_handle[1], &pty_config, pty_name[1], sizeof(pty_name[1]));
+  TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_fusion_uart_pty_open(1) returned 0x%04x", result);
+  TEST_CHECK(ddi_fusion_uart_pty_open(uart_handle[1], &pty_config, pty_name[1], sizeof(pty_name[1])) == DDI_EM_STATUS_BUSY,
+    "a UART handle was bridged twice");
+  pty_config.tx_batch_bytes = DDI_FUSION_UART_SDO_DATA_SIZE_MAX + 1;
+  TEST_CHECK(ddi_fusion_uart_pty_open(uart_handle[0], &pty_config, pty_name[0], sizeof(pty_name[0])) == DDI_EM_STATUS_INVALID_ARG,
+    "a batch larger than one transfer was accepted");
+
+  for ( channel = 0; channel < 2; channel++ )
+  {
+    printf("UART %d bridged to %s\n", uart_handle[channel], pty_name[channel]);
+    TEST_CHECK(pty_round_trip(pty_name[channel], channel), "%s: the received data differs", pty_name[channel]);
+    // The bridge counts the received bytes once the pty write returns, the reader can be a little ahead of it
+    deadline = monotonic_ms() + TEST_TIMEOUT_MS;
+    do
+    {
+      result = ddi_fusion_uart_pty_get_stats(uart_handle[channel], &stats[channel], false);
+    } while ( (result == DDI_EM_STATUS_OK) && (stats[channel].rx_bytes < TEST_BYTES) && (monotonic_ms() < deadline) );
+    TEST_CHECK(result == DDI_EM_STATUS_OK, "ddi_fusion_uart_pty_get_stats returned 0x%04x", result);
+    printf("%s: tx %" PRIu64 " bytes in %" PRIu64 " transfers, rx %" PRIu64 " bytes in %" PRIu64 " transfers, %u/%u bytes/s\n",
+      pty_name[channel], stats[channel].tx_bytes, stats[channel].tx_transfers, stats[channel].rx_bytes, stats[channel].rx_transfers,
+      stats[channel].tx_bytes_per_sec, stats[channel].rx_bytes_per_sec);
+    TEST_CHECK((stats[channel].tx_bytes == TEST_BYTES) && (stats[channel].rx_bytes == TEST_BYTES), "%s: byte counters are wrong",
+      pty_name[channel]);
+    TEST_CHECK((stats[channel].tx_errors == 0) && (stats[channel].rx_errors == 0), "%s: transfer errors", pty_name[channel]);
+  }
+  TEST_CHECK(stats[1].tx_transfers <= (TEST_BYTES + TEST_BATCH_BYTES - 1) / TEST_BATCH_BYTES + 1,
+    "%" PRIu64 " transmits for batches of %d bytes", stats[1].tx_transfers, TEST_BATCH_BYTES);
+
+  // Closing the UART handle closes its bridge
+  ddi_fusion_uart_close(uart_handle[1]);
+  TEST_CHECK(ddi_fusion_uart_pty_get_stats(uart_handle[1], &stats[1], false) == DDI_EM_STATUS_NOT_FOUND, "the bridge outlived its UART handle");
+  TEST_CHECK(ddi_fusion_uart_pty_close(uart_handle[0]) == DDI_EM_STATUS_OK, "ddi_fusion_uart_pty_close failed");
+  ddi_fusion_uart_close(uart_handle[0]);
+  ddi_em_uart_sim_detach(em_handle);
+
+  ddi_em_deinit(em_handle);
+  ddi_em_sdk_deinit();
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,162 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// UART handle registry test program
+// Runs the master over the in-memory loopback link and opens and closes UART handles on two master instances while
+// the cyclic thread walks the open handles, up to DDI_FUSION_UART_MAX_HANDLES.
+// Usage: ddi_em_uart_registry_test [eni file]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include "ddi_em_api.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_loopback_link.h"
+
+#define TEST_ENI_FILE           "tests/config/cram_eni.xml"
+#define TEST_UART_INDEX         0x5005
+#define TEST_HANDLES            300
+
+static int g_failures = 0;
+
+#define TEST_CHECK(cond, ...) do { if ( !(cond) ) { printf("FAIL: " __VA_ARGS__); printf("\n"); g_failures++; } } while (0)
+
+static ddi_fusion_uart_handle g_handles[DDI_FUSION_UART_MAX_HANDLES];
+static bool g_is_open[DDI_FUSION_UART_MAX_HANDLES];
+
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Open a handle and check that it is not open already
+static ddi_em_result open_handle(ddi_em_handle em_handle, uint32_t count, ddi_fusion_uart_handle *handle)
+{
+  ddi_em_result result;
+
+  result = ddi_fusion_uart_open(em_handle, 0, TEST_UART_INDEX, (uart_channel)(count % 4), 0, handle);
+  if ( result == DDI_EM_STATUS_OK )
+  {
+    TEST_CHECK((*handle >= 0) && (*handle < DDI_FUSION_UART_MAX_HANDLES), "handle %d is out of range", *handle);
+    if ( (*handle >= 0) && (*handle < DDI_FUSION_UART_MAX_HANDLES) )
+    {
+      TEST_CHECK(!g_is_open[*handle], "handle %d was returned twice", *handle);
+      g_is_open[*handle] = true;
+    }
+  }
+  return result;
+}
+
+int main (int argc, char **argv)
+{
+  const char *eni_file = (argc > 1) ? argv[1] : TEST_ENI_FILE;
+  ddi_em_handle em_handle;
+  ddi_em_result result;
+  ddi_em_init_params init_params;
+  ddi_fusion_uart_handle handle, closed[TEST_HANDLES];
+  uint32_t count, closed_count, reused, open_count;
+  uint64_t start_ns, elapsed_ns;
+
+  // The loopback test doesn't need the deployment log directory
+  setenv("DDI_EM_LOG_DIR", "/tmp", 0);
+
+  result = ddi_em_sdk_init();
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_sdk_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+
+  memset(&init_params, 0, sizeof(ddi_em_init_params));
+  init_params.network_adapter       = DDI_EM_NIC_1;
+  init_params.scan_rate_us          = 1000;
+  init_params.enable_cyclic_thread  = 1;
+  // There are no slaves behind the loopback link
+  init_params.network_control_flags = DDI_EM_NETWORK_MASTER_STATE_CHECK_DISABLE;
+  result = ddi_em_init(&init_params, &em_handle);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_init failed: 0x%04x (%s) \n", result, ddi_em_get_error_string(result));
+    return -1;
+  }
+  result = ddi_em_configure_master(em_handle, eni_file);
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    printf("ddi_em_configure_master(%s) failed: 0x%04x (%s) \n", eni_file, result, ddi_em_get_error_string(result));
+    ddi_em_deinit(em_handle);
+    return -1;
+  }
+
+  // More handles than the physical channels of one master instance, alternating between two master instances
+  for ( count = 0; count < TEST_HANDLES; count++ )
+  {
+    result = open_handle((count & 1) ? em_handle + 1 : em_handle, count, &g_handles[count]);
+    TEST_CHECK(result == DDI_EM_STATUS_OK, "open %u returned 0x%04x", count, result);
+  }
+  TEST_CHECK(ddi_fusion_uart_close(-1) == DDI_EM_STATUS_INVALID_INSTANCE, "closed handle -1");
+  TEST_CHECK(ddi_fusion_uart_close(DDI_FUSION_UART_MAX_HANDLES) == DDI_EM_STATUS_INVALID_INSTANCE, "closed a handle beyond the limit");
+  TEST_CHECK(ddi_fusion_uart_close(DDI_FUSION_UART_MAX_HANDLES - 1) == DDI_EM_STATUS_INVALID_INSTANCE, "closed a handle never opened");
+
+  // Closed handles are reused before new ones are allocated
+  closed_count = 0;
+  for ( count = 0; count < TEST_HANDLES; count += 3 )
+  {
+    TEST_CHECK(ddi_fusion_uart_close(g_handles[count]) == DDI_EM_STATUS_OK, "close of handle %d failed", g_handles[count]);
+    TEST_CHECK(ddi_fusion_uart_close(g_handles[count]) == DDI_EM_STATUS_OK, "second close of handle %d failed", g_handles[count]);
+    g_is_open[g_handles[count]] = false;
+    closed[closed_count++] = g_handles[count];
+  }
+  reused = 0;
+  for ( count = 0; count < TEST_HANDLES; count += 3 )
+  {
+    result = open_handle(em_handle + 1, count, &handle);
+    TEST_CHECK(result == DDI_EM_STATUS_OK, "reopen %u returned 0x%04x", count, result);
+    g_handles[count] = handle;
+    reused += (handle == closed[--closed_count]) ? 1 : 0;
+  }
+  TEST_CHECK(reused == (TEST_HANDLES + 2) / 3, "%u of %u closed handles were reused", reused, (TEST_HANDLES + 2) / 3);
+
+  // Fill the registry
+  open_count = TEST_HANDLES;
+  start_ns = monotonic_ns();
+  while ( open_count < DDI_FUSION_UART_MAX_HANDLES + 1 )
+  {
+    result = open_handle((open_count & 1) ? em_handle + 1 : em_handle, open_count, &handle);
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      break;
+    }
+    g_handles[open_count++] = handle;
+  }
+  elapsed_ns = monotonic_ns() - start_ns;
+  TEST_CHECK(result == DDI_EM_STATUS_NO_RESOURCES, "open of a full registry returned 0x%04x", result);
+  TEST_CHECK(open_count == DDI_FUSION_UART_MAX_HANDLES, "%u handles open at once", open_count);
+  printf("%u handles open, %" PRIu64 " ns per open\n", open_count, elapsed_ns / (open_count - TEST_HANDLES));
+
+  // Close and reopen them all while the cyclic thread runs
+  start_ns = monotonic_ns();
+  for ( count = 0; count < open_count; count++ )
+  {
+    TEST_CHECK(ddi_fusion_uart_close(g_handles[count]) == DDI_EM_STATUS_OK, "close of handle %d failed", g_handles[count]);
+    g_is_open[g_handles[count]] = false;
+    result = open_handle(em_handle, count, &g_handles[count]);
+    TEST_CHECK(result == DDI_EM_STATUS_OK, "reopen of a full registry returned 0x%04x", result);
+  }
+  elapsed_ns = monotonic_ns() - start_ns;
+  printf("%" PRIu64 " ns per close and reopen\n", elapsed_ns / open_count);
+
+  // Deinit closes the handles that are still open
+  ddi_em_deinit(em_handle);
+  TEST_CHECK(ddi_fusion_uart_close(g_handles[0]) == DDI_EM_STATUS_OK, "close after deinit failed");
+  ddi_em_sdk_deinit();
+  printf("%s\n", g_failures ? "FAILED" : "PASSED");
+  return g_failures ? 1 : 0;
+}
@@ -0,0 +1,287 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Simulated Fusion UART slave, see ddi_em_uart_sim.h
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "ddi_em_api.h"
+#include "ddi_em_fusion.h"
+#include "ddi_em_fusion_uart_api.h"
+#include "ddi_em_coe_standin.h"
+#include "ddi_em_fusion_uart_standin.h"
+#include "ddi_em_uart_sim.h"
+
+#define UART_SIM_CHANNELS (MAX_NUMBER_UART_ETHERCAT_MODULES * MAX_NUMBER_UART_PER_MODULE)
+// The objects of a UART module, relative to its 0x5nn5 configuration index
+#define UART_SIM_INFO_OBJECT     1
+#define UART_SIM_TX_OBJECT       2
+#define UART_SIM_RX_OBJECT       6
+// SI0 of a Tx or Rx object holds the data length
+#define UART_SIM_SI0_SIZE        sizeof(uint16_t)
+
+typedef struct {
+  uint8_t  data[DDI_EM_UART_SIM_BUFFER_SIZE];
+  uint64_t ready_ns[DDI_EM_UART_SIM_BUFFER_SIZE];   // Time the line has carried the byte
+  uint32_t head;
+  uint32_t count;
+  uint64_t line_free_ns;                            // Time the line has carried the last byte sent
+} uart_sim_channel;
+
+typedef struct {
+  pthread_mutex_t        lock;          // Protects the channels and the counters
+  pthread_mutex_t        mailbox_lock;  // One mailbox transfer at a time
+  ddi_em_uart_sim_config config;
+  ddi_em_uart_sim_stats  stats;
+  uint32_t               module_count;
+  uart_sim_channel       channels[UART_SIM_CHANNELS];
+  uint16_t               status[UART_SIM_CHANNELS];  // The status image, read by the library every cycle
+} uart_sim;
+
+static uart_sim g_uart_sim = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER };
+
+static uint64_t monotonic_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Take the mailbox for the duration of one transfer
+static void mailbox_transfer(void)
+{
+  struct timespec delay;
+  uint64_t start_ns;
+
+  pthread_mutex_lock(&g_uart_sim.mailbox_lock);
+  start_ns = monotonic_ns();
+  if ( g_uart_sim.config.sdo_latency_us != 0 )
+  {
+    delay.tv_sec = g_uart_sim.config.sdo_latency_us / 1000000;
+    delay.tv_nsec = (g_uart_sim.config.sdo_latency_us % 1000000) * 1000;
+    nanosleep(&delay, NULL);
+  }
+  __atomic_add_fetch(&g_uart_sim.stats.mailbox_busy_ns, monotonic_ns() - start_ns, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&g_uart_sim.mailbox_lock);
+}
+
+// Return the bytes of a channel the line has carried, called with the lock held
+static uint32_t get_ready_count(uart_sim_channel *channel, uint64_t now_ns)
+{
+  uint32_t count = 0;
+
+  while ( (count < channel->count) && (channel->ready_ns[(channel->head + count) % DDI_EM_UART_SIM_BUFFER_SIZE] <= now_ns) )
+  {
+    count++;
+  }
+  return count;
+}
+
+// Queue the bytes of a Tx object write on the line of the channel, called with the lock held
+static ddi_em_result write_tx_object(uart_sim_channel *channel, const uint8_t *data, uint32_t len)
+{
+  uint16_t length;
+  uint64_t now_ns, byte_ns;
+  uint32_t index;
+
+  if ( len < UART_SIM_SI0_SIZE )
+  {
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+  memcpy(&length, data, UART_SIM_SI0_SIZE);
+  if ( (length > DDI_FUSION_UART_SDO_DATA_SIZE_MAX) || (length != len - UART_SIM_SI0_SIZE) )
+  {
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+  now_ns = monotonic_ns();
+  byte_ns = g_uart_sim.config.bytes_per_sec ? 1000000000ULL / g_uart_sim.config.bytes_per_sec : 0;
+  if ( channel->line_free_ns < now_ns )
+  {
+    channel->line_free_ns = now_ns;
+  }
+  for ( index = 0; index < length; index++ )
+  {
+    channel->line_free_ns += byte_ns;
+    if ( channel->count == DDI_EM_UART_SIM_BUFFER_SIZE )
+    {
+      g_uart_sim.stats.overflow_bytes++;
+      continue;
+    }
+    channel->data[(channel->head + channel->count) % DDI_EM_UART_SIM_BUFFER_SIZE] = data[UART_SIM_SI0_SIZE + index];
+    channel->ready_ns[(channel->head + channel->count) % DDI_EM_UART_SIM_BUFFER_SIZE] = channel->line_free_ns;
+    channel->count++;
+  }
+  g_uart_sim.stats.tx_transfers++;
+  g_uart_sim.stats.tx_bytes += length;
+  return DDI_EM_STATUS_OK;
+}
+
+// Read up to 255 of the bytes the line has carried from the Rx object of the channel, called with the lock held
+static ddi_em_result read_rx_object(uart_sim_channel *channel, uint8_t *data, uint32_t len, uint32_t *out_len)
+{
+  uint16_t length;
+  uint32_t count, index;
+
+  if ( len < UART_SIM_SI0_SIZE )
+  {
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+  count = get_ready_count(channel, monotonic_ns());
+  if ( count > DDI_FUSION_UART_SDO_DATA_SIZE_MAX )
+  {
+    count = DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+  }
+  if ( count > len - UART_SIM_SI0_SIZE )
+  {
+    count = len - UART_SIM_SI0_SIZE;
+  }
+  length = (uint16_t)count;
+  memcpy(data, &length, UART_SIM_SI0_SIZE);
+  for ( index = 0; index < count; index++ )
+  {
+    data[UART_SIM_SI0_SIZE + index] = channel->data[(channel->head + index) % DDI_EM_UART_SIM_BUFFER_SIZE];
+  }
+  channel->head = (channel->head + count) % DDI_EM_UART_SIM_BUFFER_SIZE;
+  channel->count -= count;
+  *out_len = UART_SIM_SI0_SIZE + count;
+  g_uart_sim.stats.rx_transfers++;
+  g_uart_sim.stats.rx_bytes += count;
+  return DDI_EM_STATUS_OK;
+}
+
+// Read the live status word of the channel, called with the lock held
+static ddi_em_result read_status(uart_sim_channel *channel, uint8_t *data, uint32_t len, uint32_t *out_len)
+{
+  uint16_t status;
+
+  if ( len < sizeof(status) )
+  {
+    return DDI_EM_STATUS_INVALID_SIZE;
+  }
+  status = get_ready_count(channel, monotonic_ns()) & DDI_FUSION_UART_STATUS_RX_BYTE_MASK;
+  memcpy(data, &status, sizeof(status));
+  *out_len = sizeof(status);
+  g_uart_sim.stats.status_reads++;
+  return DDI_EM_STATUS_OK;
+}
+
+// The mailbox stand-in, serves the UART objects of the simulated modules
+static ddi_em_result serve_transfer(ddi_em_handle em_handle, ddi_es_handle es_handle, uint16_t index, uint16_t subindex,
+                                    uint8_t *data, uint32_t len, uint32_t *out_len, uint32_t flags, void *user_data)
+{
+  uint32_t module = (index / DDI_FUSION_SLOT_INCREMENT) & 0xFF;
+  int32_t object = (int32_t)(index % DDI_FUSION_SLOT_INCREMENT) - (int32_t)(DDI_FUSION_UART_CONFIG_SDO_INDEX % DDI_FUSION_SLOT_INCREMENT);
+  ddi_em_result result = DDI_EM_STATUS_NOT_SUPPORTED;
+  bool write = (out_len == NULL);
+
+  if ( data == NULL )
+  {
+    return DDI_EM_STATUS_NULL_ARGUMENT;
+  }
+  mailbox_transfer();
+  pthread_mutex_lock(&g_uart_sim.lock);
+  if ( ((index & 0xF000) == (DDI_FUSION_UART_CONFIG_SDO_INDEX & 0xF000)) && (module < g_uart_sim.module_count) )
+  {
+    if ( write && (object >= UART_SIM_TX_OBJECT) && (object < UART_SIM_TX_OBJECT + MAX_NUMBER_UART_PER_MODULE) )
+    {
+      result = write_tx_object(&g_uart_sim.channels[module * MAX_NUMBER_UART_PER_MODULE + object - UART_SIM_TX_OBJECT], data, len);
+    }
+    else if ( !write && (object >= UART_SIM_RX_OBJECT) && (object < UART_SIM_RX_OBJECT + MAX_NUMBER_UART_PER_MODULE) )
+    {
+      result = read_rx_object(&g_uart_sim.channels[module * MAX_NUMBER_UART_PER_MODULE + object - UART_SIM_RX_OBJECT], data, len, out_len);
+    }
+    else if ( !write && (object == UART_SIM_INFO_OBJECT) && (subindex >= DDI_FUSION_UART_STATUS_CH0_SI) &&
+              (subindex <= DDI_FUSION_UART_STATUS_CH3_SI) )
+    {
+      result = read_status(&g_uart_sim.channels[module * MAX_NUMBER_UART_PER_MODULE + subindex - DDI_FUSION_UART_STATUS_CH0_SI], data,
+                           len, out_len);
+    }
+  }
+  if ( result != DDI_EM_STATUS_OK )
+  {
+    g_uart_sim.stats.rejected++;
+  }
+  pthread_mutex_unlock(&g_uart_sim.lock);
+  return result;
+}
+
+ddi_em_result ddi_em_uart_sim_attach(ddi_em_handle em_handle, uint32_t module_count)
+{
+  ddi_em_result result;
+  uint32_t module;
+
+  if ( (module_count == 0) || (module_count > MAX_NUMBER_UART_ETHERCAT_MODULES) )
+  {
+    return DDI_EM_STATUS_INVALID_ARG;
+  }
+  for ( module = 0; module < module_count; module++ )
+  {
+    result = ddi_fusion_uart_map_standin_status(em_handle, DDI_FUSION_UART_ETHERCAT_MODULE(module + 1),
+      module * MAX_NUMBER_UART_PER_MODULE, &g_uart_sim.status[module * MAX_NUMBER_UART_PER_MODULE]);
+    if ( result != DDI_EM_STATUS_OK )
+    {
+      return result;
+    }
+  }
+  pthread_mutex_lock(&g_uart_sim.lock);
+  g_uart_sim.module_count = module_count;
+  pthread_mutex_unlock(&g_uart_sim.lock);
+  return ddi_em_coe_set_standin(em_handle, serve_transfer, NULL);
+}
+
+void ddi_em_uart_sim_detach(ddi_em_handle em_handle)
+{
+  uint32_t module;
+
+  ddi_em_coe_set_standin(em_handle, NULL, NULL);
+  pthread_mutex_lock(&g_uart_sim.lock);
+  for ( module = 0; module < g_uart_sim.module_count; module++ )
+  {
+    ddi_fusion_uart_map_standin_status(em_handle, DDI_FUSION_UART_ETHERCAT_MODULE(module + 1), module * MAX_NUMBER_UART_PER_MODULE, NULL);
+  }
+  g_uart_sim.module_count = 0;
+  pthread_mutex_unlock(&g_uart_sim.lock);
+}
+
+void ddi_em_uart_sim_configure(const ddi_em_uart_sim_config *config)
+{
+  uint32_t channel;
+
+  pthread_mutex_lock(&g_uart_sim.lock);
+  g_uart_sim.config = *config;
+  memset(&g_uart_sim.stats, 0, sizeof(g_uart_sim.stats));
+  memset(g_uart_sim.channels, 0, sizeof(g_uart_sim.channels));
+  for ( channel = 0; channel < UART_SIM_CHANNELS; channel++ )
+  {
+    __atomic_store_n(&g_uart_sim.status[channel], 0, __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&g_uart_sim.lock);
+}
+
+void ddi_em_uart_sim_cycle(void)
+{
+  uint64_t now_ns = monotonic_ns();
+  uint32_t channel;
+
+  pthread_mutex_lock(&g_uart_sim.lock);
+  for ( channel = 0; channel < g_uart_sim.module_count * MAX_NUMBER_UART_PER_MODULE; channel++ )
+  {
+    __atomic_store_n(&g_uart_sim.status[channel],
+      (uint16_t)(get_ready_count(&g_uart_sim.channels[channel], now_ns) & DDI_FUSION_UART_STATUS_RX_BYTE_MASK), __ATOMIC_RELAXED);
+  }
+  pthread_mutex_unlock(&g_uart_sim.lock);
+}
+
+void ddi_em_uart_sim_get_stats(ddi_em_uart_sim_stats *stats)
+{
+  pthread_mutex_lock(&g_uart_sim.lock);
+  *stats = g_uart_sim.stats;
+  pthread_mutex_unlock(&g_uart_sim.lock);
+}
@@ -0,0 +1,83 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+#ifndef __DDI_EM_UART_SIM_H__
+#define __DDI_EM_UART_SIM_H__
+
+// Simulated Fusion UART slave, used by the UART tests that run without EtherCAT hardware.
+// The simulation sits below the UART library: it is the mailbox stand-in of the master instance (ddi_em_coe_standin.h)
+// and serves the Tx (0x5nn7-0x5nnA), Rx (0x5nnB-0x5nnE) and status (0x5nn6) objects of its modules, and the status
+// words of the modules are mapped to its status image (ddi_em_fusion_uart_standin.h). Every library path above the
+// mailbox runs unchanged: the SDO images, the transmit scheduler, the status mirror and the receive timelines.
+// Every channel is looped back, the bytes written to its Tx object are read from its Rx object once the simulated
+// line has carried them. The transfers share one simulated mailbox, each takes the configured SDO latency. Like the
+// process data of a real slave, the status image only changes when the test calls ddi_em_uart_sim_cycle() from its
+// cyclic callback.
+
+#include <stdint.h>
+#include "ddi_em_api.h"
+
+/*! @var DDI_EM_UART_SIM_BUFFER_SIZE
+  @brief The Rx buffer of each simulated channel, the status reports at most 12 bits of Rx bytes available
+*/
+#define DDI_EM_UART_SIM_BUFFER_SIZE 4095
+
+/** ddi_em_uart_sim_config
+ @brief Timing of the simulated UART slave
+ */
+typedef struct {
+  uint32_t bytes_per_sec;    /**< Line rate of the looped back channels, 0 delivers the bytes at once */
+  uint32_t sdo_latency_us;   /**< Time each simulated mailbox transfer takes */
+} ddi_em_uart_sim_config;
+
+/** ddi_em_uart_sim_stats
+ @brief Transfer counters of the simulated UART slave
+ */
+typedef struct {
+  uint64_t tx_transfers;     /**< Tx object writes */
+  uint64_t rx_transfers;     /**< Rx object reads */
+  uint64_t status_reads;     /**< Status object reads, made when the status mirror of the library is stale */
+  uint64_t tx_bytes;         /**< Bytes sent */
+  uint64_t rx_bytes;         /**< Bytes received */
+  uint64_t overflow_bytes;   /**< Bytes dropped by a full Rx buffer */
+  uint64_t rejected;         /**< Transfers to objects the simulation doesn't serve, or with a bad length */
+  uint64_t mailbox_busy_ns;  /**< Time the mailbox was taken by transfers */
+} ddi_em_uart_sim_stats;
+
+/** ddi_em_uart_sim_attach
+ @brief Simulate UART modules 1 to module_count on a configured master instance, module n on the physical channels
+        4 * (n - 1) to 4 * (n - 1) + 3. Called before the UART handles are opened.
+ @param em_handle The EtherCAT Master handle
+ @param module_count The number of UART modules, 1 to MAX_NUMBER_UART_ETHERCAT_MODULES
+ @return ddi_em_result The result code of the operation @see ddi_em_result
+ */
+ddi_em_result ddi_em_uart_sim_attach(ddi_em_handle em_handle, uint32_t module_count);
+
+/** ddi_em_uart_sim_detach
+ @brief Stop simulating the UART modules, called after the UART handles are closed
+ @param em_handle The EtherCAT Master handle
+ */
+void ddi_em_uart_sim_detach(ddi_em_handle em_handle);
+
+/** ddi_em_uart_sim_configure
+ @brief Set the timing of the simulated UART slave and empty its channels
+ @param config The timing
+ */
+void ddi_em_uart_sim_configure(const ddi_em_uart_sim_config *config);
+
+/** ddi_em_uart_sim_get_stats
+ @brief Return the transfer counters of the simulated UART slave
+ @param stats The transfer counters
+ */
+void ddi_em_uart_sim_get_stats(ddi_em_uart_sim_stats *stats);
+
+/** ddi_em_uart_sim_cycle
+ @brief Latch the status image, called from the cyclic callback of the test
+ */
+void ddi_em_uart_sim_cycle(void);
+
+#endif // __DDI_EM_UART_SIM_H__
@@ -0,0 +1,272 @@
+/**************************************************************************
+(c) Copyright 2022 Digital Dynamics Inc. Scotts Valley CA USA.
+Unpublished copyright. All rights reserved. Contains proprietary and
+confidential trade secrets belonging to DDI. Disclosure or release without
+prior written authorization of DDI is prohibited.
+**************************************************************************/
+
+// Process data capture decoder
+// Converts a capture file written by ddi_em_recorder_start() to CSV, one line per recorded cycle.
+// Regions of 1, 2, 4 or 8 bytes are printed as unsigned little-endian numbers, other regions as hex strings.
+// Usage: ddi_em_capture_decode [-i] [-s first_cycle] [-n cycles] capture_file [csv_file]
+//   -i  print the capture information instead of the records
+//   -s  start at the first record at or after this cycle, the index is used to seek to it
+//   -n  stop after this many records
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include "ddi_em_capture.h"
+
+typedef struct {
+  FILE                  *file;
+  ddi_em_capture_header  header;
+  ddi_em_capture_region  regions[DDI_EM_CAPTURE_MAX_REGIONS];
+  ddi_em_capture_footer  footer;
+  bool                   complete;        // Was the footer written? Interrupted captures have no index
+  uint64_t               record_count;
+  ddi_em_capture_index  *index;
+} capture_file;
+
+static void usage(void)
+{
+  printf("Usage: ddi_em_capture_decode [-i] [-s first_cycle] [-n cycles] capture_file [csv_file]\n");
+}
+
+// Read the header, the regions and, if present, the footer and the index
+static bool capture_open(capture_file *capture, const char *filename)
+{
+  uint64_t record_size = sizeof(ddi_em_capture_record);
+  uint32_t index;
+  long file_size;
+
+  memset(capture, 0, sizeof(capture_file));
+  capture->file = fopen(filename, "rb");
+  if ( capture->file == NULL )
+  {
+    printf("Cannot open %s\n", filename);
+    return false;
+  }
+  if ( (fread(&capture->header, sizeof(capture->header), 1, capture->file) != 1) ||
+       memcmp(capture->header.magic, DDI_EM_CAPTURE_MAGIC, sizeof(capture->header.magic)) ||
+       (capture->header.version != DDI_EM_CAPTURE_VERSION) || (capture->header.region_count > DDI_EM_CAPTURE_MAX_REGIONS) ||
+       (fread(capture->regions, sizeof(ddi_em_capture_region), capture->header.region_count, capture->file) != capture->header.region_count) )
+  {
+    printf("%s is not a version %d capture file\n", filename, DDI_EM_CAPTURE_VERSION);
+    return false;
+  }
+  // A record holds its cycle number and timestamp followed by the bytes of every region
+  for ( index = 0; index < capture->header.region_count; index++ )
+  {
+    record_size += capture->regions[index].byte_size;
+  }
+  if ( capture->header.record_size != record_size )
+  {
+    printf("%s has %u byte records, its regions need %" PRIu64 " bytes\n", filename, capture->header.record_size, record_size);
+    return false;
+  }
+
+  fseek(capture->file, 0, SEEK_END);
+  file_size = ftell(capture->file);
+  if ( (file_size >= (long)(capture->header.data_offset + sizeof(ddi_em_capture_footer))) &&
+       (fseek(capture->file, file_size - sizeof(ddi_em_capture_footer), SEEK_SET) == 0) &&
+       (fread(&capture->footer, sizeof(capture->footer), 1, capture->file) == 1) &&
+       !memcmp(capture->footer.magic, DDI_EM_CAPTURE_MAGIC, sizeof(capture->footer.magic)) )
+  {
+    capture->complete = true;
+    capture->record_count = capture->footer.record_count;
+    capture->index = (ddi_em_capture_index *)calloc(capture->footer.index_count + 1, sizeof(ddi_em_capture_index));
+    if ( (capture->index == NULL) || (fseek(capture->file, capture->footer.index_offset, SEEK_SET) != 0) ||
+         (fread(capture->index, sizeof(ddi_em_capture_index), capture->footer.index_count, capture->file) != capture->footer.index_count) )
+    {
+      printf("%s: the capture index is damaged, decoding without it\n", filename);
+      capture->footer.index_count = 0;
+    }
+  }
+  else
+  {
+    // The recording was interrupted, decode the complete records
+    capture->record_count = (file_size - capture->header.data_offset) / capture->header.record_size;
+  }
+  return true;
+}
+
+// Return the first record to decode for a start cycle, the index narrows the search down to one interval
+static uint64_t capture_find_cycle(capture_file *capture, uint64_t first_cycle)
+{
+  ddi_em_capture_record record;
+  uint64_t number = 0, low = 0, high, middle;
+
+  if ( capture->complete && (capture->footer.index_count > 0) )
+  {
+    high = capture->footer.index_count;
+    while ( high - low > 1 )
+    {
+      middle = (low + high) / 2;
+      if ( capture->index[middle].cycle <= first_cycle )
+      {
+        low = middle;
+      }
+      else
+      {
+        high = middle;
+      }
+    }
+    number = (capture->index[low].cycle <= first_cycle) ? capture->index[low].record : 0;
+  }
+  for ( ; number < capture->record_count; number++ )
+  {
+    fseek(capture->file, capture->header.data_offset + number * capture->header.record_size, SEEK_SET);
+    if ( (fread(&record, sizeof(record), 1, capture->file) != 1) || (record.cycle >= first_cycle) )
+    {
+      break;
+    }
+  }
+  return number;
+}
+
+// Print the capture information
+static void capture_print_info(capture_file *capture)
+{
+  uint32_t index;
+
+  printf("Cycle time:    %u us\n", capture->header.cycle_time_us);
+  printf("Decimation:    %u\n", capture->header.decimation);
+  printf("Record size:   %u bytes\n", capture->header.record_size);
+  printf("Records:       %" PRIu64 "%s\n", capture->record_count, capture->complete ? "" : " (interrupted capture)");
+  if ( capture->complete )
+  {
+    printf("Dropped:       %" PRIu64 "\n", capture->footer.dropped_count);
+    printf("Index entries: %" PRIu64 "\n", capture->footer.index_count);
+  }
+  for ( index = 0; index < capture->header.region_count; index++ )
+  {
+    printf("Region %2u:     %-32s %s byte %u, %u bytes\n", index, capture->regions[index].name,
+      capture->regions[index].is_output ? "output" : "input ", capture->regions[index].byte_offset, capture->regions[index].byte_size);
+  }
+}
+
+// Print one region value of a record
+static void capture_print_value(FILE *out, const uint8_t *data, uint32_t size)
+{
+  uint64_t value = 0;
+  uint32_t byte;
+
+  if ( (size == 1) || (size == 2) || (size == 4) || (size == 8) )
+  {
+    for ( byte = 0; byte < size; byte++ )
+    {
+      value |= (uint64_t)data[byte] << (8 * byte);
+    }
+    fprintf(out, ",%" PRIu64, value);
+    return;
+  }
+  fprintf(out, ",0x");
+  for ( byte = 0; byte < size; byte++ )
+  {
+    fprintf(out, "%02x", data[byte]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  capture_file capture;
+  ddi_em_capture_record *record;
+  FILE *out = stdout;
+  uint8_t *buffer, *data;
+  uint64_t first_cycle = 0, max_records = UINT64_MAX, number, decoded = 0;
+  uint32_t index;
+  bool info_only = false;
+  int option;
+
+  while ( (option = getopt(argc, argv, "is:n:h")) != -1 )
+  {
+    switch ( option )
+    {
+      case 'i':
+        info_only = true;
+        break;
+      case 's':
+        first_cycle = strtoull(optarg, NULL, 0);
+        break;
+      case 'n':
+        max_records = strtoull(optarg, NULL, 0);
+        break;
+      default:
+        usage();
+        return -1;
+    }
+  }
+  if ( optind >= argc )
+  {
+    usage();
+    return -1;
+  }
+  if ( !capture_open(&capture, argv[optind]) )
+  {
+    return -1;
+  }
+  if ( info_only )
+  {
+    capture_print_info(&capture);
+    return 0;
+  }
+  if ( optind + 1 < argc )
+  {
+    out = fopen(argv[optind + 1], "w");
+    if ( out == NULL )
+    {
+      printf("Cannot create %s\n", argv[optind + 1]);
+      return -1;
+    }
+  }
+
+  buffer = (uint8_t *)malloc(capture.header.record_size);
+  if ( buffer == NULL )
+  {
+    return -1;
+  }
+  fprintf(out, "cycle,timestamp_ns");
+  for ( index = 0; index < capture.header.region_count; index++ )
+  {
+    if ( capture.regions[index].name[0] )
+    {
+      fprintf(out, ",%.*s", DDI_EM_CAPTURE_NAME_LEN, capture.regions[index].name);
+    }
+    else
+    {
+      fprintf(out, ",%s_%u", capture.regions[index].is_output ? "out" : "in", capture.regions[index].byte_offset);
+    }
+  }
+  fprintf(out, "\n");
+
+  number = capture_find_cycle(&capture, first_cycle);
+  fseek(capture.file, capture.header.data_offset + number * capture.header.record_size, SEEK_SET);
+  record = (ddi_em_capture_record *)buffer;
+  for ( ; (number < capture.record_count) && (decoded < max_records); number++, decoded++ )
+  {
+    if ( fread(buffer, capture.header.record_size, 1, capture.file) != 1 )
+    {
+      break;
+    }
+    fprintf(out, "%" PRIu64 ",%" PRIu64, record->cycle, record->timestamp_ns);
+    data = (uint8_t *)(record + 1);
+    for ( index = 0; index < capture.header.region_count; index++ )
+    {
+      capture_print_value(out, data, capture.regions[index].byte_size);
+      data += capture.regions[index].byte_size;
+    }
+    fprintf(out, "\n");
+  }
+
+  if ( out != stdout )
+  {
+    fclose(out);
+  }
+  fclose(capture.file);
+  free(capture.index);
+  free(buffer);
+  return 0;
+}
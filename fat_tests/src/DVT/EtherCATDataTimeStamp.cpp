@@ -125,6 +125,7 @@ void TimeStamp_IO::cyclic_method (void *arg)
   int count;
   static int toggle_on = 0;
   static uint16_t aout_output_value = 0, dout_output_value = 0, din_input_value = 0;
+  static uint16_t output_values[DDI_FUSION_MAX_MODULES];
 
   // Validate parameters
   if (!arg)
@@ -165,7 +166,8 @@ void TimeStamp_IO::cyclic_method (void *arg)
   {
     // set the dout values according the test pattern
     for(count=0; count < 12; count++)
-      ddi_sdk_fusion_set_dout16(local_fusion_instance, count, dout_output_value);
+      output_values[count] = dout_output_value;
+    ddi_sdk_fusion_set_dout16_all(local_fusion_instance, output_values, 12);
   }
   
   // If there's aouts present then set them all
@@ -173,8 +175,8 @@ void TimeStamp_IO::cyclic_method (void *arg)
   {
     // set the aout values according the test pattern
     for(count=0; count < local_fusion_instance->aout_count; count++)
-      // fusion_instance->aouts[count] = output_value;
-      ddi_sdk_fusion_set_aout(local_fusion_instance, count, aout_output_value);
+      output_values[count] = aout_output_value;
+    ddi_sdk_fusion_set_aout_all(local_fusion_instance, output_values, local_fusion_instance->aout_count);
   }
 }
 
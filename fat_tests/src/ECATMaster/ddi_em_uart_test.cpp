@@ -5,6 +5,8 @@ confidential trade secrets belonging to DDI. Disclosure or release without
 prior written authorization of DDI is prohibited.
 **************************************************************************/
 #include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 #include <termios.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -542,6 +544,421 @@ TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_event_test)
   ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
 }
 
+// Test the UART status mirrored from the process data against a loopback transmit
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_status_test)
+{
+  uint8_t tx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX], rx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t rx_length;
+  uint16_t bytes_avail;
+  uint8_t error_details;
+  ddi_fusion_uart_status status;
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  memset(tx_data, 0xA5, sizeof(tx_data));
+  SetFixtureStatus(ddi_fusion_uart_tx_data(GetFusionUARTHandle(), tx_data, sizeof(tx_data)));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_data failed\n";
+
+  // The status follows the process data, the loop makes no mailbox transfers
+  do
+  {
+    SetFixtureStatus(ddi_fusion_uart_get_status(GetFusionUARTHandle(), &status));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+    ASSERT_LT(status.age_ns, (uint64_t)DDI_FUSION_UART_STATUS_MAX_AGE_MS * 1000000);
+  } while ( status.rx_bytes_avail < sizeof(tx_data) );
+  ASSERT_EQ(0, status.error);
+
+  SetFixtureStatus(ddi_fusion_uart_get_rx_bytes_avail(GetFusionUARTHandle(), &bytes_avail));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_GE(bytes_avail, sizeof(tx_data));
+
+  SetFixtureStatus(ddi_fusion_uart_get_error_status(GetFusionUARTHandle(), &error_details));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_EQ(0, error_details);
+
+  SetFixtureStatus(ddi_fusion_uart_rx_data(GetFusionUARTHandle(), rx_data, &rx_length));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_rx_data failed \n";
+  ASSERT_EQ(0, memcmp(rx_data, tx_data, sizeof(tx_data))) << "UART compare failed\n";
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
+// Frames received by DDIEM_UART_232_loopback_framing_test
+typedef struct {
+  uint32_t frame_count;
+  uint32_t frame_lengths[4];
+  uint8_t  frames[4][32];
+} uart_frame_log;
+
+static void UART_frame_callback(uart_event *event, void *user_data)
+{
+  uart_frame_log *log = (uart_frame_log *)user_data;
+  uint32_t count = __atomic_load_n(&log->frame_count, __ATOMIC_ACQUIRE);
+
+  if ( (event->event == UART_EVENT_FRAME) && (count < 4) && (event->frame_length <= sizeof(log->frames[0])) )
+  {
+    memcpy(log->frames[count], event->frame, event->frame_length);
+    log->frame_lengths[count] = event->frame_length;
+    __atomic_store_n(&log->frame_count, count + 1, __ATOMIC_RELEASE);
+  }
+}
+
+// Test RS-232 loopback test with the received data split into delimited frames by a framed UART handle
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_framing_test)
+{
+  const char tx_data[] = "first\r\nsecond\r\nthird\r\n";
+  const char *expected_frames[] = { "first", "second", "third" };
+  int test_count = 0;
+  uint32_t frame;
+  uart_framing_config framing;
+  uart_frame_log frame_log;
+  ddi_fusion_uart_handle framed_handle;
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  // The framed handle receives the data sent on the fixture handle
+  memset(&framing, 0, sizeof(framing));
+  framing.mode = UART_FRAMING_DELIMITER;
+  framing.delimiter[0] = '\r';
+  framing.delimiter[1] = '\n';
+  framing.delimiter_length = 2;
+  SetFixtureStatus(ddi_fusion_uart_open_framed(GetEtherCATMasterHandle(), GetEtherCATSlaveHandle(), GetEnvironmentPointer()->GetUARTIndex(),
+    (uart_channel)GetEnvironmentPointer()->GetUARTChannel(), 0, &framing, &framed_handle));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_open_framed failed\n";
+  memset(&frame_log, 0, sizeof(frame_log));
+  SetFixtureStatus(ddi_fusion_uart_register_event(framed_handle, UART_frame_callback, &frame_log));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+
+  SetFixtureStatus(ddi_fusion_uart_tx_data(GetFusionUARTHandle(), (uint8_t *)tx_data, strlen(tx_data)));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_data failed\n";
+
+  while ( (__atomic_load_n(&frame_log.frame_count, __ATOMIC_ACQUIRE) < 3) && (test_count++ < 1000) )
+  {
+    usleep(1000);
+  }
+  ASSERT_EQ(3, __atomic_load_n(&frame_log.frame_count, __ATOMIC_ACQUIRE)) << "UART frames not received\n";
+  for ( frame = 0; frame < 3; frame++ )
+  {
+    ASSERT_EQ(strlen(expected_frames[frame]), frame_log.frame_lengths[frame]);
+    ASSERT_EQ(0, memcmp(expected_frames[frame], frame_log.frames[frame], frame_log.frame_lengths[frame])) << "UART frame compare failed\n";
+  }
+
+  SetFixtureStatus(ddi_fusion_uart_close(framed_handle));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
+// Test RS-232 loopback test with two transmits apart in time received in separately timestamped chunks
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_rx_timestamps_test)
+{
+  uint8_t tx_data[] = "firstsecond";
+  uint8_t rx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t rx_length, chunk_count;
+  uint16_t bytes_avail = 0;
+  ddi_fusion_uart_rx_chunk chunks[8];
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  SetFixtureStatus(ddi_fusion_uart_rx_data_timed(GetFusionUARTHandle(), rx_data, &rx_length, chunks, 0, &chunk_count));
+  ASSERT_EQ(DDI_EM_STATUS_INVALID_ARG, GetFixtureStatus()) << "an empty chunk array should be rejected\n";
+
+  // Send "first", then "second" 50 ms later
+  SetFixtureStatus(ddi_fusion_uart_tx_data(GetFusionUARTHandle(), tx_data, 5));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_data failed\n";
+  usleep(50000);
+  SetFixtureStatus(ddi_fusion_uart_tx_data(GetFusionUARTHandle(), &tx_data[5], 6));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_data failed\n";
+
+  while ( bytes_avail < 11 )
+  {
+    SetFixtureStatus(ddi_fusion_uart_get_rx_bytes_avail(GetFusionUARTHandle(), &bytes_avail));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  }
+  // Let the cyclic thread see the last rise
+  usleep(10000);
+  SetFixtureStatus(ddi_fusion_uart_rx_data_timed(GetFusionUARTHandle(), rx_data, &rx_length, chunks, 8, &chunk_count));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_rx_data_timed failed \n";
+  ASSERT_EQ(11, rx_length);
+  ASSERT_EQ(0, memcmp(rx_data, tx_data, 11)) << "UART compare failed\n";
+
+  // The chunks cover the data in order, the second transmit starts a chunk at least 40 ms after the first
+  ASSERT_GE(chunk_count, 2);
+  ASSERT_EQ(0, chunks[0].offset);
+  for ( uint32_t chunk = 0; chunk < chunk_count; chunk++ )
+  {
+    ASSERT_EQ(0, chunks[chunk].flags & (DDI_FUSION_UART_RX_CHUNK_UNTIMED | DDI_FUSION_UART_RX_CHUNK_MERGED));
+    if ( chunk != 0 )
+    {
+      ASSERT_EQ(chunks[chunk - 1].offset + chunks[chunk - 1].length, chunks[chunk].offset);
+      ASSERT_GT(chunks[chunk].cycle, chunks[chunk - 1].cycle);
+      ASSERT_GT(chunks[chunk].timestamp_ns, chunks[chunk - 1].timestamp_ns);
+    }
+    if ( chunks[chunk].offset == 5 )
+    {
+      ASSERT_GE(chunks[chunk].timestamp_ns - chunks[0].timestamp_ns, 40000000ULL) << "the gap between the transmits was not seen\n";
+    }
+    ASSERT_FALSE((chunks[chunk].offset < 5) && (chunks[chunk].offset + chunks[chunk].length > 5)) << "a chunk spans both transmits\n";
+  }
+  ASSERT_EQ(11, chunks[chunk_count - 1].offset + chunks[chunk_count - 1].length);
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
+// Test RS-232 loopback test with the transmit data queued on the UART transmit scheduler
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_tx_scheduler_test)
+{
+  uint8_t tx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX], rx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t rx_length, offset;
+  uint16_t bytes_avail = 0;
+  ddi_fusion_uart_tx_stats stats;
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  SetFixtureStatus(ddi_fusion_uart_tx_queue(GetFusionUARTHandle(), tx_data, sizeof(tx_data)));
+  ASSERT_EQ(DDI_EM_STATUS_NOT_READY, GetFixtureStatus()) << "ddi_fusion_uart_tx_queue without a scheduler should fail\n";
+
+  SetFixtureStatus(ddi_fusion_uart_tx_scheduler_start(GetEtherCATMasterHandle(), 0));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_scheduler_start failed\n";
+  SetFixtureStatus(ddi_fusion_uart_get_tx_stats(GetFusionUARTHandle(), &stats, true));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+
+  // Queue three writes, the scheduler coalesces them into one SDO
+  for ( offset = 0; offset < sizeof(tx_data); offset++ )
+  {
+    tx_data[offset] = offset;
+  }
+  for ( offset = 0; offset < sizeof(tx_data); offset += sizeof(tx_data) / 3 )
+  {
+    SetFixtureStatus(ddi_fusion_uart_tx_queue(GetFusionUARTHandle(), &tx_data[offset], sizeof(tx_data) / 3));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_queue failed\n";
+  }
+  SetFixtureStatus(ddi_fusion_uart_tx_flush_queue(GetFusionUARTHandle(), TEST_DEFAULT_TIMEOUT));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_flush_queue failed\n";
+
+  SetFixtureStatus(ddi_fusion_uart_get_tx_stats(GetFusionUARTHandle(), &stats, false));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_EQ(sizeof(tx_data), stats.bytes_sent);
+  ASSERT_EQ(3, stats.writes_sent);
+  ASSERT_EQ(0, stats.errors);
+  ASSERT_EQ(0, stats.queued_bytes);
+
+  while ( bytes_avail < sizeof(tx_data) )
+  {
+    SetFixtureStatus(ddi_fusion_uart_get_rx_bytes_avail(GetFusionUARTHandle(), &bytes_avail));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  }
+  SetFixtureStatus(ddi_fusion_uart_rx_data(GetFusionUARTHandle(), rx_data, &rx_length));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_rx_data failed \n";
+  ASSERT_EQ(0, memcmp(rx_data, tx_data, sizeof(tx_data))) << "UART compare failed\n";
+
+  SetFixtureStatus(ddi_fusion_uart_tx_scheduler_stop(GetEtherCATMasterHandle()));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_scheduler_stop failed\n";
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
+// Test RS-232 loopback test with the data written to and read from leased UART buffers
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_lease_test)
+{
+  ddi_fusion_uart_buffer tx_buffer, rx_buffer, buffers[DDI_FUSION_UART_LEASE_BUFFERS + 1];
+  uint32_t offset, count;
+  uint16_t bytes_avail = 0;
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  // A handle has DDI_FUSION_UART_LEASE_BUFFERS buffers, a buffer is given back once
+  for ( count = 0; count < DDI_FUSION_UART_LEASE_BUFFERS; count++ )
+  {
+    SetFixtureStatus(ddi_fusion_uart_tx_lease(GetFusionUARTHandle(), &buffers[count]));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_lease failed\n";
+  }
+  SetFixtureStatus(ddi_fusion_uart_tx_lease(GetFusionUARTHandle(), &buffers[count]));
+  ASSERT_EQ(DDI_EM_STATUS_NO_RESOURCES, GetFixtureStatus()) << "more buffers were leased than the handle has\n";
+  for ( count = 0; count < DDI_FUSION_UART_LEASE_BUFFERS; count++ )
+  {
+    SetFixtureStatus(ddi_fusion_uart_release_buffer(GetFusionUARTHandle(), &buffers[count]));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_release_buffer failed\n";
+  }
+  SetFixtureStatus(ddi_fusion_uart_release_buffer(GetFusionUARTHandle(), &buffers[0]));
+  ASSERT_EQ(DDI_EM_STATUS_INVALID_ARG, GetFixtureStatus()) << "a buffer was given back twice\n";
+
+  // Fill a transmit buffer in place and send it
+  SetFixtureStatus(ddi_fusion_uart_tx_lease(GetFusionUARTHandle(), &tx_buffer));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_lease failed\n";
+  for ( offset = 0; offset < DDI_FUSION_UART_SDO_DATA_SIZE_MAX; offset++ )
+  {
+    tx_buffer.data[offset] = offset;
+  }
+  tx_buffer.length = DDI_FUSION_UART_SDO_DATA_SIZE_MAX;
+  SetFixtureStatus(ddi_fusion_uart_tx_commit(GetFusionUARTHandle(), &tx_buffer));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_commit failed\n";
+  SetFixtureStatus(ddi_fusion_uart_tx_commit(GetFusionUARTHandle(), &tx_buffer));
+  ASSERT_EQ(DDI_EM_STATUS_INVALID_ARG, GetFixtureStatus()) << "a committed buffer was sent again\n";
+
+  while ( bytes_avail < DDI_FUSION_UART_SDO_DATA_SIZE_MAX )
+  {
+    SetFixtureStatus(ddi_fusion_uart_get_rx_bytes_avail(GetFusionUARTHandle(), &bytes_avail));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  }
+  SetFixtureStatus(ddi_fusion_uart_rx_borrow(GetFusionUARTHandle(), &rx_buffer));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_rx_borrow failed \n";
+  ASSERT_EQ(DDI_FUSION_UART_SDO_DATA_SIZE_MAX, rx_buffer.length);
+  for ( offset = 0; offset < DDI_FUSION_UART_SDO_DATA_SIZE_MAX; offset++ )
+  {
+    ASSERT_EQ((uint8_t)offset, rx_buffer.data[offset]) << "UART compare failed\n";
+  }
+  SetFixtureStatus(ddi_fusion_uart_release_buffer(GetFusionUARTHandle(), &rx_buffer));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_release_buffer failed\n";
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
+// Test RS-232 loopback test with the receive data signalled on a UART event file descriptor
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_event_fd_test)
+{
+  int test_count = 0, event_fd;
+  uint32_t events;
+  uint8_t tx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX], rx_data[DDI_FUSION_UART_SDO_DATA_SIZE_MAX];
+  uint32_t rx_length;
+  struct pollfd poll_fd;
+  DDIEMUtility m_ddi_em_utility;
+  uart_pd_callback_args       pd_callback_args;
+
+  pd_callback_args.em_handle = GetEtherCATMasterHandle();
+  pd_callback_args.es_cfg = GetEtherCATSlaveConfigPointer();
+
+  // Register the cyclic callback
+  SetFixtureStatus(ddi_em_register_cyclic_callback(GetEtherCATMasterHandle(), m_ddi_em_utility.UART_cyclic_function, &pd_callback_args));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_register_cyclic_callback has failed\n";
+
+  // set the EtherCAT Master State to OP mode
+  SetFixtureStatus(ddi_em_set_master_state(GetEtherCATMasterHandle(), DDI_EM_STATE_OP, TEST_DEFAULT_TIMEOUT));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_em_set_master_state failed.\n";
+
+  SetFixtureStatus(ddi_fusion_uart_channel_flush(GetFusionUARTHandle()));
+  EXPECT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "channel flush failed\n";
+
+  // Signal the fd once a whole transmit has looped back
+  SetFixtureStatus(ddi_fusion_uart_enable_event_fd(GetFusionUARTHandle(), UART_FD_EVENT_RX_THRESHOLD | UART_FD_EVENT_ERROR, sizeof(tx_data), &event_fd));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "uart enable event fd failed\n";
+  poll_fd.fd = event_fd;
+  poll_fd.events = POLLIN;
+
+  memset(tx_data, 0x5A, sizeof(tx_data));
+  while ( test_count++ < 10 )
+  {
+    SetFixtureStatus(ddi_fusion_uart_tx_data(GetFusionUARTHandle(), tx_data, sizeof(tx_data)));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_tx_data failed\n";
+
+    // Wait on the fd instead of polling the Rx bytes available
+    ASSERT_EQ(1, poll(&poll_fd, 1, 1000)) << "no UART event signalled\n";
+    SetFixtureStatus(ddi_fusion_uart_get_fd_events(GetFusionUARTHandle(), &events));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+    ASSERT_EQ((uint32_t)UART_FD_EVENT_RX_THRESHOLD, events);
+
+    SetFixtureStatus(ddi_fusion_uart_rx_data(GetFusionUARTHandle(), rx_data, &rx_length));
+    ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus()) << "ddi_fusion_uart_rx_data failed \n";
+    ASSERT_EQ(0, memcmp(rx_data, tx_data, sizeof(tx_data))) << "UART compare failed\n";
+  }
+
+  // The fd is quiet once the data is read
+  ASSERT_EQ(0, poll(&poll_fd, 1, 100));
+
+  SetFixtureStatus(ddi_fusion_uart_disable_event_fd(GetFusionUARTHandle()));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+
+  // Stop the cylcic thread started by ddi_em_cyclic_task_start()
+  SetFixtureStatus(ddi_em_cyclic_task_stop(GetEtherCATMasterHandle()));
+  // ddi_em_cyclic_task_stop returns 0 if successful
+  ASSERT_EQ(GetFixtureStatus(), DDI_EM_STATUS_OK);
+}
+
 TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_event_test2)
 {
   uint callback_count;
@@ -789,6 +1206,49 @@ TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_param_set_get_interface_test)
   }
 }
 
+TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_param_apply_read_config_test)
+{
+  uart_channel_config config, read_back;
+  uart_baud baud;
+  ddi_em_result channel_result;
+  ddi_fusion_uart_handle handle = GetFusionUARTHandle();
+
+  config.interface    = UART_INTERFACE_RS232;
+  config.baud         = UART_BAUD_57600;
+  config.parity       = UART_PARITY_EVEN;
+  config.data_bits    = UART_DATA_BITS_8;
+  config.stop_bits    = UART_STOP_BITS_2;
+  config.flow_control = UART_FLOW_CONTROL_RTS_CTS;
+
+  // Write the whole channel configuration in one transfer
+  SetFixtureStatus(ddi_fusion_uart_apply_config(handle, &config));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+
+  SetFixtureStatus(ddi_fusion_uart_read_config(handle, &read_back));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_EQ(0, memcmp(&config, &read_back, sizeof(config)));
+
+  // The single setting getters see the same configuration
+  SetFixtureStatus(ddi_fusion_uart_get_baud(handle, &baud));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_EQ(config.baud, baud);
+
+  // An invalid setting fails that channel without a transfer
+  config.baud = (uart_baud)(UART_BAUD_115200 + 1);
+  SetFixtureStatus(ddi_fusion_uart_apply_config_list(&handle, &config, 1, &channel_result));
+  ASSERT_EQ(DDI_EM_STATUS_INVALID_ARG, GetFixtureStatus());
+  ASSERT_EQ(DDI_EM_STATUS_INVALID_ARG, channel_result);
+
+  // Leave the channel at 115200 8-N-1 without flow control
+  config.baud         = UART_BAUD_115200;
+  config.parity       = UART_PARITY_NONE;
+  config.stop_bits    = UART_STOP_BITS_1;
+  config.flow_control = UART_FLOW_CONTROL_OFF;
+  SetFixtureStatus(ddi_fusion_uart_apply_config_list(&handle, &config, 1, &channel_result));
+  ASSERT_EQ(DDI_EM_STATUS_OK, GetFixtureStatus());
+  ASSERT_EQ(DDI_EM_STATUS_OK, channel_result);
+}
+
 TEST_F(ddi_fusion_uart_test_fixture, DDIEM_UART_232_loopback_all_params)
 {
   bool data_7;